@@ -0,0 +1,162 @@
+#include "BookCacheKey.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace BookCacheKey {
+
+namespace {
+constexpr char INDEX_FILE_NAME[] = "/keys.bin";
+constexpr uint32_t INDEX_MAGIC = 0x494B4342;  // "BCKI"
+constexpr uint8_t INDEX_VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+// Paths remembered, a path shares its slot with every path of the same hash modulo SLOT_COUNT
+constexpr size_t SLOT_COUNT = 256;
+// Bytes hashed at each end of the book
+constexpr size_t FINGERPRINT_BLOCK = 4096;
+constexpr size_t IO_CHUNK = 512;
+
+#pragma pack(push, 1)
+struct Slot {
+  uint32_t pathHash;
+  uint32_t size;
+  uint32_t modified;  // FAT date << 16 | FAT time
+  uint32_t key;
+};
+#pragma pack(pop)
+
+uint32_t hashPath(const std::string& path) { return static_cast<uint32_t>(std::hash<std::string>{}(path)); }
+
+// Opens the index for reading and writing, starting an empty one if it is missing or from another version
+bool openIndex(FsFile& file, const std::string& cacheDir) {
+  SdMan.mkdir(cacheDir.c_str());
+  const std::string indexPath = cacheDir + INDEX_FILE_NAME;
+  file = SdMan.open(indexPath.c_str(), O_RDWR | O_CREAT);
+  if (!file) {
+    Serial.printf("[%lu] [BCK] Failed to open %s\n", millis(), indexPath.c_str());
+    return false;
+  }
+
+  uint8_t header[HEADER_SIZE] = {};
+  if (file.size() == HEADER_SIZE + SLOT_COUNT * sizeof(Slot) && file.read(header, HEADER_SIZE) == HEADER_SIZE) {
+    uint32_t magic;
+    memcpy(&magic, header, sizeof(magic));
+    if (magic == INDEX_MAGIC && header[4] == INDEX_VERSION) {
+      return true;
+    }
+  }
+
+  // All slots are written up front so that any of them can be updated in place
+  Serial.printf("[%lu] [BCK] Starting a new cache key index\n", millis());
+  memset(header, 0, sizeof(header));
+  memcpy(header, &INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header[4] = INDEX_VERSION;
+  bool ok = file.truncate(0) && file.seek(0) && file.write(header, HEADER_SIZE) == HEADER_SIZE;
+  uint8_t zeros[IO_CHUNK] = {};
+  for (size_t left = SLOT_COUNT * sizeof(Slot); ok && left > 0;) {
+    const size_t n = std::min(left, sizeof(zeros));
+    ok = file.write(zeros, n) == n;
+    left -= n;
+  }
+  if (!ok) {
+    Serial.printf("[%lu] [BCK] Failed to initialise %s\n", millis(), indexPath.c_str());
+    file.close();
+  }
+  return ok;
+}
+
+bool hashRange(FsFile& file, const uint32_t offset, size_t length, uint32_t& crc) {
+  uint8_t buffer[IO_CHUNK];
+  if (!file.seek(offset)) {
+    return false;
+  }
+  while (length > 0) {
+    const size_t n = std::min(length, sizeof(buffer));
+    if (file.read(buffer, n) != static_cast<int>(n)) {
+      return false;
+    }
+    crc = mz_crc32(crc, buffer, n);
+    length -= n;
+  }
+  return true;
+}
+
+bool fingerprint(FsFile& book, const uint32_t size, uint32_t& key) {
+  key = mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+  const uint32_t headLength = std::min<uint32_t>(size, FINGERPRINT_BLOCK);
+  const uint32_t tailStart = std::max<uint32_t>(headLength, size > FINGERPRINT_BLOCK ? size - FINGERPRINT_BLOCK : 0);
+  return hashRange(book, 0, headLength, key) && hashRange(book, tailStart, size - tailStart, key);
+}
+
+bool keyFor(const std::string& bookPath, const std::string& cacheDir, uint32_t& key) {
+  FsFile book;
+  if (!SdMan.openFileForRead("BCK", bookPath, book)) {
+    return false;
+  }
+  uint16_t date = 0;
+  uint16_t time = 0;
+  book.getModifyDateTime(&date, &time);
+  Slot wanted = {hashPath(bookPath), static_cast<uint32_t>(book.size()), static_cast<uint32_t>(date) << 16 | time, 0};
+
+  FsFile index;
+  const size_t slotOffset = HEADER_SIZE + (wanted.pathHash % SLOT_COUNT) * sizeof(Slot);
+  if (openIndex(index, cacheDir)) {
+    Slot slot;
+    if (index.seek(slotOffset) && index.read(reinterpret_cast<uint8_t*>(&slot), sizeof(slot)) == sizeof(slot) &&
+        slot.pathHash == wanted.pathHash && slot.size == wanted.size && slot.modified == wanted.modified) {
+      key = slot.key;
+      index.close();
+      book.close();
+      return true;
+    }
+  }
+
+  const unsigned long start = millis();
+  const bool ok = fingerprint(book, wanted.size, wanted.key);
+  book.close();
+  if (ok && index) {
+    if (!index.seek(slotOffset) ||
+        index.write(reinterpret_cast<const uint8_t*>(&wanted), sizeof(wanted)) != sizeof(wanted)) {
+      Serial.printf("[%lu] [BCK] Failed to remember the key of %s\n", millis(), bookPath.c_str());
+    }
+  }
+  if (index) {
+    index.close();
+  }
+  if (!ok) {
+    Serial.printf("[%lu] [BCK] Failed to read %s\n", millis(), bookPath.c_str());
+    return false;
+  }
+
+  key = wanted.key;
+  Serial.printf("[%lu] [BCK] Cache key of %s is %lu (%lu ms)\n", millis(), bookPath.c_str(), key, millis() - start);
+  return true;
+}
+}  // namespace
+
+std::string cachePath(const std::string& bookPath, const std::string& cacheDir, const char* prefix) {
+  const std::string pathKeyed = cacheDir + "/" + prefix + std::to_string(std::hash<std::string>{}(bookPath));
+  uint32_t key;
+  if (!keyFor(bookPath, cacheDir, key)) {
+    return pathKeyed;
+  }
+
+  std::string contentKeyed = cacheDir + "/" + prefix + std::to_string(key);
+  if (contentKeyed != pathKeyed && !SdMan.exists(contentKeyed.c_str()) && SdMan.exists(pathKeyed.c_str())) {
+    auto dir = SdMan.open(pathKeyed.c_str());
+    if (dir && dir.rename(contentKeyed.c_str())) {
+      Serial.printf("[%lu] [BCK] Moved cache %s to %s\n", millis(), pathKeyed.c_str(), contentKeyed.c_str());
+    }
+    if (dir) {
+      dir.close();
+    }
+  }
+  return contentKeyed;
+}
+
+}  // namespace BookCacheKey
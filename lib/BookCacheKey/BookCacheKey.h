@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+
+/**
+ * Names book cache directories by the book's content instead of its path, so renaming or moving a book keeps its
+ * cache.
+ *
+ * The key is a CRC-32 over the file size and its first and last 4 KB. For an EPUB those hold the first entries and
+ * the end of the ZIP central directory with the CRCs of the entries, for an XTC the header and the last pages.
+ * Hashing them costs two small reads, and <cacheDir>/keys.bin remembers the key of each path together with the size
+ * and modification time it was computed for, so opening a known book only reads one 16-byte slot.
+ */
+namespace BookCacheKey {
+
+// Returns <cacheDir>/<prefix><key>. Caches named by the hash of the path, from before content keys, are renamed on
+// first use. Falls back to the path hash if the book cannot be read.
+std::string cachePath(const std::string& bookPath, const std::string& cacheDir, const char* prefix);
+
+}  // namespace BookCacheKey
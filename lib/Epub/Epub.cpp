@@ -1,5 +1,6 @@
 #include "Epub.h"
 
+#include <BookCacheKey.h>
 #include <FsHelpers.h>
 #include <HardwareSerial.h>
 #include <JpegToBmpConverter.h>
@@ -98,50 +99,25 @@ bool Epub::parseTocNcxFile() const {
 
   Serial.printf("[%lu] [EBP] Parsing toc ncx file: %s\n", millis(), tocNcxItem.c_str());
 
-  const auto tmpNcxPath = getCachePath() + "/toc.ncx";
-  FsFile tempNcxFile;
-  if (!SdMan.openFileForWrite("EBP", tmpNcxPath, tempNcxFile)) {
+  size_t ncxSize;
+  if (!getItemSize(tocNcxItem, &ncxSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc ncx\n", millis());
     return false;
   }
-  readItemContentsToStream(tocNcxItem, tempNcxFile, 1024);
-  tempNcxFile.close();
-  if (!SdMan.openFileForRead("EBP", tmpNcxPath, tempNcxFile)) {
-    return false;
-  }
-  const auto ncxSize = tempNcxFile.size();
 
   TocNcxParser ncxParser(contentBasePath, ncxSize, bookMetadataCache.get());
 
   if (!ncxParser.setup()) {
     Serial.printf("[%lu] [EBP] Could not setup toc ncx parser\n", millis());
-    tempNcxFile.close();
     return false;
   }
 
-  const auto ncxBuffer = static_cast<uint8_t*>(malloc(1024));
-  if (!ncxBuffer) {
-    Serial.printf("[%lu] [EBP] Could not allocate memory for toc ncx parser\n", millis());
-    tempNcxFile.close();
+  // Inflate straight into the parser, like content.opf
+  if (!readItemContentsToStream(tocNcxItem, ncxParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not process all toc ncx data\n", millis());
     return false;
   }
 
-  while (tempNcxFile.available()) {
-    const auto readSize = tempNcxFile.read(ncxBuffer, 1024);
-    if (readSize == 0) break;
-    const auto processedSize = ncxParser.write(ncxBuffer, readSize);
-
-    if (processedSize != readSize) {
-      Serial.printf("[%lu] [EBP] Could not process all toc ncx data\n", millis());
-      free(ncxBuffer);
-      tempNcxFile.close();
-      return false;
-    }
-  }
-
-  free(ncxBuffer);
-  tempNcxFile.close();
-  SdMan.remove(tmpNcxPath.c_str());
-
   Serial.printf("[%lu] [EBP] Parsed TOC items\n", millis());
   return true;
 }
@@ -155,17 +131,11 @@ bool Epub::parseTocNavFile() const {
 
   Serial.printf("[%lu] [EBP] Parsing toc nav file: %s\n", millis(), tocNavItem.c_str());
 
-  const auto tmpNavPath = getCachePath() + "/toc.nav";
-  FsFile tempNavFile;
-  if (!SdMan.openFileForWrite("EBP", tmpNavPath, tempNavFile)) {
+  size_t navSize;
+  if (!getItemSize(tocNavItem, &navSize)) {
+    Serial.printf("[%lu] [EBP] Could not get size of toc nav\n", millis());
     return false;
   }
-  readItemContentsToStream(tocNavItem, tempNavFile, 1024);
-  tempNavFile.close();
-  if (!SdMan.openFileForRead("EBP", tmpNavPath, tempNavFile)) {
-    return false;
-  }
-  const auto navSize = tempNavFile.size();
 
   TocNavParser navParser(contentBasePath, navSize, bookMetadataCache.get());
 
@@ -174,28 +144,12 @@ bool Epub::parseTocNavFile() const {
     return false;
   }
 
-  const auto navBuffer = static_cast<uint8_t*>(malloc(1024));
-  if (!navBuffer) {
-    Serial.printf("[%lu] [EBP] Could not allocate memory for toc nav parser\n", millis());
+  // Inflate straight into the parser, like content.opf
+  if (!readItemContentsToStream(tocNavItem, navParser, 1024)) {
+    Serial.printf("[%lu] [EBP] Could not process all toc nav data\n", millis());
     return false;
   }
 
-  while (tempNavFile.available()) {
-    const auto readSize = tempNavFile.read(navBuffer, 1024);
-    const auto processedSize = navParser.write(navBuffer, readSize);
-
-    if (processedSize != readSize) {
-      Serial.printf("[%lu] [EBP] Could not process all toc nav data\n", millis());
-      free(navBuffer);
-      tempNavFile.close();
-      return false;
-    }
-  }
-
-  free(navBuffer);
-  tempNavFile.close();
-  SdMan.remove(tmpNavPath.c_str());
-
   Serial.printf("[%lu] [EBP] Parsed TOC nav items\n", millis());
   return true;
 }
@@ -205,7 +159,7 @@ bool Epub::load(const bool buildIfMissing) {
   Serial.printf("[%lu] [EBP] Loading ePub: %s\n", millis(), filepath.c_str());
 
   // Initialize spine/TOC cache
-  bookMetadataCache.reset(new BookMetadataCache(cachePath));
+  bookMetadataCache.reset(new BookMetadataCache(getCachePath()));
 
   // Try to load existing cache first
   if (bookMetadataCache->load()) {
@@ -228,49 +182,78 @@ bool Epub::load(const bool buildIfMissing) {
     return false;
   }
 
-  // OPF Pass
-  BookMetadataCache::BookMetadata bookMetadata;
-  if (!bookMetadataCache->beginContentOpfPass()) {
-    Serial.printf("[%lu] [EBP] Could not begin writing content.opf pass\n", millis());
-    return false;
-  }
-  if (!parseContentOpf(bookMetadata)) {
-    Serial.printf("[%lu] [EBP] Could not parse content.opf\n", millis());
-    return false;
+  // A build cut short by a reset or power loss continues after the last pass it finished
+  BookMetadataCache::BuildJournal journal;
+  if (bookMetadataCache->loadJournal(journal)) {
+    Serial.printf("[%lu] [EBP] Resuming interrupted build, %s already done\n", millis(),
+                  journal.phase == BookMetadataCache::BuildJournal::TOC_DONE ? "content.opf and TOC passes"
+                                                                             : "content.opf pass");
+    contentBasePath = journal.contentBasePath;
+    tocNcxItem = journal.tocNcxItem;
+    tocNavItem = journal.tocNavItem;
   }
-  if (!bookMetadataCache->endContentOpfPass()) {
-    Serial.printf("[%lu] [EBP] Could not end writing content.opf pass\n", millis());
-    return false;
+
+  // OPF Pass
+  if (journal.phase < BookMetadataCache::BuildJournal::CONTENT_OPF_DONE) {
+    const auto passStart = millis();
+    if (!bookMetadataCache->beginContentOpfPass()) {
+      Serial.printf("[%lu] [EBP] Could not begin writing content.opf pass\n", millis());
+      return false;
+    }
+    if (!parseContentOpf(journal.metadata)) {
+      Serial.printf("[%lu] [EBP] Could not parse content.opf\n", millis());
+      return false;
+    }
+    if (!bookMetadataCache->endContentOpfPass()) {
+      Serial.printf("[%lu] [EBP] Could not end writing content.opf pass\n", millis());
+      return false;
+    }
+    journal.phase = BookMetadataCache::BuildJournal::CONTENT_OPF_DONE;
+    journal.contentBasePath = contentBasePath;
+    journal.tocNcxItem = tocNcxItem;
+    journal.tocNavItem = tocNavItem;
+    if (!bookMetadataCache->saveJournal(journal)) {
+      Serial.printf("[%lu] [EBP] Could not save build journal - ignoring\n", millis());
+    }
+    Serial.printf("[%lu] [EBP] content.opf pass took %lu ms\n", millis(), millis() - passStart);
   }
 
   // TOC Pass - try EPUB 3 nav first, fall back to NCX
-  if (!bookMetadataCache->beginTocPass()) {
-    Serial.printf("[%lu] [EBP] Could not begin writing toc pass\n", millis());
-    return false;
-  }
+  if (journal.phase < BookMetadataCache::BuildJournal::TOC_DONE) {
+    const auto passStart = millis();
+    if (!bookMetadataCache->beginTocPass()) {
+      Serial.printf("[%lu] [EBP] Could not begin writing toc pass\n", millis());
+      return false;
+    }
 
-  bool tocParsed = false;
+    bool tocParsed = false;
 
-  // Try EPUB 3 nav document first (preferred)
-  if (!tocNavItem.empty()) {
-    Serial.printf("[%lu] [EBP] Attempting to parse EPUB 3 nav document\n", millis());
-    tocParsed = parseTocNavFile();
-  }
+    // Try EPUB 3 nav document first (preferred)
+    if (!tocNavItem.empty()) {
+      Serial.printf("[%lu] [EBP] Attempting to parse EPUB 3 nav document\n", millis());
+      tocParsed = parseTocNavFile();
+    }
 
-  // Fall back to NCX if nav parsing failed or wasn't available
-  if (!tocParsed && !tocNcxItem.empty()) {
-    Serial.printf("[%lu] [EBP] Falling back to NCX TOC\n", millis());
-    tocParsed = parseTocNcxFile();
-  }
+    // Fall back to NCX if nav parsing failed or wasn't available
+    if (!tocParsed && !tocNcxItem.empty()) {
+      Serial.printf("[%lu] [EBP] Falling back to NCX TOC\n", millis());
+      tocParsed = parseTocNcxFile();
+    }
 
-  if (!tocParsed) {
-    Serial.printf("[%lu] [EBP] Warning: Could not parse any TOC format\n", millis());
-    // Continue anyway - book will work without TOC
-  }
+    if (!tocParsed) {
+      Serial.printf("[%lu] [EBP] Warning: Could not parse any TOC format\n", millis());
+      // Continue anyway - book will work without TOC
+    }
 
-  if (!bookMetadataCache->endTocPass()) {
-    Serial.printf("[%lu] [EBP] Could not end writing toc pass\n", millis());
-    return false;
+    if (!bookMetadataCache->endTocPass()) {
+      Serial.printf("[%lu] [EBP] Could not end writing toc pass\n", millis());
+      return false;
+    }
+    journal.phase = BookMetadataCache::BuildJournal::TOC_DONE;
+    if (!bookMetadataCache->saveJournal(journal)) {
+      Serial.printf("[%lu] [EBP] Could not save build journal - ignoring\n", millis());
+    }
+    Serial.printf("[%lu] [EBP] TOC pass took %lu ms\n", millis(), millis() - passStart);
   }
 
   // Close the cache files
@@ -280,7 +263,7 @@ bool Epub::load(const bool buildIfMissing) {
   }
 
   // Build final book.bin
-  if (!bookMetadataCache->buildBookBin(filepath, bookMetadata)) {
+  if (!bookMetadataCache->buildBookBin(filepath, journal.metadata)) {
     Serial.printf("[%lu] [EBP] Could not update mappings and sizes\n", millis());
     return false;
   }
@@ -290,7 +273,7 @@ bool Epub::load(const bool buildIfMissing) {
   }
 
   // Reload the cache from disk so it's in the correct state
-  bookMetadataCache.reset(new BookMetadataCache(cachePath));
+  bookMetadataCache.reset(new BookMetadataCache(getCachePath()));
   if (!bookMetadataCache->load()) {
     Serial.printf("[%lu] [EBP] Failed to reload cache after writing\n", millis());
     return false;
@@ -301,12 +284,12 @@ bool Epub::load(const bool buildIfMissing) {
 }
 
 bool Epub::clearCache() const {
-  if (!SdMan.exists(cachePath.c_str())) {
+  if (!SdMan.exists(getCachePath().c_str())) {
     Serial.printf("[%lu] [EPB] Cache does not exist, no action needed\n", millis());
     return true;
   }
 
-  if (!SdMan.removeDir(cachePath.c_str())) {
+  if (!SdMan.removeDir(getCachePath().c_str())) {
     Serial.printf("[%lu] [EPB] Failed to clear cache\n", millis());
     return false;
   }
@@ -316,14 +299,19 @@ bool Epub::clearCache() const {
 }
 
 void Epub::setupCacheDir() const {
-  if (SdMan.exists(cachePath.c_str())) {
+  if (SdMan.exists(getCachePath().c_str())) {
     return;
   }
 
-  SdMan.mkdir(cachePath.c_str());
+  SdMan.mkdir(getCachePath().c_str());
 }
 
-const std::string& Epub::getCachePath() const { return cachePath; }
+const std::string& Epub::getCachePath() const {
+  if (cachePath.empty()) {
+    cachePath = BookCacheKey::cachePath(filepath, cacheDir, "epub_");
+  }
+  return cachePath;
+}
 
 const std::string& Epub::getPath() const { return filepath; }
 
@@ -345,9 +333,9 @@ const std::string& Epub::getAuthor() const {
   return bookMetadataCache->coreMetadata.author;
 }
 
-std::string Epub::getCoverBmpPath() const { return cachePath + "/cover.bmp"; }
+std::string Epub::getCoverBmpPath() const { return getCachePath() + "/cover.bmp"; }
 
-bool Epub::generateCoverBmp() const {
+bool Epub::generateCoverBmp(const std::function<bool()>& yieldFn) const {
   // Already generated, return true
   if (SdMan.exists(getCoverBmpPath().c_str())) {
     return true;
@@ -367,28 +355,20 @@ bool Epub::generateCoverBmp() const {
   if (coverImageHref.substr(coverImageHref.length() - 4) == ".jpg" ||
       coverImageHref.substr(coverImageHref.length() - 5) == ".jpeg") {
     Serial.printf("[%lu] [EBP] Generating BMP from JPG cover image\n", millis());
-    const auto coverJpgTempPath = getCachePath() + "/.cover.jpg";
-
-    FsFile coverJpg;
-    if (!SdMan.openFileForWrite("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverJpg, 1024);
-    coverJpg.close();
-
-    if (!SdMan.openFileForRead("EBP", coverJpgTempPath, coverJpg)) {
+    // Decode straight from the zip rather than extracting the JPEG to the card first
+    ZipFile zip(filepath);
+    ZipFile::ItemReader coverJpg(zip);
+    if (!coverJpg.open(FsHelpers::normalisePath(coverImageHref).c_str(), 1024)) {
+      Serial.printf("[%lu] [EBP] Could not open cover image in zip\n", millis());
       return false;
     }
 
     FsFile coverBmp;
     if (!SdMan.openFileForWrite("EBP", getCoverBmpPath(), coverBmp)) {
-      coverJpg.close();
       return false;
     }
-    const bool success = JpegToBmpConverter::jpegFileToBmpStream(coverJpg, coverBmp);
-    coverJpg.close();
+    const bool success = JpegToBmpConverter::jpegZipItemToBmpStream(coverJpg, coverBmp, yieldFn);
     coverBmp.close();
-    SdMan.remove(coverJpgTempPath.c_str());
 
     if (!success) {
       Serial.printf("[%lu] [EBP] Failed to generate BMP from JPG cover image\n", millis());
@@ -472,6 +452,17 @@ BookMetadataCache::TocEntry Epub::getTocItem(const int tocIndex) const {
   return bookMetadataCache->getTocEntry(tocIndex);
 }
 
+int Epub::getTocItems(const int startTocIndex, const int count,
+                      std::vector<BookMetadataCache::TocEntry>& items) const {
+  if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
+    Serial.printf("[%lu] [EBP] getTocItems called but cache not loaded\n", millis());
+    items.clear();
+    return 0;
+  }
+
+  return bookMetadataCache->getTocEntries(startTocIndex, count, items);
+}
+
 int Epub::getTocItemsCount() const {
   if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
     return 0;
@@ -503,6 +494,15 @@ int Epub::getSpineIndexForTocIndex(const int tocIndex) const {
 
 int Epub::getTocIndexForSpineIndex(const int spineIndex) const { return getSpineItem(spineIndex).tocIndex; }
 
+int Epub::getSpineIndexForHref(const std::string& href) const {
+  if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
+    Serial.printf("[%lu] [EBP] getSpineIndexForHref called but cache not loaded\n", millis());
+    return -1;
+  }
+
+  return bookMetadataCache->findSpineIndex(href);
+}
+
 size_t Epub::getBookSize() const {
   if (!bookMetadataCache || !bookMetadataCache->isLoaded() || bookMetadataCache->getSpineCount() == 0) {
     return 0;
@@ -526,17 +526,14 @@ int Epub::getSpineIndexForTextReference() const {
     return 0;
   }
 
-  // loop through spine items to get the correct index matching the text href
-  for (size_t i = 0; i < getSpineItemsCount(); i++) {
-    if (getSpineItem(i).href == bookMetadataCache->coreMetadata.textReferenceHref) {
-      Serial.printf("[%lu] [ERS] Text reference %s found at index %d\n", millis(),
-                    bookMetadataCache->coreMetadata.textReferenceHref.c_str(), i);
-      return i;
-    }
+  const int spineIndex = bookMetadataCache->findSpineIndex(bookMetadataCache->coreMetadata.textReferenceHref);
+  if (spineIndex < 0) {
+    Serial.printf("[%lu] [EBP] Section not found for text reference\n", millis());
+    return 0;
   }
-  // This should not happen, as we checked for empty textReferenceHref earlier
-  Serial.printf("[%lu] [EBP] Section not found for text reference\n", millis());
-  return 0;
+  Serial.printf("[%lu] [ERS] Text reference %s found at index %d\n", millis(),
+                bookMetadataCache->coreMetadata.textReferenceHref.c_str(), spineIndex);
+  return spineIndex;
 }
 
 // Calculate progress in book
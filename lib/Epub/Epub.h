@@ -2,6 +2,7 @@
 
 #include <Print.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -20,8 +21,10 @@ class Epub {
   std::string filepath;
   // the base path for items in the EPUB file
   std::string contentBasePath;
-  // Uniq cache key based on filepath
-  std::string cachePath;
+  std::string cacheDir;
+  // Cache directory named by the file's content, so it survives renames and moves. Resolved by the first
+  // getCachePath(), as it reads the book (and keys.bin) from the SD card.
+  mutable std::string cachePath;
   // Spine and TOC cache
   std::unique_ptr<BookMetadataCache> bookMetadataCache;
 
@@ -31,10 +34,8 @@ class Epub {
   bool parseTocNavFile() const;
 
  public:
-  explicit Epub(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)) {
-    // create a cache key based on the filepath
-    cachePath = cacheDir + "/epub_" + std::to_string(std::hash<std::string>{}(this->filepath));
-  }
+  explicit Epub(std::string filepath, std::string cacheDir)
+      : filepath(std::move(filepath)), cacheDir(std::move(cacheDir)) {}
   ~Epub() = default;
   std::string& getBasePath() { return contentBasePath; }
   bool load(bool buildIfMissing = true);
@@ -45,17 +46,21 @@ class Epub {
   const std::string& getTitle() const;
   const std::string& getAuthor() const;
   std::string getCoverBmpPath() const;
-  bool generateCoverBmp() const;
+  // yieldFn is called while the cover is decoded, return false to abort
+  bool generateCoverBmp(const std::function<bool()>& yieldFn = nullptr) const;
   uint8_t* readItemContentsToBytes(const std::string& itemHref, size_t* size = nullptr,
                                    bool trailingNullByte = false) const;
   bool readItemContentsToStream(const std::string& itemHref, Print& out, size_t chunkSize) const;
   bool getItemSize(const std::string& itemHref, size_t* size) const;
   BookMetadataCache::SpineEntry getSpineItem(int spineIndex) const;
   BookMetadataCache::TocEntry getTocItem(int tocIndex) const;
+  int getTocItems(int startTocIndex, int count, std::vector<BookMetadataCache::TocEntry>& items) const;
   int getSpineItemsCount() const;
   int getTocItemsCount() const;
   int getSpineIndexForTocIndex(int tocIndex) const;
   int getTocIndexForSpineIndex(int spineIndex) const;
+  // Spine index of a link target such as "OEBPS/text/ch1.xhtml#note3", -1 if it is not in the spine
+  int getSpineIndexForHref(const std::string& href) const;
   size_t getCumulativeSpineItemSize(int spineIndex) const;
   int getSpineIndexForTextReference() const;
 
@@ -1,18 +1,128 @@
 #include "BookMetadataCache.h"
 
+#include <Arduino.h>
 #include <HardwareSerial.h>
 #include <Serialization.h>
 #include <ZipFile.h>
+#include <miniz.h>
 
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <sstream>
 #include <vector>
 
 #include "FsHelpers.h"
 
 namespace {
-constexpr uint8_t BOOK_CACHE_VERSION = 3;
+constexpr uint8_t BOOK_CACHE_VERSION = 4;
 constexpr char bookBinFile[] = "/book.bin";
 constexpr char tmpSpineBinFile[] = "/spine.bin.tmp";
 constexpr char tmpTocBinFile[] = "/toc.bin.tmp";
+constexpr char journalFile[] = "/build.journal";
+// Href hashes sorted on the card when they do not fit in the heap, and the other half of each merge pass
+constexpr char tmpHrefsBinFile[] = "/hrefs.bin.tmp";
+constexpr char tmpHrefsMergeBinFile[] = "/hrefs.merge.tmp";
+constexpr uint8_t JOURNAL_VERSION = 1;
+// Journals only hold counts, checksums and a few strings
+constexpr size_t MAX_JOURNAL_SIZE = 4096;
+// Href index record in book.bin: hash, then spine index
+constexpr uint32_t HREF_INDEX_ENTRY_SIZE = sizeof(uint32_t) + sizeof(uint16_t);
+// Largest free block that must be left after the href hashes are allocated, for the ZIP central directory and the
+// parsers
+constexpr size_t MIN_HEAP_LEFT_BY_HREF_HASHES = 32 * 1024;
+// Smallest buffer of a build with too little heap for all the href hashes, taken even below
+// MIN_HEAP_LEFT_BY_HREF_HASHES
+constexpr size_t MIN_LOW_HEAP_BUFFER_SIZE = 1536;
+
+// Orders of the href hashes: by hash for lookups and the href index, by spine index to reach an item directly
+constexpr auto byHash = [](const auto& a, const auto& b) {
+  return a.hash < b.hash || (a.hash == b.hash && a.spineIndex < b.spineIndex);
+};
+constexpr auto bySpineIndex = [](const auto& a, const auto& b) { return a.spineIndex < b.spineIndex; };
+
+// FNV-1a of the href up to any '#'
+uint32_t hrefHash(const std::string& href) {
+  uint32_t hash = 2166136261u;
+  for (const char c : href) {
+    if (c == '#') {
+      break;
+    }
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+// Records of the given size to buffer when the href hashes do not all fit: whatever the heap holds beyond
+// MIN_HEAP_LEFT_BY_HREF_HASHES, at least MIN_LOW_HEAP_BUFFER_SIZE bytes and at most count records
+size_t lowHeapRecords(const size_t recordSize, const size_t count) {
+  const size_t free = ESP.getMaxAllocHeap();
+  const size_t bytes = free > MIN_HEAP_LEFT_BY_HREF_HASHES ? free - MIN_HEAP_LEFT_BY_HREF_HASHES : 0;
+  return std::min(std::max(bytes, MIN_LOW_HEAP_BUFFER_SIZE) / recordSize, count);
+}
+
+// Sequential reader of one sorted run in a temp file, through its part of the merge buffer
+template <typename Record>
+class RunReader {
+  FsFile& file;
+  Record* const buffer;
+  const size_t capacity;
+  uint32_t filePosition;
+  size_t left;
+  size_t count = 0;
+  size_t next = 0;
+
+ public:
+  RunReader(FsFile& file, Record* buffer, const size_t capacity, const size_t firstRecord, const size_t length)
+      : file(file), buffer(buffer), capacity(capacity), filePosition(firstRecord * sizeof(Record)), left(length) {}
+
+  // Next record of the run, nullptr at its end or on a read error
+  const Record* peek() {
+    if (next == count) {
+      count = std::min(left, capacity);
+      next = 0;
+      const size_t size = count * sizeof(Record);
+      if (count == 0 || !file.seek(filePosition) || file.read(buffer, size) != static_cast<int>(size)) {
+        count = 0;
+        left = 0;
+        return nullptr;
+      }
+      filePosition += size;
+      left -= count;
+    }
+    return &buffer[next];
+  }
+  void pop() { next++; }
+};
+
+// Size and CRC-32 of a temp file, so a resumed build can tell it is complete
+struct FileCheck {
+  uint32_t size = 0;
+  uint32_t crc = 0;
+
+  bool operator==(const FileCheck& other) const { return size == other.size && crc == other.crc; }
+};
+
+bool checkFile(const std::string& path, FileCheck& check) {
+  FsFile file;
+  if (!SdMan.openFileForRead("BMC", path, file)) {
+    return false;
+  }
+  uint8_t buffer[512];
+  check.size = file.size();
+  check.crc = MZ_CRC32_INIT;
+  for (uint32_t left = check.size; left > 0;) {
+    const size_t n = std::min<uint32_t>(left, sizeof(buffer));
+    if (file.read(buffer, n) != static_cast<int>(n)) {
+      file.close();
+      return false;
+    }
+    check.crc = mz_crc32(check.crc, buffer, n);
+    left -= n;
+  }
+  file.close();
+  return true;
+}
 }  // namespace
 
 /* ============= WRITING / BUILDING FUNCTIONS ================ */
@@ -48,15 +158,235 @@ bool BookMetadataCache::beginTocPass() {
     spineFile.close();
     return false;
   }
+  if (loadSpineHrefHashes()) {
+    std::sort(spineHrefHashes.get(), spineHrefHashes.get() + spineCount, byHash);
+  } else if (!sortSpineHrefHashesOnCard()) {
+    tocFile.close();
+    spineFile.close();
+    return false;
+  }
   return true;
 }
 
 bool BookMetadataCache::endTocPass() {
   tocFile.close();
   spineFile.close();
+  spineHrefHashes.reset();
+  removeSortedHrefHashes();
+  return true;
+}
+
+// Hashes the href of every spine item, in spine order, leaving spineFile at its end. False, with nothing allocated,
+// when the heap is too low for them.
+bool BookMetadataCache::loadSpineHrefHashes() {
+  spineHrefHashes.reset();
+  const size_t size = sizeof(HrefHash) * spineCount;
+  if (ESP.getMaxAllocHeap() < size + MIN_HEAP_LEFT_BY_HREF_HASHES) {
+    Serial.printf("[%lu] [BMC] Low memory for %d href hashes (%u bytes in one block), sorting them on the card\n",
+                  millis(), spineCount, static_cast<unsigned>(ESP.getMaxAllocHeap()));
+    return false;
+  }
+  spineHrefHashes.reset(new (std::nothrow) HrefHash[spineCount]);
+  if (!spineHrefHashes) {
+    Serial.printf("[%lu] [BMC] Could not allocate %d href hashes, sorting them on the card\n", millis(), spineCount);
+    return false;
+  }
+
+  spineFile.seek(0);
+  for (int i = 0; i < spineCount; i++) {
+    const uint32_t position = spineFile.position();
+    const auto spineEntry = readSpineEntry(spineFile);
+    spineHrefHashes[i] = {hrefHash(spineEntry.href), position, static_cast<uint16_t>(i), -1};
+  }
+  return true;
+}
+
+// The href hashes sorted by hash in hrefFile, for a heap too low to hold them all: runs as long as the heap allows are
+// sorted in memory and written out one after the other, then merged in pairs until a single run is left. Each merge
+// pass reads and writes every record once, so the card traffic grows as n log n.
+bool BookMetadataCache::sortSpineHrefHashesOnCard() {
+  removeSortedHrefHashes();
+  const size_t bufferSize = lowHeapRecords(sizeof(HrefHash), spineCount);
+  std::unique_ptr<HrefHash[]> buffer(new (std::nothrow) HrefHash[std::max<size_t>(bufferSize, 1)]);
+  if (!buffer) {
+    Serial.printf("[%lu] [BMC] Could not allocate %u href hashes to sort\n", millis(),
+                  static_cast<unsigned>(bufferSize));
+    return false;
+  }
+
+  std::string sortedPath = cachePath + tmpHrefsBinFile;
+  std::string mergedPath = cachePath + tmpHrefsMergeBinFile;
+  FsFile runs;
+  if (!SdMan.openFileForWrite("BMC", sortedPath, runs)) {
+    return false;
+  }
+  bool ok = true;
+  spineFile.seek(0);
+  for (size_t first = 0; ok && first < spineCount; first += bufferSize) {
+    const size_t count = std::min<size_t>(bufferSize, spineCount - first);
+    for (size_t i = 0; i < count; i++) {
+      const uint32_t position = spineFile.position();
+      const auto spineEntry = readSpineEntry(spineFile);
+      buffer[i] = {hrefHash(spineEntry.href), position, static_cast<uint16_t>(first + i), -1};
+    }
+    std::sort(buffer.get(), buffer.get() + count, byHash);
+    const size_t size = count * sizeof(HrefHash);
+    ok = runs.write(reinterpret_cast<const uint8_t*>(buffer.get()), size) == size;
+  }
+  runs.close();
+
+  int passes = 0;
+  for (size_t runLength = bufferSize; ok && runLength < spineCount; runLength *= 2) {
+    ok = mergeHrefHashRuns(sortedPath, mergedPath, runLength, buffer.get(), bufferSize);
+    std::swap(sortedPath, mergedPath);
+    passes++;
+  }
+  buffer.reset();
+  if (SdMan.exists(mergedPath.c_str())) {
+    SdMan.remove(mergedPath.c_str());
+  }
+  if (!ok || !SdMan.openFileForRead("BMC", sortedPath, hrefFile)) {
+    Serial.printf("[%lu] [BMC] Could not sort href hashes on the card\n", millis());
+    removeSortedHrefHashes();
+    return false;
+  }
+  Serial.printf("[%lu] [BMC] Sorted %d href hashes on the card in runs of %u, %d merge passes\n", millis(), spineCount,
+                static_cast<unsigned>(bufferSize), passes);
   return true;
 }
 
+// One merge pass: each pair of consecutive sorted runs of runLength records in the source file becomes one sorted run
+// in the destination file. The two runs share the buffer, each half is refilled from the card as it runs out.
+bool BookMetadataCache::mergeHrefHashRuns(const std::string& sourcePath, const std::string& destinationPath,
+                                          const size_t runLength, HrefHash* buffer, const size_t bufferSize) const {
+  FsFile source;
+  FsFile destination;
+  if (!SdMan.openFileForRead("BMC", sourcePath, source)) {
+    return false;
+  }
+  if (!SdMan.openFileForWrite("BMC", destinationPath, destination)) {
+    source.close();
+    return false;
+  }
+
+  const size_t half = std::max<size_t>(bufferSize / 2, 1);
+  bool ok = true;
+  for (size_t first = 0; ok && first < spineCount; first += 2 * runLength) {
+    const size_t leftLength = std::min<size_t>(runLength, spineCount - first);
+    const size_t rightLength = std::min<size_t>(runLength, spineCount - first - leftLength);
+    RunReader<HrefHash> left(source, buffer, half, first, leftLength);
+    RunReader<HrefHash> right(source, buffer + half, std::max<size_t>(bufferSize - half, 1), first + leftLength,
+                              rightLength);
+    size_t written = 0;
+    for (;;) {
+      const HrefHash* a = left.peek();
+      const HrefHash* b = right.peek();
+      if (!a && !b) {
+        break;
+      }
+      const bool takeLeft = a && (!b || !byHash(*b, *a));
+      const HrefHash* record = takeLeft ? a : b;
+      if (destination.write(reinterpret_cast<const uint8_t*>(record), sizeof(HrefHash)) != sizeof(HrefHash)) {
+        ok = false;
+        break;
+      }
+      takeLeft ? left.pop() : right.pop();
+      written++;
+    }
+    // A run cut short by a read error
+    ok = ok && written == leftLength + rightLength;
+  }
+  ok = destination.sync() && ok;
+  destination.close();
+  source.close();
+  return ok;
+}
+
+void BookMetadataCache::removeSortedHrefHashes() {
+  if (hrefFile) {
+    hrefFile.close();
+  }
+  if (SdMan.exists((cachePath + tmpHrefsBinFile).c_str())) {
+    SdMan.remove((cachePath + tmpHrefsBinFile).c_str());
+  }
+  if (SdMan.exists((cachePath + tmpHrefsMergeBinFile).c_str())) {
+    SdMan.remove((cachePath + tmpHrefsMergeBinFile).c_str());
+  }
+}
+
+int BookMetadataCache::findSpineIndexForTocHref(const std::string& href) {
+  const uint32_t hash = hrefHash(href);
+  if (!spineHrefHashes) {
+    // Binary search of the hashes sorted on the card
+    const auto readRecord = [this](const uint32_t index, HrefHash& record) {
+      return hrefFile.seek(index * sizeof(HrefHash)) &&
+             hrefFile.read(&record, sizeof(HrefHash)) == static_cast<int>(sizeof(HrefHash));
+    };
+    HrefHash record;
+    uint32_t low = 0;
+    uint32_t high = spineCount;
+    while (low < high) {
+      const uint32_t middle = (low + high) / 2;
+      if (!readRecord(middle, record)) {
+        return -1;
+      }
+      if (record.hash < hash) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    for (uint32_t i = low; i < spineCount && readRecord(i, record) && record.hash == hash; i++) {
+      spineFile.seek(record.position);
+      if (readSpineEntry(spineFile).href == href) {
+        return record.spineIndex;
+      }
+    }
+    return -1;
+  }
+
+  const HrefHash* const begin = spineHrefHashes.get();
+  const HrefHash* const end = begin + spineCount;
+  const HrefHash* it = std::lower_bound(begin, end, hash,
+                                        [](const HrefHash& entry, const uint32_t value) { return entry.hash < value; });
+  // Different hrefs can share a hash, only the spine entry itself can confirm a match
+  for (; it != end && it->hash == hash; ++it) {
+    spineFile.seek(it->position);
+    if (readSpineEntry(spineFile).href == href) {
+      return it->spineIndex;
+    }
+  }
+  return -1;
+}
+
+// The href index without the href hashes in memory, copied from the hashes sorted on the card
+bool BookMetadataCache::writeHrefIndexFromCard() {
+  if (!sortSpineHrefHashesOnCard()) {
+    return false;
+  }
+  HrefHash record;
+  bool ok = true;
+  for (int i = 0; ok && i < spineCount; i++) {
+    ok = hrefFile.read(&record, sizeof(HrefHash)) == static_cast<int>(sizeof(HrefHash));
+    serialization::writePod(bookFile, record.hash);
+    serialization::writePod(bookFile, record.spineIndex);
+  }
+  removeSortedHrefHashes();
+  return ok;
+}
+
+// First TOC entry of each of count spine items from firstSpineIndex on, -1 for none, from one pass over the TOC
+void BookMetadataCache::readTocIndexes(const int firstSpineIndex, int16_t* tocIndexes, const int count) {
+  std::fill(tocIndexes, tocIndexes + count, static_cast<int16_t>(-1));
+  tocFile.seek(0);
+  for (int j = 0; j < tocCount; j++) {
+    const int slot = readTocEntry(tocFile).spineIndex - firstSpineIndex;
+    if (slot >= 0 && slot < count && tocIndexes[slot] == -1) {
+      tocIndexes[slot] = static_cast<int16_t>(j);
+    }
+  }
+}
+
 bool BookMetadataCache::endWrite() {
   if (!buildMode) {
     Serial.printf("[%lu] [BMC] endWrite called but not in build mode\n", millis());
@@ -68,6 +398,111 @@ bool BookMetadataCache::endWrite() {
   return true;
 }
 
+bool BookMetadataCache::saveJournal(const BuildJournal& journal) const {
+  FileCheck spineCheck;
+  FileCheck tocCheck;
+  if ((journal.phase >= BuildJournal::CONTENT_OPF_DONE && !checkFile(cachePath + tmpSpineBinFile, spineCheck)) ||
+      (journal.phase >= BuildJournal::TOC_DONE && !checkFile(cachePath + tmpTocBinFile, tocCheck))) {
+    return false;
+  }
+
+  std::ostringstream body;
+  serialization::writePod(body, JOURNAL_VERSION);
+  serialization::writePod(body, journal.phase);
+  serialization::writePod(body, spineCount);
+  serialization::writePod(body, tocCount);
+  serialization::writePod(body, spineCheck);
+  serialization::writePod(body, tocCheck);
+  serialization::writeString(body, journal.metadata.title);
+  serialization::writeString(body, journal.metadata.author);
+  serialization::writeString(body, journal.metadata.coverItemHref);
+  serialization::writeString(body, journal.metadata.textReferenceHref);
+  serialization::writeString(body, journal.contentBasePath);
+  serialization::writeString(body, journal.tocNcxItem);
+  serialization::writeString(body, journal.tocNavItem);
+  const std::string data = body.str();
+  // A journal cut short by a reset fails the trailing checksum and is ignored
+  const uint32_t crc = mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+
+  FsFile file;
+  if (!SdMan.openFileForWrite("BMC", cachePath + journalFile, file)) {
+    return false;
+  }
+  const bool ok = file.write(reinterpret_cast<const uint8_t*>(data.data()), data.size()) == data.size() &&
+                  file.write(reinterpret_cast<const uint8_t*>(&crc), sizeof(crc)) == sizeof(crc) && file.sync();
+  file.close();
+  return ok;
+}
+
+bool BookMetadataCache::loadJournal(BuildJournal& journal) {
+  FsFile file;
+  if (!SdMan.openFileForRead("BMC", cachePath + journalFile, file)) {
+    return false;
+  }
+  const size_t size = file.size();
+  std::string data(size, '\0');
+  const bool read = size > sizeof(uint32_t) && size <= MAX_JOURNAL_SIZE &&
+                    file.read(reinterpret_cast<uint8_t*>(&data[0]), size) == static_cast<int>(size);
+  file.close();
+  if (!read) {
+    return false;
+  }
+  uint32_t crc;
+  memcpy(&crc, data.data() + size - sizeof(crc), sizeof(crc));
+  data.resize(size - sizeof(crc));
+  if (crc != mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const uint8_t*>(data.data()), data.size())) {
+    Serial.printf("[%lu] [BMC] Ignoring incomplete build journal\n", millis());
+    return false;
+  }
+
+  std::istringstream body(data);
+  uint8_t version;
+  BuildJournal stored;
+  uint16_t storedSpineCount;
+  uint16_t storedTocCount;
+  FileCheck spineCheck;
+  FileCheck tocCheck;
+  serialization::readPod(body, version);
+  if (version != JOURNAL_VERSION) {
+    return false;
+  }
+  serialization::readPod(body, stored.phase);
+  serialization::readPod(body, storedSpineCount);
+  serialization::readPod(body, storedTocCount);
+  serialization::readPod(body, spineCheck);
+  serialization::readPod(body, tocCheck);
+  serialization::readString(body, stored.metadata.title);
+  serialization::readString(body, stored.metadata.author);
+  serialization::readString(body, stored.metadata.coverItemHref);
+  serialization::readString(body, stored.metadata.textReferenceHref);
+  serialization::readString(body, stored.contentBasePath);
+  serialization::readString(body, stored.tocNcxItem);
+  serialization::readString(body, stored.tocNavItem);
+  if (!body) {
+    return false;
+  }
+
+  // Passes are only skipped if their temp files are exactly as they were when the pass finished
+  FileCheck check;
+  if (stored.phase >= BuildJournal::TOC_DONE &&
+      (!checkFile(cachePath + tmpTocBinFile, check) || !(check == tocCheck))) {
+    stored.phase = BuildJournal::CONTENT_OPF_DONE;
+    storedTocCount = 0;
+  }
+  if (stored.phase >= BuildJournal::CONTENT_OPF_DONE &&
+      (!checkFile(cachePath + tmpSpineBinFile, check) || !(check == spineCheck))) {
+    return false;
+  }
+  if (stored.phase == BuildJournal::NOTHING_DONE) {
+    return false;
+  }
+
+  journal = std::move(stored);
+  spineCount = storedSpineCount;
+  tocCount = storedTocCount;
+  return true;
+}
+
 bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMetadata& metadata) {
   // Open all three files, writing to meta, reading from spine and toc
   if (!SdMan.openFileForWrite("BMC", cachePath + bookBinFile, bookFile)) {
@@ -89,11 +524,13 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
       sizeof(BOOK_CACHE_VERSION) + /* LUT Offset */ sizeof(uint32_t) + sizeof(spineCount) + sizeof(tocCount);
   const uint32_t metadataSize = metadata.title.size() + metadata.author.size() + metadata.coverItemHref.size() +
                                 metadata.textReferenceHref.size() + sizeof(uint32_t) * 4;
-  const uint32_t lutSize = sizeof(uint32_t) * spineCount + sizeof(uint32_t) * tocCount;
+  const uint32_t lutSize =
+      sizeof(uint32_t) * spineCount + sizeof(uint32_t) * tocCount + HREF_INDEX_ENTRY_SIZE * spineCount;
   const uint32_t lutOffset = headerASize + metadataSize;
 
-  // Header A
-  serialization::writePod(bookFile, BOOK_CACHE_VERSION);
+  // Header A. The version is only written once everything else is on the card, so a book.bin cut short by a reset
+  // never loads.
+  serialization::writePod(bookFile, static_cast<uint8_t>(0));
   serialization::writePod(bookFile, lutOffset);
   serialization::writePod(bookFile, spineCount);
   serialization::writePod(bookFile, tocCount);
@@ -103,11 +540,19 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
   serialization::writeString(bookFile, metadata.coverItemHref);
   serialization::writeString(bookFile, metadata.textReferenceHref);
 
-  // Loop through spine entries, writing LUT positions
-  spineFile.seek(0);
+  // Loop through spine entries, writing LUT positions. With the href hashes in memory their positions are known.
+  const bool hashed = loadSpineHrefHashes();
+  if (!hashed) {
+    spineFile.seek(0);
+  }
   for (int i = 0; i < spineCount; i++) {
-    uint32_t pos = spineFile.position();
-    auto spineEntry = readSpineEntry(spineFile);
+    uint32_t pos;
+    if (hashed) {
+      pos = spineHrefHashes[i].position;
+    } else {
+      pos = spineFile.position();
+      readSpineEntry(spineFile);
+    }
     serialization::writePod(bookFile, pos + lutOffset + lutSize);
   }
 
@@ -119,13 +564,41 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
     serialization::writePod(bookFile, pos + lutOffset + lutSize + static_cast<uint32_t>(spineFile.position()));
   }
 
+  // Href index, sorted by hash so a lookup is a binary search
+  if (hashed) {
+    std::sort(spineHrefHashes.get(), spineHrefHashes.get() + spineCount, byHash);
+    for (int i = 0; i < spineCount; i++) {
+      serialization::writePod(bookFile, spineHrefHashes[i].hash);
+      serialization::writePod(bookFile, spineHrefHashes[i].spineIndex);
+    }
+    std::sort(spineHrefHashes.get(), spineHrefHashes.get() + spineCount, bySpineIndex);
+  } else if (!writeHrefIndexFromCard()) {
+    bookFile.close();
+    spineFile.close();
+    tocFile.close();
+    return false;
+  }
+
   // LUTs complete
+  // First TOC entry of each spine item, from one pass over the TOC
+  if (hashed) {
+    tocFile.seek(0);
+    for (int j = 0; j < tocCount; j++) {
+      const auto tocEntry = readTocEntry(tocFile);
+      if (tocEntry.spineIndex >= 0 && tocEntry.spineIndex < spineCount &&
+          spineHrefHashes[tocEntry.spineIndex].tocIndex == -1) {
+        spineHrefHashes[tocEntry.spineIndex].tocIndex = static_cast<int16_t>(j);
+      }
+    }
+  }
+
   // Loop through spines from spine file matching up TOC indexes, calculating cumulative size and writing to book.bin
 
   ZipFile zip(epubPath);
   // Pre-open zip file to speed up size calculations
   if (!zip.open()) {
     Serial.printf("[%lu] [BMC] Could not open EPUB zip for size calculations\n", millis());
+    spineHrefHashes.reset();
     bookFile.close();
     spineFile.close();
     tocFile.close();
@@ -136,25 +609,40 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
   //       Perhaps only a cache of spine items or a better way to speedup lookups?
   if (!zip.loadAllFileStatSlims()) {
     Serial.printf("[%lu] [BMC] Could not load zip local header offsets for size calculations\n", millis());
+    spineHrefHashes.reset();
     bookFile.close();
     spineFile.close();
     tocFile.close();
     zip.close();
     return false;
   }
+  // Without the href hashes, the TOC indexes of as many spine items as the heap holds come from each pass over the TOC
+  const size_t tocWindowSize = hashed ? 0 : lowHeapRecords(sizeof(int16_t), spineCount);
+  std::unique_ptr<int16_t[]> tocWindow;
+  if (!hashed) {
+    tocWindow.reset(new (std::nothrow) int16_t[std::max<size_t>(tocWindowSize, 1)]);
+    if (!tocWindow) {
+      Serial.printf("[%lu] [BMC] Could not allocate TOC indexes for %u spine items\n", millis(),
+                    static_cast<unsigned>(tocWindowSize));
+      bookFile.close();
+      spineFile.close();
+      tocFile.close();
+      zip.close();
+      return false;
+    }
+  }
   uint32_t cumSize = 0;
   spineFile.seek(0);
   int lastSpineTocIndex = -1;
   for (int i = 0; i < spineCount; i++) {
     auto spineEntry = readSpineEntry(spineFile);
-
-    tocFile.seek(0);
-    for (int j = 0; j < tocCount; j++) {
-      auto tocEntry = readTocEntry(tocFile);
-      if (tocEntry.spineIndex == i) {
-        spineEntry.tocIndex = j;
-        break;
+    if (hashed) {
+      spineEntry.tocIndex = spineHrefHashes[i].tocIndex;
+    } else {
+      if (i % tocWindowSize == 0) {
+        readTocIndexes(i, tocWindow.get(), std::min<int>(tocWindowSize, spineCount - i));
       }
+      spineEntry.tocIndex = tocWindow[i % tocWindowSize];
     }
 
     // Not a huge deal if we don't fine a TOC entry for the spine entry, this is expected behaviour for EPUBs
@@ -180,6 +668,7 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
     // Write out spine data to book.bin
     writeSpineEntry(bookFile, spineEntry);
   }
+  spineHrefHashes.reset();
   // Close opened zip file
   zip.close();
 
@@ -190,9 +679,15 @@ bool BookMetadataCache::buildBookBin(const std::string& epubPath, const BookMeta
     writeTocEntry(bookFile, tocEntry);
   }
 
+  const bool complete = bookFile.sync() && bookFile.seek(0) &&
+                        bookFile.write(&BOOK_CACHE_VERSION, sizeof(BOOK_CACHE_VERSION)) == sizeof(BOOK_CACHE_VERSION);
   bookFile.close();
   spineFile.close();
   tocFile.close();
+  if (!complete) {
+    Serial.printf("[%lu] [BMC] Could not finish book.bin\n", millis());
+    return false;
+  }
 
   Serial.printf("[%lu] [BMC] Successfully built book.bin\n", millis());
   return true;
@@ -205,6 +700,15 @@ bool BookMetadataCache::cleanupTmpFiles() const {
   if (SdMan.exists((cachePath + tmpTocBinFile).c_str())) {
     SdMan.remove((cachePath + tmpTocBinFile).c_str());
   }
+  if (SdMan.exists((cachePath + journalFile).c_str())) {
+    SdMan.remove((cachePath + journalFile).c_str());
+  }
+  if (SdMan.exists((cachePath + tmpHrefsBinFile).c_str())) {
+    SdMan.remove((cachePath + tmpHrefsBinFile).c_str());
+  }
+  if (SdMan.exists((cachePath + tmpHrefsMergeBinFile).c_str())) {
+    SdMan.remove((cachePath + tmpHrefsMergeBinFile).c_str());
+  }
   return true;
 }
 
@@ -246,19 +750,7 @@ void BookMetadataCache::createTocEntry(const std::string& title, const std::stri
     return;
   }
 
-  int spineIndex = -1;
-  // find spine index
-  // TODO: This lookup is slow as need to scan through all items each time. We can't hold it all in memory due to size.
-  //       But perhaps we can load just the hrefs in a vector/list to do an index lookup?
-  spineFile.seek(0);
-  for (int i = 0; i < spineCount; i++) {
-    auto spineEntry = readSpineEntry(spineFile);
-    if (spineEntry.href == href) {
-      spineIndex = i;
-      break;
-    }
-  }
-
+  const int spineIndex = findSpineIndexForTocHref(href);
   if (spineIndex == -1) {
     Serial.printf("[%lu] [BMC] addTocEntry: Could not find spine item for TOC href %s\n", millis(), href.c_str());
   }
@@ -335,6 +827,73 @@ BookMetadataCache::TocEntry BookMetadataCache::getTocEntry(const int index) {
   return readTocEntry(bookFile);
 }
 
+int BookMetadataCache::getTocEntries(const int startIndex, const int count, std::vector<TocEntry>& entries) {
+  entries.clear();
+  if (!loaded) {
+    Serial.printf("[%lu] [BMC] getTocEntries called but cache not loaded\n", millis());
+    return 0;
+  }
+
+  if (startIndex < 0 || startIndex >= static_cast<int>(tocCount) || count <= 0) {
+    return 0;
+  }
+
+  // Only the first entry needs a LUT lookup, the rest follow it in the file
+  const int endIndex = std::min(startIndex + count, static_cast<int>(tocCount));
+  bookFile.seek(lutOffset + sizeof(uint32_t) * spineCount + sizeof(uint32_t) * startIndex);
+  uint32_t tocEntryPos;
+  serialization::readPod(bookFile, tocEntryPos);
+  bookFile.seek(tocEntryPos);
+
+  entries.reserve(endIndex - startIndex);
+  for (int i = startIndex; i < endIndex; i++) {
+    entries.push_back(readTocEntry(bookFile));
+  }
+  return static_cast<int>(entries.size());
+}
+
+int BookMetadataCache::findSpineIndex(const std::string& href) {
+  if (!loaded) {
+    Serial.printf("[%lu] [BMC] findSpineIndex called but cache not loaded\n", millis());
+    return -1;
+  }
+
+  const std::string path = href.substr(0, href.find('#'));
+  const uint32_t hash = hrefHash(path);
+  const uint32_t indexOffset = lutOffset + sizeof(uint32_t) * spineCount + sizeof(uint32_t) * tocCount;
+
+  // First index record with this hash
+  int low = 0;
+  int high = spineCount;
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    uint32_t midHash;
+    bookFile.seek(indexOffset + HREF_INDEX_ENTRY_SIZE * mid);
+    serialization::readPod(bookFile, midHash);
+    if (midHash < hash) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  // Different hrefs can share a hash, only the spine entry itself can confirm a match
+  for (int i = low; i < spineCount; i++) {
+    uint32_t entryHash;
+    uint16_t spineIndex;
+    bookFile.seek(indexOffset + HREF_INDEX_ENTRY_SIZE * i);
+    serialization::readPod(bookFile, entryHash);
+    serialization::readPod(bookFile, spineIndex);
+    if (entryHash != hash) {
+      break;
+    }
+    if (getSpineEntry(spineIndex).href == path) {
+      return spineIndex;
+    }
+  }
+  return -1;
+}
+
 BookMetadataCache::SpineEntry BookMetadataCache::readSpineEntry(FsFile& file) const {
   SpineEntry entry;
   serialization::readString(file, entry.href);
@@ -2,7 +2,9 @@
 
 #include <SDCardManager.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 class BookMetadataCache {
  public:
@@ -13,13 +15,26 @@ class BookMetadataCache {
     std::string textReferenceHref;
   };
 
+  // What an interrupted build had finished. Saved after each pass, so that the next build can skip the passes whose
+  // temp files are still intact.
+  struct BuildJournal {
+    enum Phase : uint8_t { NOTHING_DONE = 0, CONTENT_OPF_DONE = 1, TOC_DONE = 2 };
+
+    uint8_t phase = NOTHING_DONE;
+    BookMetadata metadata;
+    // Found by the content.opf pass, needed by the TOC pass
+    std::string contentBasePath;
+    std::string tocNcxItem;
+    std::string tocNavItem;
+  };
+
   struct SpineEntry {
     std::string href;
-    size_t cumulativeSize;
+    uint32_t cumulativeSize;
     int16_t tocIndex;
 
     SpineEntry() : cumulativeSize(0), tocIndex(-1) {}
-    SpineEntry(std::string href, const size_t cumulativeSize, const int16_t tocIndex)
+    SpineEntry(std::string href, const uint32_t cumulativeSize, const int16_t tocIndex)
         : href(std::move(href)), cumulativeSize(cumulativeSize), tocIndex(tocIndex) {}
   };
 
@@ -41,7 +56,7 @@ class BookMetadataCache {
 
  private:
   std::string cachePath;
-  size_t lutOffset;
+  uint32_t lutOffset;
   uint16_t spineCount;
   uint16_t tocCount;
   bool loaded;
@@ -52,6 +67,28 @@ class BookMetadataCache {
   FsFile spineFile;
   FsFile tocFile;
 
+  // One per spine item while the TOC pass matches TOC hrefs to spine items (sorted by hash) and while buildBookBin
+  // writes the href index and the TOC index of each item. The spine temp file position is kept to check a hash match
+  // against the href itself. Left empty when the heap is low, hrefFile holds them sorted by hash instead.
+  struct HrefHash {
+    uint32_t hash;
+    uint32_t position;
+    uint16_t spineIndex;
+    int16_t tocIndex;
+  };
+  static_assert(sizeof(HrefHash) == 12, "No padding beyond the hash, position and two indexes");
+  std::unique_ptr<HrefHash[]> spineHrefHashes;
+  // Href hashes sorted on the card, read back one record at a time
+  FsFile hrefFile;
+
+  bool loadSpineHrefHashes();
+  bool sortSpineHrefHashesOnCard();
+  bool mergeHrefHashRuns(const std::string& sourcePath, const std::string& destinationPath, size_t runLength,
+                         HrefHash* buffer, size_t bufferSize) const;
+  void removeSortedHrefHashes();
+  int findSpineIndexForTocHref(const std::string& href);
+  bool writeHrefIndexFromCard();
+  void readTocIndexes(int firstSpineIndex, int16_t* tocIndexes, int count);
   uint32_t writeSpineEntry(FsFile& file, const SpineEntry& entry) const;
   uint32_t writeTocEntry(FsFile& file, const TocEntry& entry) const;
   SpineEntry readSpineEntry(FsFile& file) const;
@@ -74,6 +111,9 @@ class BookMetadataCache {
   bool endTocPass();
   bool endWrite();
   bool cleanupTmpFiles() const;
+  bool saveJournal(const BuildJournal& journal) const;
+  // Restores the journal of an interrupted build and the entry counts it recorded. Must be called after beginWrite().
+  bool loadJournal(BuildJournal& journal);
 
   // Post-processing to update mappings and sizes
   bool buildBookBin(const std::string& epubPath, const BookMetadata& metadata);
@@ -82,6 +122,10 @@ class BookMetadataCache {
   bool load();
   SpineEntry getSpineEntry(int index);
   TocEntry getTocEntry(int index);
+  // Reads up to count consecutive TOC entries with a single seek (entries are stored back to back)
+  int getTocEntries(int startIndex, int count, std::vector<TocEntry>& entries);
+  // Spine item with the given href, ignoring any #fragment. -1 if no spine item has it.
+  int findSpineIndex(const std::string& href);
   int getSpineCount() const { return spineCount; }
   int getTocCount() const { return tocCount; }
   bool isLoaded() const { return loaded; }
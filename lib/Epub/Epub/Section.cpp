@@ -7,7 +7,7 @@
 #include "parsers/ChapterHtmlSlimParser.h"
 
 namespace {
-constexpr uint8_t SECTION_FILE_VERSION = 9;
+constexpr uint8_t SECTION_FILE_VERSION = 10;
 constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(int) + sizeof(float) + sizeof(bool) + sizeof(uint8_t) +
                                  sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint32_t);
 }  // namespace
@@ -91,8 +91,19 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
     }
   }
 
+  uint32_t lutOffset;
   serialization::readPod(file, pageCount);
+  serialization::readPod(file, lutOffset);
   file.close();
+
+  // The LUT offset is filled in last, a zero means the build never finished (e.g. power loss mid-build)
+  if (lutOffset == 0) {
+    Serial.printf("[%lu] [SCT] Deserialization failed: Incomplete section file\n", millis());
+    pageCount = 0;
+    clearCache();
+    return false;
+  }
+
   Serial.printf("[%lu] [SCT] Deserialization succeeded: %d pages\n", millis(), pageCount);
   return true;
 }
@@ -116,7 +127,8 @@ bool Section::clearCache() const {
 bool Section::createSectionFile(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
                                 const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                                 const uint16_t viewportHeight, const std::function<void()>& progressSetupFn,
-                                const std::function<void(int)>& progressFn) {
+                                const std::function<void(int)>& progressFn,
+                                const std::function<bool()>& yieldFn) {
   constexpr uint32_t MIN_SIZE_FOR_PROGRESS = 50 * 1024;  // 50KB
   const auto localPath = epub->getSpineItem(spineIndex).href;
   const auto tmpHtmlPath = epub->getCachePath() + "/.tmp_" + std::to_string(spineIndex) + ".html";
@@ -163,6 +175,11 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
 
   Serial.printf("[%lu] [SCT] Streamed temp HTML to %s (%d bytes)\n", millis(), tmpHtmlPath.c_str(), fileSize);
 
+  if (yieldFn && !yieldFn()) {
+    SdMan.remove(tmpHtmlPath.c_str());
+    return false;
+  }
+
   // Only show progress bar for larger chapters where rendering overhead is worth it
   if (progressSetupFn && fileSize >= MIN_SIZE_FOR_PROGRESS) {
     progressSetupFn();
@@ -179,7 +196,7 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
       tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
       viewportHeight,
       [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); },
-      progressFn);
+      progressFn, yieldFn);
   success = visitor.parseAndBuildPages();
 
   SdMan.remove(tmpHtmlPath.c_str());
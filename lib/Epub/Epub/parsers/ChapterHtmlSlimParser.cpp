@@ -3,43 +3,46 @@
 #include <GfxRenderer.h>
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
-#include <expat.h>
+#include <XmlNames.h>
 
 #include "../Page.h"
-
-const char* HEADER_TAGS[] = {"h1", "h2", "h3", "h4", "h5", "h6"};
-constexpr int NUM_HEADER_TAGS = sizeof(HEADER_TAGS) / sizeof(HEADER_TAGS[0]);
+#include "XhtmlTokenizer.h"
 
 // Minimum file size (in bytes) to show progress bar - smaller chapters don't benefit from it
 constexpr size_t MIN_SIZE_FOR_PROGRESS = 50 * 1024;  // 50KB
 
-const char* BLOCK_TAGS[] = {"p", "li", "div", "br", "blockquote"};
-constexpr int NUM_BLOCK_TAGS = sizeof(BLOCK_TAGS) / sizeof(BLOCK_TAGS[0]);
-
-const char* BOLD_TAGS[] = {"b", "strong"};
-constexpr int NUM_BOLD_TAGS = sizeof(BOLD_TAGS) / sizeof(BOLD_TAGS[0]);
-
-const char* ITALIC_TAGS[] = {"i", "em"};
-constexpr int NUM_ITALIC_TAGS = sizeof(ITALIC_TAGS) / sizeof(ITALIC_TAGS[0]);
-
-const char* IMAGE_TAGS[] = {"img"};
-constexpr int NUM_IMAGE_TAGS = sizeof(IMAGE_TAGS) / sizeof(IMAGE_TAGS[0]);
-
-const char* SKIP_TAGS[] = {"head", "table"};
-constexpr int NUM_SKIP_TAGS = sizeof(SKIP_TAGS) / sizeof(SKIP_TAGS[0]);
+enum TagKind { OTHER_TAG, HEADER_TAG, BLOCK_TAG, LINE_BREAK_TAG, BOLD_TAG, ITALIC_TAG, IMAGE_TAG, SKIP_TAG };
+
+constexpr auto TAGS = makeXmlNameTable<TagKind>({
+    {"h1", HEADER_TAG},
+    {"h2", HEADER_TAG},
+    {"h3", HEADER_TAG},
+    {"h4", HEADER_TAG},
+    {"h5", HEADER_TAG},
+    {"h6", HEADER_TAG},
+    {"p", BLOCK_TAG},
+    {"li", BLOCK_TAG},
+    {"div", BLOCK_TAG},
+    {"blockquote", BLOCK_TAG},
+    {"br", LINE_BREAK_TAG},
+    {"b", BOLD_TAG},
+    {"strong", BOLD_TAG},
+    {"i", ITALIC_TAG},
+    {"em", ITALIC_TAG},
+    {"img", IMAGE_TAG},
+    {"head", SKIP_TAG},
+    {"table", SKIP_TAG},
+});
+
+enum AttributeKind { OTHER_ATTRIBUTE, ROLE_ATTRIBUTE, EPUB_TYPE_ATTRIBUTE };
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<AttributeKind>({
+    {"role", ROLE_ATTRIBUTE},
+    {"epub:type", EPUB_TYPE_ATTRIBUTE},
+});
 
 bool isWhitespace(const char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
 
-// given the start and end of a tag, check to see if it matches a known tag
-bool matches(const char* tag_name, const char* possible_tags[], const int possible_tag_count) {
-  for (int i = 0; i < possible_tag_count; i++) {
-    if (strcmp(tag_name, possible_tags[i]) == 0) {
-      return true;
-    }
-  }
-  return false;
-}
-
 // start a new text block if needed
 void ChapterHtmlSlimParser::startNewTextBlock(const TextBlock::Style style) {
   if (currentTextBlock) {
@@ -54,7 +57,25 @@ void ChapterHtmlSlimParser::startNewTextBlock(const TextBlock::Style style) {
   currentTextBlock.reset(new ParsedText(style, extraParagraphSpacing));
 }
 
-void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
+void ChapterHtmlSlimParser::flushPartWordBuffer(const EpdFontFamily::Style fontStyle) {
+  partWordBuffer[partWordBufferIndex] = '\0';
+  currentTextBlock->addWord(partWordBuffer, fontStyle);
+  partWordBufferIndex = 0;
+
+  // If we have > 750 words buffered up, perform the layout and consume out all but the last line
+  // There should be enough here to build out 1-2 full pages and doing this will free up a lot of
+  // memory.
+  // Spotted when reading Intermezzo, there are some really long text blocks in there.
+  // Checked per word rather than per characterData call, so that the pages do not depend on how the text was split.
+  if (currentTextBlock->size() > 750) {
+    Serial.printf("[%lu] [EHP] Text block too long, splitting into multiple pages\n", millis());
+    currentTextBlock->layoutAndExtractLines(
+        renderer, fontId, viewportWidth,
+        [this](const std::shared_ptr<TextBlock>& textBlock) { addLineToPage(textBlock); }, false);
+  }
+}
+
+void ChapterHtmlSlimParser::startElement(void* userData, const char* name, const char** atts) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
   // Middle of skip
@@ -63,14 +84,16 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     return;
   }
 
-  if (matches(name, IMAGE_TAGS, NUM_IMAGE_TAGS)) {
+  const TagKind tag = TAGS.find(name);
+
+  if (tag == IMAGE_TAG) {
     // TODO: Start processing image tags
     self->skipUntilDepth = self->depth;
     self->depth += 1;
     return;
   }
 
-  if (matches(name, SKIP_TAGS, NUM_SKIP_TAGS)) {
+  if (tag == SKIP_TAG) {
     // start skip
     self->skipUntilDepth = self->depth;
     self->depth += 1;
@@ -80,8 +103,9 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
   // Skip blocks with role="doc-pagebreak" and epub:type="pagebreak"
   if (atts != nullptr) {
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "role") == 0 && strcmp(atts[i + 1], "doc-pagebreak") == 0 ||
-          strcmp(atts[i], "epub:type") == 0 && strcmp(atts[i + 1], "pagebreak") == 0) {
+      const AttributeKind attribute = ATTRIBUTES.find(atts[i]);
+      if ((attribute == ROLE_ATTRIBUTE && strcmp(atts[i + 1], "doc-pagebreak") == 0) ||
+          (attribute == EPUB_TYPE_ATTRIBUTE && strcmp(atts[i + 1], "pagebreak") == 0)) {
         self->skipUntilDepth = self->depth;
         self->depth += 1;
         return;
@@ -89,25 +113,31 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
     }
   }
 
-  if (matches(name, HEADER_TAGS, NUM_HEADER_TAGS)) {
-    self->startNewTextBlock(TextBlock::CENTER_ALIGN);
-    self->boldUntilDepth = std::min(self->boldUntilDepth, self->depth);
-  } else if (matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS)) {
-    if (strcmp(name, "br") == 0) {
+  switch (tag) {
+    case HEADER_TAG:
+      self->startNewTextBlock(TextBlock::CENTER_ALIGN);
+      self->boldUntilDepth = std::min(self->boldUntilDepth, self->depth);
+      break;
+    case LINE_BREAK_TAG:
       self->startNewTextBlock(self->currentTextBlock->getStyle());
-    } else {
+      break;
+    case BLOCK_TAG:
       self->startNewTextBlock((TextBlock::Style)self->paragraphAlignment);
-    }
-  } else if (matches(name, BOLD_TAGS, NUM_BOLD_TAGS)) {
-    self->boldUntilDepth = std::min(self->boldUntilDepth, self->depth);
-  } else if (matches(name, ITALIC_TAGS, NUM_ITALIC_TAGS)) {
-    self->italicUntilDepth = std::min(self->italicUntilDepth, self->depth);
+      break;
+    case BOLD_TAG:
+      self->boldUntilDepth = std::min(self->boldUntilDepth, self->depth);
+      break;
+    case ITALIC_TAG:
+      self->italicUntilDepth = std::min(self->italicUntilDepth, self->depth);
+      break;
+    default:
+      break;
   }
 
   self->depth += 1;
 }
 
-void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char* s, const int len) {
+void ChapterHtmlSlimParser::characterData(void* userData, const char* s, const int len) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
   // Middle of skip
@@ -128,17 +158,15 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
     if (isWhitespace(s[i])) {
       // Currently looking at whitespace, if there's anything in the partWordBuffer, flush it
       if (self->partWordBufferIndex > 0) {
-        self->partWordBuffer[self->partWordBufferIndex] = '\0';
-        self->currentTextBlock->addWord(self->partWordBuffer, fontStyle);
-        self->partWordBufferIndex = 0;
+        self->flushPartWordBuffer(fontStyle);
       }
       // Skip the whitespace char
       continue;
     }
 
     // Skip soft-hyphen with UTF-8 representation (U+00AD) = 0xC2 0xAD
-    const XML_Char SHY_BYTE_1 = static_cast<XML_Char>(0xC2);
-    const XML_Char SHY_BYTE_2 = static_cast<XML_Char>(0xAD);
+    const char SHY_BYTE_1 = static_cast<char>(0xC2);
+    const char SHY_BYTE_2 = static_cast<char>(0xAD);
     // 1. Check for the start of the 2-byte Soft Hyphen sequence
     if (s[i] == SHY_BYTE_1) {
       // 2. Check if the next byte exists AND if it completes the sequence
@@ -153,27 +181,14 @@ void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char
 
     // If we're about to run out of space, then cut the word off and start a new one
     if (self->partWordBufferIndex >= MAX_WORD_SIZE) {
-      self->partWordBuffer[self->partWordBufferIndex] = '\0';
-      self->currentTextBlock->addWord(self->partWordBuffer, fontStyle);
-      self->partWordBufferIndex = 0;
+      self->flushPartWordBuffer(fontStyle);
     }
 
     self->partWordBuffer[self->partWordBufferIndex++] = s[i];
   }
-
-  // If we have > 750 words buffered up, perform the layout and consume out all but the last line
-  // There should be enough here to build out 1-2 full pages and doing this will free up a lot of
-  // memory.
-  // Spotted when reading Intermezzo, there are some really long text blocks in there.
-  if (self->currentTextBlock->size() > 750) {
-    Serial.printf("[%lu] [EHP] Text block too long, splitting into multiple pages\n", millis());
-    self->currentTextBlock->layoutAndExtractLines(
-        self->renderer, self->fontId, self->viewportWidth,
-        [self](const std::shared_ptr<TextBlock>& textBlock) { self->addLineToPage(textBlock); }, false);
-  }
 }
 
-void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* name) {
+void ChapterHtmlSlimParser::endElement(void* userData, const char* name) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
   if (self->partWordBufferIndex > 0) {
@@ -181,9 +196,9 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
     // We don't want to flush out content when closing inline tags like <span>.
     // Currently this also flushes out on closing <b> and <i> tags, but they are line tags so that shouldn't happen,
     // text styling needs to be overhauled to fix it.
-    const bool shouldBreakText =
-        matches(name, BLOCK_TAGS, NUM_BLOCK_TAGS) || matches(name, HEADER_TAGS, NUM_HEADER_TAGS) ||
-        matches(name, BOLD_TAGS, NUM_BOLD_TAGS) || matches(name, ITALIC_TAGS, NUM_ITALIC_TAGS) || self->depth == 1;
+    const TagKind tag = TAGS.find(name);
+    const bool shouldBreakText = tag == BLOCK_TAG || tag == LINE_BREAK_TAG || tag == HEADER_TAG || tag == BOLD_TAG ||
+                                 tag == ITALIC_TAG || self->depth == 1;
 
     if (shouldBreakText) {
       EpdFontFamily::Style fontStyle = EpdFontFamily::REGULAR;
@@ -195,9 +210,7 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
         fontStyle = EpdFontFamily::ITALIC;
       }
 
-      self->partWordBuffer[self->partWordBufferIndex] = '\0';
-      self->currentTextBlock->addWord(self->partWordBuffer, fontStyle);
-      self->partWordBufferIndex = 0;
+      self->flushPartWordBuffer(fontStyle);
     }
   }
 
@@ -222,17 +235,8 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
 bool ChapterHtmlSlimParser::parseAndBuildPages() {
   startNewTextBlock((TextBlock::Style)this->paragraphAlignment);
 
-  const XML_Parser parser = XML_ParserCreate(nullptr);
-  int done;
-
-  if (!parser) {
-    Serial.printf("[%lu] [EHP] Couldn't allocate memory for parser\n", millis());
-    return false;
-  }
-
   FsFile file;
   if (!SdMan.openFileForRead("EHP", filepath, file)) {
-    XML_ParserFree(parser);
     return false;
   }
 
@@ -240,19 +244,14 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
   const size_t totalSize = file.size();
   size_t bytesRead = 0;
   int lastProgress = -1;
+  bool done;
 
-  XML_SetUserData(parser, this);
-  XML_SetElementHandler(parser, startElement, endElement);
-  XML_SetCharacterDataHandler(parser, characterData);
+  XhtmlTokenizer tokenizer(this, startElement, characterData, endElement);
 
   do {
-    void* const buf = XML_GetBuffer(parser, 1024);
+    char* const buf = tokenizer.getBuffer(1024);
     if (!buf) {
       Serial.printf("[%lu] [EHP] Couldn't allocate memory for buffer\n", millis());
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
       file.close();
       return false;
     }
@@ -261,10 +260,6 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
 
     if (len == 0 && file.available() > 0) {
       Serial.printf("[%lu] [EHP] File read error\n", millis());
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
       file.close();
       return false;
     }
@@ -282,22 +277,19 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
 
     done = file.available() == 0;
 
-    if (XML_ParseBuffer(parser, static_cast<int>(len), done) == XML_STATUS_ERROR) {
-      Serial.printf("[%lu] [EHP] Parse error at line %lu:\n%s\n", millis(), XML_GetCurrentLineNumber(parser),
-                    XML_ErrorString(XML_GetErrorCode(parser)));
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
+    if (!tokenizer.parseBuffer(len, done)) {
+      Serial.printf("[%lu] [EHP] Couldn't allocate memory for buffer\n", millis());
+      file.close();
+      return false;
+    }
+
+    if (!done && yieldFn && !yieldFn()) {
+      Serial.printf("[%lu] [EHP] Parse aborted\n", millis());
       file.close();
       return false;
     }
   } while (!done);
 
-  XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-  XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-  XML_SetCharacterDataHandler(parser, nullptr);
-  XML_ParserFree(parser);
   file.close();
 
   // Process last page if there is still text
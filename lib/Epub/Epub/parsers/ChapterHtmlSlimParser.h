@@ -1,7 +1,5 @@
 #pragma once
 
-#include <expat.h>
-
 #include <climits>
 #include <functional>
 #include <memory>
@@ -19,6 +17,7 @@ class ChapterHtmlSlimParser {
   GfxRenderer& renderer;
   std::function<void(std::unique_ptr<Page>)> completePageFn;
   std::function<void(int)> progressFn;  // Progress callback (0-100)
+  std::function<bool()> yieldFn;        // Called between input chunks, return false to abort
   int depth = 0;
   int skipUntilDepth = INT_MAX;
   int boldUntilDepth = INT_MAX;
@@ -39,10 +38,11 @@ class ChapterHtmlSlimParser {
 
   void startNewTextBlock(TextBlock::Style style);
   void makePages();
-  // XML callbacks
-  static void XMLCALL startElement(void* userData, const XML_Char* name, const XML_Char** atts);
-  static void XMLCALL characterData(void* userData, const XML_Char* s, int len);
-  static void XMLCALL endElement(void* userData, const XML_Char* name);
+  void flushPartWordBuffer(EpdFontFamily::Style fontStyle);
+  // XhtmlTokenizer callbacks
+  static void startElement(void* userData, const char* name, const char** atts);
+  static void characterData(void* userData, const char* s, int len);
+  static void endElement(void* userData, const char* name);
 
  public:
   explicit ChapterHtmlSlimParser(const std::string& filepath, GfxRenderer& renderer, const int fontId,
@@ -50,7 +50,8 @@ class ChapterHtmlSlimParser {
                                  const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                                  const uint16_t viewportHeight,
                                  const std::function<void(std::unique_ptr<Page>)>& completePageFn,
-                                 const std::function<void(int)>& progressFn = nullptr)
+                                 const std::function<void(int)>& progressFn = nullptr,
+                                 const std::function<bool()>& yieldFn = nullptr)
       : filepath(filepath),
         renderer(renderer),
         fontId(fontId),
@@ -60,7 +61,8 @@ class ChapterHtmlSlimParser {
         viewportWidth(viewportWidth),
         viewportHeight(viewportHeight),
         completePageFn(completePageFn),
-        progressFn(progressFn) {}
+        progressFn(progressFn),
+        yieldFn(yieldFn) {}
   ~ChapterHtmlSlimParser() = default;
   bool parseAndBuildPages();
   void addLineToPage(std::shared_ptr<TextBlock> line);
@@ -1,6 +1,33 @@
 #include "ContainerParser.h"
 
 #include <HardwareSerial.h>
+#include <XmlNames.h>
+
+namespace {
+enum Tag {
+  OTHER_TAG,
+  CONTAINER_TAG,
+  ROOTFILES_TAG,
+  ROOTFILE_TAG,
+};
+
+constexpr auto TAGS = makeXmlNameTable<Tag>({
+    {"container", CONTAINER_TAG},
+    {"rootfiles", ROOTFILES_TAG},
+    {"rootfile", ROOTFILE_TAG},
+});
+
+enum Attribute {
+  OTHER_ATTRIBUTE,
+  MEDIA_TYPE_ATTRIBUTE,
+  FULL_PATH_ATTRIBUTE,
+};
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<Attribute>({
+    {"media-type", MEDIA_TYPE_ATTRIBUTE},
+    {"full-path", FULL_PATH_ATTRIBUTE},
+});
+}  // namespace
 
 bool ContainerParser::setup() {
   parser = XML_ParserCreate(nullptr);
@@ -55,26 +82,28 @@ size_t ContainerParser::write(const uint8_t* buffer, const size_t size) {
 
 void XMLCALL ContainerParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<ContainerParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
   // Simple state tracking to ensure we are looking at the valid schema structure
-  if (self->state == START && strcmp(name, "container") == 0) {
+  if (self->state == START && tag == CONTAINER_TAG) {
     self->state = IN_CONTAINER;
     return;
   }
 
-  if (self->state == IN_CONTAINER && strcmp(name, "rootfiles") == 0) {
+  if (self->state == IN_CONTAINER && tag == ROOTFILES_TAG) {
     self->state = IN_ROOTFILES;
     return;
   }
 
-  if (self->state == IN_ROOTFILES && strcmp(name, "rootfile") == 0) {
+  if (self->state == IN_ROOTFILES && tag == ROOTFILE_TAG) {
     const char* mediaType = nullptr;
     const char* path = nullptr;
 
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "media-type") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == MEDIA_TYPE_ATTRIBUTE) {
         mediaType = atts[i + 1];
-      } else if (strcmp(atts[i], "full-path") == 0) {
+      } else if (attribute == FULL_PATH_ATTRIBUTE) {
         path = atts[i + 1];
       }
     }
@@ -88,10 +117,11 @@ void XMLCALL ContainerParser::startElement(void* userData, const XML_Char* name,
 
 void XMLCALL ContainerParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<ContainerParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
-  if (self->state == IN_ROOTFILES && strcmp(name, "rootfiles") == 0) {
+  if (self->state == IN_ROOTFILES && tag == ROOTFILES_TAG) {
     self->state = IN_CONTAINER;
-  } else if (self->state == IN_CONTAINER && strcmp(name, "container") == 0) {
+  } else if (self->state == IN_CONTAINER && tag == CONTAINER_TAG) {
     self->state = START;
   }
 }
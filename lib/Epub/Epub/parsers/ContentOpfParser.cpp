@@ -3,12 +3,75 @@
 #include <FsHelpers.h>
 #include <HardwareSerial.h>
 #include <Serialization.h>
+#include <XmlNames.h>
 
 #include "../BookMetadataCache.h"
 
 namespace {
 constexpr char MEDIA_TYPE_NCX[] = "application/x-dtbncx+xml";
 constexpr char itemCacheFile[] = "/.items.bin";
+
+enum Tag {
+  OTHER_TAG,
+  PACKAGE_TAG,
+  METADATA_TAG,
+  TITLE_TAG,
+  CREATOR_TAG,
+  META_TAG,
+  MANIFEST_TAG,
+  ITEM_TAG,
+  SPINE_TAG,
+  ITEMREF_TAG,
+  GUIDE_TAG,
+  REFERENCE_TAG,
+};
+
+// OPF elements may carry the opf: prefix
+constexpr auto TAGS = makeXmlNameTable<Tag>({
+    {"package", PACKAGE_TAG},
+    {"opf:package", PACKAGE_TAG},
+    {"metadata", METADATA_TAG},
+    {"opf:metadata", METADATA_TAG},
+    {"dc:title", TITLE_TAG},
+    {"dc:creator", CREATOR_TAG},
+    {"meta", META_TAG},
+    {"opf:meta", META_TAG},
+    {"manifest", MANIFEST_TAG},
+    {"opf:manifest", MANIFEST_TAG},
+    {"item", ITEM_TAG},
+    {"opf:item", ITEM_TAG},
+    {"spine", SPINE_TAG},
+    {"opf:spine", SPINE_TAG},
+    {"itemref", ITEMREF_TAG},
+    {"opf:itemref", ITEMREF_TAG},
+    {"guide", GUIDE_TAG},
+    {"opf:guide", GUIDE_TAG},
+    {"reference", REFERENCE_TAG},
+    {"opf:reference", REFERENCE_TAG},
+});
+
+enum Attribute {
+  OTHER_ATTRIBUTE,
+  NAME_ATTRIBUTE,
+  CONTENT_ATTRIBUTE,
+  ID_ATTRIBUTE,
+  HREF_ATTRIBUTE,
+  MEDIA_TYPE_ATTRIBUTE,
+  PROPERTIES_ATTRIBUTE,
+  IDREF_ATTRIBUTE,
+  TYPE_ATTRIBUTE,
+};
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<Attribute>({
+    {"name", NAME_ATTRIBUTE},
+    {"content", CONTENT_ATTRIBUTE},
+    {"id", ID_ATTRIBUTE},
+    {"href", HREF_ATTRIBUTE},
+    {"media-type", MEDIA_TYPE_ATTRIBUTE},
+    {"properties", PROPERTIES_ATTRIBUTE},
+    {"idref", IDREF_ATTRIBUTE},
+    {"type", TYPE_ATTRIBUTE},
+});
 }  // namespace
 
 bool ContentOpfParser::setup() {
@@ -85,29 +148,29 @@ size_t ContentOpfParser::write(const uint8_t* buffer, const size_t size) {
 
 void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<ContentOpfParser*>(userData);
-  (void)atts;
+  const Tag tag = TAGS.find(name);
 
-  if (self->state == START && (strcmp(name, "package") == 0 || strcmp(name, "opf:package") == 0)) {
+  if (self->state == START && tag == PACKAGE_TAG) {
     self->state = IN_PACKAGE;
     return;
   }
 
-  if (self->state == IN_PACKAGE && (strcmp(name, "metadata") == 0 || strcmp(name, "opf:metadata") == 0)) {
+  if (self->state == IN_PACKAGE && tag == METADATA_TAG) {
     self->state = IN_METADATA;
     return;
   }
 
-  if (self->state == IN_METADATA && strcmp(name, "dc:title") == 0) {
+  if (self->state == IN_METADATA && tag == TITLE_TAG) {
     self->state = IN_BOOK_TITLE;
     return;
   }
 
-  if (self->state == IN_METADATA && strcmp(name, "dc:creator") == 0) {
+  if (self->state == IN_METADATA && tag == CREATOR_TAG) {
     self->state = IN_BOOK_AUTHOR;
     return;
   }
 
-  if (self->state == IN_PACKAGE && (strcmp(name, "manifest") == 0 || strcmp(name, "opf:manifest") == 0)) {
+  if (self->state == IN_PACKAGE && tag == MANIFEST_TAG) {
     self->state = IN_MANIFEST;
     if (!SdMan.openFileForWrite("COF", self->cachePath + itemCacheFile, self->tempItemStore)) {
       Serial.printf(
@@ -117,7 +180,7 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     return;
   }
 
-  if (self->state == IN_PACKAGE && (strcmp(name, "spine") == 0 || strcmp(name, "opf:spine") == 0)) {
+  if (self->state == IN_PACKAGE && tag == SPINE_TAG) {
     self->state = IN_SPINE;
     if (!SdMan.openFileForRead("COF", self->cachePath + itemCacheFile, self->tempItemStore)) {
       Serial.printf(
@@ -127,7 +190,7 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     return;
   }
 
-  if (self->state == IN_PACKAGE && (strcmp(name, "guide") == 0 || strcmp(name, "opf:guide") == 0)) {
+  if (self->state == IN_PACKAGE && tag == GUIDE_TAG) {
     self->state = IN_GUIDE;
     // TODO Remove print
     Serial.printf("[%lu] [COF] Entering guide state.\n", millis());
@@ -139,14 +202,15 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     return;
   }
 
-  if (self->state == IN_METADATA && (strcmp(name, "meta") == 0 || strcmp(name, "opf:meta") == 0)) {
+  if (self->state == IN_METADATA && tag == META_TAG) {
     bool isCover = false;
     std::string coverItemId;
 
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "name") == 0 && strcmp(atts[i + 1], "cover") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == NAME_ATTRIBUTE && strcmp(atts[i + 1], "cover") == 0) {
         isCover = true;
-      } else if (strcmp(atts[i], "content") == 0) {
+      } else if (attribute == CONTENT_ATTRIBUTE) {
         coverItemId = atts[i + 1];
       }
     }
@@ -157,20 +221,21 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     return;
   }
 
-  if (self->state == IN_MANIFEST && (strcmp(name, "item") == 0 || strcmp(name, "opf:item") == 0)) {
+  if (self->state == IN_MANIFEST && tag == ITEM_TAG) {
     std::string itemId;
     std::string href;
     std::string mediaType;
     std::string properties;
 
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "id") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == ID_ATTRIBUTE) {
         itemId = atts[i + 1];
-      } else if (strcmp(atts[i], "href") == 0) {
+      } else if (attribute == HREF_ATTRIBUTE) {
         href = self->baseContentPath + atts[i + 1];
-      } else if (strcmp(atts[i], "media-type") == 0) {
+      } else if (attribute == MEDIA_TYPE_ATTRIBUTE) {
         mediaType = atts[i + 1];
-      } else if (strcmp(atts[i], "properties") == 0) {
+      } else if (attribute == PROPERTIES_ATTRIBUTE) {
         properties = atts[i + 1];
       }
     }
@@ -206,9 +271,10 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
   // NOTE: This relies on spine appearing after item manifest (which is pretty safe as it's part of the EPUB spec)
   // Only run the spine parsing if there's a cache to add it to
   if (self->cache) {
-    if (self->state == IN_SPINE && (strcmp(name, "itemref") == 0 || strcmp(name, "opf:itemref") == 0)) {
+    if (self->state == IN_SPINE && tag == ITEMREF_TAG) {
       for (int i = 0; atts[i]; i += 2) {
-        if (strcmp(atts[i], "idref") == 0) {
+        const Attribute attribute = ATTRIBUTES.find(atts[i]);
+        if (attribute == IDREF_ATTRIBUTE) {
           const std::string idref = atts[i + 1];
           // Resolve the idref to href using items map
           // TODO: This lookup is slow as need to scan through all items each time.
@@ -230,11 +296,12 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
     }
   }
   // parse the guide
-  if (self->state == IN_GUIDE && (strcmp(name, "reference") == 0 || strcmp(name, "opf:reference") == 0)) {
+  if (self->state == IN_GUIDE && tag == REFERENCE_TAG) {
     std::string type;
     std::string textHref;
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "type") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == TYPE_ATTRIBUTE) {
         type = atts[i + 1];
         if (type == "text" || type == "start") {
           continue;
@@ -242,7 +309,7 @@ void XMLCALL ContentOpfParser::startElement(void* userData, const XML_Char* name
           Serial.printf("[%lu] [COF] Skipping non-text reference in guide: %s\n", millis(), type.c_str());
           break;
         }
-      } else if (strcmp(atts[i], "href") == 0) {
+      } else if (attribute == HREF_ATTRIBUTE) {
         textHref = self->baseContentPath + atts[i + 1];
       }
     }
@@ -270,42 +337,42 @@ void XMLCALL ContentOpfParser::characterData(void* userData, const XML_Char* s,
 
 void XMLCALL ContentOpfParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<ContentOpfParser*>(userData);
-  (void)name;
+  const Tag tag = TAGS.find(name);
 
-  if (self->state == IN_SPINE && (strcmp(name, "spine") == 0 || strcmp(name, "opf:spine") == 0)) {
+  if (self->state == IN_SPINE && tag == SPINE_TAG) {
     self->state = IN_PACKAGE;
     self->tempItemStore.close();
     return;
   }
 
-  if (self->state == IN_GUIDE && (strcmp(name, "guide") == 0 || strcmp(name, "opf:guide") == 0)) {
+  if (self->state == IN_GUIDE && tag == GUIDE_TAG) {
     self->state = IN_PACKAGE;
     self->tempItemStore.close();
     return;
   }
 
-  if (self->state == IN_MANIFEST && (strcmp(name, "manifest") == 0 || strcmp(name, "opf:manifest") == 0)) {
+  if (self->state == IN_MANIFEST && tag == MANIFEST_TAG) {
     self->state = IN_PACKAGE;
     self->tempItemStore.close();
     return;
   }
 
-  if (self->state == IN_BOOK_TITLE && strcmp(name, "dc:title") == 0) {
+  if (self->state == IN_BOOK_TITLE && tag == TITLE_TAG) {
     self->state = IN_METADATA;
     return;
   }
 
-  if (self->state == IN_BOOK_AUTHOR && strcmp(name, "dc:creator") == 0) {
+  if (self->state == IN_BOOK_AUTHOR && tag == CREATOR_TAG) {
     self->state = IN_METADATA;
     return;
   }
 
-  if (self->state == IN_METADATA && (strcmp(name, "metadata") == 0 || strcmp(name, "opf:metadata") == 0)) {
+  if (self->state == IN_METADATA && tag == METADATA_TAG) {
     self->state = IN_PACKAGE;
     return;
   }
 
-  if (self->state == IN_PACKAGE && (strcmp(name, "package") == 0 || strcmp(name, "opf:package") == 0)) {
+  if (self->state == IN_PACKAGE && tag == PACKAGE_TAG) {
     self->state = START;
     return;
   }
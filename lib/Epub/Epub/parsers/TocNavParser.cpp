@@ -1,9 +1,43 @@
 #include "TocNavParser.h"
 
 #include <HardwareSerial.h>
+#include <XmlNames.h>
 
 #include "../BookMetadataCache.h"
 
+namespace {
+enum Tag {
+  OTHER_TAG,
+  HTML_TAG,
+  BODY_TAG,
+  NAV_TAG,
+  OL_TAG,
+  LI_TAG,
+  A_TAG,
+};
+
+constexpr auto TAGS = makeXmlNameTable<Tag>({
+    {"html", HTML_TAG},
+    {"body", BODY_TAG},
+    {"nav", NAV_TAG},
+    {"ol", OL_TAG},
+    {"li", LI_TAG},
+    {"a", A_TAG},
+});
+
+enum Attribute {
+  OTHER_ATTRIBUTE,
+  HREF_ATTRIBUTE,
+  TYPE_ATTRIBUTE,
+};
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<Attribute>({
+    {"href", HREF_ATTRIBUTE},
+    {"epub:type", TYPE_ATTRIBUTE},
+    {"type", TYPE_ATTRIBUTE},
+});
+}  // namespace
+
 bool TocNavParser::setup() {
   parser = XML_ParserCreate(nullptr);
   if (!parser) {
@@ -70,22 +104,24 @@ size_t TocNavParser::write(const uint8_t* buffer, const size_t size) {
 
 void XMLCALL TocNavParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<TocNavParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
   // Track HTML structure loosely - we mainly care about finding <nav epub:type="toc">
-  if (strcmp(name, "html") == 0) {
+  if (tag == HTML_TAG) {
     self->state = IN_HTML;
     return;
   }
 
-  if (self->state == IN_HTML && strcmp(name, "body") == 0) {
+  if (self->state == IN_HTML && tag == BODY_TAG) {
     self->state = IN_BODY;
     return;
   }
 
   // Look for <nav epub:type="toc"> anywhere in body (or nested elements)
-  if (self->state >= IN_BODY && strcmp(name, "nav") == 0) {
+  if (self->state >= IN_BODY && tag == NAV_TAG) {
     for (int i = 0; atts[i]; i += 2) {
-      if ((strcmp(atts[i], "epub:type") == 0 || strcmp(atts[i], "type") == 0) && strcmp(atts[i + 1], "toc") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == TYPE_ATTRIBUTE && strcmp(atts[i + 1], "toc") == 0) {
         self->state = IN_NAV_TOC;
         Serial.printf("[%lu] [NAV] Found nav toc element\n", millis());
         return;
@@ -99,24 +135,25 @@ void XMLCALL TocNavParser::startElement(void* userData, const XML_Char* name, co
     return;
   }
 
-  if (strcmp(name, "ol") == 0) {
+  if (tag == OL_TAG) {
     self->olDepth++;
     self->state = IN_OL;
     return;
   }
 
-  if (self->state == IN_OL && strcmp(name, "li") == 0) {
+  if (self->state == IN_OL && tag == LI_TAG) {
     self->state = IN_LI;
     self->currentLabel.clear();
     self->currentHref.clear();
     return;
   }
 
-  if (self->state == IN_LI && strcmp(name, "a") == 0) {
+  if (self->state == IN_LI && tag == A_TAG) {
     self->state = IN_ANCHOR;
     // Get href attribute
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "href") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == HREF_ATTRIBUTE) {
         self->currentHref = atts[i + 1];
         break;
       }
@@ -136,8 +173,9 @@ void XMLCALL TocNavParser::characterData(void* userData, const XML_Char* s, cons
 
 void XMLCALL TocNavParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<TocNavParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
-  if (strcmp(name, "a") == 0 && self->state == IN_ANCHOR) {
+  if (tag == A_TAG && self->state == IN_ANCHOR) {
     // Create TOC entry when closing anchor tag (we have all data now)
     if (!self->currentLabel.empty() && !self->currentHref.empty()) {
       std::string href = self->baseContentPath + self->currentHref;
@@ -161,12 +199,12 @@ void XMLCALL TocNavParser::endElement(void* userData, const XML_Char* name) {
     return;
   }
 
-  if (strcmp(name, "li") == 0 && (self->state == IN_LI || self->state == IN_OL)) {
+  if (tag == LI_TAG && (self->state == IN_LI || self->state == IN_OL)) {
     self->state = IN_OL;
     return;
   }
 
-  if (strcmp(name, "ol") == 0 && self->state >= IN_NAV_TOC) {
+  if (tag == OL_TAG && self->state >= IN_NAV_TOC) {
     self->olDepth--;
     if (self->olDepth == 0) {
       self->state = IN_NAV_TOC;
@@ -176,7 +214,7 @@ void XMLCALL TocNavParser::endElement(void* userData, const XML_Char* name) {
     return;
   }
 
-  if (strcmp(name, "nav") == 0 && self->state >= IN_NAV_TOC) {
+  if (tag == NAV_TAG && self->state >= IN_NAV_TOC) {
     self->state = IN_BODY;
     Serial.printf("[%lu] [NAV] Finished parsing nav toc\n", millis());
     return;
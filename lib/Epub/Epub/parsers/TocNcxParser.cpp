@@ -1,9 +1,40 @@
 #include "TocNcxParser.h"
 
 #include <HardwareSerial.h>
+#include <XmlNames.h>
 
 #include "../BookMetadataCache.h"
 
+namespace {
+enum Tag {
+  OTHER_TAG,
+  NCX_TAG,
+  NAV_MAP_TAG,
+  NAV_POINT_TAG,
+  NAV_LABEL_TAG,
+  TEXT_TAG,
+  CONTENT_TAG,
+};
+
+constexpr auto TAGS = makeXmlNameTable<Tag>({
+    {"ncx", NCX_TAG},
+    {"navMap", NAV_MAP_TAG},
+    {"navPoint", NAV_POINT_TAG},
+    {"navLabel", NAV_LABEL_TAG},
+    {"text", TEXT_TAG},
+    {"content", CONTENT_TAG},
+});
+
+enum Attribute {
+  OTHER_ATTRIBUTE,
+  SRC_ATTRIBUTE,
+};
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<Attribute>({
+    {"src", SRC_ATTRIBUTE},
+});
+}  // namespace
+
 bool TocNcxParser::setup() {
   parser = XML_ParserCreate(nullptr);
   if (!parser) {
@@ -84,19 +115,20 @@ void XMLCALL TocNcxParser::startElement(void* userData, const XML_Char* name, co
   // </navPoint>
 
   auto* self = static_cast<TocNcxParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
-  if (self->state == START && strcmp(name, "ncx") == 0) {
+  if (self->state == START && tag == NCX_TAG) {
     self->state = IN_NCX;
     return;
   }
 
-  if (self->state == IN_NCX && strcmp(name, "navMap") == 0) {
+  if (self->state == IN_NCX && tag == NAV_MAP_TAG) {
     self->state = IN_NAV_MAP;
     return;
   }
 
   // Handles both top-level and nested navPoints
-  if ((self->state == IN_NAV_MAP || self->state == IN_NAV_POINT) && strcmp(name, "navPoint") == 0) {
+  if ((self->state == IN_NAV_MAP || self->state == IN_NAV_POINT) && tag == NAV_POINT_TAG) {
     self->state = IN_NAV_POINT;
     self->currentDepth++;
 
@@ -105,19 +137,20 @@ void XMLCALL TocNcxParser::startElement(void* userData, const XML_Char* name, co
     return;
   }
 
-  if (self->state == IN_NAV_POINT && strcmp(name, "navLabel") == 0) {
+  if (self->state == IN_NAV_POINT && tag == NAV_LABEL_TAG) {
     self->state = IN_NAV_LABEL;
     return;
   }
 
-  if (self->state == IN_NAV_LABEL && strcmp(name, "text") == 0) {
+  if (self->state == IN_NAV_LABEL && tag == TEXT_TAG) {
     self->state = IN_NAV_LABEL_TEXT;
     return;
   }
 
-  if (self->state == IN_NAV_POINT && strcmp(name, "content") == 0) {
+  if (self->state == IN_NAV_POINT && tag == CONTENT_TAG) {
     for (int i = 0; atts[i]; i += 2) {
-      if (strcmp(atts[i], "src") == 0) {
+      const Attribute attribute = ATTRIBUTES.find(atts[i]);
+      if (attribute == SRC_ATTRIBUTE) {
         self->currentSrc = atts[i + 1];
         break;
       }
@@ -135,18 +168,19 @@ void XMLCALL TocNcxParser::characterData(void* userData, const XML_Char* s, cons
 
 void XMLCALL TocNcxParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<TocNcxParser*>(userData);
+  const Tag tag = TAGS.find(name);
 
-  if (self->state == IN_NAV_LABEL_TEXT && strcmp(name, "text") == 0) {
+  if (self->state == IN_NAV_LABEL_TEXT && tag == TEXT_TAG) {
     self->state = IN_NAV_LABEL;
     return;
   }
 
-  if (self->state == IN_NAV_LABEL && strcmp(name, "navLabel") == 0) {
+  if (self->state == IN_NAV_LABEL && tag == NAV_LABEL_TAG) {
     self->state = IN_NAV_POINT;
     return;
   }
 
-  if (self->state == IN_NAV_POINT && strcmp(name, "navPoint") == 0) {
+  if (self->state == IN_NAV_POINT && tag == NAV_POINT_TAG) {
     self->currentDepth--;
     if (self->currentDepth == 0) {
       self->state = IN_NAV_MAP;
@@ -154,7 +188,7 @@ void XMLCALL TocNcxParser::endElement(void* userData, const XML_Char* name) {
     return;
   }
 
-  if (self->state == IN_NAV_POINT && strcmp(name, "content") == 0) {
+  if (self->state == IN_NAV_POINT && tag == CONTENT_TAG) {
     // At this point (end of content tag), we likely have both Label (from previous tags) and Src.
     // This is the safest place to push the data, assuming <navLabel> always comes before <content>.
     // NCX spec says navLabel comes before content.
@@ -0,0 +1,648 @@
+#include "XhtmlTokenizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+// Longest unfinished token kept between buffers, longer tags lose their attributes
+constexpr size_t MAX_PENDING = 1024;
+// Longest reference, "&" to ";", anything longer is text
+constexpr size_t MAX_REFERENCE_LENGTH = 32;
+constexpr int MAX_ATTRIBUTES = 16;
+
+const char* VOID_ELEMENTS[] = {"area", "base",  "br",   "col",   "embed",  "hr",    "img",
+                               "input", "link", "meta", "param", "source", "track", "wbr"};
+constexpr int NUM_VOID_ELEMENTS = sizeof(VOID_ELEMENTS) / sizeof(VOID_ELEMENTS[0]);
+
+struct NamedReference {
+  const char* name;
+  const char* utf8;
+};
+
+// XML's own references and the HTML ones common in books, other names are dropped like expat drops them
+const NamedReference NAMED_REFERENCES[] = {
+    {"amp", "&"},
+    {"lt", "<"},
+    {"gt", ">"},
+    {"quot", "\""},
+    {"apos", "'"},
+    {"nbsp", "\xC2\xA0"},
+    {"shy", "\xC2\xAD"},
+    {"ensp", "\xE2\x80\x82"},
+    {"emsp", "\xE2\x80\x83"},
+    {"thinsp", "\xE2\x80\x89"},
+    {"ndash", "\xE2\x80\x93"},
+    {"mdash", "\xE2\x80\x94"},
+    {"lsquo", "\xE2\x80\x98"},
+    {"rsquo", "\xE2\x80\x99"},
+    {"sbquo", "\xE2\x80\x9A"},
+    {"ldquo", "\xE2\x80\x9C"},
+    {"rdquo", "\xE2\x80\x9D"},
+    {"bdquo", "\xE2\x80\x9E"},
+    {"bull", "\xE2\x80\xA2"},
+    {"hellip", "\xE2\x80\xA6"},
+    {"laquo", "\xC2\xAB"},
+    {"raquo", "\xC2\xBB"},
+    {"middot", "\xC2\xB7"},
+    {"copy", "\xC2\xA9"},
+    {"reg", "\xC2\xAE"},
+    {"trade", "\xE2\x84\xA2"},
+    {"deg", "\xC2\xB0"},
+    {"times", "\xC3\x97"},
+};
+constexpr int NUM_NAMED_REFERENCES = sizeof(NAMED_REFERENCES) / sizeof(NAMED_REFERENCES[0]);
+
+bool isSpace(const char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
+
+bool isNameStart(const char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (c & 0x80);
+}
+
+char toLower(const char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c; }
+
+bool isVoidElement(const char* name) {
+  for (int i = 0; i < NUM_VOID_ELEMENTS; i++) {
+    if (strcmp(name, VOID_ELEMENTS[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 1 if [pos, end) starts with prefix, -1 if it ends before it could tell, 0 otherwise
+int matchPrefix(const char* pos, const char* end, const char* prefix) {
+  for (; *prefix; pos++, prefix++) {
+    if (pos == end) return -1;
+    if (*pos != *prefix) return 0;
+  }
+  return 1;
+}
+
+// Length of s without a multi-byte UTF-8 sequence cut off at its end
+size_t completeUtf8Length(const char* s, const size_t len) {
+  for (size_t back = 1; back <= 3 && back <= len; back++) {
+    const auto c = static_cast<uint8_t>(s[len - back]);
+    if ((c & 0xC0) == 0x80) {
+      continue;
+    }
+    const size_t sequenceLength = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    return sequenceLength > back ? len - back : len;
+  }
+  return len;
+}
+
+size_t encodeUtf8(const uint32_t cp, char* out) {
+  if (cp < 0x80) {
+    out[0] = static_cast<char>(cp);
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = static_cast<char>(0xC0 | (cp >> 6));
+    out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = static_cast<char>(0xE0 | (cp >> 12));
+    out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = static_cast<char>(0xF0 | (cp >> 18));
+  out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+// Decodes the reference named by [name, name + len), the text between '&' and ';', into out and returns its length.
+// out may be the '&' before name, the decoded text is never longer than the reference. Unknown names decode to nothing.
+size_t decodeReference(const char* name, const size_t len, char* out) {
+  if (len >= 2 && name[0] == '#') {
+    const bool hex = name[1] == 'x' || name[1] == 'X';
+    uint32_t cp = 0;
+    size_t i = hex ? 2 : 1;
+    if (i == len) return 0;
+    for (; i < len; i++) {
+      const char c = name[i];
+      uint32_t digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (hex && toLower(c) >= 'a' && toLower(c) <= 'f') {
+        digit = toLower(c) - 'a' + 10;
+      } else {
+        return 0;
+      }
+      cp = cp * (hex ? 16 : 10) + digit;
+      if (cp > 0x10FFFF) return 0;
+    }
+    if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+    return encodeUtf8(cp, out);
+  }
+
+  for (int i = 0; i < NUM_NAMED_REFERENCES; i++) {
+    if (strncmp(name, NAMED_REFERENCES[i].name, len) == 0 && NAMED_REFERENCES[i].name[len] == '\0') {
+      const size_t utf8Length = strlen(NAMED_REFERENCES[i].utf8);
+      memcpy(out, NAMED_REFERENCES[i].utf8, utf8Length);
+      return utf8Length;
+    }
+  }
+  return 0;
+}
+}  // namespace
+
+XhtmlTokenizer::~XhtmlTokenizer() { free(buffer); }
+
+char* XhtmlTokenizer::getBuffer(const size_t len) {
+  if (pending + len > bufferSize) {
+    const auto grown = static_cast<char*>(realloc(buffer, pending + len));
+    if (!grown) {
+      return nullptr;
+    }
+    buffer = grown;
+    bufferSize = pending + len;
+  }
+  return buffer + pending;
+}
+
+// Chapters declared as ISO-8859-1 are converted to UTF-8 as they come in, as expat does. Other encodings are read as
+// UTF-8. Returns false while the first len bytes may be an unfinished XML declaration.
+bool XhtmlTokenizer::detectEncoding(const size_t len) {
+  if (strncmp(buffer, "<?xml", std::min<size_t>(len, 5)) != 0) {
+    return true;
+  }
+  const char* declarationEnd = len < 5 ? nullptr : static_cast<const char*>(memchr(buffer, '>', len));
+  if (!declarationEnd) {
+    return false;
+  }
+  const std::string declaration(buffer, declarationEnd - buffer);
+  const size_t encoding = declaration.find("encoding");
+  if (encoding == std::string::npos) {
+    return true;
+  }
+  const size_t valueStart = declaration.find_first_of("\"'", encoding);
+  if (valueStart == std::string::npos) {
+    return true;
+  }
+  const size_t valueEnd = declaration.find(declaration[valueStart], valueStart + 1);
+  if (valueEnd == std::string::npos) {
+    return true;
+  }
+  std::string value = declaration.substr(valueStart + 1, valueEnd - valueStart - 1);
+  for (auto& c : value) {
+    c = toLower(c);
+  }
+  latin1 = value == "iso-8859-1" || value == "latin1" || value == "iso8859-1";
+  return true;
+}
+
+// Expands the len bytes of new input after the pending ones from ISO-8859-1 to UTF-8, returns the new length
+size_t XhtmlTokenizer::transcodeLatin1(const size_t len) {
+  size_t highBytes = 0;
+  for (size_t i = pending; i < pending + len; i++) {
+    if (static_cast<uint8_t>(buffer[i]) >= 0x80) {
+      highBytes++;
+    }
+  }
+  if (highBytes == 0) {
+    return len;
+  }
+  if (pending + len + highBytes > bufferSize) {
+    const auto grown = static_cast<char*>(realloc(buffer, pending + len + highBytes));
+    if (!grown) {
+      return 0;
+    }
+    buffer = grown;
+    bufferSize = pending + len + highBytes;
+  }
+  // Back to front, so that the input is read before it is overwritten
+  char* out = buffer + pending + len + highBytes;
+  for (size_t i = pending + len; i-- > pending;) {
+    const auto c = static_cast<uint8_t>(buffer[i]);
+    if (c >= 0x80) {
+      *--out = static_cast<char>(0x80 | (c & 0x3F));
+      *--out = static_cast<char>(0xC0 | (c >> 6));
+    } else {
+      *--out = static_cast<char>(c);
+    }
+  }
+  return len + highBytes;
+}
+
+bool XhtmlTokenizer::parseBuffer(size_t len, const bool isFinal) {
+  if (!buffer) {
+    return false;
+  }
+
+  if (!started) {
+    // Nothing is parsed until the XML declaration, which gives the encoding, has been read whole
+    if (!detectEncoding(pending + len) && !isFinal && pending + len < MAX_PENDING) {
+      pending += len;
+      return true;
+    }
+    started = true;
+    len += pending;
+    pending = 0;
+  }
+  if (latin1 && len > 0) {
+    len = transcodeLatin1(len);
+    if (len == 0) {
+      return false;
+    }
+  }
+
+  char* pos = buffer;
+  char* const end = buffer + pending + len;
+  waiting = false;
+  while (pos < end && !waiting) {
+    switch (mode) {
+      case TEXT:
+        pos = parseText(pos, end, isFinal);
+        break;
+      case COMMENT:
+        pos = parseComment(pos, end, isFinal);
+        break;
+      case CDATA:
+        pos = parseCdata(pos, end, isFinal);
+        break;
+      case DECLARATION:
+        pos = parseDeclaration(pos, end);
+        break;
+      case PROCESSING_INSTRUCTION:
+        pos = parseProcessingInstruction(pos, end, isFinal);
+        break;
+      case LONG_TAG:
+        pos = parseLongTag(pos, end);
+        break;
+    }
+  }
+
+  // Keep what is left for the next buffer
+  pending = end - pos;
+  if (pending > 0 && pos != buffer) {
+    memmove(buffer, pos, pending);
+  }
+
+  if (isFinal) {
+    pending = 0;
+    while (!openElements.empty()) {
+      const std::string name = std::move(openElements.back());
+      openElements.pop_back();
+      if (endElement) endElement(userData, name.c_str());
+    }
+  }
+  return true;
+}
+
+char* XhtmlTokenizer::parseText(char* pos, char* const end, const bool isFinal) {
+  char* markup = pos;
+  while (markup < end && *markup != '<' && *markup != '&') {
+    markup++;
+  }
+
+  if (markup == end) {
+    // Hold back a UTF-8 sequence cut off by the end of the buffer, so that handlers always see whole characters
+    const size_t length = isFinal ? end - pos : completeUtf8Length(pos, end - pos);
+    emitText(pos, length);
+    waiting = pos + length < end;
+    return pos + length;
+  }
+
+  emitText(pos, markup - pos);
+  return *markup == '&' ? parseReference(markup, end, isFinal) : parseMarkup(markup, end, isFinal);
+}
+
+char* XhtmlTokenizer::parseReference(char* pos, char* const end, const bool isFinal) {
+  char* const name = pos + 1;
+  char* const limit = end - name > static_cast<long>(MAX_REFERENCE_LENGTH) ? name + MAX_REFERENCE_LENGTH : end;
+  char* semicolon = name;
+  while (semicolon < limit && *semicolon != ';' && *semicolon != '<' && *semicolon != '&' && !isSpace(*semicolon)) {
+    semicolon++;
+  }
+
+  if (semicolon < limit && *semicolon == ';') {
+    emitText(pos, decodeReference(name, semicolon - name, pos));
+    return semicolon + 1;
+  }
+  if (semicolon == end && !isFinal) {
+    waiting = true;
+    return pos;
+  }
+  // Not a reference, keep the '&'
+  emitText(pos, 1);
+  return pos + 1;
+}
+
+char* XhtmlTokenizer::parseMarkup(char* pos, char* const end, const bool isFinal) {
+  if (end - pos < 2) {
+    if (!isFinal) {
+      waiting = true;
+      return pos;
+    }
+    emitText(pos, 1);
+    return end;
+  }
+
+  if (pos[1] == '!') {
+    const int comment = matchPrefix(pos, end, "<!--");
+    const int cdata = matchPrefix(pos, end, "<![CDATA[");
+    if ((comment < 0 || cdata < 0) && !isFinal) {
+      waiting = true;
+      return pos;
+    }
+    if (comment > 0) {
+      mode = COMMENT;
+      return pos + 4;
+    }
+    if (cdata > 0) {
+      mode = CDATA;
+      return pos + 9;
+    }
+    mode = DECLARATION;
+    declarationDepth = 0;
+    declarationQuote = 0;
+    return pos + 2;
+  }
+
+  if (pos[1] == '?') {
+    mode = PROCESSING_INSTRUCTION;
+    return pos + 2;
+  }
+
+  const bool isEndTag = pos[1] == '/';
+  char* const name = pos + (isEndTag ? 2 : 1);
+  if (name == end) {
+    if (!isFinal) {
+      waiting = true;
+      return pos;
+    }
+    return end;
+  }
+  if (!isNameStart(*name)) {
+    // A '<' that starts no tag, keep it
+    emitText(pos, 1);
+    return pos + 1;
+  }
+
+  // Find the '>', ignoring any in quoted attribute values
+  char quote = 0;
+  char* tagEnd = name;
+  for (; tagEnd < end; tagEnd++) {
+    if (quote) {
+      if (*tagEnd == quote) quote = 0;
+    } else if (*tagEnd == '"' || *tagEnd == '\'') {
+      quote = *tagEnd;
+    } else if (*tagEnd == '>') {
+      break;
+    }
+  }
+
+  if (tagEnd < end) {
+    if (isEndTag) {
+      parseEndTag(name, tagEnd);
+    } else {
+      parseStartTag(name, tagEnd);
+    }
+    return tagEnd + 1;
+  }
+
+  if (isFinal) {
+    // Unterminated tag at the end of the input
+    return end;
+  }
+  if (static_cast<size_t>(end - pos) < MAX_PENDING) {
+    waiting = true;
+    return pos;
+  }
+
+  // Too long to keep, usually an image with inline data. Keep the name and skip to the end of the tag.
+  char* nameEnd = name;
+  while (nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '/') {
+    nameEnd++;
+  }
+  longTagName.assign(name, nameEnd);
+  for (auto& c : longTagName) {
+    c = toLower(c);
+  }
+  longTagIsEnd = isEndTag;
+  longTagQuote = quote;
+  longTagLastChar = end[-1];
+  mode = LONG_TAG;
+  return end;
+}
+
+char* XhtmlTokenizer::parseComment(char* pos, char* const end, const bool isFinal) {
+  for (char* c = pos; c + 2 < end; c++) {
+    if (c[0] == '-' && c[1] == '-' && c[2] == '>') {
+      mode = TEXT;
+      return c + 3;
+    }
+  }
+  if (isFinal || end - pos <= 2) {
+    waiting = !isFinal;
+    return isFinal ? end : pos;
+  }
+  // Keep the last two bytes, they may start the "-->"
+  waiting = true;
+  return end - 2;
+}
+
+char* XhtmlTokenizer::parseCdata(char* pos, char* const end, const bool isFinal) {
+  for (char* c = pos; c + 2 < end; c++) {
+    if (c[0] == ']' && c[1] == ']' && c[2] == '>') {
+      emitText(pos, c - pos);
+      mode = TEXT;
+      return c + 3;
+    }
+  }
+  if (isFinal) {
+    emitText(pos, end - pos);
+    return end;
+  }
+  // Keep the last two bytes, they may start the "]]>", and any UTF-8 sequence they cut off
+  const size_t length = end - pos > 2 ? completeUtf8Length(pos, end - pos - 2) : 0;
+  emitText(pos, length);
+  waiting = true;
+  return pos + length;
+}
+
+char* XhtmlTokenizer::parseDeclaration(char* pos, char* const end) {
+  for (; pos < end; pos++) {
+    const char c = *pos;
+    if (declarationQuote) {
+      if (c == declarationQuote) declarationQuote = 0;
+    } else if (c == '"' || c == '\'') {
+      declarationQuote = c;
+    } else if (c == '[') {
+      declarationDepth++;
+    } else if (c == ']') {
+      declarationDepth--;
+    } else if (c == '>' && declarationDepth <= 0) {
+      mode = TEXT;
+      return pos + 1;
+    }
+  }
+  return end;
+}
+
+char* XhtmlTokenizer::parseProcessingInstruction(char* pos, char* const end, const bool isFinal) {
+  for (char* c = pos; c + 1 < end; c++) {
+    if (c[0] == '?' && c[1] == '>') {
+      mode = TEXT;
+      return c + 2;
+    }
+  }
+  if (isFinal || end - pos <= 1) {
+    waiting = !isFinal;
+    return isFinal ? end : pos;
+  }
+  // Keep the last byte, it may start the "?>"
+  waiting = true;
+  return end - 1;
+}
+
+char* XhtmlTokenizer::parseLongTag(char* pos, char* const end) {
+  for (char* c = pos; c < end; c++) {
+    if (longTagQuote) {
+      if (*c == longTagQuote) longTagQuote = 0;
+    } else if (*c == '"' || *c == '\'') {
+      longTagQuote = *c;
+    } else if (*c == '>') {
+      const bool selfClosing = (c > pos ? c[-1] : longTagLastChar) == '/';
+      mode = TEXT;
+      if (longTagIsEnd) {
+        handleEndElement(longTagName.c_str());
+      } else {
+        const char* atts[] = {nullptr};
+        handleStartElement(longTagName.c_str(), atts, selfClosing);
+      }
+      return c + 1;
+    }
+  }
+  longTagLastChar = end[-1];
+  return end;
+}
+
+// [start, end) is the tag between '<' and '>'. Names are lower cased, values are decoded and all are terminated in
+// place.
+void XhtmlTokenizer::parseStartTag(char* start, char* end) {
+  bool selfClosing = false;
+  if (end > start && end[-1] == '/') {
+    selfClosing = true;
+    end--;
+  }
+  *end = '\0';
+
+  char* c = start;
+  for (; c < end && !isSpace(*c); c++) {
+    *c = toLower(*c);
+  }
+  const char* name = start;
+  if (c < end) {
+    *c++ = '\0';
+  }
+
+  const char* atts[2 * MAX_ATTRIBUTES + 1];
+  int attCount = 0;
+  while (c < end && attCount < MAX_ATTRIBUTES) {
+    while (c < end && isSpace(*c)) c++;
+    if (c == end) break;
+
+    char* const attName = c;
+    for (; c < end && !isSpace(*c) && *c != '='; c++) {
+      *c = toLower(*c);
+    }
+    char* const attNameEnd = c;
+    while (c < end && isSpace(*c)) c++;
+
+    char* value = attNameEnd;
+    char* valueEnd = attNameEnd;
+    if (c < end && *c == '=') {
+      c++;
+      while (c < end && isSpace(*c)) c++;
+      if (c < end && (*c == '"' || *c == '\'')) {
+        const char quote = *c++;
+        value = c;
+        while (c < end && *c != quote) c++;
+      } else {
+        value = c;
+        while (c < end && !isSpace(*c)) c++;
+      }
+      valueEnd = c;
+      if (c < end) c++;
+    }
+    *attNameEnd = '\0';
+    *valueEnd = '\0';
+
+    // Decode references in place, the value only gets shorter
+    char* out = value;
+    for (char* in = value; in < valueEnd;) {
+      if (*in == '&') {
+        char* semicolon = static_cast<char*>(memchr(in, ';', valueEnd - in));
+        if (semicolon && static_cast<size_t>(semicolon - in) <= MAX_REFERENCE_LENGTH) {
+          char decoded[4];
+          const size_t length = decodeReference(in + 1, semicolon - in - 1, decoded);
+          memcpy(out, decoded, length);
+          out += length;
+          in = semicolon + 1;
+          continue;
+        }
+      }
+      *out++ = *in++;
+    }
+    *out = '\0';
+
+    atts[2 * attCount] = attName;
+    atts[2 * attCount + 1] = value;
+    attCount++;
+  }
+  atts[2 * attCount] = nullptr;
+
+  handleStartElement(name, atts, selfClosing);
+}
+
+void XhtmlTokenizer::parseEndTag(char* start, char* const end) {
+  char* c = start;
+  for (; c < end && !isSpace(*c); c++) {
+    *c = toLower(*c);
+  }
+  *c = '\0';
+  handleEndElement(start);
+}
+
+void XhtmlTokenizer::handleStartElement(const char* name, const char** atts, const bool selfClosing) {
+  if (startElement) startElement(userData, name, atts);
+  // Void elements never have content, whether or not they are written as <br/>
+  if (selfClosing || isVoidElement(name)) {
+    if (endElement) endElement(userData, name);
+    return;
+  }
+  openElements.emplace_back(name);
+}
+
+void XhtmlTokenizer::handleEndElement(const char* name) {
+  if (isVoidElement(name)) {
+    // Already ended with its start tag
+    return;
+  }
+  for (size_t i = openElements.size(); i-- > 0;) {
+    if (openElements[i] == name) {
+      // Also ends any element left open inside it
+      while (openElements.size() > i) {
+        const std::string closing = std::move(openElements.back());
+        openElements.pop_back();
+        if (endElement) endElement(userData, closing.c_str());
+      }
+      return;
+    }
+  }
+  // End tag without a start tag, ignored
+}
+
+void XhtmlTokenizer::emitText(const char* s, const size_t len) const {
+  // Text outside the root element is not content, as in XML
+  if (len > 0 && characterData && !openElements.empty()) {
+    characterData(userData, s, static_cast<int>(len));
+  }
+}
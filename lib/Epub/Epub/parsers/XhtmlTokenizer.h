@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Streaming tokenizer for chapter XHTML, used by ChapterHtmlSlimParser in place of expat.
+// Only covers what chapters need: elements with their attributes, text, character references and CDATA sections.
+// Comments, processing instructions and the doctype are skipped. Text is handed to the handler straight from the input
+// buffer, and tag names and attributes are terminated in place, so nothing is copied.
+// Markup that expat rejects is tolerated: void elements such as <br> need no end tag, stray end tags are ignored,
+// elements left open are closed at the end of the input and a '<' or '&' that starts no markup is kept as text.
+// Other differences from expat: element and attribute names are lower cased, common HTML named references such as
+// &nbsp; and &mdash; are decoded rather than dropped, and CRLF line ends in text are passed on as they are.
+class XhtmlTokenizer {
+ public:
+  typedef void (*StartElementHandler)(void* userData, const char* name, const char** atts);
+  typedef void (*CharacterDataHandler)(void* userData, const char* s, int len);
+  typedef void (*EndElementHandler)(void* userData, const char* name);
+
+ private:
+  enum Mode { TEXT, COMMENT, CDATA, DECLARATION, PROCESSING_INSTRUCTION, LONG_TAG };
+
+  void* userData;
+  StartElementHandler startElement;
+  CharacterDataHandler characterData;
+  EndElementHandler endElement;
+
+  // Unconsumed input from the last parse (an unfinished tag, reference or UTF-8 sequence) followed by the new input
+  char* buffer = nullptr;
+  size_t bufferSize = 0;
+  size_t pending = 0;
+  bool started = false;
+  bool latin1 = false;
+  // Set when parsing stops before the end of the buffer to wait for more input
+  bool waiting = false;
+
+  Mode mode = TEXT;
+  std::vector<std::string> openElements;
+  // Skipping a <!DOCTYPE ...> declaration, which may have an internal subset in brackets
+  int declarationDepth = 0;
+  char declarationQuote = 0;
+  // Tag too long to buffer, its attributes are dropped
+  std::string longTagName;
+  bool longTagIsEnd = false;
+  char longTagQuote = 0;
+  char longTagLastChar = 0;
+
+  bool detectEncoding(size_t len);
+  size_t transcodeLatin1(size_t len);
+  char* parseText(char* pos, char* end, bool isFinal);
+  char* parseReference(char* pos, char* end, bool isFinal);
+  char* parseMarkup(char* pos, char* end, bool isFinal);
+  char* parseComment(char* pos, char* end, bool isFinal);
+  char* parseCdata(char* pos, char* end, bool isFinal);
+  char* parseDeclaration(char* pos, char* end);
+  char* parseProcessingInstruction(char* pos, char* end, bool isFinal);
+  char* parseLongTag(char* pos, char* end);
+  void parseStartTag(char* start, char* end);
+  void parseEndTag(char* start, char* end);
+  void handleStartElement(const char* name, const char** atts, bool selfClosing);
+  void handleEndElement(const char* name);
+  void emitText(const char* s, size_t len) const;
+
+ public:
+  explicit XhtmlTokenizer(void* userData, const StartElementHandler startElement,
+                          const CharacterDataHandler characterData, const EndElementHandler endElement)
+      : userData(userData), startElement(startElement), characterData(characterData), endElement(endElement) {}
+  ~XhtmlTokenizer();
+  XhtmlTokenizer(const XhtmlTokenizer&) = delete;
+  XhtmlTokenizer& operator=(const XhtmlTokenizer&) = delete;
+
+  // Like XML_GetBuffer and XML_ParseBuffer: read up to len bytes into the returned buffer, then parse them.
+  // Both fail only when memory runs out.
+  char* getBuffer(size_t len);
+  bool parseBuffer(size_t len, bool isFinal);
+};
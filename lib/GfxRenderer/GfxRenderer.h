@@ -29,11 +29,15 @@ class GfxRenderer {
   RenderMode renderMode;
   Orientation orientation;
   uint8_t* bwBufferChunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
+  // When set, drawing goes into this buffer instead of the display's framebuffer (see offscreen)
+  uint8_t* drawBuffer = nullptr;
   std::map<int, EpdFontFamily> fontMap;
   void renderChar(const EpdFontFamily& fontFamily, uint32_t cp, int* x, const int* y, bool pixelState,
                   EpdFontFamily::Style style) const;
   void freeBwBufferChunks();
   void rotateCoordinates(int x, int y, int* rotatedX, int* rotatedY) const;
+  GfxRenderer(EInkDisplay& einkDisplay, uint8_t* drawBuffer)
+      : einkDisplay(einkDisplay), renderMode(BW), orientation(Portrait), drawBuffer(drawBuffer) {}
 
  public:
   explicit GfxRenderer(EInkDisplay& einkDisplay) : einkDisplay(einkDisplay), renderMode(BW), orientation(Portrait) {}
@@ -103,6 +107,9 @@ class GfxRenderer {
 
   // Low level functions
   uint8_t* getFrameBuffer() const;
+  // A renderer that draws into buffer (getBufferSize() bytes) and never touches the display, so it can be used by
+  // another task. It has no fonts; only the drawing primitives and drawBitmap are meant to be used on it.
+  GfxRenderer offscreen(uint8_t* buffer) const { return GfxRenderer(einkDisplay, buffer); }
   static size_t getBufferSize();
   void grayscaleRevert() const;
   void getOrientedViewableTRBL(int* outTop, int* outRight, int* outBottom, int* outLeft) const;
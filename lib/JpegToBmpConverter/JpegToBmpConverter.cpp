@@ -8,8 +8,10 @@
 #include <cstring>
 
 // Context structure for picojpeg callback
+// Reads from either a file or a zip item
 struct JpegReadContext {
-  FsFile& file;
+  FsFile* file;
+  ZipFile::ItemReader* zipItem;
   uint8_t buffer[512];
   size_t bufferPos;
   size_t bufferFilled;
@@ -400,13 +402,18 @@ unsigned char JpegToBmpConverter::jpegReadCallback(unsigned char* pBuf, const un
                                                    unsigned char* pBytes_actually_read, void* pCallback_data) {
   auto* context = static_cast<JpegReadContext*>(pCallback_data);
 
-  if (!context || !context->file) {
+  if (!context || (context->file ? !*context->file : !context->zipItem)) {
     return PJPG_STREAM_READ_ERROR;
   }
 
   // Check if we need to refill our context buffer
   if (context->bufferPos >= context->bufferFilled) {
-    context->bufferFilled = context->file.read(context->buffer, sizeof(context->buffer));
+    const int dataRead = context->file ? context->file->read(context->buffer, sizeof(context->buffer))
+                                       : context->zipItem->read(context->buffer, sizeof(context->buffer));
+    if (dataRead < 0) {
+      return PJPG_STREAM_READ_ERROR;
+    }
+    context->bufferFilled = dataRead;
     context->bufferPos = 0;
 
     if (context->bufferFilled == 0) {
@@ -429,10 +436,19 @@ unsigned char JpegToBmpConverter::jpegReadCallback(unsigned char* pBuf, const un
 
 // Core function: Convert JPEG file to 2-bit BMP
 bool JpegToBmpConverter::jpegFileToBmpStream(FsFile& jpegFile, Print& bmpOut) {
-  Serial.printf("[%lu] [JPG] Converting JPEG to BMP\n", millis());
+  JpegReadContext context = {.file = &jpegFile, .zipItem = nullptr, .buffer = {}, .bufferPos = 0, .bufferFilled = 0};
+  return jpegToBmpStream(context, bmpOut, nullptr);
+}
+
+bool JpegToBmpConverter::jpegZipItemToBmpStream(ZipFile::ItemReader& jpegItem, Print& bmpOut,
+                                                const std::function<bool()>& yieldFn) {
+  JpegReadContext context = {.file = nullptr, .zipItem = &jpegItem, .buffer = {}, .bufferPos = 0, .bufferFilled = 0};
+  return jpegToBmpStream(context, bmpOut, yieldFn);
+}
 
-  // Setup context for picojpeg callback
-  JpegReadContext context = {.file = jpegFile, .bufferPos = 0, .bufferFilled = 0};
+bool JpegToBmpConverter::jpegToBmpStream(JpegReadContext& context, Print& bmpOut,
+                                         const std::function<bool()>& yieldFn) {
+  Serial.printf("[%lu] [JPG] Converting JPEG to BMP\n", millis());
 
   // Initialize picojpeg decoder
   pjpeg_image_info_t imageInfo;
@@ -555,7 +571,13 @@ bool JpegToBmpConverter::jpegFileToBmpStream(FsFile& jpegFile, Print& bmpOut) {
   // Process MCUs row-by-row and write to BMP as we go (top-down)
   const int mcuPixelWidth = imageInfo.m_MCUWidth;
 
+  bool cancelled = false;
   for (int mcuY = 0; mcuY < imageInfo.m_MCUSPerCol; mcuY++) {
+    if (yieldFn && !yieldFn()) {
+      cancelled = true;
+      break;
+    }
+
     // Clear the MCU row buffer
     memset(mcuRowBuffer, 0, mcuRowPixels);
 
@@ -735,6 +757,10 @@ bool JpegToBmpConverter::jpegFileToBmpStream(FsFile& jpegFile, Print& bmpOut) {
   free(mcuRowBuffer);
   free(rowBuffer);
 
+  if (cancelled) {
+    Serial.printf("[%lu] [JPG] JPEG to BMP conversion cancelled\n", millis());
+    return false;
+  }
   Serial.printf("[%lu] [JPG] Successfully converted JPEG to BMP\n", millis());
   return true;
 }
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <ZipFile.h>
+
+#include <functional>
+
 class FsFile;
 class Print;
-class ZipFile;
+struct JpegReadContext;
 
 class JpegToBmpConverter {
   static void writeBmpHeader(Print& bmpOut, int width, int height);
   // [COMMENTED OUT] static uint8_t grayscaleTo2Bit(uint8_t grayscale, int x, int y);
   static unsigned char jpegReadCallback(unsigned char* pBuf, unsigned char buf_size,
                                         unsigned char* pBytes_actually_read, void* pCallback_data);
+  static bool jpegToBmpStream(JpegReadContext& context, Print& bmpOut, const std::function<bool()>& yieldFn);
 
  public:
   static bool jpegFileToBmpStream(FsFile& jpegFile, Print& bmpOut);
+  // Decodes while the item is inflated, without extracting it to a file first. yieldFn is called between rows of
+  // MCUs, return false to abort.
+  static bool jpegZipItemToBmpStream(ZipFile::ItemReader& jpegItem, Print& bmpOut,
+                                     const std::function<bool()>& yieldFn = nullptr);
 };
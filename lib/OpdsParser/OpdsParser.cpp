@@ -1,9 +1,44 @@
 #include "OpdsParser.h"
 
 #include <HardwareSerial.h>
+#include <XmlNames.h>
 
 #include <cstring>
 
+namespace {
+enum Tag {
+  OTHER_TAG,
+  ENTRY_TAG,
+  TITLE_TAG,
+  AUTHOR_TAG,
+  NAME_TAG,
+  ID_TAG,
+  LINK_TAG,
+};
+
+constexpr auto TAGS = makeXmlNameTable<Tag>({
+    {"entry", ENTRY_TAG},
+    {"title", TITLE_TAG},
+    {"author", AUTHOR_TAG},
+    {"name", NAME_TAG},
+    {"id", ID_TAG},
+    {"link", LINK_TAG},
+});
+
+enum Attribute {
+  OTHER_ATTRIBUTE,
+  REL_ATTRIBUTE,
+  TYPE_ATTRIBUTE,
+  HREF_ATTRIBUTE,
+};
+
+constexpr auto ATTRIBUTES = makeXmlNameTable<Attribute>({
+    {"rel", REL_ATTRIBUTE},
+    {"type", TYPE_ATTRIBUTE},
+    {"href", HREF_ATTRIBUTE},
+});
+}  // namespace
+
 OpdsParser::~OpdsParser() {
   if (parser) {
     XML_StopParser(parser, XML_FALSE);
@@ -86,20 +121,12 @@ std::vector<OpdsEntry> OpdsParser::getBooks() const {
   return books;
 }
 
-const char* OpdsParser::findAttribute(const XML_Char** atts, const char* name) {
-  for (int i = 0; atts[i]; i += 2) {
-    if (strcmp(atts[i], name) == 0) {
-      return atts[i + 1];
-    }
-  }
-  return nullptr;
-}
-
 void XMLCALL OpdsParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<OpdsParser*>(userData);
+  const Tag tag = TAGS.findLocal(name);
 
-  // Check for entry element (with or without namespace prefix)
-  if (strcmp(name, "entry") == 0 || strstr(name, ":entry") != nullptr) {
+  // Elements are matched with or without a namespace prefix
+  if (tag == ENTRY_TAG) {
     self->inEntry = true;
     self->currentEntry = OpdsEntry{};
     return;
@@ -108,37 +135,52 @@ void XMLCALL OpdsParser::startElement(void* userData, const XML_Char* name, cons
   if (!self->inEntry) return;
 
   // Check for title element
-  if (strcmp(name, "title") == 0 || strstr(name, ":title") != nullptr) {
+  if (tag == TITLE_TAG) {
     self->inTitle = true;
     self->currentText.clear();
     return;
   }
 
   // Check for author element
-  if (strcmp(name, "author") == 0 || strstr(name, ":author") != nullptr) {
+  if (tag == AUTHOR_TAG) {
     self->inAuthor = true;
     return;
   }
 
   // Check for author name element
-  if (self->inAuthor && (strcmp(name, "name") == 0 || strstr(name, ":name") != nullptr)) {
+  if (self->inAuthor && tag == NAME_TAG) {
     self->inAuthorName = true;
     self->currentText.clear();
     return;
   }
 
   // Check for id element
-  if (strcmp(name, "id") == 0 || strstr(name, ":id") != nullptr) {
+  if (tag == ID_TAG) {
     self->inId = true;
     self->currentText.clear();
     return;
   }
 
   // Check for link element
-  if (strcmp(name, "link") == 0 || strstr(name, ":link") != nullptr) {
-    const char* rel = findAttribute(atts, "rel");
-    const char* type = findAttribute(atts, "type");
-    const char* href = findAttribute(atts, "href");
+  if (tag == LINK_TAG) {
+    const char* rel = nullptr;
+    const char* type = nullptr;
+    const char* href = nullptr;
+    for (int i = 0; atts[i]; i += 2) {
+      switch (ATTRIBUTES.find(atts[i])) {
+        case REL_ATTRIBUTE:
+          rel = atts[i + 1];
+          break;
+        case TYPE_ATTRIBUTE:
+          type = atts[i + 1];
+          break;
+        case HREF_ATTRIBUTE:
+          href = atts[i + 1];
+          break;
+        default:
+          break;
+      }
+    }
 
     if (href) {
       // Check for acquisition link with epub type (this is a downloadable book)
@@ -161,9 +203,10 @@ void XMLCALL OpdsParser::startElement(void* userData, const XML_Char* name, cons
 
 void XMLCALL OpdsParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<OpdsParser*>(userData);
+  const Tag tag = TAGS.findLocal(name);
 
   // Check for entry end
-  if (strcmp(name, "entry") == 0 || strstr(name, ":entry") != nullptr) {
+  if (tag == ENTRY_TAG) {
     // Only add entry if it has required fields (title and href)
     if (!self->currentEntry.title.empty() && !self->currentEntry.href.empty()) {
       self->entries.push_back(self->currentEntry);
@@ -176,7 +219,7 @@ void XMLCALL OpdsParser::endElement(void* userData, const XML_Char* name) {
   if (!self->inEntry) return;
 
   // Check for title end
-  if (strcmp(name, "title") == 0 || strstr(name, ":title") != nullptr) {
+  if (tag == TITLE_TAG) {
     if (self->inTitle) {
       self->currentEntry.title = self->currentText;
     }
@@ -185,13 +228,13 @@ void XMLCALL OpdsParser::endElement(void* userData, const XML_Char* name) {
   }
 
   // Check for author end
-  if (strcmp(name, "author") == 0 || strstr(name, ":author") != nullptr) {
+  if (tag == AUTHOR_TAG) {
     self->inAuthor = false;
     return;
   }
 
   // Check for author name end
-  if (self->inAuthor && (strcmp(name, "name") == 0 || strstr(name, ":name") != nullptr)) {
+  if (self->inAuthor && tag == NAME_TAG) {
     if (self->inAuthorName) {
       self->currentEntry.author = self->currentText;
     }
@@ -200,7 +243,7 @@ void XMLCALL OpdsParser::endElement(void* userData, const XML_Char* name) {
   }
 
   // Check for id end
-  if (strcmp(name, "id") == 0 || strstr(name, ":id") != nullptr) {
+  if (tag == ID_TAG) {
     if (self->inId) {
       self->currentEntry.id = self->currentText;
     }
@@ -82,9 +82,6 @@ class OpdsParser {
   static void XMLCALL endElement(void* userData, const XML_Char* name);
   static void XMLCALL characterData(void* userData, const XML_Char* s, int len);
 
-  // Helper to find attribute value
-  static const char* findAttribute(const XML_Char** atts, const char* name);
-
   XML_Parser parser = nullptr;
   std::vector<OpdsEntry> entries;
   OpdsEntry currentEntry;
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Classifies the element and attribute names an XML parser handles, so that callbacks switch on an enum instead of
+// running strcmp chains. Each table is a perfect hash built at compile time: a lookup is one hash of the name and one
+// compare with the only name that can be in its slot. Names not in the table give Id{}, the enum's first value.
+//
+//   enum Tag { OTHER_TAG, PACKAGE_TAG, SPINE_TAG };
+//   constexpr auto TAGS = makeXmlNameTable<Tag>({{"package", PACKAGE_TAG}, {"opf:package", PACKAGE_TAG}, ...});
+//   switch (TAGS.find(name)) { ... }
+
+template <typename Id>
+struct XmlName {
+  const char* name;
+  Id id;
+};
+
+// Not constexpr: reaching it while building a table is a compile error. The table has a name twice, or too many.
+void xmlNameTableHasNoPerfectHash();
+
+template <typename Id, size_t Count>
+class XmlNameTable {
+  static_assert(Count < 255, "Slots hold 8-bit entry indices");
+
+  // At most a quarter full, a seed without collisions is then found after a few tries
+  static constexpr size_t slotCount() {
+    size_t size = 8;
+    while (size < Count * 4) size *= 2;
+    return size;
+  }
+  static constexpr size_t SLOT_COUNT = slotCount();
+  static constexpr uint32_t MAX_SEED = 100000;
+
+  XmlName<Id> entries[Count] = {};
+  uint8_t slots[SLOT_COUNT] = {};  // Entry index + 1, 0 for empty
+  uint32_t seed = 0;
+
+  // FNV-1a, starting from the seed
+  static constexpr uint32_t hash(const char* s, const uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (; *s; s++) {
+      h = (h ^ static_cast<uint8_t>(*s)) * 16777619u;
+    }
+    return h ^ (h >> 16);
+  }
+
+  static constexpr bool equal(const char* a, const char* b) {
+    for (; *a && *a == *b; a++, b++) {
+    }
+    return *a == *b;
+  }
+
+  constexpr Id lookup(const uint32_t h, const char* name) const {
+    const uint8_t slot = slots[h & (SLOT_COUNT - 1)];
+    if (slot == 0 || !equal(entries[slot - 1].name, name)) {
+      return Id{};
+    }
+    return entries[slot - 1].id;
+  }
+
+ public:
+  constexpr explicit XmlNameTable(const XmlName<Id> (&names)[Count]) {
+    for (size_t i = 0; i < Count; i++) {
+      entries[i] = names[i];
+    }
+    for (seed = 1; seed <= MAX_SEED; seed++) {
+      for (auto& slot : slots) {
+        slot = 0;
+      }
+      bool collision = false;
+      for (size_t i = 0; i < Count && !collision; i++) {
+        uint8_t& slot = slots[hash(entries[i].name, seed) & (SLOT_COUNT - 1)];
+        collision = slot != 0;
+        slot = static_cast<uint8_t>(i + 1);
+      }
+      if (!collision) {
+        return;
+      }
+    }
+    xmlNameTableHasNoPerfectHash();
+  }
+
+  constexpr Id find(const char* name) const { return lookup(hash(name, seed), name); }
+
+  // Ignores any namespace prefix, "atom:entry" is found as "entry"
+  constexpr Id findLocal(const char* name) const {
+    const char* local = name;
+    for (const char* c = name; *c; c++) {
+      if (*c == ':') local = c + 1;
+    }
+    return find(local);
+  }
+};
+
+template <typename Id, size_t Count>
+constexpr XmlNameTable<Id, Count> makeXmlNameTable(const XmlName<Id> (&names)[Count]) {
+  return XmlNameTable<Id, Count>(names);
+}
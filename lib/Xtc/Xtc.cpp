@@ -7,6 +7,7 @@
 
 #include "Xtc.h"
 
+#include <BookCacheKey.h>
 #include <FsHelpers.h>
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
@@ -25,18 +26,20 @@ bool Xtc::load() {
     return false;
   }
 
+  // Resolved here rather than on first use, which may be on any of the reader's tasks
+  getCachePath();
   loaded = true;
   Serial.printf("[%lu] [XTC] Loaded XTC: %s (%lu pages)\n", millis(), filepath.c_str(), parser->getPageCount());
   return true;
 }
 
 bool Xtc::clearCache() const {
-  if (!SdMan.exists(cachePath.c_str())) {
+  if (!SdMan.exists(getCachePath().c_str())) {
     Serial.printf("[%lu] [XTC] Cache does not exist, no action needed\n", millis());
     return true;
   }
 
-  if (!SdMan.removeDir(cachePath.c_str())) {
+  if (!SdMan.removeDir(getCachePath().c_str())) {
     Serial.printf("[%lu] [XTC] Failed to clear cache\n", millis());
     return false;
   }
@@ -46,17 +49,25 @@ bool Xtc::clearCache() const {
 }
 
 void Xtc::setupCacheDir() const {
-  if (SdMan.exists(cachePath.c_str())) {
+  const std::string& path = getCachePath();
+  if (SdMan.exists(path.c_str())) {
     return;
   }
 
   // Create directories recursively
-  for (size_t i = 1; i < cachePath.length(); i++) {
-    if (cachePath[i] == '/') {
-      SdMan.mkdir(cachePath.substr(0, i).c_str());
+  for (size_t i = 1; i < path.length(); i++) {
+    if (path[i] == '/') {
+      SdMan.mkdir(path.substr(0, i).c_str());
     }
   }
-  SdMan.mkdir(cachePath.c_str());
+  SdMan.mkdir(path.c_str());
+}
+
+const std::string& Xtc::getCachePath() const {
+  if (cachePath.empty()) {
+    cachePath = BookCacheKey::cachePath(filepath, cacheDir, "xtc_");
+  }
+  return cachePath;
 }
 
 std::string Xtc::getTitle() const {
@@ -102,9 +113,9 @@ const std::vector<xtc::ChapterInfo>& Xtc::getChapters() const {
   return parser->getChapters();
 }
 
-std::string Xtc::getCoverBmpPath() const { return cachePath + "/cover.bmp"; }
+std::string Xtc::getCoverBmpPath() const { return getCachePath() + "/cover.bmp"; }
 
-bool Xtc::generateCoverBmp() const {
+bool Xtc::generateCoverBmp(const std::function<bool()>& yieldFn) const {
   // Already generated
   if (SdMan.exists(getCoverBmpPath().c_str())) {
     return true;
@@ -155,6 +166,10 @@ bool Xtc::generateCoverBmp() const {
     free(pageBuffer);
     return false;
   }
+  if (yieldFn && !yieldFn()) {
+    free(pageBuffer);
+    return false;
+  }
 
   // Create BMP file
   FsFile coverBmp;
@@ -337,6 +352,32 @@ xtc::XtcError Xtc::loadPageStreaming(uint32_t pageIndex,
   return const_cast<xtc::XtcParser*>(parser.get())->loadPageStreaming(pageIndex, callback, chunkSize);
 }
 
+size_t Xtc::getStoredPageSize(uint32_t pageIndex) const {
+  if (!loaded || !parser) {
+    return 0;
+  }
+  return const_cast<xtc::XtcParser*>(parser.get())->getStoredPageSize(pageIndex);
+}
+
+size_t Xtc::readStoredPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize,
+                           const std::function<bool()>& yieldFn, size_t chunkSize) const {
+  if (!loaded || !parser) {
+    return 0;
+  }
+  return const_cast<xtc::XtcParser*>(parser.get())->readStoredPage(pageIndex, buffer, bufferSize, yieldFn,
+                                                                   chunkSize);
+}
+
+xtc::XtcError Xtc::decodeStoredPage(uint32_t pageIndex, const uint8_t* storedPage, size_t storedSize,
+                                    std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
+                                    size_t chunkSize) const {
+  if (!loaded || !parser) {
+    return xtc::XtcError::FILE_NOT_FOUND;
+  }
+  return const_cast<xtc::XtcParser*>(parser.get())->decodeStoredPage(pageIndex, storedPage, storedSize, callback,
+                                                                     chunkSize);
+}
+
 uint8_t Xtc::calculateProgress(uint32_t currentPage) const {
   if (!loaded || !parser || parser->getPageCount() == 0) {
     return 0;
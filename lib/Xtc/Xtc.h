@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,15 +23,16 @@
  */
 class Xtc {
   std::string filepath;
-  std::string cachePath;
+  std::string cacheDir;
+  // Cache directory named by the file's content, so it survives renames and moves. Resolved by the first
+  // getCachePath(), as it reads the book (and keys.bin) from the SD card.
+  mutable std::string cachePath;
   std::unique_ptr<xtc::XtcParser> parser;
   bool loaded;
 
  public:
-  explicit Xtc(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)), loaded(false) {
-    // Create cache key based on filepath (same as Epub)
-    cachePath = cacheDir + "/xtc_" + std::to_string(std::hash<std::string>{}(this->filepath));
-  }
+  explicit Xtc(std::string filepath, std::string cacheDir)
+      : filepath(std::move(filepath)), cacheDir(std::move(cacheDir)), loaded(false) {}
   ~Xtc() = default;
 
   /**
@@ -51,7 +53,7 @@ class Xtc {
   void setupCacheDir() const;
 
   // Path accessors
-  const std::string& getCachePath() const { return cachePath; }
+  const std::string& getCachePath() const;
   const std::string& getPath() const { return filepath; }
 
   // Metadata
@@ -61,7 +63,8 @@ class Xtc {
 
   // Cover image support (for sleep screen)
   std::string getCoverBmpPath() const;
-  bool generateCoverBmp() const;
+  // yieldFn is called between reading the cover page and writing the BMP, return false to abort
+  bool generateCoverBmp(const std::function<bool()>& yieldFn = nullptr) const;
 
   // Page access
   uint32_t getPageCount() const;
@@ -89,6 +92,17 @@ class Xtc {
                                   std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
                                   size_t chunkSize = 1024) const;
 
+  /**
+   * Stored page access (page header and payload as held in the file, still compressed if the page is)
+   * Lets a caller keep pages in RAM and decode them later without another SD read.
+   */
+  size_t getStoredPageSize(uint32_t pageIndex) const;
+  size_t readStoredPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize,
+                        const std::function<bool()>& yieldFn = nullptr, size_t chunkSize = 4096) const;
+  xtc::XtcError decodeStoredPage(uint32_t pageIndex, const uint8_t* storedPage, size_t storedSize,
+                                 std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
+                                 size_t chunkSize = 1024) const;
+
   // Progress calculation
   uint8_t calculateProgress(uint32_t currentPage) const;
 
@@ -10,13 +10,18 @@
 #include <FsHelpers.h>
 #include <HardwareSerial.h>
 #include <SDCardManager.h>
+#include <miniz.h>
 
+#include <algorithm>
 #include <cstring>
 
 namespace xtc {
 
 XtcParser::XtcParser()
     : m_isOpen(false),
+      m_pageCount(0),
+      m_pageTableWindowStart(0),
+      m_pageTableWindowCount(0),
       m_defaultWidth(DISPLAY_WIDTH),
       m_defaultHeight(DISPLAY_HEIGHT),
       m_bitDepth(1),
@@ -67,7 +72,7 @@ XtcError XtcParser::open(const char* filepath) {
   }
 
   m_isOpen = true;
-  Serial.printf("[%lu] [XTC] Opened file: %s (%u pages, %dx%d)\n", millis(), filepath, m_header.pageCount,
+  Serial.printf("[%lu] [XTC] Opened file: %s (%lu pages, %dx%d)\n", millis(), filepath, m_pageCount,
                 m_defaultWidth, m_defaultHeight);
   return XtcError::OK;
 }
@@ -77,7 +82,9 @@ void XtcParser::close() {
     m_file.close();
     m_isOpen = false;
   }
-  m_pageTable.clear();
+  m_pageCount = 0;
+  m_pageTableWindowStart = 0;
+  m_pageTableWindowCount = 0;
   m_chapters.clear();
   m_title.clear();
   m_hasChapters = false;
@@ -111,11 +118,6 @@ XtcError XtcParser::readHeader() {
     return XtcError::INVALID_VERSION;
   }
 
-  // Basic validation
-  if (m_header.pageCount == 0) {
-    return XtcError::CORRUPTED_HEADER;
-  }
-
   Serial.printf("[%lu] [XTC] Header: magic=0x%08X (%s), ver=%u.%u, pages=%u, bitDepth=%u\n", millis(), m_header.magic,
                 (m_header.magic == XTCH_MAGIC) ? "XTCH" : "XTC", m_header.versionMajor, m_header.versionMinor,
                 m_header.pageCount, m_bitDepth);
@@ -126,7 +128,9 @@ XtcError XtcParser::readHeader() {
 XtcError XtcParser::readTitle() {
   // Title is usually at offset 0x38 (56) for 88-byte headers
   // Read title as null-terminated UTF-8 string
-  if (m_header.titleOffset == 0) {
+  // Files with chapters keep the chapter table offset at 0x30 instead (see readChapters), their title is at 0x38
+  const bool hasChapterTable = (m_header.flags >> 24) == 1;
+  if (m_header.titleOffset == 0 || hasChapterTable) {
     m_header.titleOffset = 0x38;  // Default offset
   }
 
@@ -148,37 +152,64 @@ XtcError XtcParser::readPageTable() {
     return XtcError::CORRUPTED_HEADER;
   }
 
-  // Seek to page table
-  if (!m_file.seek(m_header.pageTableOffset)) {
-    Serial.printf("[%lu] [XTC] Failed to seek to page table at %llu\n", millis(), m_header.pageTableOffset);
-    return XtcError::READ_ERROR;
+  // The header only has room for 16 bits of page count. When the page table (which runs up to the page data) holds
+  // more entries than that, and agrees with the header on the low 16 bits, trust the table's extent instead.
+  m_pageCount = m_header.pageCount;
+  if (m_header.dataOffset > m_header.pageTableOffset) {
+    const uint64_t tableEntries = (m_header.dataOffset - m_header.pageTableOffset) / sizeof(PageTableEntry);
+    if (tableEntries > UINT16_MAX && tableEntries <= UINT32_MAX && (tableEntries & 0xFFFF) == m_header.pageCount) {
+      m_pageCount = static_cast<uint32_t>(tableEntries);
+    }
+  }
+
+  // Basic validation
+  if (m_pageCount == 0) {
+    return XtcError::CORRUPTED_HEADER;
   }
 
-  m_pageTable.resize(m_header.pageCount);
+  if (m_header.pageTableOffset + static_cast<uint64_t>(m_pageCount) * sizeof(PageTableEntry) > m_file.size()) {
+    Serial.printf("[%lu] [XTC] Page table (%lu entries at %llu) runs past end of file\n", millis(), m_pageCount,
+                  m_header.pageTableOffset);
+    return XtcError::CORRUPTED_HEADER;
+  }
 
-  // Read page table entries
-  for (uint16_t i = 0; i < m_header.pageCount; i++) {
-    PageTableEntry entry;
-    size_t bytesRead = m_file.read(reinterpret_cast<uint8_t*>(&entry), sizeof(PageTableEntry));
-    if (bytesRead != sizeof(PageTableEntry)) {
-      Serial.printf("[%lu] [XTC] Failed to read page table entry %u\n", millis(), i);
-      return XtcError::READ_ERROR;
-    }
+  // Entries are fixed size and directly seekable, so only the first window is read up front
+  m_pageTableWindowCount = 0;
+  const XtcError err = loadPageTableWindow(0);
+  if (err != XtcError::OK) {
+    return err;
+  }
 
-    m_pageTable[i].offset = static_cast<uint32_t>(entry.dataOffset);
-    m_pageTable[i].size = entry.dataSize;
-    m_pageTable[i].width = entry.width;
-    m_pageTable[i].height = entry.height;
-    m_pageTable[i].bitDepth = m_bitDepth;
+  // Default dimensions come from the first page
+  m_defaultWidth = m_pageTableWindow[0].width;
+  m_defaultHeight = m_pageTableWindow[0].height;
 
-    // Update default dimensions from first page
-    if (i == 0) {
-      m_defaultWidth = entry.width;
-      m_defaultHeight = entry.height;
-    }
+  Serial.printf("[%lu] [XTC] Page table: %lu entries\n", millis(), m_pageCount);
+  return XtcError::OK;
+}
+
+XtcError XtcParser::loadPageTableWindow(const uint32_t pageIndex) {
+  // Keep a few entries behind the requested page as well, so paging backwards stays cached too
+  uint32_t start = pageIndex > PAGE_TABLE_WINDOW_SIZE / 4 ? pageIndex - PAGE_TABLE_WINDOW_SIZE / 4 : 0;
+  if (m_pageCount > PAGE_TABLE_WINDOW_SIZE && start > m_pageCount - PAGE_TABLE_WINDOW_SIZE) {
+    start = m_pageCount - PAGE_TABLE_WINDOW_SIZE;
   }
+  const uint32_t count = std::min(PAGE_TABLE_WINDOW_SIZE, m_pageCount - start);
 
-  Serial.printf("[%lu] [XTC] Read %u page table entries\n", millis(), m_header.pageCount);
+  m_pageTableWindowCount = 0;
+  if (!m_file.seek(m_header.pageTableOffset + static_cast<uint64_t>(start) * sizeof(PageTableEntry))) {
+    Serial.printf("[%lu] [XTC] Failed to seek to page table entry %lu\n", millis(), start);
+    return XtcError::READ_ERROR;
+  }
+
+  const size_t bytesToRead = count * sizeof(PageTableEntry);
+  if (m_file.read(reinterpret_cast<uint8_t*>(m_pageTableWindow), bytesToRead) != static_cast<int>(bytesToRead)) {
+    Serial.printf("[%lu] [XTC] Failed to read page table entries %lu-%lu\n", millis(), start, start + count - 1);
+    return XtcError::READ_ERROR;
+  }
+
+  m_pageTableWindowStart = start;
+  m_pageTableWindowCount = count;
   return XtcError::OK;
 }
 
@@ -267,12 +298,12 @@ XtcError XtcParser::readChapters() {
       endPage--;
     }
 
-    if (startPage >= m_header.pageCount) {
+    if (startPage >= m_pageCount) {
       continue;
     }
 
-    if (endPage >= m_header.pageCount) {
-      endPage = m_header.pageCount - 1;
+    if (endPage >= m_pageCount) {
+      endPage = m_pageCount - 1;
     }
 
     if (startPage > endPage) {
@@ -288,56 +319,71 @@ XtcError XtcParser::readChapters() {
   return XtcError::OK;
 }
 
-bool XtcParser::getPageInfo(uint32_t pageIndex, PageInfo& info) const {
-  if (pageIndex >= m_pageTable.size()) {
+bool XtcParser::getPageInfo(uint32_t pageIndex, PageInfo& info) {
+  if (pageIndex >= m_pageCount) {
     return false;
   }
-  info = m_pageTable[pageIndex];
+
+  if (pageIndex < m_pageTableWindowStart || pageIndex >= m_pageTableWindowStart + m_pageTableWindowCount) {
+    if (loadPageTableWindow(pageIndex) != XtcError::OK) {
+      return false;
+    }
+  }
+
+  const PageTableEntry& entry = m_pageTableWindow[pageIndex - m_pageTableWindowStart];
+  info.offset = static_cast<uint32_t>(entry.dataOffset);
+  info.size = entry.dataSize;
+  info.width = entry.width;
+  info.height = entry.height;
+  info.bitDepth = m_bitDepth;
+  info.padding = 0;
   return true;
 }
 
-size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) {
+XtcError XtcParser::seekToPageBitmap(uint32_t pageIndex, XtgPageHeader& pageHeader, size_t& bitmapSize) {
   if (!m_isOpen) {
-    m_lastError = XtcError::FILE_NOT_FOUND;
-    return 0;
+    return XtcError::FILE_NOT_FOUND;
   }
 
-  if (pageIndex >= m_header.pageCount) {
-    m_lastError = XtcError::PAGE_OUT_OF_RANGE;
-    return 0;
+  PageInfo page;
+  if (!getPageInfo(pageIndex, page)) {
+    return pageIndex >= m_pageCount ? XtcError::PAGE_OUT_OF_RANGE : XtcError::READ_ERROR;
   }
 
-  const PageInfo& page = m_pageTable[pageIndex];
-
   // Seek to page data
   if (!m_file.seek(page.offset)) {
     Serial.printf("[%lu] [XTC] Failed to seek to page %u at offset %lu\n", millis(), pageIndex, page.offset);
-    m_lastError = XtcError::READ_ERROR;
-    return 0;
+    return XtcError::READ_ERROR;
   }
 
   // Read page header (XTG for 1-bit, XTH for 2-bit - same structure)
-  XtgPageHeader pageHeader;
   size_t headerRead = m_file.read(reinterpret_cast<uint8_t*>(&pageHeader), sizeof(XtgPageHeader));
   if (headerRead != sizeof(XtgPageHeader)) {
     Serial.printf("[%lu] [XTC] Failed to read page header for page %u\n", millis(), pageIndex);
-    m_lastError = XtcError::READ_ERROR;
-    return 0;
+    return XtcError::READ_ERROR;
   }
 
+  return validatePageHeader(pageIndex, pageHeader, bitmapSize);
+}
+
+XtcError XtcParser::validatePageHeader(uint32_t pageIndex, const XtgPageHeader& pageHeader, size_t& bitmapSize) const {
   // Verify page magic (XTG for 1-bit, XTH for 2-bit)
   const uint32_t expectedMagic = (m_bitDepth == 2) ? XTH_MAGIC : XTG_MAGIC;
   if (pageHeader.magic != expectedMagic) {
     Serial.printf("[%lu] [XTC] Invalid page magic for page %u: 0x%08X (expected 0x%08X)\n", millis(), pageIndex,
                   pageHeader.magic, expectedMagic);
-    m_lastError = XtcError::INVALID_MAGIC;
-    return 0;
+    return XtcError::INVALID_MAGIC;
+  }
+
+  if (pageHeader.compression != XTG_COMPRESSION_NONE && pageHeader.compression != XTG_COMPRESSION_DEFLATE) {
+    Serial.printf("[%lu] [XTC] Unsupported compression %u for page %u\n", millis(), pageHeader.compression,
+                  pageIndex);
+    return XtcError::DECOMPRESSION_ERROR;
   }
 
   // Calculate bitmap size based on bit depth
   // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
   // XTH (2-bit): Two bit planes, column-major, ((width * height + 7) / 8) * 2 bytes
-  size_t bitmapSize;
   if (m_bitDepth == 2) {
     // XTH: two bit planes, each containing (width * height) bits rounded up to bytes
     bitmapSize = ((static_cast<size_t>(pageHeader.width) * pageHeader.height + 7) / 8) * 2;
@@ -345,6 +391,123 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
     bitmapSize = ((pageHeader.width + 7) / 8) * pageHeader.height;
   }
 
+  return XtcError::OK;
+}
+
+XtcError XtcParser::inflatePage(const uint8_t* deflatedData, const size_t deflatedSize, const size_t bitmapSize,
+                                uint8_t* buffer,
+                                const std::function<void(const uint8_t* data, size_t size, size_t offset)>& callback,
+                                const size_t chunkSize) {
+  if (deflatedSize == 0) {
+    return XtcError::DECOMPRESSION_ERROR;
+  }
+
+  // Setup inflator
+  const auto inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  if (!inflator) {
+    Serial.printf("[%lu] [XTC] Failed to allocate memory for inflator\n", millis());
+    return XtcError::MEMORY_ERROR;
+  }
+  tinfl_init(inflator);
+
+  // Setup file read buffer, unless the compressed stream is already in memory
+  uint8_t* fileBuffer = nullptr;
+  if (!deflatedData) {
+    fileBuffer = static_cast<uint8_t*>(malloc(chunkSize));
+    if (!fileBuffer) {
+      Serial.printf("[%lu] [XTC] Failed to allocate memory for page read buffer\n", millis());
+      free(inflator);
+      return XtcError::MEMORY_ERROR;
+    }
+  }
+
+  // With a caller buffer holding the whole page, inflate straight into it. Otherwise, inflate into a circular
+  // dictionary and hand each newly produced run to the callback.
+  uint8_t* dictionary = nullptr;
+  if (!buffer) {
+    dictionary = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+    if (!dictionary) {
+      Serial.printf("[%lu] [XTC] Failed to allocate memory for dictionary\n", millis());
+      free(fileBuffer);
+      free(inflator);
+      return XtcError::MEMORY_ERROR;
+    }
+  }
+
+  const uint8_t* readBuffer = deflatedData ? deflatedData : fileBuffer;
+  size_t fileRemainingBytes = deflatedData ? 0 : deflatedSize;
+  size_t readBufferFilled = deflatedData ? deflatedSize : 0;
+  size_t readBufferCursor = 0;
+  size_t outputBytes = 0;
+  size_t dictionaryCursor = 0;
+  XtcError result = XtcError::DECOMPRESSION_ERROR;
+
+  while (true) {
+    // Load more compressed bytes when needed
+    if (readBufferCursor >= readBufferFilled && fileRemainingBytes > 0) {
+      readBufferFilled = m_file.read(fileBuffer, std::min(chunkSize, fileRemainingBytes));
+      readBufferCursor = 0;
+      if (readBufferFilled == 0) {
+        result = XtcError::READ_ERROR;
+        break;
+      }
+      fileRemainingBytes -= readBufferFilled;
+    }
+
+    size_t inBytes = readBufferFilled - readBufferCursor;
+    size_t outBytes;
+    tinfl_status status;
+    const mz_uint32 hasMoreInput = fileRemainingBytes > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0;
+    if (buffer) {
+      outBytes = bitmapSize - outputBytes;
+      status = tinfl_decompress(inflator, readBuffer + readBufferCursor, &inBytes, buffer, buffer + outputBytes,
+                                &outBytes, hasMoreInput | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    } else {
+      outBytes = TINFL_LZ_DICT_SIZE - dictionaryCursor;
+      status = tinfl_decompress(inflator, readBuffer + readBufferCursor, &inBytes, dictionary,
+                                dictionary + dictionaryCursor, &outBytes, hasMoreInput);
+    }
+    readBufferCursor += inBytes;
+
+    if (outBytes > 0) {
+      if (outputBytes + outBytes > bitmapSize) {
+        Serial.printf("[%lu] [XTC] Inflated page exceeds expected size %u\n", millis(), bitmapSize);
+        break;
+      }
+      if (!buffer) {
+        callback(dictionary + dictionaryCursor, outBytes, outputBytes);
+        dictionaryCursor = (dictionaryCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+      }
+      outputBytes += outBytes;
+    }
+
+    if (status == TINFL_STATUS_DONE) {
+      result = outputBytes == bitmapSize ? XtcError::OK : XtcError::DECOMPRESSION_ERROR;
+      break;
+    }
+
+    // Output space exhausted with more to come, or the stream is truncated
+    if (status < 0 || (status == TINFL_STATUS_HAS_MORE_OUTPUT && outputBytes >= bitmapSize) ||
+        (status == TINFL_STATUS_NEEDS_MORE_INPUT && fileRemainingBytes == 0 && readBufferCursor >= readBufferFilled)) {
+      Serial.printf("[%lu] [XTC] tinfl_decompress() failed with status %d\n", millis(), status);
+      break;
+    }
+  }
+
+  free(dictionary);
+  free(fileBuffer);
+  free(inflator);
+  return result;
+}
+
+size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize) {
+  XtgPageHeader pageHeader;
+  size_t bitmapSize = 0;
+  m_lastError = seekToPageBitmap(pageIndex, pageHeader, bitmapSize);
+  if (m_lastError != XtcError::OK) {
+    return 0;
+  }
+
   // Check buffer size
   if (bufferSize < bitmapSize) {
     Serial.printf("[%lu] [XTC] Buffer too small: need %u, have %u\n", millis(), bitmapSize, bufferSize);
@@ -352,6 +515,15 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
     return 0;
   }
 
+  if (pageHeader.compression == XTG_COMPRESSION_DEFLATE) {
+    m_lastError = inflatePage(nullptr, pageHeader.dataSize, bitmapSize, buffer, nullptr, 1024);
+    if (m_lastError != XtcError::OK) {
+      Serial.printf("[%lu] [XTC] Failed to inflate page %u: %s\n", millis(), pageIndex, errorToString(m_lastError));
+      return 0;
+    }
+    return bitmapSize;
+  }
+
   // Read bitmap data
   size_t bytesRead = m_file.read(buffer, bitmapSize);
   if (bytesRead != bitmapSize) {
@@ -367,37 +539,15 @@ size_t XtcParser::loadPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSiz
 XtcError XtcParser::loadPageStreaming(uint32_t pageIndex,
                                       std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
                                       size_t chunkSize) {
-  if (!m_isOpen) {
-    return XtcError::FILE_NOT_FOUND;
-  }
-
-  if (pageIndex >= m_header.pageCount) {
-    return XtcError::PAGE_OUT_OF_RANGE;
-  }
-
-  const PageInfo& page = m_pageTable[pageIndex];
-
-  // Seek to page data
-  if (!m_file.seek(page.offset)) {
-    return XtcError::READ_ERROR;
-  }
-
-  // Read and skip page header (XTG for 1-bit, XTH for 2-bit)
   XtgPageHeader pageHeader;
-  size_t headerRead = m_file.read(reinterpret_cast<uint8_t*>(&pageHeader), sizeof(XtgPageHeader));
-  const uint32_t expectedMagic = (m_bitDepth == 2) ? XTH_MAGIC : XTG_MAGIC;
-  if (headerRead != sizeof(XtgPageHeader) || pageHeader.magic != expectedMagic) {
-    return XtcError::READ_ERROR;
+  size_t bitmapSize = 0;
+  const XtcError err = seekToPageBitmap(pageIndex, pageHeader, bitmapSize);
+  if (err != XtcError::OK) {
+    return err;
   }
 
-  // Calculate bitmap size based on bit depth
-  // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
-  // XTH (2-bit): Two bit planes, ((width * height + 7) / 8) * 2 bytes
-  size_t bitmapSize;
-  if (m_bitDepth == 2) {
-    bitmapSize = ((static_cast<size_t>(pageHeader.width) * pageHeader.height + 7) / 8) * 2;
-  } else {
-    bitmapSize = ((pageHeader.width + 7) / 8) * pageHeader.height;
+  if (pageHeader.compression == XTG_COMPRESSION_DEFLATE) {
+    return inflatePage(nullptr, pageHeader.dataSize, bitmapSize, nullptr, callback, chunkSize);
   }
 
   // Read in chunks
@@ -419,6 +569,93 @@ XtcError XtcParser::loadPageStreaming(uint32_t pageIndex,
   return XtcError::OK;
 }
 
+size_t XtcParser::getStoredPageSize(uint32_t pageIndex) {
+  XtgPageHeader pageHeader;
+  size_t bitmapSize = 0;
+  m_lastError = seekToPageBitmap(pageIndex, pageHeader, bitmapSize);
+  if (m_lastError != XtcError::OK) {
+    return 0;
+  }
+
+  const size_t payloadSize = pageHeader.compression == XTG_COMPRESSION_DEFLATE ? pageHeader.dataSize : bitmapSize;
+  return sizeof(XtgPageHeader) + payloadSize;
+}
+
+size_t XtcParser::readStoredPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize,
+                                 const std::function<bool()>& yieldFn, size_t chunkSize) {
+  const size_t storedSize = getStoredPageSize(pageIndex);
+  if (storedSize == 0) {
+    return 0;
+  }
+
+  if (bufferSize < storedSize) {
+    Serial.printf("[%lu] [XTC] Buffer too small: need %u, have %u\n", millis(), storedSize, bufferSize);
+    m_lastError = XtcError::MEMORY_ERROR;
+    return 0;
+  }
+
+  // With a yield function the page is read in chunks, and the caller can give the SD card up between them
+  PageInfo page;
+  bool readOk = getPageInfo(pageIndex, page) && m_file.seek(page.offset);
+  for (size_t offset = 0; readOk && offset < storedSize;) {
+    if (yieldFn && !yieldFn()) {
+      return 0;
+    }
+    const size_t toRead = yieldFn ? std::min(chunkSize, storedSize - offset) : storedSize - offset;
+    readOk = m_file.read(buffer + offset, toRead) == static_cast<int>(toRead);
+    offset += toRead;
+  }
+  if (!readOk) {
+    Serial.printf("[%lu] [XTC] Failed to read stored page %u\n", millis(), pageIndex);
+    m_lastError = XtcError::READ_ERROR;
+    return 0;
+  }
+
+  // Validate the copy of the header that ended up in the buffer
+  XtgPageHeader pageHeader;
+  memcpy(&pageHeader, buffer, sizeof(XtgPageHeader));
+  size_t bitmapSize = 0;
+  m_lastError = validatePageHeader(pageIndex, pageHeader, bitmapSize);
+  return m_lastError == XtcError::OK ? storedSize : 0;
+}
+
+XtcError XtcParser::decodeStoredPage(uint32_t pageIndex, const uint8_t* storedPage, size_t storedSize,
+                                     std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
+                                     size_t chunkSize) {
+  if (storedSize < sizeof(XtgPageHeader)) {
+    return XtcError::CORRUPTED_HEADER;
+  }
+
+  XtgPageHeader pageHeader;
+  memcpy(&pageHeader, storedPage, sizeof(XtgPageHeader));
+  size_t bitmapSize = 0;
+  const XtcError err = validatePageHeader(pageIndex, pageHeader, bitmapSize);
+  if (err != XtcError::OK) {
+    return err;
+  }
+
+  const uint8_t* payload = storedPage + sizeof(XtgPageHeader);
+  const size_t payloadSize = storedSize - sizeof(XtgPageHeader);
+
+  if (pageHeader.compression == XTG_COMPRESSION_DEFLATE) {
+    if (payloadSize < pageHeader.dataSize) {
+      return XtcError::READ_ERROR;
+    }
+    return inflatePage(payload, pageHeader.dataSize, bitmapSize, nullptr, callback, chunkSize);
+  }
+
+  if (payloadSize < bitmapSize) {
+    return XtcError::READ_ERROR;
+  }
+
+  // Hand out the same chunk sizes as loadPageStreaming() so callers see identical calls
+  for (size_t offset = 0; offset < bitmapSize; offset += chunkSize) {
+    callback(payload + offset, std::min(chunkSize, bitmapSize - offset), offset);
+  }
+
+  return XtcError::OK;
+}
+
 bool XtcParser::isValidXtcFile(const char* filepath) {
   FsFile file;
   if (!SdMan.openFileForRead("XTC", filepath, file)) {
@@ -36,16 +36,17 @@ class XtcParser {
 
   // Header information access
   const XtcHeader& getHeader() const { return m_header; }
-  uint16_t getPageCount() const { return m_header.pageCount; }
+  uint32_t getPageCount() const { return m_pageCount; }
   uint16_t getWidth() const { return m_defaultWidth; }
   uint16_t getHeight() const { return m_defaultHeight; }
   uint8_t getBitDepth() const { return m_bitDepth; }  // 1 = XTC/XTG, 2 = XTCH/XTH
 
-  // Page information
-  bool getPageInfo(uint32_t pageIndex, PageInfo& info) const;
+  // Page information (page table entries are read lazily, a small window at a time)
+  bool getPageInfo(uint32_t pageIndex, PageInfo& info);
 
   /**
    * Load page bitmap (raw 1-bit data, skipping XTG header)
+   * Deflate-compressed pages are inflated into the buffer transparently.
    *
    * @param pageIndex Page index (0-based)
    * @param buffer Output buffer (caller allocated)
@@ -57,6 +58,7 @@ class XtcParser {
   /**
    * Streaming page load
    * Memory-efficient method that reads page data in chunks.
+   * Deflate-compressed pages are inflated on the fly; offsets always refer to the inflated bitmap.
    *
    * @param pageIndex Page index
    * @param callback Callback function to receive data chunks
@@ -67,6 +69,20 @@ class XtcParser {
                              std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
                              size_t chunkSize = 1024);
 
+  /**
+   * Stored page access
+   * A stored page is the page header plus its payload exactly as held in the file (deflate-compressed pages stay
+   * compressed), so it can be kept in RAM cheaply and decoded later without touching the SD card.
+   */
+  size_t getStoredPageSize(uint32_t pageIndex);
+  // yieldFn, if given, is called before each chunk of chunkSize bytes. Returning false stops the read, which then
+  // returns 0 with no error set.
+  size_t readStoredPage(uint32_t pageIndex, uint8_t* buffer, size_t bufferSize,
+                        const std::function<bool()>& yieldFn = nullptr, size_t chunkSize = 4096);
+  XtcError decodeStoredPage(uint32_t pageIndex, const uint8_t* storedPage, size_t storedSize,
+                            std::function<void(const uint8_t* data, size_t size, size_t offset)> callback,
+                            size_t chunkSize = 1024);
+
   // Get title from metadata
   std::string getTitle() const { return m_title; }
 
@@ -80,10 +96,16 @@ class XtcParser {
   XtcError getLastError() const { return m_lastError; }
 
  private:
+  // Number of page table entries cached around the last requested page (16 bytes each)
+  static constexpr uint32_t PAGE_TABLE_WINDOW_SIZE = 32;
+
   FsFile m_file;
   bool m_isOpen;
   XtcHeader m_header;
-  std::vector<PageInfo> m_pageTable;
+  uint32_t m_pageCount;
+  PageTableEntry m_pageTableWindow[PAGE_TABLE_WINDOW_SIZE];
+  uint32_t m_pageTableWindowStart;
+  uint32_t m_pageTableWindowCount;
   std::vector<ChapterInfo> m_chapters;
   std::string m_title;
   uint16_t m_defaultWidth;
@@ -95,8 +117,14 @@ class XtcParser {
   // Internal helper functions
   XtcError readHeader();
   XtcError readPageTable();
+  XtcError loadPageTableWindow(uint32_t pageIndex);
   XtcError readTitle();
   XtcError readChapters();
+  XtcError seekToPageBitmap(uint32_t pageIndex, XtgPageHeader& pageHeader, size_t& bitmapSize);
+  XtcError validatePageHeader(uint32_t pageIndex, const XtgPageHeader& pageHeader, size_t& bitmapSize) const;
+  XtcError inflatePage(const uint8_t* deflatedData, size_t deflatedSize, size_t bitmapSize, uint8_t* buffer,
+                       const std::function<void(const uint8_t* data, size_t size, size_t offset)>& callback,
+                       size_t chunkSize);
 };
 
 }  // namespace xtc
@@ -37,7 +37,7 @@ struct XtcHeader {
   uint32_t magic;            // 0x00: Magic number "XTC\0" (0x00435458)
   uint8_t versionMajor;      // 0x04: Format version major (typically 1) (together with minor = 1.0)
   uint8_t versionMinor;      // 0x05: Format version minor (typically 0)
-  uint16_t pageCount;        // 0x06: Total page count
+  uint16_t pageCount;        // 0x06: Total page count (low 16 bits, see XtcParser::readPageTable)
   uint32_t flags;            // 0x08: Flags/reserved
   uint32_t headerSize;       // 0x0C: Size of header section (typically 88)
   uint32_t reserved1;        // 0x10: Reserved
@@ -68,8 +68,8 @@ struct XtgPageHeader {
   uint16_t width;       // 0x04: Image width (pixels)
   uint16_t height;      // 0x06: Image height (pixels)
   uint8_t colorMode;    // 0x08: Color mode (0=monochrome)
-  uint8_t compression;  // 0x09: Compression (0=uncompressed)
-  uint32_t dataSize;    // 0x0A: Image data size (bytes)
+  uint8_t compression;  // 0x09: Compression (see XTG_COMPRESSION_*)
+  uint32_t dataSize;    // 0x0A: Image data size (bytes, as stored on disk)
   uint64_t md5;         // 0x0E: MD5 checksum (first 8 bytes, optional)
   // Followed by bitmap data at offset 0x16 (22)
   //
@@ -81,9 +81,16 @@ struct XtgPageHeader {
   //   First plane: Bit1 for all pixels
   //   Second plane: Bit2 for all pixels
   //   pixelValue = (bit1 << 1) | bit2
+  //
+  // When compression is XTG_COMPRESSION_DEFLATE, the bitmap above is stored as a raw deflate stream (no zlib
+  // header) and dataSize is the length of that stream. The inflated size is always derived from width/height.
 };
 #pragma pack(pop)
 
+// XTG/XTH page compression modes
+constexpr uint8_t XTG_COMPRESSION_NONE = 0;
+constexpr uint8_t XTG_COMPRESSION_DEFLATE = 1;
+
 // Page information (internal use, optimized for memory)
 struct PageInfo {
   uint32_t offset;   // File offset to page data (max 4GB file size)
@@ -96,8 +103,8 @@ struct PageInfo {
 
 struct ChapterInfo {
   std::string name;
-  uint16_t startPage;
-  uint16_t endPage;
+  uint32_t startPage;
+  uint32_t endPage;
 };
 
 // Error codes
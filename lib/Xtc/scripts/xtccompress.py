@@ -0,0 +1,123 @@
+#!python3
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+# Rewrites an XTC/XTCH file so that every XTG/XTH page is stored as a raw deflate stream
+# (page header compression = 1). Pages that do not shrink are kept uncompressed.
+# The device inflates pages on the fly in XtcParser, so the output is a drop-in replacement.
+
+XTC_MAGIC = 0x00435458
+XTCH_MAGIC = 0x48435458
+XTG_MAGIC = 0x00475458
+XTH_MAGIC = 0x00485458
+
+HEADER_FORMAT = "<IBBHIIIIQQQII"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)  # 56
+PAGE_TABLE_ENTRY_FORMAT = "<QIHH"
+PAGE_TABLE_ENTRY_SIZE = struct.calcsize(PAGE_TABLE_ENTRY_FORMAT)  # 16
+PAGE_HEADER_FORMAT = "<IHHBBIQ"
+PAGE_HEADER_SIZE = struct.calcsize(PAGE_HEADER_FORMAT)  # 22
+
+COMPRESSION_NONE = 0
+COMPRESSION_DEFLATE = 1
+
+parser = argparse.ArgumentParser(description="Deflate-compress the pages of an XTC/XTCH file.")
+parser.add_argument("input", action="store", help="input .xtc/.xtch file.")
+parser.add_argument("output", action="store", help="output .xtc/.xtch file.")
+parser.add_argument("--level", type=int, default=9, help="deflate level (1-9, default 9).")
+args = parser.parse_args()
+
+with open(args.input, "rb") as f:
+    data = bytearray(f.read())
+
+header = list(struct.unpack_from(HEADER_FORMAT, data, 0))
+magic, page_count, page_table_offset = header[0], header[3], header[8]
+if magic not in (XTC_MAGIC, XTCH_MAGIC):
+    sys.exit(f"{args.input}: not an XTC/XTCH file")
+bit_depth = 2 if magic == XTCH_MAGIC else 1
+page_magic = XTH_MAGIC if bit_depth == 2 else XTG_MAGIC
+
+entries = [list(struct.unpack_from(PAGE_TABLE_ENTRY_FORMAT, data, page_table_offset + i * PAGE_TABLE_ENTRY_SIZE))
+           for i in range(page_count)]
+first_page_offset = min(entry[0] for entry in entries)
+if page_table_offset + page_count * PAGE_TABLE_ENTRY_SIZE > first_page_offset:
+    sys.exit(f"{args.input}: page table must precede page data")
+
+# Everything after the last page (e.g. a trailing chapter table) is carried over verbatim
+pages_end = 0
+for entry in entries:
+    offset = entry[0]
+    width, height, compression, data_size = struct.unpack_from(PAGE_HEADER_FORMAT, data, offset)[1:5]
+    if bit_depth == 2:
+        bitmap_size = ((width * height + 7) // 8) * 2
+    else:
+        bitmap_size = ((width + 7) // 8) * height
+    stored_size = data_size if compression == COMPRESSION_DEFLATE else bitmap_size
+    pages_end = max(pages_end, offset + PAGE_HEADER_SIZE + stored_size)
+
+out = bytearray(data[:first_page_offset])
+raw_total = 0
+stored_total = 0
+inflate_time = 0.0
+
+for i, entry in enumerate(entries):
+    offset = entry[0]
+    magic, width, height, color_mode, compression, data_size, md5 = struct.unpack_from(PAGE_HEADER_FORMAT, data, offset)
+    if magic != page_magic:
+        sys.exit(f"{args.input}: page {i} has invalid magic 0x{magic:08X}")
+    if bit_depth == 2:
+        bitmap_size = ((width * height + 7) // 8) * 2
+    else:
+        bitmap_size = ((width + 7) // 8) * height
+
+    payload_start = offset + PAGE_HEADER_SIZE
+    if compression == COMPRESSION_DEFLATE:
+        bitmap = zlib.decompress(bytes(data[payload_start:payload_start + data_size]), -15)
+    else:
+        bitmap = bytes(data[payload_start:payload_start + bitmap_size])
+
+    compressor = zlib.compressobj(args.level, zlib.DEFLATED, -15)
+    deflated = compressor.compress(bitmap) + compressor.flush()
+
+    # Round-trip check, and a rough measure of the decode cost per page
+    start = time.perf_counter()
+    if zlib.decompress(deflated, -15) != bitmap:
+        sys.exit(f"{args.input}: page {i} failed round-trip check")
+    inflate_time += time.perf_counter() - start
+
+    if len(deflated) < len(bitmap):
+        compression, payload = COMPRESSION_DEFLATE, deflated
+    else:
+        compression, payload = COMPRESSION_NONE, bitmap
+
+    entry[0] = len(out)
+    entry[1] = PAGE_HEADER_SIZE + len(payload)
+    out += struct.pack(PAGE_HEADER_FORMAT, magic, width, height, color_mode, compression, len(payload), md5)
+    out += payload
+
+    raw_total += len(bitmap)
+    stored_total += len(payload)
+
+# Carry over trailing data and relocate the chapter table if it lived there
+tail_offset = len(out)
+out += data[pages_end:]
+has_chapters = data[0x0B] == 1
+chapter_offset = struct.unpack_from("<Q", data, 0x30)[0]
+if has_chapters and chapter_offset >= pages_end:
+    struct.pack_into("<Q", out, 0x30, chapter_offset - pages_end + tail_offset)
+
+for i, entry in enumerate(entries):
+    struct.pack_into(PAGE_TABLE_ENTRY_FORMAT, out, page_table_offset + i * PAGE_TABLE_ENTRY_SIZE, *entry)
+
+with open(args.output, "wb") as f:
+    f.write(out)
+
+ratio = raw_total / stored_total if stored_total else 0
+print(f"{page_count} pages, {bit_depth}-bit")
+print(f"page bytes read per turn: {raw_total // page_count} raw -> {stored_total // page_count} stored "
+      f"({ratio:.1f}x smaller)")
+print(f"file size: {len(data)} -> {len(out)} bytes")
+print(f"host inflate time: {inflate_time * 1000 / page_count:.3f} ms/page")
@@ -405,7 +405,14 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
         return false;
       }
 
-      out.write(buffer, dataRead);
+      if (out.write(buffer, dataRead) != dataRead) {
+        Serial.printf("[%lu] [ZIP] Failed to write all output bytes to stream\n", millis());
+        free(buffer);
+        if (!wasOpen) {
+          close();
+        }
+        return false;
+      }
       remaining -= dataRead;
     }
 
@@ -548,3 +555,132 @@ bool ZipFile::readFileToStream(const char* filename, Print& out, const size_t ch
   Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
   return false;
 }
+
+ZipFile::ItemReader::~ItemReader() {
+  free(outputBuffer);
+  free(fileReadBuffer);
+  free(inflator);
+  if (!wasOpen) {
+    zip.close();
+  }
+}
+
+bool ZipFile::ItemReader::open(const char* filename, const size_t chunkSize) {
+  wasOpen = zip.isOpen();
+  if (!wasOpen && !zip.open()) {
+    return false;
+  }
+
+  if (!zip.loadFileStatSlim(filename, &fileStat)) {
+    return false;
+  }
+
+  const long fileOffset = zip.getDataOffset(fileStat);
+  if (fileOffset < 0) {
+    return false;
+  }
+  zip.file.seek(fileOffset);
+
+  if (fileStat.method == MZ_NO_COMPRESSION) {
+    fileRemainingBytes = fileStat.uncompressedSize;
+    return true;
+  }
+
+  if (fileStat.method != MZ_DEFLATED) {
+    Serial.printf("[%lu] [ZIP] Unsupported compression method\n", millis());
+    return false;
+  }
+
+  fileRemainingBytes = fileStat.compressedSize;
+  this->chunkSize = chunkSize;
+  inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  fileReadBuffer = static_cast<uint8_t*>(malloc(chunkSize));
+  outputBuffer = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+  if (!inflator || !fileReadBuffer || !outputBuffer) {
+    Serial.printf("[%lu] [ZIP] Failed to allocate memory for inflator\n", millis());
+    return false;
+  }
+  memset(inflator, 0, sizeof(tinfl_decompressor));
+  tinfl_init(inflator);
+  memset(outputBuffer, 0, TINFL_LZ_DICT_SIZE);
+  return true;
+}
+
+int ZipFile::ItemReader::read(uint8_t* buffer, const size_t size) {
+  if (fileStat.method == MZ_NO_COMPRESSION) {
+    // no deflation, read straight from the zip
+    const size_t toRead = size < fileRemainingBytes ? size : fileRemainingBytes;
+    if (toRead == 0) {
+      return 0;
+    }
+    const int dataRead = zip.file.read(buffer, toRead);
+    if (dataRead <= 0) {
+      Serial.printf("[%lu] [ZIP] Could not read more bytes\n", millis());
+      return -1;
+    }
+    fileRemainingBytes -= dataRead;
+    return dataRead;
+  }
+
+  if (!inflator) {
+    return -1;
+  }
+
+  size_t copied = 0;
+  while (copied < size) {
+    // Hand out what the last inflate step produced before running another, it may overwrite the dictionary
+    if (pendingBytes > 0) {
+      const size_t toCopy = pendingBytes < size - copied ? pendingBytes : size - copied;
+      memcpy(buffer + copied, outputBuffer + pendingCursor, toCopy);
+      pendingCursor += toCopy;
+      pendingBytes -= toCopy;
+      copied += toCopy;
+      continue;
+    }
+
+    if (done) {
+      break;
+    }
+
+    // Load more compressed bytes when needed
+    if (fileReadBufferCursor >= fileReadBufferFilledBytes && fileRemainingBytes > 0) {
+      const int dataRead =
+          zip.file.read(fileReadBuffer, fileRemainingBytes < chunkSize ? fileRemainingBytes : chunkSize);
+      if (dataRead <= 0) {
+        Serial.printf("[%lu] [ZIP] Could not read more bytes\n", millis());
+        return -1;
+      }
+      fileReadBufferFilledBytes = dataRead;
+      fileRemainingBytes -= dataRead;
+      fileReadBufferCursor = 0;
+    }
+
+    // Available bytes in fileReadBuffer to process
+    size_t inBytes = fileReadBufferFilledBytes - fileReadBufferCursor;
+    // Space remaining in outputBuffer
+    size_t outBytes = TINFL_LZ_DICT_SIZE - outputCursor;
+
+    const tinfl_status status =
+        tinfl_decompress(inflator, fileReadBuffer + fileReadBufferCursor, &inBytes, outputBuffer,
+                         outputBuffer + outputCursor, &outBytes, fileRemainingBytes > 0 ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+
+    fileReadBufferCursor += inBytes;
+    pendingCursor = outputCursor;
+    pendingBytes = outBytes;
+    // Update output position in buffer (with wraparound)
+    outputCursor = (outputCursor + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status < 0) {
+      Serial.printf("[%lu] [ZIP] tinfl_decompress() failed with status %d\n", millis(), status);
+      return -1;
+    }
+    if (status == TINFL_STATUS_DONE) {
+      done = true;
+    } else if (inBytes == 0 && outBytes == 0) {
+      // No input left and nothing more to flush
+      Serial.printf("[%lu] [ZIP] Unexpected EOF\n", millis());
+      return -1;
+    }
+  }
+  return static_cast<int>(copied);
+}
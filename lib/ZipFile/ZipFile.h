@@ -4,6 +4,8 @@
 #include <string>
 #include <unordered_map>
 
+struct tinfl_decompressor_tag;
+
 class ZipFile {
  public:
   struct FileStatSlim {
@@ -43,4 +45,35 @@ class ZipFile {
   // These functions will open and close the zip as needed
   uint8_t* readFileToMemory(const char* filename, size_t* size = nullptr, bool trailingNullByte = false);
   bool readFileToStream(const char* filename, Print& out, size_t chunkSize);
+
+  // Pull based alternative to readFileToStream, for consumers that ask for bytes as they need them (the JPEG decoder)
+  // rather than take them as they are inflated. Opens the zip if needed and keeps it open until destroyed.
+  class ItemReader {
+    ZipFile& zip;
+    bool wasOpen = true;
+    FileStatSlim fileStat = {};
+    size_t fileRemainingBytes = 0;
+    // Inflate state, only allocated for deflated items
+    tinfl_decompressor_tag* inflator = nullptr;
+    uint8_t* fileReadBuffer = nullptr;
+    size_t chunkSize = 0;
+    size_t fileReadBufferFilledBytes = 0;
+    size_t fileReadBufferCursor = 0;
+    uint8_t* outputBuffer = nullptr;
+    size_t outputCursor = 0;   // Current offset in the circular dictionary
+    size_t pendingCursor = 0;  // Inflated bytes in the dictionary not yet handed out
+    size_t pendingBytes = 0;
+    bool done = false;
+
+   public:
+    explicit ItemReader(ZipFile& zip) : zip(zip) {}
+    ~ItemReader();
+    ItemReader(const ItemReader&) = delete;
+    ItemReader& operator=(const ItemReader&) = delete;
+
+    bool open(const char* filename, size_t chunkSize);
+    size_t size() const { return fileStat.uncompressedSize; }
+    // Returns the number of bytes read, 0 at the end of the item, or -1 on error
+    int read(uint8_t* buffer, size_t size);
+  };
 };
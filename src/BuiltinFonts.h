@@ -0,0 +1,6 @@
+#pragma once
+#include <GfxRenderer.h>
+
+// Registers the fonts built into the firmware under their ids in fontIds.h. The host tools use the same table, so
+// that they measure text exactly like the device.
+void insertBuiltinFonts(GfxRenderer& renderer);
@@ -0,0 +1,388 @@
+#include "CacheManager.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "CrossPointSettings.h"
+#include "util/StringUtils.h"
+
+namespace CacheManager {
+
+namespace {
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char INDEX_FILE[] = "/.crosspoint/cache.bin";
+constexpr char SECTIONS_DIR_NAME[] = "/sections";
+constexpr char ACCESS_FILE_NAME[] = "access.bin";
+// The reading position, the one file in a book cache that cannot be rebuilt from the book
+constexpr char PROGRESS_FILE_NAME[] = "progress.bin";
+constexpr uint32_t INDEX_MAGIC = 0x4D484343;  // "CCHM"
+constexpr uint8_t INDEX_VERSION = 1;
+
+enum Flags : uint8_t {
+  FLAG_MEASURED = 1 << 0,  // bookBytes and sectionBytes are up to date
+  FLAG_EVICTED = 1 << 1,   // Only the reading position is left, until the book is opened again
+};
+
+#pragma pack(push, 1)
+struct Header {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t reserved[3];
+  uint32_t clock;  // Incremented on every book open and section use
+};
+
+struct Record {
+  char dir[18];  // Name of the cache directory in /.crosspoint
+  uint8_t flags;
+  uint8_t reserved;
+  uint32_t lastOpened;    // Clock value when the book was last opened
+  uint32_t bookBytes;     // Files directly in the cache directory
+  uint32_t sectionBytes;  // Files in sections/
+};
+#pragma pack(pop)
+
+// Cache directory of the open book, never evicted
+std::string openDir;
+// Whether the cache directories were listed since boot
+bool listed = false;
+bool pending = true;
+// Limit the caches were last found to fit in
+uint64_t checkedBudget = 0;
+
+std::string dirName(const std::string& cachePath) { return cachePath.substr(cachePath.find_last_of('/') + 1); }
+
+std::string dirPath(const Record& record) { return std::string(CACHE_DIR) + "/" + record.dir; }
+
+bool isBookCacheDir(const std::string& name) {
+  return name.size() < sizeof(Record::dir) && (name.rfind("epub_", 0) == 0 || name.rfind("xtc_", 0) == 0);
+}
+
+Record newRecord(const std::string& name) {
+  Record record = {};
+  strncpy(record.dir, name.c_str(), sizeof(record.dir) - 1);
+  return record;
+}
+
+void load(Header& header, std::vector<Record>& records) {
+  header = {INDEX_MAGIC, INDEX_VERSION, {}, 0};
+  records.clear();
+
+  FsFile file;
+  if (!SdMan.openFileForRead("CCH", INDEX_FILE, file)) {
+    return;
+  }
+  const size_t fileSize = file.size();
+  Header stored;
+  bool valid = fileSize >= sizeof(Header) && (fileSize - sizeof(Header)) % sizeof(Record) == 0 &&
+               file.read(reinterpret_cast<uint8_t*>(&stored), sizeof(stored)) == sizeof(stored) &&
+               stored.magic == INDEX_MAGIC && stored.version == INDEX_VERSION;
+  if (valid) {
+    header = stored;
+    records.resize((fileSize - sizeof(Header)) / sizeof(Record));
+    const size_t bytes = records.size() * sizeof(Record);
+    if (file.read(reinterpret_cast<uint8_t*>(records.data()), bytes) != static_cast<int>(bytes)) {
+      records.clear();
+      valid = false;
+    }
+  }
+  file.close();
+
+  if (!valid) {
+    // Cut short or garbled, e.g. by a power loss during save(). The books it held are found again by listing the
+    // cache directories.
+    Serial.printf("[%lu] [CCH] %s is damaged, listing the caches again\n", millis(), INDEX_FILE);
+    listed = false;
+    pending = true;
+  }
+}
+
+void save(const Header& header, const std::vector<Record>& records) {
+  FsFile file;
+  if (!SdMan.openFileForWrite("CCH", INDEX_FILE, file)) {
+    return;
+  }
+  const size_t bytes = records.size() * sizeof(Record);
+  if (file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+      file.write(reinterpret_cast<const uint8_t*>(records.data()), bytes) != bytes) {
+    Serial.printf("[%lu] [CCH] Failed to write %s\n", millis(), INDEX_FILE);
+  }
+  file.close();
+}
+
+Record* find(std::vector<Record>& records, const std::string& name) {
+  const auto it = std::find_if(records.begin(), records.end(),
+                               [&name](const Record& record) { return name == record.dir; });
+  return it == records.end() ? nullptr : &*it;
+}
+
+// Calls visit(name, size) for every file directly in path
+template <typename Visitor>
+void forEachFile(const std::string& path, Visitor&& visit) {
+  auto dir = SdMan.open(path.c_str());
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return;
+  }
+  char name[64];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    if (!file.isDirectory()) {
+      file.getName(name, sizeof(name));
+      visit(name, static_cast<uint32_t>(file.size()));
+    }
+    file.close();
+  }
+  dir.close();
+}
+
+uint32_t filesSize(const std::string& path) {
+  uint32_t total = 0;
+  forEachFile(path, [&total](const char*, const uint32_t size) { total += size; });
+  return total;
+}
+
+// Brings the records in line with the cache directories on the card
+void listDirs(std::vector<Record>& records) {
+  auto dir = SdMan.open(CACHE_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return;
+  }
+  std::vector<Record> found;
+  char name[64];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (file.isDirectory() && isBookCacheDir(name)) {
+      const Record* known = find(records, name);
+      found.push_back(known ? *known : newRecord(name));
+    }
+    file.close();
+  }
+  dir.close();
+  records.swap(found);
+}
+
+void measure(Record& record) {
+  const std::string path = dirPath(record);
+  record.bookBytes = filesSize(path);
+  record.sectionBytes = filesSize(path + SECTIONS_DIR_NAME);
+  record.flags |= FLAG_MEASURED;
+}
+
+// Removes the least recently used section of the book
+void evictSection(Record& record) {
+  const std::string sectionsPath = dirPath(record) + SECTIONS_DIR_NAME;
+  const std::string accessPath = sectionsPath + "/" + ACCESS_FILE_NAME;
+
+  std::vector<uint32_t> lastUsed;
+  FsFile access;
+  if (SdMan.openFileForRead("CCH", accessPath, access)) {
+    lastUsed.resize(access.size() / sizeof(uint32_t));
+    const size_t bytes = lastUsed.size() * sizeof(uint32_t);
+    if (access.read(reinterpret_cast<uint8_t*>(lastUsed.data()), bytes) != static_cast<int>(bytes)) {
+      lastUsed.clear();
+    }
+    access.close();
+  }
+
+  // Sections without an entry were never shown, only built ahead, and go first
+  std::string oldest;
+  uint32_t oldestUse = UINT32_MAX;
+  uint32_t oldestSize = 0;
+  forEachFile(sectionsPath, [&](const char* name, const uint32_t size) {
+    if (!StringUtils::checkFileExtension(name, ".bin") || strcmp(name, ACCESS_FILE_NAME) == 0) {
+      return;
+    }
+    const auto spineIndex = static_cast<size_t>(strtoul(name, nullptr, 10));
+    const uint32_t use = spineIndex < lastUsed.size() ? lastUsed[spineIndex] : 0;
+    if (oldest.empty() || use < oldestUse) {
+      oldest = name;
+      oldestUse = use;
+      oldestSize = size;
+    }
+  });
+
+  if (oldest.empty()) {
+    SdMan.remove(accessPath.c_str());
+    record.sectionBytes = 0;
+    return;
+  }
+  SdMan.remove((sectionsPath + "/" + oldest).c_str());
+  record.sectionBytes -= std::min(record.sectionBytes, oldestSize);
+  Serial.printf("[%lu] [CCH] Evicted section %s of %s\n", millis(), oldest.c_str(), record.dir);
+}
+
+// Removes everything the reader rebuilds when the book is opened again (book.bin, sections, cover, resume snapshot),
+// keeping the reading position. Returns false if nothing was kept and the directory is gone.
+bool evictBook(Record& record) {
+  const std::string path = dirPath(record);
+  SdMan.removeDir((path + SECTIONS_DIR_NAME).c_str());
+
+  std::vector<std::string> rebuilt;
+  bool keptProgress = false;
+  forEachFile(path, [&](const char* name, uint32_t) {
+    if (strcmp(name, PROGRESS_FILE_NAME) == 0) {
+      keptProgress = true;
+    } else {
+      rebuilt.emplace_back(name);
+    }
+  });
+  if (!keptProgress) {
+    SdMan.removeDir(path.c_str());
+    return false;
+  }
+  for (const auto& name : rebuilt) {
+    SdMan.remove((path + "/" + name).c_str());
+  }
+  record.bookBytes = filesSize(path);
+  record.sectionBytes = 0;
+  record.flags |= FLAG_EVICTED;
+  return true;
+}
+
+// Least recently opened record, other than the open book, that passes the filter
+template <typename Filter>
+Record* leastRecentlyOpened(std::vector<Record>& records, Filter&& filter) {
+  Record* oldest = nullptr;
+  for (auto& record : records) {
+    if (openDir != record.dir && filter(record) && (!oldest || record.lastOpened < oldest->lastOpened)) {
+      oldest = &record;
+    }
+  }
+  return oldest;
+}
+}  // namespace
+
+void bookOpened(const std::string& cachePath) {
+  openDir = dirName(cachePath);
+  if (!isBookCacheDir(openDir)) {
+    return;
+  }
+
+  Header header;
+  std::vector<Record> records;
+  load(header, records);
+  Record* record = find(records, openDir);
+  if (!record) {
+    records.push_back(newRecord(openDir));
+    record = &records.back();
+  }
+  record->lastOpened = ++header.clock;
+  // The reader rebuilds what was evicted
+  record->flags &= ~FLAG_EVICTED;
+  save(header, records);
+  pending = true;
+}
+
+void bookClosed(const std::string& cachePath) {
+  const std::string name = dirName(cachePath);
+  if (name == openDir) {
+    openDir.clear();
+  }
+
+  Header header;
+  std::vector<Record> records;
+  load(header, records);
+  if (Record* record = find(records, name)) {
+    record->flags &= ~FLAG_MEASURED;
+    save(header, records);
+  }
+  pending = true;
+}
+
+void sectionUsed(const std::string& cachePath, const int spineIndex) {
+  if (spineIndex < 0) {
+    return;
+  }
+
+  // Only the clock in the header changes, so it is updated in place
+  auto index = SdMan.open(INDEX_FILE, O_RDWR);
+  Header header;
+  if (!index || index.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+      header.magic != INDEX_MAGIC || header.version != INDEX_VERSION) {
+    if (index) index.close();
+    return;
+  }
+  header.clock++;
+  const bool clockSaved =
+      index.seek(0) && index.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+  index.close();
+  if (!clockSaved) {
+    return;
+  }
+
+  const std::string accessPath = cachePath + SECTIONS_DIR_NAME + "/" + ACCESS_FILE_NAME;
+  auto access = SdMan.open(accessPath.c_str(), O_RDWR | O_CREAT);
+  if (!access) {
+    return;
+  }
+  // Sections that were never shown read as 0
+  const size_t offset = static_cast<size_t>(spineIndex) * sizeof(uint32_t);
+  constexpr uint32_t never = 0;
+  bool ok = access.seek(access.size());
+  while (ok && access.size() < offset) {
+    ok = access.write(reinterpret_cast<const uint8_t*>(&never), sizeof(never)) == sizeof(never);
+  }
+  ok = ok && access.seek(offset) &&
+       access.write(reinterpret_cast<const uint8_t*>(&header.clock), sizeof(header.clock)) == sizeof(header.clock);
+  access.close();
+  if (!ok) {
+    Serial.printf("[%lu] [CCH] Failed to record use of section %d\n", millis(), spineIndex);
+  }
+}
+
+bool hasWork() { return pending || checkedBudget != SETTINGS.getCacheBudgetBytes(); }
+
+void idleStep() {
+  Header header;
+  std::vector<Record> records;
+  load(header, records);
+
+  if (!listed) {
+    listDirs(records);
+    listed = true;
+    save(header, records);
+    return;
+  }
+
+  for (auto& record : records) {
+    if (!(record.flags & FLAG_MEASURED)) {
+      measure(record);
+      save(header, records);
+      return;
+    }
+  }
+
+  const uint64_t budget = SETTINGS.getCacheBudgetBytes();
+  uint64_t total = 0;
+  for (const auto& record : records) {
+    total += record.bookBytes + record.sectionBytes;
+  }
+  if (total > budget) {
+    if (Record* record = leastRecentlyOpened(records, [](const Record& r) { return r.sectionBytes > 0; })) {
+      evictSection(*record);
+      save(header, records);
+      return;
+    }
+    if (Record* record = leastRecentlyOpened(records, [](const Record& r) { return !(r.flags & FLAG_EVICTED); })) {
+      Serial.printf("[%lu] [CCH] Evicting cache %s (%lu bytes)\n", millis(), record->dir, record->bookBytes);
+      if (!evictBook(*record)) {
+        records.erase(records.begin() + (record - records.data()));
+      }
+      save(header, records);
+      return;
+    }
+  }
+
+  // Within the limit, or only the open book and reading positions are left
+  Serial.printf("[%lu] [CCH] Caches hold %lu KB in %u books\n", millis(), static_cast<unsigned long>(total / 1024),
+                records.size());
+  pending = false;
+  checkedBudget = budget;
+}
+
+}  // namespace CacheManager
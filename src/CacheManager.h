@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+
+/**
+ * Keeps the book caches in /.crosspoint under the size limit chosen in the settings.
+ *
+ * /.crosspoint/cache.bin holds one record per book cache directory with the size of its files and when it was last
+ * opened, as a value of a counter stored in the same file. Each book also keeps <cache dir>/sections/access.bin,
+ * with the counter value at which every section was last shown.
+ *
+ * The main loop calls idleStep() while nothing else is going on. Each call does one small piece of work: listing the
+ * cache directories, measuring one of them or removing one file. When the caches are over the limit, sections go
+ * first, least recently used first, from every book but the open one. Once no other book has sections left, books
+ * are evicted, least recently opened first: everything the reader can rebuild is removed, but progress.bin stays so the
+ * book still opens where it was left.
+ */
+namespace CacheManager {
+
+// The book whose cache is at cachePath was opened. It is never evicted while open.
+void bookOpened(const std::string& cachePath);
+// The open book was closed, its cache is measured again since the reader may have added files
+void bookClosed(const std::string& cachePath);
+// Section spineIndex of the book at cachePath is on screen
+void sectionUsed(const std::string& cachePath, int spineIndex);
+
+// Whether idleStep() has anything to do
+bool hasWork();
+// Does one piece of bookkeeping or eviction. Must not run while a display task may touch the SD card.
+void idleStep();
+
+}  // namespace CacheManager
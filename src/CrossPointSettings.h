@@ -52,6 +52,9 @@ class CrossPointSettings {
   // E-ink refresh frequency (pages between full refreshes)
   enum REFRESH_FREQUENCY { REFRESH_1 = 0, REFRESH_5 = 1, REFRESH_10 = 2, REFRESH_15 = 3, REFRESH_30 = 4 };
 
+  // Size limit of the book caches in /.crosspoint
+  enum CACHE_BUDGET { CACHE_64_MB = 0, CACHE_256_MB = 1, CACHE_1_GB = 2, CACHE_UNLIMITED = 3 };
+
   // Sleep screen settings
   uint8_t sleepScreen = DARK;
   // Sleep screen cover mode settings
@@ -80,6 +83,8 @@ class CrossPointSettings {
   uint8_t refreshFrequency = REFRESH_15;
   // Reader screen margin settings
   uint8_t screenMargin = 5;
+  // Book cache size limit (default 1 GB)
+  uint8_t cacheBudget = CACHE_1_GB;
   // OPDS browser settings
   char opdsServerUrl[128] = "";
 
@@ -97,6 +102,7 @@ class CrossPointSettings {
   float getReaderLineCompression() const;
   unsigned long getSleepTimeoutMs() const;
   int getRefreshFrequency() const;
+  uint64_t getCacheBudgetBytes() const;
 };
 
 // Helper macro to access settings
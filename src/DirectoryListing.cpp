@@ -0,0 +1,281 @@
+#include "DirectoryListing.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+#include "LibraryCatalog.h"
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t LISTING_VERSION = 2;
+constexpr char CACHE_DIR[] = "/.crosspoint/dirs";
+// Bytes of raw directory entries hashed per read
+constexpr size_t SIGNATURE_CHUNK = 512;
+// Entries read at a time by find()
+constexpr size_t FIND_BATCH = 32;
+
+#pragma pack(push, 1)
+struct FileHeader {
+  uint8_t version;
+  uint8_t reserved[3];
+  uint32_t signature;
+  uint32_t count;
+};
+
+struct EntryHeader {
+  uint8_t isDirectory;
+  uint32_t size;
+  uint32_t modified;
+  uint16_t nameLength;
+};
+#pragma pack(pop)
+
+bool isHidden(const char* name) { return name[0] == '.' || strcmp(name, "System Volume Information") == 0; }
+}  // namespace
+
+bool DirectoryListing::load(const std::string& dirPath) {
+  offsets.clear();
+  memoryEntries.clear();
+  inMemory = false;
+  dataEnd = 0;
+
+  const unsigned long start = millis();
+  uint32_t signature;
+  if (!DirectoryListing::signature(dirPath, signature)) {
+    return false;
+  }
+
+  std::string key = dirPath;
+  if (key.empty() || key.back() != '/') key += '/';
+  cachePath = std::string(CACHE_DIR) + "/" + std::to_string(std::hash<std::string>{}(key)) + ".bin";
+
+  if (loadCache(signature)) {
+    Serial.printf("[%lu] [DIR] Listing of %s from cache: %u entries in %lu ms\n", millis(), dirPath.c_str(),
+                  offsets.size(), millis() - start);
+    return true;
+  }
+  return rebuild(dirPath, signature);
+}
+
+bool DirectoryListing::signature(const std::string& dirPath, uint32_t& out) {
+  auto dir = SdMan.open(dirPath.c_str());
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return false;
+  }
+
+  uint8_t buffer[SIGNATURE_CHUNK];
+  uint32_t crc = MZ_CRC32_INIT;
+  int n;
+  while ((n = dir.read(buffer, sizeof(buffer))) > 0) {
+    crc = mz_crc32(crc, buffer, n);
+  }
+  dir.close();
+  out = crc;
+  return true;
+}
+
+bool DirectoryListing::loadCache(const uint32_t signature) {
+  FsFile file;
+  if (!SdMan.openFileForRead("DIR", cachePath, file)) {
+    return false;
+  }
+
+  FileHeader header;
+  bool ok = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+            header.version == LISTING_VERSION && header.signature == signature &&
+            sizeof(header) + header.count * sizeof(uint32_t) <= file.size();
+  if (ok) {
+    offsets.resize(header.count);
+    const size_t tableSize = header.count * sizeof(uint32_t);
+    ok = tableSize == 0 || file.read(reinterpret_cast<uint8_t*>(offsets.data()), tableSize) ==
+                               static_cast<int>(tableSize);
+    dataEnd = file.size();
+  }
+  file.close();
+
+  if (!ok) {
+    offsets.clear();
+  }
+  return ok;
+}
+
+bool DirectoryListing::rebuild(const std::string& dirPath, const uint32_t signature) {
+  const unsigned long start = millis();
+
+  auto dir = SdMan.open(dirPath.c_str());
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return false;
+  }
+
+  std::vector<Entry> entries;
+  std::vector<std::string> keys;
+  std::vector<LibraryCatalog::FileInfo> books;
+  char name[500];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (isHidden(name)) {
+      file.close();
+      continue;
+    }
+
+    Entry entry;
+    entry.isDirectory = file.isDirectory();
+    if (!entry.isDirectory && LibraryCatalog::formatOf(name) == LibraryCatalog::FORMAT_NONE) {
+      file.close();
+      continue;
+    }
+
+    uint16_t date = 0;
+    uint16_t time = 0;
+    file.getModifyDateTime(&date, &time);
+    entry.modified = static_cast<uint32_t>(date) << 16 | time;
+    entry.size = entry.isDirectory ? 0 : static_cast<uint32_t>(file.size());
+    entry.name = name;
+    file.close();
+
+    keys.push_back(StringUtils::naturalSortKey(entry.name));
+    if (entry.isDirectory) {
+      entry.name += '/';
+    } else {
+      books.push_back({entry.name, entry.size, entry.modified});
+    }
+    entries.push_back(std::move(entry));
+  }
+  dir.close();
+
+  // Folders first, then by natural sort key, with the raw name as tie breaker ("01" vs "1")
+  std::vector<uint32_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+    if (entries[a].isDirectory != entries[b].isDirectory) return entries[a].isDirectory;
+    if (keys[a] != keys[b]) return keys[a] < keys[b];
+    return entries[a].name < entries[b].name;
+  });
+  keys.clear();
+  keys.shrink_to_fit();
+
+  LibraryCatalog::refreshDirectory(dirPath, books);
+  books.clear();
+  books.shrink_to_fit();
+
+  // Offsets of every entry, behind the header and the offset table itself
+  offsets.resize(entries.size());
+  uint32_t offset = sizeof(FileHeader) + entries.size() * sizeof(uint32_t);
+  for (size_t i = 0; i < order.size(); i++) {
+    offsets[i] = offset;
+    offset += sizeof(EntryHeader) + entries[order[i]].name.length();
+  }
+  dataEnd = offset;
+
+  SdMan.mkdir("/.crosspoint");
+  SdMan.mkdir(CACHE_DIR);
+  FsFile file;
+  bool ok = SdMan.openFileForWrite("DIR", cachePath, file);
+  if (ok) {
+    FileHeader header = {};
+    header.version = LISTING_VERSION;
+    // Written last, so a listing cut short by a power loss never matches
+    header.signature = ~signature;
+    header.count = entries.size();
+    ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    const size_t tableSize = offsets.size() * sizeof(uint32_t);
+    ok = ok && (tableSize == 0 ||
+                file.write(reinterpret_cast<const uint8_t*>(offsets.data()), tableSize) == tableSize);
+    for (size_t i = 0; ok && i < order.size(); i++) {
+      const Entry& entry = entries[order[i]];
+      const EntryHeader entryHeader = {entry.isDirectory, entry.size, entry.modified,
+                                       static_cast<uint16_t>(entry.name.length())};
+      ok = file.write(reinterpret_cast<const uint8_t*>(&entryHeader), sizeof(entryHeader)) == sizeof(entryHeader) &&
+           file.write(reinterpret_cast<const uint8_t*>(entry.name.data()), entry.name.length()) == entry.name.length();
+    }
+    header.signature = signature;
+    ok = ok && file.sync() && file.seek(0) &&
+         file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+  }
+
+  if (!ok) {
+    Serial.printf("[%lu] [DIR] Failed to write listing cache %s, keeping it in memory\n", millis(), cachePath.c_str());
+    SdMan.remove(cachePath.c_str());
+    offsets.clear();
+    memoryEntries.reserve(entries.size());
+    for (const auto index : order) {
+      memoryEntries.push_back(std::move(entries[index]));
+    }
+    inMemory = true;
+  }
+
+  Serial.printf("[%lu] [DIR] Rebuilt listing of %s: %u entries in %lu ms\n", millis(), dirPath.c_str(), size(),
+                millis() - start);
+  return true;
+}
+
+bool DirectoryListing::read(const size_t first, const size_t count, std::vector<Entry>& out) const {
+  out.clear();
+  const size_t last = std::min(first + count, size());
+  if (first >= last) {
+    return true;
+  }
+
+  if (inMemory) {
+    out.assign(memoryEntries.begin() + first, memoryEntries.begin() + last);
+    return true;
+  }
+
+  // The rows are stored back to back, so they come in with a single read
+  const uint32_t begin = offsets[first];
+  const uint32_t end = last < offsets.size() ? offsets[last] : dataEnd;
+  std::vector<uint8_t> buffer(end - begin);
+
+  FsFile file;
+  if (!SdMan.openFileForRead("DIR", cachePath, file)) {
+    return false;
+  }
+  const bool ok = file.seek(begin) && file.read(buffer.data(), buffer.size()) == static_cast<int>(buffer.size());
+  file.close();
+  if (!ok) {
+    Serial.printf("[%lu] [DIR] Failed to read entries %u-%u of %s\n", millis(), first, last, cachePath.c_str());
+    return false;
+  }
+
+  size_t pos = 0;
+  for (size_t i = first; i < last; i++) {
+    EntryHeader entryHeader;
+    if (pos + sizeof(entryHeader) > buffer.size()) break;
+    memcpy(&entryHeader, buffer.data() + pos, sizeof(entryHeader));
+    pos += sizeof(entryHeader);
+    if (pos + entryHeader.nameLength > buffer.size()) break;
+
+    Entry entry;
+    entry.isDirectory = entryHeader.isDirectory != 0;
+    entry.size = entryHeader.size;
+    entry.modified = entryHeader.modified;
+    entry.name.assign(reinterpret_cast<const char*>(buffer.data() + pos), entryHeader.nameLength);
+    pos += entryHeader.nameLength;
+    out.push_back(std::move(entry));
+  }
+  return out.size() == last - first;
+}
+
+size_t DirectoryListing::find(const std::string& name) const {
+  std::vector<Entry> batch;
+  for (size_t first = 0; first < size(); first += FIND_BATCH) {
+    if (!read(first, FIND_BATCH, batch)) {
+      break;
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (batch[i].name == name) {
+        return first + i;
+      }
+    }
+  }
+  return 0;
+}
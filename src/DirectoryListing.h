@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * The folders and books of one directory, as shown by the file browser, cached in
+ * /.crosspoint/dirs/<hash of the directory path>.bin.
+ *
+ * Entries are stored already sorted (folders first, then natural order of the names, see
+ * StringUtils::naturalSortKey), behind a table of their file offsets. Opening a directory reads the header and the
+ * offset table only, and the browser reads the names of the rows it shows.
+ *
+ * The cache is keyed by a CRC of the directory's raw entries, which hold every file's name, size and timestamps.
+ * Reading those is a plain sequential read, far cheaper than opening each entry, and it notices any change made on the
+ * device or on a computer. Folder modification times would not do: the root directory has none, and FAT does not
+ * update a folder's time when files are added to it.
+ */
+class DirectoryListing {
+ public:
+  struct Entry {
+    std::string name;
+    bool isDirectory = false;
+    uint32_t size = 0;
+    uint32_t modified = 0;  // FAT date << 16 | FAT time
+  };
+
+  // Opens the listing of dirPath, rebuilding the cache if the directory changed. Returns false if it is not a
+  // directory.
+  bool load(const std::string& dirPath);
+
+  size_t size() const { return inMemory ? memoryEntries.size() : offsets.size(); }
+  bool empty() const { return size() == 0; }
+
+  // Reads up to count entries starting at first
+  bool read(size_t first, size_t count, std::vector<Entry>& out) const;
+
+  // Index of the entry with this name (folders end in '/'), or 0 if there is none
+  size_t find(const std::string& name) const;
+
+  // CRC of the raw directory entries of dirPath, changes whenever anything in the directory does. Returns false if
+  // dirPath is not a directory.
+  static bool signature(const std::string& dirPath, uint32_t& out);
+
+ private:
+  std::string cachePath;
+  std::vector<uint32_t> offsets;
+  uint32_t dataEnd = 0;
+  // Holds the whole listing when the cache file could not be written
+  std::vector<Entry> memoryEntries;
+  bool inMemory = false;
+
+  bool loadCache(uint32_t signature);
+  bool rebuild(const std::string& dirPath, uint32_t signature);
+};
@@ -0,0 +1,317 @@
+#include "LibraryCatalog.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "util/StringUtils.h"
+
+namespace LibraryCatalog {
+
+namespace {
+constexpr char CATALOG_FILE[] = "/.crosspoint/library.bin";
+constexpr uint32_t CATALOG_MAGIC = 0x4342504C;  // "LPBC"
+constexpr uint8_t CATALOG_VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+// Records read per SD access while scanning
+constexpr size_t SCAN_BATCH = 8;
+
+uint32_t hashPath(const std::string& path) { return static_cast<uint32_t>(std::hash<std::string>{}(path)); }
+
+std::string withTrailingSlash(std::string dirPath) {
+  if (dirPath.empty() || dirPath.back() != '/') dirPath += '/';
+  return dirPath;
+}
+
+void copyField(char* dest, const size_t size, const std::string& src) {
+  const size_t length = std::min(src.length(), size - 1);
+  memcpy(dest, src.data(), length);
+  memset(dest + length, 0, size - length);
+}
+
+// Opens the catalog for reading and writing, starting a fresh one if it is missing or from another version
+bool openCatalog(FsFile& file) {
+  SdMan.mkdir("/.crosspoint");
+  file = SdMan.open(CATALOG_FILE, O_RDWR | O_CREAT);
+  if (!file) {
+    Serial.printf("[%lu] [LIB] Failed to open %s\n", millis(), CATALOG_FILE);
+    return false;
+  }
+
+  uint8_t header[HEADER_SIZE] = {};
+  if (file.size() >= HEADER_SIZE && file.read(header, HEADER_SIZE) == HEADER_SIZE) {
+    uint32_t magic;
+    memcpy(&magic, header, sizeof(magic));
+    if (magic == CATALOG_MAGIC && header[4] == CATALOG_VERSION) {
+      return true;
+    }
+  }
+
+  Serial.printf("[%lu] [LIB] Starting a new catalog\n", millis());
+  memset(header, 0, sizeof(header));
+  memcpy(header, &CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+  header[4] = CATALOG_VERSION;
+  if (!file.truncate(0) || !file.seek(0) || file.write(header, HEADER_SIZE) != HEADER_SIZE) {
+    Serial.printf("[%lu] [LIB] Failed to initialise %s\n", millis(), CATALOG_FILE);
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+size_t recordCount(FsFile& file) { return (file.size() - HEADER_SIZE) / sizeof(Record); }
+
+// Calls visit(index, record) for every record, reading SCAN_BATCH records at a time
+template <typename Visitor>
+void scan(FsFile& file, Visitor&& visit) {
+  const size_t count = recordCount(file);
+  Record batch[SCAN_BATCH];
+  file.seek(HEADER_SIZE);
+  for (size_t start = 0; start < count; start += SCAN_BATCH) {
+    const size_t n = std::min(SCAN_BATCH, count - start);
+    if (file.read(reinterpret_cast<uint8_t*>(batch), n * sizeof(Record)) != static_cast<int>(n * sizeof(Record))) {
+      Serial.printf("[%lu] [LIB] Catalog read failed at record %u\n", millis(), start);
+      return;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (!visit(start + i, batch[i])) {
+        return;
+      }
+    }
+  }
+}
+
+bool writeRecord(FsFile& file, const size_t index, const Record& record) {
+  return file.seek(HEADER_SIZE + index * sizeof(Record)) &&
+         file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+}
+
+void resetRecord(Record& record, const std::string& path, const uint32_t dirHash, const uint32_t size,
+                 const uint32_t modified) {
+  memset(&record, 0, sizeof(record));
+  record.pathHash = hashPath(path);
+  record.dirHash = dirHash;
+  record.fileSize = size;
+  record.modified = modified;
+  record.format = formatOf(path);
+}
+}  // namespace
+
+Format formatOf(const std::string& path) {
+  if (StringUtils::checkFileExtension(path, ".epub")) return FORMAT_EPUB;
+  if (StringUtils::checkFileExtension(path, ".xtch")) return FORMAT_XTCH;
+  if (StringUtils::checkFileExtension(path, ".xtc")) return FORMAT_XTC;
+  return FORMAT_NONE;
+}
+
+bool find(const std::string& path, Record& record) {
+  FsFile file;
+  if (!SdMan.openFileForRead("LIB", CATALOG_FILE, file)) {
+    return false;
+  }
+  if (file.size() < HEADER_SIZE) {
+    file.close();
+    return false;
+  }
+
+  const uint32_t pathHash = hashPath(path);
+  bool found = false;
+  scan(file, [&](size_t, const Record& candidate) {
+    if (candidate.format != FORMAT_NONE && candidate.pathHash == pathHash) {
+      record = candidate;
+      found = true;
+    }
+    return !found;
+  });
+  file.close();
+  return found;
+}
+
+void refreshDirectory(const std::string& dirPath, const std::vector<FileInfo>& files) {
+  const std::string dir = withTrailingSlash(dirPath);
+  const uint32_t dirHash = hashPath(dir);
+
+  // (path hash, file index), sorted for lookups while scanning
+  std::vector<std::pair<uint32_t, uint32_t>> byHash;
+  byHash.reserve(files.size());
+  for (uint32_t i = 0; i < files.size(); i++) {
+    byHash.emplace_back(hashPath(dir + files[i].name), i);
+  }
+  std::sort(byHash.begin(), byHash.end());
+  std::vector<bool> seen(files.size(), false);
+
+  FsFile file;
+  if (!openCatalog(file)) {
+    return;
+  }
+
+  const unsigned long start = millis();
+  std::vector<std::pair<size_t, Record>> rewrites;
+  std::vector<size_t> freeSlots;
+  scan(file, [&](const size_t index, const Record& record) {
+    if (record.format == FORMAT_NONE) {
+      freeSlots.push_back(index);
+      return true;
+    }
+    if (record.dirHash != dirHash) {
+      return true;
+    }
+
+    const auto it = std::lower_bound(byHash.begin(), byHash.end(), std::make_pair(record.pathHash, uint32_t{0}));
+    if (it == byHash.end() || it->first != record.pathHash || seen[it->second]) {
+      // The book is gone (or this is a duplicate), release the record
+      Record freed = {};
+      rewrites.emplace_back(index, freed);
+      freeSlots.push_back(index);
+      return true;
+    }
+
+    const FileInfo& info = files[it->second];
+    seen[it->second] = true;
+    if (record.fileSize == info.size && record.modified == info.modified) {
+      return true;
+    }
+
+    // Replaced by another file of the same name: whatever was known about the old one no longer applies
+    Record changed;
+    resetRecord(changed, dir + info.name, dirHash, info.size, info.modified);
+    rewrites.emplace_back(index, changed);
+    return true;
+  });
+
+  size_t nextFree = 0;
+  size_t appendIndex = recordCount(file);
+  size_t added = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    if (seen[i]) continue;
+    Record created;
+    resetRecord(created, dir + files[i].name, dirHash, files[i].size, files[i].modified);
+    const size_t index = nextFree < freeSlots.size() ? freeSlots[nextFree++] : appendIndex++;
+    rewrites.emplace_back(index, created);
+    added++;
+  }
+
+  // Freed slots may be reused by new books, the later write wins
+  bool ok = true;
+  for (const auto& [index, record] : rewrites) {
+    ok = writeRecord(file, index, record) && ok;
+  }
+  if (!rewrites.empty()) {
+    ok = file.sync() && ok;
+  }
+  file.close();
+
+  if (!ok) {
+    Serial.printf("[%lu] [LIB] Failed to update catalog for %s\n", millis(), dir.c_str());
+  } else if (!rewrites.empty()) {
+    Serial.printf("[%lu] [LIB] Refreshed %s: %u records written (%u new) in %lu ms\n", millis(), dir.c_str(),
+                  rewrites.size(), added, millis() - start);
+  }
+}
+
+void findTitles(const std::vector<std::string>& paths, std::vector<std::string>& titles) {
+  titles.assign(paths.size(), std::string());
+  if (paths.empty()) {
+    return;
+  }
+
+  FsFile file;
+  if (!SdMan.openFileForRead("LIB", CATALOG_FILE, file)) {
+    return;
+  }
+  if (file.size() < HEADER_SIZE) {
+    file.close();
+    return;
+  }
+
+  std::vector<uint32_t> hashes;
+  hashes.reserve(paths.size());
+  for (const auto& path : paths) {
+    hashes.push_back(hashPath(path));
+  }
+
+  size_t remaining = paths.size();
+  scan(file, [&](size_t, const Record& record) {
+    if (record.format == FORMAT_NONE || !(record.flags & FLAG_METADATA)) {
+      return true;
+    }
+    for (size_t i = 0; i < hashes.size(); i++) {
+      if (hashes[i] == record.pathHash && titles[i].empty()) {
+        titles[i] = std::string(record.title, strnlen(record.title, sizeof(record.title)));
+        remaining--;
+      }
+    }
+    return remaining > 0;
+  });
+  file.close();
+}
+
+void updateBook(const std::string& path, const std::string& title, const std::string& author, const bool coverCached,
+                const uint8_t progressPercent) {
+  const auto lastSlash = path.find_last_of('/');
+  const std::string dir = lastSlash == std::string::npos ? "/" : path.substr(0, lastSlash + 1);
+
+  uint32_t size = 0;
+  uint32_t modified = 0;
+  FsFile book;
+  if (SdMan.openFileForRead("LIB", path, book)) {
+    uint16_t date = 0;
+    uint16_t time = 0;
+    book.getModifyDateTime(&date, &time);
+    size = book.size();
+    modified = static_cast<uint32_t>(date) << 16 | time;
+    book.close();
+  }
+
+  FsFile file;
+  if (!openCatalog(file)) {
+    return;
+  }
+
+  const uint32_t pathHash = hashPath(path);
+  size_t index = SIZE_MAX;
+  size_t freeIndex = SIZE_MAX;
+  Record record;
+  scan(file, [&](const size_t i, const Record& candidate) {
+    if (candidate.format == FORMAT_NONE) {
+      if (freeIndex == SIZE_MAX) freeIndex = i;
+      return true;
+    }
+    if (candidate.pathHash == pathHash) {
+      index = i;
+      record = candidate;
+      return false;
+    }
+    return true;
+  });
+
+  if (index == SIZE_MAX || record.fileSize != size || record.modified != modified) {
+    if (index == SIZE_MAX) {
+      index = freeIndex != SIZE_MAX ? freeIndex : recordCount(file);
+    }
+    resetRecord(record, path, hashPath(dir), size, modified);
+  }
+
+  if (!title.empty()) {
+    copyField(record.title, sizeof(record.title), title);
+    copyField(record.author, sizeof(record.author), author);
+    record.flags |= FLAG_METADATA;
+  }
+  if (coverCached) {
+    record.flags |= FLAG_COVER_CACHED;
+  } else {
+    record.flags &= ~FLAG_COVER_CACHED;
+  }
+  record.progressPercent = progressPercent;
+
+  const bool ok = writeRecord(file, index, record) && file.sync();
+  file.close();
+  if (!ok) {
+    Serial.printf("[%lu] [LIB] Failed to update catalog record for %s\n", millis(), path.c_str());
+  }
+}
+
+}  // namespace LibraryCatalog
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Catalog of the books on the SD card, kept in /.crosspoint/library.bin.
+ *
+ * The file is a short header followed by fixed-size records, one per book, keyed by the hash of the book's path.
+ * Lookups read the file front to back in a few large reads, and updates overwrite single records in place, so the
+ * home screen and the file browser can show titles without opening any book.
+ *
+ * Records are created by the file browser whenever it re-reads a directory. Size and modification time tell it when
+ * a file changed, so only those records are rewritten. Title, author, cover state and progress are filled in by the
+ * readers when a book is closed.
+ */
+namespace LibraryCatalog {
+
+enum Format : uint8_t { FORMAT_NONE = 0, FORMAT_EPUB, FORMAT_XTC, FORMAT_XTCH };
+
+enum Flags : uint8_t {
+  FLAG_METADATA = 1 << 0,      // title and author come from the book itself
+  FLAG_COVER_CACHED = 1 << 1,  // cover.bmp exists in the book's cache directory
+};
+
+#pragma pack(push, 1)
+struct Record {
+  uint32_t pathHash;
+  uint32_t dirHash;   // Hash of the containing directory, with a trailing '/'
+  uint32_t fileSize;
+  uint32_t modified;  // FAT date << 16 | FAT time
+  uint8_t format;     // FORMAT_NONE marks a free record
+  uint8_t flags;
+  uint8_t progressPercent;
+  uint8_t reserved;
+  char title[68];
+  char author[40];
+};
+#pragma pack(pop)
+static_assert(sizeof(Record) == 128, "Record size is part of the file format");
+
+// A book as seen while listing its directory
+struct FileInfo {
+  std::string name;
+  uint32_t size;
+  uint32_t modified;
+};
+
+Format formatOf(const std::string& path);
+
+// Finds the record for the book at path, returns false if there is none
+bool find(const std::string& path, Record& record);
+
+// Brings the records of dirPath in line with files. Records of files that changed are reset, ones that are gone are
+// freed, new files get a record.
+void refreshDirectory(const std::string& dirPath, const std::vector<FileInfo>& files);
+
+// Looks up several books in one pass. titles receives the known title of each path, or an empty string.
+void findTitles(const std::vector<std::string>& paths, std::vector<std::string>& titles);
+
+// Stores what a reader learnt about a book, creating its record if needed
+void updateBook(const std::string& path, const std::string& title, const std::string& author, bool coverCached,
+                uint8_t progressPercent);
+
+}  // namespace LibraryCatalog
@@ -1,7 +1,15 @@
 #include "MappedInputManager.h"
 
+#include <Arduino.h>
+
 #include "CrossPointSettings.h"
 
+namespace {
+constexpr uint8_t physicalButtons[] = {InputManager::BTN_BACK,  InputManager::BTN_CONFIRM, InputManager::BTN_LEFT,
+                                       InputManager::BTN_RIGHT, InputManager::BTN_UP,      InputManager::BTN_DOWN,
+                                       InputManager::BTN_POWER};
+}  // namespace
+
 decltype(InputManager::BTN_BACK) MappedInputManager::mapButton(const Button button) const {
   const auto frontLayout = static_cast<CrossPointSettings::FRONT_BUTTON_LAYOUT>(SETTINGS.frontButtonLayout);
   const auto sideLayout = static_cast<CrossPointSettings::SIDE_BUTTON_LAYOUT>(SETTINGS.sideButtonLayout);
@@ -72,6 +80,71 @@ decltype(InputManager::BTN_BACK) MappedInputManager::mapButton(const Button butt
   return InputManager::BTN_BACK;
 }
 
+void MappedInputManager::update() {
+  inputManager.update();
+  if (!inputManager.wasAnyPressed() && !inputManager.wasAnyReleased()) {
+    return;
+  }
+
+  const unsigned long now = millis();
+  for (const auto button : physicalButtons) {
+    if (inputManager.wasPressed(button)) {
+      pushEvent({button, true, 0, now});
+    }
+    if (inputManager.wasReleased(button)) {
+      pushEvent({button, false, inputManager.getHeldTime(), now});
+    }
+  }
+}
+
+void MappedInputManager::pushEvent(const Event& event) {
+  if (eventCount == EVENT_QUEUE_SIZE) {
+    eventHead = (eventHead + 1) % EVENT_QUEUE_SIZE;
+    eventCount--;
+  }
+  events[(eventHead + eventCount) % EVENT_QUEUE_SIZE] = event;
+  eventCount++;
+}
+
+bool MappedInputManager::popEvent(Event& event) {
+  if (eventCount == 0) {
+    return false;
+  }
+  event = events[eventHead];
+  eventHead = (eventHead + 1) % EVENT_QUEUE_SIZE;
+  eventCount--;
+  return true;
+}
+
+bool MappedInputManager::takePageTurns(const unsigned long longPressMs, int& turns, int& longTurns) {
+  turns = 0;
+  longTurns = 0;
+  bool any = false;
+  Event event;
+  while (popEvent(event)) {
+    if (event.pressed) {
+      continue;
+    }
+
+    int direction = 0;
+    if (isButton(event, Button::PageForward) || isButton(event, Button::Right)) {
+      direction = 1;
+    } else if (isButton(event, Button::PageBack) || isButton(event, Button::Left)) {
+      direction = -1;
+    } else {
+      continue;
+    }
+
+    any = true;
+    if (event.heldTime > longPressMs) {
+      longTurns += direction;
+    } else {
+      turns += direction;
+    }
+  }
+  return any;
+}
+
 bool MappedInputManager::wasPressed(const Button button) const { return inputManager.wasPressed(mapButton(button)); }
 
 bool MappedInputManager::wasReleased(const Button button) const { return inputManager.wasReleased(mapButton(button)); }
@@ -82,6 +155,15 @@ bool MappedInputManager::wasAnyPressed() const { return inputManager.wasAnyPress
 
 bool MappedInputManager::wasAnyReleased() const { return inputManager.wasAnyReleased(); }
 
+bool MappedInputManager::isAnyPressed() const {
+  for (const auto button : physicalButtons) {
+    if (inputManager.isPressed(button)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 unsigned long MappedInputManager::getHeldTime() const { return inputManager.getHeldTime(); }
 
 MappedInputManager::Labels MappedInputManager::mapLabels(const char* back, const char* confirm, const char* previous,
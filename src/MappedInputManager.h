@@ -13,17 +13,48 @@ class MappedInputManager {
     const char* btn4;
   };
 
+  // A change of one physical button, as seen by update()
+  struct Event {
+    uint8_t button;          // InputManager::BTN_*
+    bool pressed;            // false for a release
+    unsigned long heldTime;  // How long the button was down, set on releases
+    unsigned long time;      // millis() when the change was seen
+  };
+
   explicit MappedInputManager(InputManager& inputManager) : inputManager(inputManager) {}
 
+  // Polls the buttons and queues every press and release, call once per main loop iteration
+  void update();
+  // Takes the oldest queued event, returns false if there is none
+  bool popEvent(Event& event);
+  // Whether any press or release is waiting in the queue
+  bool hasEvents() const { return eventCount > 0; }
+  // Drops queued events, e.g. ones meant for an activity that has since been left
+  void clearEvents() { eventCount = 0; }
+  bool isButton(const Event& event, Button button) const { return event.button == mapButton(button); }
+  // Drains the queue and sums the page turn releases into one jump: +1 for each forward release, -1 for each back
+  // release. Releases held for longer than longPressMs are summed into longTurns instead. Other events are dropped.
+  // Returns false if no page turn was queued.
+  bool takePageTurns(unsigned long longPressMs, int& turns, int& longTurns);
+
   bool wasPressed(Button button) const;
   bool wasReleased(Button button) const;
   bool isPressed(Button button) const;
   bool wasAnyPressed() const;
   bool wasAnyReleased() const;
+  bool isAnyPressed() const;
   unsigned long getHeldTime() const;
   Labels mapLabels(const char* back, const char* confirm, const char* previous, const char* next) const;
 
  private:
+  // Holds what arrived while the current activity was busy. If nothing drains it, the oldest events are dropped.
+  static constexpr uint8_t EVENT_QUEUE_SIZE = 32;
+
   InputManager& inputManager;
+  Event events[EVENT_QUEUE_SIZE] = {};
+  uint8_t eventHead = 0;
+  uint8_t eventCount = 0;
+
+  void pushEvent(const Event& event);
   decltype(InputManager::BTN_BACK) mapButton(Button button) const;
 };
@@ -0,0 +1,160 @@
+#include "ProgressStore.h"
+
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "Battery.h"
+
+namespace {
+// How long the position has to stay unchanged before it is written
+constexpr unsigned long SETTLE_TIME_MS = 2000;
+// Below this charge a change is written after a short pause instead of the full settle time
+constexpr uint16_t LOW_BATTERY_PERCENT = 10;
+constexpr unsigned long LOW_BATTERY_SETTLE_TIME_MS = 250;
+// progress.bin as written by earlier firmware: just the record, no slots. Current files still start with it, kept up
+// to date on every write, so that earlier firmware reads the position instead of a slot header.
+constexpr size_t LEGACY_RECORD_SIZE = 4;
+}  // namespace
+
+uint32_t ProgressStore::slotCrc(const Slot& slot) {
+  return mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const uint8_t*>(&slot), offsetof(Slot, crc));
+}
+
+bool ProgressStore::load(uint8_t* data, const size_t size) {
+  memset(data, 0, size);
+
+  FsFile f;
+  if (!SdMan.openFileForRead("PRG", path, f)) {
+    return false;
+  }
+
+  const size_t fileSize = f.size();
+  if (fileSize == LEGACY_RECORD_SIZE) {
+    memset(current, 0, sizeof(current));
+    const bool ok = f.read(current, LEGACY_RECORD_SIZE) == LEGACY_RECORD_SIZE;
+    f.close();
+    if (!ok) {
+      return false;
+    }
+    sequence = 0;
+    memcpy(data, current, std::min(size, DATA_SIZE));
+    return true;
+  }
+
+  Slot slots[2];
+  const bool readOk =
+      f.seek(LEGACY_RECORD_SIZE) && f.read(reinterpret_cast<uint8_t*>(slots), sizeof(slots)) == sizeof(slots);
+  f.close();
+  if (!readOk) {
+    Serial.printf("[%lu] [PRG] Progress file too short: %s\n", millis(), path.c_str());
+    return false;
+  }
+
+  const Slot* newest = nullptr;
+  for (const auto& slot : slots) {
+    if (slot.crc != slotCrc(slot)) {
+      continue;
+    }
+    // Sequence numbers may wrap, compare them as a signed distance
+    if (!newest || static_cast<int32_t>(slot.sequence - newest->sequence) > 0) {
+      newest = &slot;
+    }
+  }
+
+  if (!newest) {
+    Serial.printf("[%lu] [PRG] No valid progress record in %s\n", millis(), path.c_str());
+    return false;
+  }
+
+  memcpy(current, newest->data, DATA_SIZE);
+  sequence = newest->sequence;
+  dirty = false;
+  memcpy(data, current, std::min(size, DATA_SIZE));
+  return true;
+}
+
+void ProgressStore::set(const uint8_t* data, const size_t size) {
+  uint8_t updated[DATA_SIZE] = {};
+  memcpy(updated, data, std::min(size, DATA_SIZE));
+  if (memcmp(updated, current, DATA_SIZE) == 0) {
+    return;
+  }
+
+  memcpy(current, updated, DATA_SIZE);
+  dirty = true;
+  batteryChecked = false;
+  lastChangeTime = millis();
+}
+
+void ProgressStore::flushIfDue() {
+  if (!dirty) {
+    return;
+  }
+
+  const unsigned long elapsed = millis() - lastChangeTime;
+  if (elapsed >= SETTLE_TIME_MS) {
+    flush();
+    return;
+  }
+
+  // The battery is read once per change, when the short pause is over, not on every call
+  if (elapsed >= LOW_BATTERY_SETTLE_TIME_MS && !batteryChecked) {
+    batteryChecked = true;
+    if (battery.readPercentage() <= LOW_BATTERY_PERCENT) {
+      flush();
+    }
+  }
+}
+
+bool ProgressStore::flush() {
+  if (!dirty || path.empty()) {
+    return true;
+  }
+
+  const unsigned long start = millis();
+
+  Slot slot;
+  slot.sequence = sequence + 1;
+  memcpy(slot.data, current, DATA_SIZE);
+  slot.crc = slotCrc(slot);
+
+  // Overwrite only the older slot, so the newest record on disk stays intact until this one is complete
+  FsFile f = SdMan.open(path.c_str(), O_RDWR | O_CREAT);
+  if (!f) {
+    Serial.printf("[%lu] [PRG] Failed to open %s for writing\n", millis(), path.c_str());
+    return false;
+  }
+
+  const size_t slotIndex = slot.sequence & 1;
+  bool ok = true;
+  if (f.size() != LEGACY_RECORD_SIZE + 2 * sizeof(Slot)) {
+    // New file, or a 4-byte one from earlier firmware: lay out both slots, leaving the unused one invalid
+    Slot slots[2] = {};
+    slots[slotIndex] = slot;
+    ok = f.seek(LEGACY_RECORD_SIZE) &&
+         f.write(reinterpret_cast<const uint8_t*>(slots), sizeof(slots)) == sizeof(slots);
+  } else {
+    ok = f.seek(LEGACY_RECORD_SIZE + slotIndex * sizeof(Slot)) &&
+         f.write(reinterpret_cast<const uint8_t*>(&slot), sizeof(slot)) == sizeof(slot);
+  }
+  // The legacy record goes last: a torn write can only leave it stale, and only earlier firmware reads it
+  ok = ok && f.seek(0) && f.write(current, LEGACY_RECORD_SIZE) == LEGACY_RECORD_SIZE;
+  ok = f.sync() && ok;
+  f.close();
+
+  if (!ok) {
+    Serial.printf("[%lu] [PRG] Failed to write progress to %s\n", millis(), path.c_str());
+    return false;
+  }
+
+  sequence = slot.sequence;
+  dirty = false;
+  Serial.printf("[%lu] [PRG] Saved progress (slot %u, seq %lu) in %lu ms\n", millis(), slotIndex, sequence,
+                millis() - start);
+  return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Reading position of one book, kept in <book cache dir>/progress.bin.
+ *
+ * Page turns only update the in-memory record. It is written once the position has settled for a moment (a shorter
+ * one when the battery runs low), or when flush() is called (leaving the reader, which includes going to sleep), so a
+ * burst of page turns costs one SD write instead of one per turn.
+ *
+ * The file holds two slots that are written alternately, each with a sequence number and a CRC. A write torn by a
+ * power loss only damages the slot being written, and load() falls back to the other one. The slots follow a copy of
+ * the record's first 4 bytes, the whole file of earlier firmware, so that firmware still finds the position.
+ */
+class ProgressStore {
+ public:
+  static constexpr size_t DATA_SIZE = 8;
+
+  explicit ProgressStore(std::string path = "") : path(std::move(path)) {}
+
+  void setPath(std::string newPath) { path = std::move(newPath); }
+
+  // Fills data with the newest valid record, zero-padded to size. Returns false if there is none.
+  bool load(uint8_t* data, size_t size);
+
+  // Updates the in-memory record; only marks it for writing if it changed
+  void set(const uint8_t* data, size_t size);
+
+  // Writes the record if it is due, call regularly while the SD card is not in use
+  void flushIfDue();
+
+  // Writes the record now if it has unsaved changes
+  bool flush();
+
+  bool hasUnsavedChanges() const { return dirty; }
+
+ private:
+  struct Slot {
+    uint32_t sequence;
+    uint8_t data[DATA_SIZE];
+    uint32_t crc;  // Over sequence and data
+  };
+
+  std::string path;
+  uint8_t current[DATA_SIZE] = {};
+  uint32_t sequence = 0;
+  bool dirty = false;
+  bool batteryChecked = false;
+  unsigned long lastChangeTime = 0;
+
+  static uint32_t slotCrc(const Slot& slot);
+};
@@ -0,0 +1,262 @@
+#include "ResumeSnapshot.h"
+
+#include <Epub.h>
+#include <GfxRenderer.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+#include "CrossPointSettings.h"
+#include "ProgressStore.h"
+
+namespace ResumeSnapshot {
+
+namespace {
+constexpr uint8_t SNAPSHOT_VERSION = 1;
+constexpr size_t POSITION_SIZE = 4;
+// Bytes buffered between the SD card and the PackBits coder
+constexpr size_t IO_CHUNK = 512;
+
+#pragma pack(push, 1)
+struct Header {
+  uint8_t version;
+  uint8_t planes;  // 1 for black and white, 3 with the two greyscale planes
+  uint8_t reserved[2];
+  uint32_t pathHash;
+  uint32_t bookSize;
+  uint32_t bookModified;  // FAT date << 16 | FAT time
+  uint32_t settings;      // settingsSignature() when the page was drawn
+  uint8_t position[POSITION_SIZE];
+  uint32_t planeSizes[3];  // Compressed size of each plane, 0 until the snapshot is complete
+};
+#pragma pack(pop)
+
+unsigned long shownTime = 0;
+
+// Everything that changes how a page of a book is laid out or drawn
+uint32_t settingsSignature() {
+  const uint8_t settings[] = {SETTINGS.fontFamily,         SETTINGS.fontSize,     SETTINGS.lineSpacing,
+                              SETTINGS.paragraphAlignment, SETTINGS.screenMargin, SETTINGS.extraParagraphSpacing,
+                              SETTINGS.orientation,        SETTINGS.statusBar,    SETTINGS.textAntiAliasing};
+  return mz_crc32(MZ_CRC32_INIT, settings, sizeof(settings));
+}
+
+uint32_t hashPath(const std::string& path) { return static_cast<uint32_t>(std::hash<std::string>{}(path)); }
+
+bool statBook(const std::string& bookPath, uint32_t& size, uint32_t& modified) {
+  FsFile book;
+  if (!SdMan.openFileForRead("RSN", bookPath, book)) {
+    return false;
+  }
+  uint16_t date = 0;
+  uint16_t time = 0;
+  book.getModifyDateTime(&date, &time);
+  size = book.size();
+  modified = static_cast<uint32_t>(date) << 16 | time;
+  book.close();
+  return true;
+}
+
+// PackBits: a control byte n < 128 is followed by n + 1 literal bytes, n >= 128 repeats the next byte n - 125 times
+class PackBitsWriter {
+  FsFile& file;
+  uint8_t buffer[IO_CHUNK];
+  size_t used = 0;
+  size_t written = 0;
+  bool ok = true;
+
+  void put(const uint8_t* data, const size_t size) {
+    if (used + size > sizeof(buffer)) flush();
+    memcpy(buffer + used, data, size);
+    used += size;
+  }
+
+ public:
+  explicit PackBitsWriter(FsFile& file) : file(file) {}
+
+  void encode(const uint8_t* data, const size_t size) {
+    size_t i = 0;
+    while (i < size) {
+      size_t run = 1;
+      while (i + run < size && run < 130 && data[i + run] == data[i]) run++;
+      if (run >= 3) {
+        const uint8_t control[2] = {static_cast<uint8_t>(run + 125), data[i]};
+        put(control, sizeof(control));
+        i += run;
+        continue;
+      }
+
+      // Literals up to the next run of three
+      const size_t start = i;
+      while (i < size && i - start < 128 && !(i + 2 < size && data[i] == data[i + 1] && data[i] == data[i + 2])) {
+        i++;
+      }
+      const auto control = static_cast<uint8_t>(i - start - 1);
+      put(&control, 1);
+      put(data + start, i - start);
+    }
+  }
+
+  void flush() {
+    if (used > 0) {
+      ok = ok && file.write(buffer, used) == used;
+      written += used;
+      used = 0;
+    }
+  }
+
+  bool good() const { return ok; }
+  size_t size() const { return written + used; }
+};
+
+bool decodePlane(FsFile& file, const size_t compressedSize, uint8_t* out, const size_t outSize) {
+  uint8_t buffer[IO_CHUNK];
+  size_t available = 0;
+  size_t pos = 0;
+  size_t remaining = compressedSize;
+  const auto next = [&](uint8_t& byte) {
+    if (pos == available) {
+      const size_t n = std::min(sizeof(buffer), remaining);
+      if (n == 0 || file.read(buffer, n) != static_cast<int>(n)) return false;
+      remaining -= n;
+      available = n;
+      pos = 0;
+    }
+    byte = buffer[pos++];
+    return true;
+  };
+
+  size_t outPos = 0;
+  uint8_t control;
+  while (outPos < outSize && next(control)) {
+    if (control < 128) {
+      const size_t count = control + 1;
+      if (outPos + count > outSize) return false;
+      for (size_t i = 0; i < count; i++) {
+        if (!next(out[outPos++])) return false;
+      }
+    } else {
+      const size_t count = control - 125;
+      uint8_t value;
+      if (outPos + count > outSize || !next(value)) return false;
+      memset(out + outPos, value, count);
+      outPos += count;
+    }
+  }
+  return outPos == outSize;
+}
+}  // namespace
+
+std::string pathFor(const std::string& bookCachePath) { return bookCachePath + "/resume.bin"; }
+
+bool show(GfxRenderer& renderer, const std::string& bookPath) {
+  const Epub epub(bookPath, "/.crosspoint");
+  FsFile file;
+  if (!SdMan.openFileForRead("RSN", pathFor(epub.getCachePath()), file)) {
+    return false;
+  }
+
+  Header header;
+  uint32_t bookSize = 0;
+  uint32_t bookModified = 0;
+  uint8_t position[POSITION_SIZE];
+  ProgressStore progress(epub.getCachePath() + "/progress.bin");
+  bool current = file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+                 header.version == SNAPSHOT_VERSION && (header.planes == 1 || header.planes == 3) &&
+                 header.pathHash == hashPath(bookPath) && header.settings == settingsSignature() &&
+                 statBook(bookPath, bookSize, bookModified) && header.bookSize == bookSize &&
+                 header.bookModified == bookModified && progress.load(position, sizeof(position)) &&
+                 memcmp(header.position, position, sizeof(position)) == 0;
+  for (uint8_t plane = 0; current && plane < header.planes; plane++) {
+    current = header.planeSizes[plane] > 0;
+  }
+  if (!current) {
+    Serial.printf("[%lu] [RSN] No current snapshot for %s\n", millis(), bookPath.c_str());
+    file.close();
+    return false;
+  }
+
+  // Same sequence as the reader: black and white first, then the greyscale planes on top
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+  const size_t planeSize = GfxRenderer::getBufferSize();
+  if (!decodePlane(file, header.planeSizes[0], frameBuffer, planeSize)) {
+    Serial.printf("[%lu] [RSN] Corrupt snapshot for %s\n", millis(), bookPath.c_str());
+    file.close();
+    return false;
+  }
+  renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
+  shownTime = millis();
+
+  if (header.planes == 3) {
+    renderer.storeBwBuffer();
+    if (decodePlane(file, header.planeSizes[1], frameBuffer, planeSize)) {
+      renderer.copyGrayscaleLsbBuffers();
+      if (decodePlane(file, header.planeSizes[2], frameBuffer, planeSize)) {
+        renderer.copyGrayscaleMsbBuffers();
+        renderer.displayGrayBuffer();
+      }
+    }
+    renderer.restoreBwBuffer();
+  }
+  file.close();
+
+  Serial.printf("[%lu] [RSN] Snapshot of %s on screen %lu ms after boot\n", millis(), bookPath.c_str(), shownTime);
+  return true;
+}
+
+unsigned long takeShownTime() {
+  const unsigned long time = shownTime;
+  shownTime = 0;
+  return time;
+}
+
+bool Writer::open(const std::string& bookPath, const std::string& bookCachePath, const uint8_t* position,
+                  const size_t positionSize) {
+  path = pathFor(bookCachePath);
+  planes = 0;
+  memset(planeSizes, 0, sizeof(planeSizes));
+
+  Header header = {};
+  header.version = SNAPSHOT_VERSION;
+  header.pathHash = hashPath(bookPath);
+  header.settings = settingsSignature();
+  memcpy(header.position, position, std::min(positionSize, sizeof(header.position)));
+  ok = statBook(bookPath, header.bookSize, header.bookModified) && SdMan.openFileForWrite("RSN", path, file);
+  // Plane count and sizes stay 0 until close(), so a snapshot cut short is never shown
+  ok = ok && file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+  return ok;
+}
+
+void Writer::addPlane(const uint8_t* buffer) {
+  if (!ok || planes >= 3) {
+    ok = false;
+    return;
+  }
+  PackBitsWriter writer(file);
+  writer.encode(buffer, GfxRenderer::getBufferSize());
+  writer.flush();
+  ok = writer.good();
+  planeSizes[planes++] = writer.size();
+}
+
+bool Writer::close() {
+  if (!file) {
+    return false;
+  }
+
+  ok = ok && (planes == 1 || planes == 3) && file.sync() && file.seek(offsetof(Header, planes)) &&
+       file.write(&planes, sizeof(planes)) == sizeof(planes) && file.seek(offsetof(Header, planeSizes)) &&
+       file.write(reinterpret_cast<const uint8_t*>(planeSizes), sizeof(planeSizes)) == sizeof(planeSizes);
+  file.close();
+
+  if (!ok) {
+    Serial.printf("[%lu] [RSN] Failed to write %s\n", millis(), path.c_str());
+    SdMan.remove(path.c_str());
+  }
+  return ok;
+}
+
+}  // namespace ResumeSnapshot
@@ -0,0 +1,46 @@
+#pragma once
+#include <SDCardManager.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class GfxRenderer;
+
+/**
+ * The page on screen when the device last went to sleep in an EPUB, kept in <book cache dir>/resume.bin so that
+ * waking up can show it before fonts, book and section are loaded.
+ *
+ * The file holds the framebuffer planes of the page (black and white, plus the two greyscale planes with text
+ * anti-aliasing), each PackBits-compressed: a page is mostly white, so a plane shrinks from 48000 bytes to a few KB.
+ * The header records the book's path hash, size and time, a signature of the settings that change the layout and
+ * the reading position, and a snapshot is only shown if all of them still match.
+ */
+namespace ResumeSnapshot {
+
+std::string pathFor(const std::string& bookCachePath);
+
+// Shows the snapshot of bookPath if it is still current, returns false without touching the display otherwise
+bool show(GfxRenderer& renderer, const std::string& bookPath);
+
+// millis() at which show() put a snapshot on screen, or 0 if it did not. Only the first call returns it.
+unsigned long takeShownTime();
+
+// Saves the planes of a snapshot as they are drawn
+class Writer {
+  FsFile file;
+  bool ok = false;
+  std::string path;
+  uint8_t planes = 0;
+  uint32_t planeSizes[3] = {};
+
+ public:
+  // Starts the snapshot of bookPath at its reading position (the bytes stored in progress.bin)
+  bool open(const std::string& bookPath, const std::string& bookCachePath, const uint8_t* position,
+            size_t positionSize);
+  void addPlane(const uint8_t* buffer);
+  // Finishes the snapshot, removing it if anything failed. Returns true if it was kept.
+  bool close();
+};
+
+}  // namespace ResumeSnapshot
@@ -0,0 +1,193 @@
+#include "SleepFrame.h"
+
+#include <Bitmap.h>
+#include <GfxRenderer.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "CrossPointSettings.h"
+
+namespace SleepFrame {
+
+namespace {
+constexpr uint8_t FRAME_VERSION = 1;
+
+#pragma pack(push, 1)
+struct Header {
+  uint8_t version;
+  uint8_t orientation;
+  uint8_t coverMode;
+  uint8_t planes;  // 1 for black and white, 3 with the two greyscale planes
+};
+#pragma pack(pop)
+
+bool readHeader(FsFile& file, Header& header, const uint8_t orientation) {
+  return file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+         header.version == FRAME_VERSION && header.orientation == orientation &&
+         header.coverMode == SETTINGS.sleepScreenCoverMode && (header.planes == 1 || header.planes == 3) &&
+         file.size() == sizeof(header) + header.planes * GfxRenderer::getBufferSize();
+}
+}  // namespace
+
+std::string coverFramePath(const std::string& bookCachePath) { return bookCachePath + "/sleep.frame"; }
+
+void place(const Bitmap& bitmap, const int pageWidth, const int pageHeight, int& x, int& y, float& cropX,
+           float& cropY) {
+  cropX = 0;
+  cropY = 0;
+
+  Serial.printf("[%lu] [SLP] bitmap %d x %d, screen %d x %d\n", millis(), bitmap.getWidth(), bitmap.getHeight(),
+                pageWidth, pageHeight);
+  if (bitmap.getWidth() > pageWidth || bitmap.getHeight() > pageHeight) {
+    // image will scale, make sure placement is right
+    float ratio = static_cast<float>(bitmap.getWidth()) / static_cast<float>(bitmap.getHeight());
+    const float screenRatio = static_cast<float>(pageWidth) / static_cast<float>(pageHeight);
+
+    Serial.printf("[%lu] [SLP] bitmap ratio: %f, screen ratio: %f\n", millis(), ratio, screenRatio);
+    if (ratio > screenRatio) {
+      // image wider than viewport ratio, scaled down image needs to be centered vertically
+      if (SETTINGS.sleepScreenCoverMode == CrossPointSettings::SLEEP_SCREEN_COVER_MODE::CROP) {
+        cropX = 1.0f - (screenRatio / ratio);
+        Serial.printf("[%lu] [SLP] Cropping bitmap x: %f\n", millis(), cropX);
+        ratio = (1.0f - cropX) * static_cast<float>(bitmap.getWidth()) / static_cast<float>(bitmap.getHeight());
+      }
+      x = 0;
+      y = std::round((static_cast<float>(pageHeight) - static_cast<float>(pageWidth) / ratio) / 2);
+      Serial.printf("[%lu] [SLP] Centering with ratio %f to y=%d\n", millis(), ratio, y);
+    } else {
+      // image taller than viewport ratio, scaled down image needs to be centered horizontally
+      if (SETTINGS.sleepScreenCoverMode == CrossPointSettings::SLEEP_SCREEN_COVER_MODE::CROP) {
+        cropY = 1.0f - (ratio / screenRatio);
+        Serial.printf("[%lu] [SLP] Cropping bitmap y: %f\n", millis(), cropY);
+        ratio = static_cast<float>(bitmap.getWidth()) / ((1.0f - cropY) * static_cast<float>(bitmap.getHeight()));
+      }
+      x = std::round((pageWidth - pageHeight * ratio) / 2);
+      y = 0;
+      Serial.printf("[%lu] [SLP] Centering with ratio %f to x=%d\n", millis(), ratio, x);
+    }
+  } else {
+    // center the image
+    x = (pageWidth - bitmap.getWidth()) / 2;
+    y = (pageHeight - bitmap.getHeight()) / 2;
+  }
+}
+
+bool isCurrent(const std::string& path, const uint8_t orientation) {
+  FsFile file;
+  if (!SdMan.openFileForRead("SLP", path, file)) {
+    return false;
+  }
+  Header header;
+  const bool current = readHeader(file, header, orientation);
+  file.close();
+  return current;
+}
+
+bool show(GfxRenderer& renderer, const std::string& path) {
+  FsFile file;
+  if (!SdMan.openFileForRead("SLP", path, file)) {
+    return false;
+  }
+
+  Header header;
+  if (!readHeader(file, header, renderer.getOrientation())) {
+    file.close();
+    return false;
+  }
+
+  const size_t planeSize = GfxRenderer::getBufferSize();
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+  if (file.read(frameBuffer, planeSize) != static_cast<int>(planeSize)) {
+    file.close();
+    return false;
+  }
+  renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
+
+  if (header.planes == 3) {
+    if (file.read(frameBuffer, planeSize) == static_cast<int>(planeSize)) {
+      renderer.copyGrayscaleLsbBuffers();
+      if (file.read(frameBuffer, planeSize) == static_cast<int>(planeSize)) {
+        renderer.copyGrayscaleMsbBuffers();
+        renderer.displayGrayBuffer();
+      }
+    }
+  }
+  file.close();
+  return true;
+}
+
+bool prerender(const GfxRenderer& renderer, const std::string& bmpPath, const std::string& path,
+               const std::function<bool()>& yield) {
+  FsFile bmp;
+  if (!SdMan.openFileForRead("SLP", bmpPath, bmp)) {
+    return false;
+  }
+  Bitmap bitmap(bmp);
+  if (bitmap.parseHeaders() != BmpReaderError::Ok) {
+    bmp.close();
+    return false;
+  }
+
+  auto* buffer = static_cast<uint8_t*>(malloc(GfxRenderer::getBufferSize()));
+  if (!buffer) {
+    Serial.printf("[%lu] [SLP] Not enough memory to pre-render %s\n", millis(), path.c_str());
+    bmp.close();
+    return false;
+  }
+
+  // Sleep screens are always drawn in portrait, whatever the reader uses
+  auto offscreen = renderer.offscreen(buffer);
+  int x, y;
+  float cropX, cropY;
+  const int pageWidth = offscreen.getScreenWidth();
+  const int pageHeight = offscreen.getScreenHeight();
+  place(bitmap, pageWidth, pageHeight, x, y, cropX, cropY);
+
+  Writer writer;
+  writer.open(path, offscreen.getOrientation(), bitmap.hasGreyscale());
+  const GfxRenderer::RenderMode modes[] = {GfxRenderer::BW, GfxRenderer::GRAYSCALE_LSB, GfxRenderer::GRAYSCALE_MSB};
+  const int planes = bitmap.hasGreyscale() ? 3 : 1;
+  bool stopped = false;
+  for (int plane = 0; plane < planes && !stopped; plane++) {
+    bitmap.rewindToData();
+    offscreen.clearScreen(modes[plane] == GfxRenderer::BW ? 0xFF : 0x00);
+    offscreen.setRenderMode(modes[plane]);
+    offscreen.drawBitmap(bitmap, x, y, pageWidth, pageHeight, cropX, cropY);
+    writer.addPlane(buffer);
+    stopped = !yield();
+  }
+  free(buffer);
+  bmp.close();
+
+  return writer.close(!stopped);
+}
+
+void Writer::open(const std::string& path, const uint8_t orientation, const bool greyscale) {
+  this->path = path;
+  ok = !path.empty() && SdMan.openFileForWrite("SLP", path, file);
+  if (ok) {
+    const Header header = {FRAME_VERSION, orientation, SETTINGS.sleepScreenCoverMode,
+                           static_cast<uint8_t>(greyscale ? 3 : 1)};
+    ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+  }
+}
+
+void Writer::addPlane(const uint8_t* buffer) {
+  ok = ok && file.write(buffer, GfxRenderer::getBufferSize()) == GfxRenderer::getBufferSize();
+}
+
+bool Writer::close(const bool keep) {
+  if (!file) {
+    return false;
+  }
+  file.close();
+  ok = ok && keep;
+  if (!ok) {
+    Serial.printf("[%lu] [SLP] Frame %s not completed\n", millis(), path.c_str());
+    SdMan.remove(path.c_str());
+  }
+  return ok;
+}
+
+}  // namespace SleepFrame
@@ -0,0 +1,49 @@
+#pragma once
+#include <SDCardManager.h>
+
+#include <functional>
+#include <string>
+
+class Bitmap;
+class GfxRenderer;
+
+/**
+ * A sleep screen saved exactly as it was drawn: the black and white framebuffer, followed by the two greyscale planes
+ * for images with more than one bit per pixel. Showing one is a sequential read straight into the framebuffer.
+ *
+ * Frames remember the orientation and cover mode they were drawn for, a frame for other settings is not shown.
+ */
+namespace SleepFrame {
+
+// Where the frame of a book's cover lives, inside its cache directory
+std::string coverFramePath(const std::string& bookCachePath);
+
+// Where and how much of bitmap to draw on a pageWidth x pageHeight screen for the current cover mode
+void place(const Bitmap& bitmap, int pageWidth, int pageHeight, int& x, int& y, float& cropX, float& cropY);
+
+// True if path holds a complete frame for the given orientation and the current cover mode
+bool isCurrent(const std::string& path, uint8_t orientation);
+
+// Shows the frame at path, returns false without touching the display if there is no current one
+bool show(GfxRenderer& renderer, const std::string& path);
+
+// Draws bmpPath into a frame at path without touching the display. Runs on a background task: it uses an offscreen
+// renderer and its own frame buffer, and calls yield between planes, which stops it when it returns false.
+bool prerender(const GfxRenderer& renderer, const std::string& bmpPath, const std::string& path,
+               const std::function<bool()>& yield);
+
+// Saves the planes of a frame as they are drawn
+class Writer {
+  FsFile file;
+  bool ok = false;
+  std::string path;
+
+ public:
+  // Starts a frame at path with one plane, or three if greyscale. Does nothing if path is empty.
+  void open(const std::string& path, uint8_t orientation, bool greyscale);
+  void addPlane(const uint8_t* buffer);
+  // Finishes the frame, removing it if anything failed or keep is false. Returns true if the frame was kept.
+  bool close(bool keep = true);
+};
+
+}  // namespace SleepFrame
@@ -0,0 +1,218 @@
+#include "SleepImageIndex.h"
+
+#include <Arduino.h>
+#include <Bitmap.h>
+#include <SDCardManager.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "DirectoryListing.h"
+#include "util/StringUtils.h"
+
+namespace SleepImageIndex {
+
+namespace {
+constexpr uint8_t INDEX_VERSION = 1;
+constexpr char SLEEP_DIR[] = "/sleep";
+constexpr char CACHE_DIR[] = "/.crosspoint/sleep";
+constexpr char INDEX_FILE[] = "/.crosspoint/sleep/index.bin";
+constexpr char FRAME_EXTENSION[] = ".frame";
+
+#pragma pack(push, 1)
+struct FileHeader {
+  uint8_t version;
+  uint8_t reserved[3];
+  uint32_t signature;
+  uint32_t count;
+};
+
+struct Record {
+  uint32_t size;
+  uint32_t modified;
+  uint16_t width;
+  uint16_t height;
+  uint8_t bpp;
+  uint8_t reserved[3];
+  char name[112];
+};
+#pragma pack(pop)
+static_assert(sizeof(Record) == 128, "Record size is part of the file format");
+
+bool readHeader(FsFile& file, FileHeader& header) {
+  return file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+         header.version == INDEX_VERSION && sizeof(header) + header.count * sizeof(Record) <= file.size();
+}
+
+std::string frameName(const Record& record) {
+  const std::string key = std::string(record.name) + ":" + std::to_string(record.size) + ":" +
+                          std::to_string(record.modified);
+  return std::to_string(std::hash<std::string>{}(key)) + FRAME_EXTENSION;
+}
+
+// Frames of images that are gone or changed are never read again
+void removeStaleFrames(const std::vector<Record>& records) {
+  std::vector<std::string> keep;
+  keep.reserve(records.size());
+  for (const auto& record : records) {
+    keep.push_back(frameName(record));
+  }
+
+  auto dir = SdMan.open(CACHE_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return;
+  }
+  std::vector<std::string> stale;
+  char name[64];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    file.close();
+    if (StringUtils::checkFileExtension(name, FRAME_EXTENSION) &&
+        std::find(keep.begin(), keep.end(), name) == keep.end()) {
+      stale.emplace_back(name);
+    }
+  }
+  dir.close();
+
+  for (const auto& name : stale) {
+    SdMan.remove((std::string(CACHE_DIR) + "/" + name).c_str());
+  }
+}
+
+bool rebuild(const uint32_t signature) {
+  const unsigned long start = millis();
+  auto dir = SdMan.open(SLEEP_DIR);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return false;
+  }
+
+  std::vector<Record> records;
+  char name[500];
+  for (auto file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (file.isDirectory() || name[0] == '.') {
+      file.close();
+      continue;
+    }
+    if (!StringUtils::checkFileExtension(name, ".bmp")) {
+      Serial.printf("[%lu] [SLI] Skipping non-.bmp file name: %s\n", millis(), name);
+      file.close();
+      continue;
+    }
+    if (strlen(name) >= sizeof(Record::name)) {
+      Serial.printf("[%lu] [SLI] Skipping file with a name too long to index: %s\n", millis(), name);
+      file.close();
+      continue;
+    }
+
+    Bitmap bitmap(file);
+    const auto error = bitmap.parseHeaders();
+    if (error != BmpReaderError::Ok) {
+      Serial.printf("[%lu] [SLI] Skipping invalid BMP file %s: %s\n", millis(), name, Bitmap::errorToString(error));
+      file.close();
+      continue;
+    }
+
+    Record record = {};
+    uint16_t date = 0;
+    uint16_t time = 0;
+    file.getModifyDateTime(&date, &time);
+    record.size = file.size();
+    record.modified = static_cast<uint32_t>(date) << 16 | time;
+    record.width = bitmap.getWidth();
+    record.height = bitmap.getHeight();
+    record.bpp = bitmap.getBpp();
+    strncpy(record.name, name, sizeof(record.name) - 1);
+    records.push_back(record);
+    file.close();
+  }
+  dir.close();
+
+  SdMan.mkdir("/.crosspoint");
+  SdMan.mkdir(CACHE_DIR);
+  FsFile file;
+  bool ok = SdMan.openFileForWrite("SLI", INDEX_FILE, file);
+  if (ok) {
+    FileHeader header = {};
+    header.version = INDEX_VERSION;
+    // Written last, so an index cut short by a power loss never matches
+    header.signature = ~signature;
+    header.count = records.size();
+    const size_t recordsSize = records.size() * sizeof(Record);
+    ok = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+         (recordsSize == 0 || file.write(reinterpret_cast<const uint8_t*>(records.data()), recordsSize) == recordsSize);
+    header.signature = signature;
+    ok = ok && file.sync() && file.seek(0) &&
+         file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header);
+    file.close();
+  }
+  if (!ok) {
+    Serial.printf("[%lu] [SLI] Failed to write %s\n", millis(), INDEX_FILE);
+    SdMan.remove(INDEX_FILE);
+    return false;
+  }
+
+  removeStaleFrames(records);
+  Serial.printf("[%lu] [SLI] Indexed %u sleep images in %lu ms\n", millis(), records.size(), millis() - start);
+  return true;
+}
+}  // namespace
+
+bool pickRandom(Image& image) {
+  uint32_t signature;
+  if (!DirectoryListing::signature(SLEEP_DIR, signature)) {
+    return false;
+  }
+
+  FsFile file;
+  FileHeader header;
+  bool valid = SdMan.openFileForRead("SLI", INDEX_FILE, file) && readHeader(file, header) &&
+               header.signature == signature;
+  if (!valid) {
+    if (file) file.close();
+    if (!rebuild(signature) || !SdMan.openFileForRead("SLI", INDEX_FILE, file)) {
+      return false;
+    }
+    if (!readHeader(file, header)) {
+      file.close();
+      return false;
+    }
+  }
+
+  if (header.count == 0) {
+    file.close();
+    return false;
+  }
+
+  Record record;
+  const uint32_t index = random(header.count);
+  const bool ok = file.seek(sizeof(header) + index * sizeof(Record)) &&
+                  file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record);
+  file.close();
+  if (!ok) {
+    Serial.printf("[%lu] [SLI] Failed to read record %u of %s\n", millis(), index, INDEX_FILE);
+    return false;
+  }
+
+  image.name.assign(record.name, strnlen(record.name, sizeof(record.name)));
+  image.size = record.size;
+  image.modified = record.modified;
+  image.width = record.width;
+  image.height = record.height;
+  image.bpp = record.bpp;
+  return true;
+}
+
+std::string framePath(const Image& image) {
+  Record record = {};
+  record.size = image.size;
+  record.modified = image.modified;
+  strncpy(record.name, image.name.c_str(), sizeof(record.name) - 1);
+  return std::string(CACHE_DIR) + "/" + frameName(record);
+}
+
+}  // namespace SleepImageIndex
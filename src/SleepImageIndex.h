@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Index of the valid images in /sleep, kept in /.crosspoint/sleep/index.bin.
+ *
+ * Building it parses the headers of every BMP once. The index remembers the directory signature it was built from
+ * (see DirectoryListing::signature), so later sleeps only re-read /sleep's raw entries and then a single record.
+ *
+ * Each image also gets a pre-rendered frame next to the index: the panel buffers exactly as drawn, written the first
+ * time the image is shown and read straight back into the framebuffer after that.
+ */
+namespace SleepImageIndex {
+
+struct Image {
+  std::string name;
+  uint32_t size = 0;
+  uint32_t modified = 0;  // FAT date << 16 | FAT time
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t bpp = 0;
+};
+
+// Picks one of the valid images at random, rebuilding the index if /sleep changed. Returns false if there is none.
+bool pickRandom(Image& image);
+
+// Where the pre-rendered frame of image lives, changes with the image's size and time
+std::string framePath(const Image& image);
+
+}  // namespace SleepImageIndex
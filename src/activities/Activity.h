@@ -20,7 +20,11 @@ class Activity {
   virtual ~Activity() = default;
   virtual void onEnter() { Serial.printf("[%lu] [ACT] Entering activity: %s\n", millis(), name.c_str()); }
   virtual void onExit() { Serial.printf("[%lu] [ACT] Exiting activity: %s\n", millis(), name.c_str()); }
+  // Called just before onExit() when the activity is left because the device goes to sleep
+  virtual void onSleep() {}
   virtual void loop() {}
   virtual bool skipLoopDelay() { return false; }
   virtual bool preventAutoSleep() { return false; }
+  // Whether a background task of this activity may be reading or writing the SD card right now
+  virtual bool isSdBusy() { return false; }
 };
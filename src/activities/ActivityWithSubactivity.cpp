@@ -1,13 +1,18 @@
 #include "ActivityWithSubactivity.h"
 
+#include "MappedInputManager.h"
+
 void ActivityWithSubactivity::exitActivity() {
   if (subActivity) {
     subActivity->onExit();
     subActivity.reset();
   }
+  // Presses meant for the sub activity must not be replayed to this one
+  mappedInput.clearEvents();
 }
 
 void ActivityWithSubactivity::enterNewActivity(Activity* activity) {
+  mappedInput.clearEvents();
   subActivity.reset(activity);
   subActivity->onEnter();
 }
@@ -14,4 +14,13 @@ class ActivityWithSubactivity : public Activity {
       : Activity(std::move(name), renderer, mappedInput) {}
   void loop() override;
   void onExit() override;
+  void onSleep() override {
+    if (subActivity) {
+      subActivity->onSleep();
+    }
+  }
+  // The sub activity's background work counts as this activity's, main() only asks the top-level activity
+  bool skipLoopDelay() override { return subActivity && subActivity->skipLoopDelay(); }
+  bool preventAutoSleep() override { return subActivity && subActivity->preventAutoSleep(); }
+  bool isSdBusy() override { return subActivity && subActivity->isSdBusy(); }
 };
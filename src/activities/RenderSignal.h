@@ -0,0 +1,68 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+
+/**
+ * Drop-in replacement for an activity's `bool updateRequired` flag. Setting it to true also notifies the
+ * activity's display task, so that task can block in wait() instead of polling the flag every few ms.
+ *
+ * The signal tracks whether its display task is drawing or parked in wait(). The main loop only lets the device
+ * light sleep while every display task is parked (see anyBusy()).
+ */
+class RenderSignal {
+  // Every signal alive, so that anyBusy() can ask each one
+  static inline RenderSignal* first = nullptr;
+
+  // The activity's own task handle, set by xTaskCreate() and cleared by onExit() once the task is deleted
+  TaskHandle_t& task;
+  RenderSignal* next;
+  volatile bool pending = false;
+  std::atomic<bool> parked{false};
+
+ public:
+  explicit RenderSignal(TaskHandle_t& task) : task(task), next(first) { first = this; }
+  ~RenderSignal() {
+    for (RenderSignal** signal = &first; *signal; signal = &(*signal)->next) {
+      if (*signal == this) {
+        *signal = next;
+        break;
+      }
+    }
+  }
+  RenderSignal(const RenderSignal&) = delete;
+  RenderSignal& operator=(const RenderSignal&) = delete;
+
+  RenderSignal& operator=(const bool required) {
+    pending = required;
+    if (required && task) {
+      xTaskNotifyGive(task);
+    }
+    return *this;
+  }
+  operator bool() const { return pending; }
+
+  // Called by the display task when it has nothing left to draw. Returns when an update is requested or timeout
+  // passes. A request made before the call is not lost, the notification stays pending until it is taken here.
+  void wait(const TickType_t timeout = portMAX_DELAY) {
+    parked = true;
+    ulTaskNotifyTake(pdTRUE, timeout);
+    parked = false;
+  }
+
+  // Busy from the moment the display task exists until it parks in wait(), and again after each wake-up. An
+  // activity that never created its task (e.g. onEnter() returned early) is never busy.
+  bool isBusy() const { return task != nullptr && !parked; }
+
+  // Signals are created and destroyed with their activities, on the main loop task that calls this
+  static bool anyBusy() {
+    for (const RenderSignal* signal = first; signal; signal = signal->next) {
+      if (signal->isBusy()) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+
 #include "../Activity.h"
 
 class Bitmap;
@@ -14,6 +16,7 @@ class SleepActivity final : public Activity {
   void renderDefaultSleepScreen() const;
   void renderCustomSleepScreen() const;
   void renderCoverSleepScreen() const;
-  void renderBitmapSleepScreen(const Bitmap& bitmap) const;
+  // Draws bitmap, and saves the result as a SleepFrame at framePath unless it is empty
+  void renderBitmapSleepScreen(const Bitmap& bitmap, const std::string& framePath = "") const;
   void renderBlankSleepScreen() const;
 };
@@ -145,7 +145,7 @@ void OpdsBookBrowserActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 /**
  * Activity for browsing and downloading books from an OPDS server.
@@ -35,7 +36,7 @@ class OpdsBookBrowserActivity final : public Activity {
  private:
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
 
   BrowserState state = BrowserState::LOADING;
   std::vector<OpdsEntry> entries;
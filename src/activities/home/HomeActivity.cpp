@@ -1,6 +1,5 @@
 #include "HomeActivity.h"
 
-#include <Epub.h>
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
 
@@ -9,6 +8,7 @@
 
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
 #include "ScreenComponents.h"
 #include "fontIds.h"
@@ -45,16 +45,13 @@ void HomeActivity::onEnter() {
       lastBookTitle = lastBookTitle.substr(lastSlash + 1);
     }
 
-    // If epub, try to load the metadata for title/author
-    if (StringUtils::checkFileExtension(lastBookTitle, ".epub")) {
-      Epub epub(APP_STATE.openEpubPath, "/.crosspoint");
-      epub.load(false);
-      if (!epub.getTitle().empty()) {
-        lastBookTitle = std::string(epub.getTitle());
-      }
-      if (!epub.getAuthor().empty()) {
-        lastBookAuthor = std::string(epub.getAuthor());
-      }
+    // Title and author come from the library catalog, so no book has to be opened here
+    LibraryCatalog::Record record;
+    if (LibraryCatalog::find(APP_STATE.openEpubPath, record) && (record.flags & LibraryCatalog::FLAG_METADATA)) {
+      lastBookTitle = std::string(record.title, strnlen(record.title, sizeof(record.title)));
+      lastBookAuthor = std::string(record.author, strnlen(record.author, sizeof(record.author)));
+    } else if (StringUtils::checkFileExtension(lastBookTitle, ".epub")) {
+      lastBookTitle.resize(lastBookTitle.length() - 5);
     } else if (StringUtils::checkFileExtension(lastBookTitle, ".xtch")) {
       lastBookTitle.resize(lastBookTitle.length() - 5);
     } else if (StringUtils::checkFileExtension(lastBookTitle, ".xtc")) {
@@ -133,7 +130,7 @@ void HomeActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
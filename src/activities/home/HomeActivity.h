@@ -6,12 +6,13 @@
 #include <functional>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 class HomeActivity final : public Activity {
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   int selectorIndex = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   bool hasContinueReading = false;
   bool hasOpdsUrl = false;
   std::string lastBookTitle;
@@ -134,5 +134,7 @@ class CalibreWirelessActivity final : public Activity {
   void onExit() override;
   void loop() override;
   bool preventAutoSleep() override { return true; }
+  // The network task writes received books to the SD card
+  bool isSdBusy() override { return networkTaskHandle != nullptr; }
   bool skipLoopDelay() override { return true; }
 };
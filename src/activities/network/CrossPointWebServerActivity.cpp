@@ -355,7 +355,7 @@ void CrossPointWebServerActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -9,6 +9,7 @@
 
 #include "NetworkModeSelectionActivity.h"
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 #include "network/CrossPointWebServer.h"
 
 // Web server activity states
@@ -33,7 +34,7 @@ enum class WebServerActivityState {
 class CrossPointWebServerActivity final : public ActivityWithSubactivity {
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   WebServerActivityState state = WebServerActivityState::MODE_SELECTION;
   const std::function<void()> onGoBack;
 
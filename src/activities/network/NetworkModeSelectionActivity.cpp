@@ -86,7 +86,7 @@ void NetworkModeSelectionActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
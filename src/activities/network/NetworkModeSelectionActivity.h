@@ -6,6 +6,7 @@
 #include <functional>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 // Enum for network mode selection
 enum class NetworkMode { JOIN_NETWORK, CREATE_HOTSPOT };
@@ -22,7 +23,7 @@ class NetworkModeSelectionActivity final : public Activity {
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   int selectedIndex = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   const std::function<void(NetworkMode)> onModeSelected;
   const std::function<void()> onCancel;
 
@@ -466,7 +466,7 @@ void WifiSelectionActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait(10 / portTICK_PERIOD_MS);
   }
 }
 
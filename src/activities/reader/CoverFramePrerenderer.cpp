@@ -0,0 +1,87 @@
+#include "CoverFramePrerenderer.h"
+
+#include <Esp.h>
+#include <GfxRenderer.h>
+
+#include "CrossPointSettings.h"
+#include "SleepFrame.h"
+
+namespace {
+// Largest free heap block needed to start: the frame buffer plus the cover decoding
+constexpr size_t minFreeBlock = 64 * 1024;
+}  // namespace
+
+void CoverFramePrerenderer::start(SemaphoreHandle_t mutex, const std::string& framePath, CoverGenerator generateCover) {
+  if (started) {
+    return;
+  }
+  started = true;
+
+  // Sleep screens are drawn in portrait
+  if (SETTINGS.sleepScreen != CrossPointSettings::SLEEP_SCREEN_MODE::COVER ||
+      SleepFrame::isCurrent(framePath, GfxRenderer::Portrait)) {
+    return;
+  }
+  if (ESP.getMaxAllocHeap() < minFreeBlock) {
+    Serial.printf("[%lu] [CFP] Not pre-rendering the cover, low memory (%d bytes free)\n", millis(),
+                  ESP.getFreeHeap());
+    return;
+  }
+
+  this->mutex = mutex;
+  this->framePath = framePath;
+  this->generateCover = std::move(generateCover);
+  cancelRequested = false;
+
+  // Lowest priority: it only runs while the display task and the main loop are idle
+  if (xTaskCreate(&CoverFramePrerenderer::taskTrampoline, "CoverFrameTask",
+                  8192,              // Stack size (cover decoding)
+                  this,              // Parameters
+                  tskIDLE_PRIORITY,  // Priority
+                  &taskHandle        // Task handle
+                  ) != pdPASS) {
+    Serial.printf("[%lu] [CFP] Failed to start cover pre-render task\n", millis());
+    taskHandle = nullptr;
+  }
+}
+
+void CoverFramePrerenderer::stop() {
+  cancelRequested = true;
+  while (taskHandle) {
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
+}
+
+void CoverFramePrerenderer::taskTrampoline(void* param) {
+  auto* self = static_cast<CoverFramePrerenderer*>(param);
+  self->task();
+}
+
+void CoverFramePrerenderer::task() {
+  const unsigned long start = millis();
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  bool done = false;
+  if (!cancelRequested) {
+    const auto yieldFn = [this] { return yield(); };
+    const std::string coverBmpPath = generateCover(yieldFn);
+    done = !coverBmpPath.empty() && yield() && SleepFrame::prerender(renderer, coverBmpPath, framePath, yieldFn);
+  }
+  xSemaphoreGive(mutex);
+
+  if (done) {
+    Serial.printf("[%lu] [CFP] Pre-rendered cover sleep screen in %lu ms\n", millis(), millis() - start);
+  } else {
+    Serial.printf("[%lu] [CFP] Cover sleep screen not pre-rendered\n", millis());
+  }
+
+  taskHandle = nullptr;
+  vTaskDelete(nullptr);
+}
+
+bool CoverFramePrerenderer::yield() {
+  xSemaphoreGive(mutex);
+  vTaskDelay(1);
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  return !cancelRequested;
+}
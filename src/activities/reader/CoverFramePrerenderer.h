@@ -0,0 +1,46 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <functional>
+#include <string>
+
+class GfxRenderer;
+
+/**
+ * Prepares the cover sleep screen of the open book on a background task, so that going to sleep only has to copy a
+ * saved SleepFrame to the display instead of decoding the cover.
+ *
+ * The task shares the SD card with the reader's display task, so it holds the reader's rendering mutex while it works
+ * and hands it back between steps.
+ */
+class CoverFramePrerenderer {
+ public:
+  // Returns the path of the cover BMP, or an empty string if the book has none. Calls yield between steps and gives
+  // up if it returns false.
+  using CoverGenerator = std::function<std::string(const std::function<bool()>& yield)>;
+
+ private:
+  GfxRenderer& renderer;
+  TaskHandle_t taskHandle = nullptr;
+  SemaphoreHandle_t mutex = nullptr;
+  std::string framePath;
+  CoverGenerator generateCover;
+  volatile bool cancelRequested = false;
+  bool started = false;
+
+  static void taskTrampoline(void* param);
+  void task();
+  bool yield();
+
+ public:
+  explicit CoverFramePrerenderer(GfxRenderer& renderer) : renderer(renderer) {}
+
+  // Only the first call does anything: it starts the task if the cover sleep screen is selected and there is no
+  // current frame at framePath. generateCover runs on the task, and hands the mutex back whenever it yields.
+  void start(SemaphoreHandle_t mutex, const std::string& framePath, CoverGenerator generateCover);
+  // Stops the task at its next step and waits for it. Must not be called while holding the mutex.
+  void stop();
+  bool isRunning() const { return taskHandle != nullptr; }
+};
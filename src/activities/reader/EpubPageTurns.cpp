@@ -0,0 +1,30 @@
+#include "EpubPageTurns.h"
+
+#include <algorithm>
+
+namespace EpubPageTurns {
+
+Target resolve(const int currentPage, const int pageCount, const int turns, const int chapterSkips) {
+  if (chapterSkips != 0) {
+    if (turns < 0) {
+      return {true, chapterSkips - 1, LAST_PAGE};
+    }
+    return {true, chapterSkips, std::min(turns, LAST_PAGE - 1)};
+  }
+
+  if (turns < 0) {
+    if (currentPage >= -turns) {
+      return {false, 0, currentPage + turns};
+    }
+    return {true, -1, LAST_PAGE};
+  }
+
+  const int lastPage = pageCount - 1;
+  if (currentPage + turns <= lastPage) {
+    return {false, 0, currentPage + turns};
+  }
+  // Carry the turns left over past this chapter into the next one, the reader clamps them to its length
+  return {true, 1, std::min(turns - (lastPage - currentPage) - 1, LAST_PAGE - 1)};
+}
+
+}  // namespace EpubPageTurns
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Works out where a batch of page turns leads in an EPUB. Kept apart from EpubReaderActivity so it can be built and
+ * exercised on the host.
+ */
+namespace EpubPageTurns {
+
+// Opens a section on its last page, whatever its length
+constexpr int LAST_PAGE = UINT16_MAX;
+
+struct Target {
+  bool reload;     // The section is left (or loaded again) rather than turned within
+  int spineDelta;  // Chapters to move by, when reloading
+  int page;        // Page to show. When reloading, anything past the end of the section means its last page.
+};
+
+// Applies turns and chapterSkips as summed by MappedInputManager::takePageTurns, starting at currentPage of a section
+// of pageCount pages. Chapter skips go first and the turns then count from the start of the chapter skipped to, so
+// turns pressed along with a skip during a slow render are kept. Turning back past the start of a chapter lands on the
+// last page of the chapter before, as a single back turn does.
+Target resolve(int currentPage, int pageCount, int turns, int chapterSkips);
+
+}  // namespace EpubPageTurns
@@ -1,15 +1,23 @@
 #include "EpubReaderActivity.h"
 
 #include <Epub/Page.h>
+#include <Esp.h>
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
 
+#include <algorithm>
+
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "EpubPageTurns.h"
 #include "EpubReaderChapterSelectionActivity.h"
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
+#include "ResumeSnapshot.h"
 #include "ScreenComponents.h"
+#include "SleepFrame.h"
 #include "fontIds.h"
 
 namespace {
@@ -17,6 +25,10 @@ namespace {
 constexpr unsigned long skipChapterMs = 700;
 constexpr unsigned long goHomeMs = 1000;
 constexpr int statusBarMargin = 19;
+// Start building the next chapter once the reader is this many pages from the end of the current one
+constexpr int preindexPagesBeforeEnd = 5;
+// Largest free heap block needed to start a background build (task stack, XML parser and layout buffers)
+constexpr size_t preindexMinFreeBlock = 48 * 1024;
 }  // namespace
 
 void EpubReaderActivity::taskTrampoline(void* param) {
@@ -52,16 +64,14 @@ void EpubReaderActivity::onEnter() {
   renderingMutex = xSemaphoreCreateMutex();
 
   epub->setupCacheDir();
-
-  FsFile f;
-  if (SdMan.openFileForRead("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
-      currentSpineIndex = data[0] + (data[1] << 8);
-      nextPageNumber = data[2] + (data[3] << 8);
-      Serial.printf("[%lu] [ERS] Loaded cache: %d, %d\n", millis(), currentSpineIndex, nextPageNumber);
-    }
-    f.close();
+  CacheManager::bookOpened(epub->getCachePath());
+
+  progress.setPath(epub->getCachePath() + "/progress.bin");
+  uint8_t data[4];
+  if (progress.load(data, sizeof(data))) {
+    currentSpineIndex = data[0] + (data[1] << 8);
+    nextPageNumber = data[2] + (data[3] << 8);
+    Serial.printf("[%lu] [ERS] Loaded cache: %d, %d\n", millis(), currentSpineIndex, nextPageNumber);
   }
   // We may want a better condition to detect if we are opening for the first time.
   // This will trigger if the book is re-opened at Chapter 0.
@@ -92,17 +102,42 @@ void EpubReaderActivity::onEnter() {
 void EpubReaderActivity::onExit() {
   ActivityWithSubactivity::onExit();
 
-  // Reset orientation back to portrait for the rest of the UI
-  renderer.setOrientation(GfxRenderer::Orientation::Portrait);
-
   // Wait until not rendering to delete task to avoid killing mid-instruction to EPD
   xSemaphoreTake(renderingMutex, portMAX_DELAY);
   if (displayTaskHandle) {
     vTaskDelete(displayTaskHandle);
     displayTaskHandle = nullptr;
   }
+  // Only shown on wake-up, so not worth the SD writes when the book is merely closed. Needs the reader's orientation,
+  // so before it is reset.
+  if (goingToSleep) {
+    saveResumeSnapshot();
+  }
+
+  // Reset orientation back to portrait for the rest of the UI
+  renderer.setOrientation(GfxRenderer::Orientation::Portrait);
+  // A background build only stops at its next yield, which needs the mutex
+  preindexCancelRequested = true;
+  xSemaphoreGive(renderingMutex);
+  while (preindexTaskHandle) {
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
+  coverFrame.stop();
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
+  // Also reached when going to sleep, so this is the last chance to persist the position
+  progress.flush();
+  if (epub) {
+    uint8_t bookProgress = 100;
+    if (currentSpineIndex < epub->getSpineItemsCount()) {
+      const float sectionProgress =
+          section && section->pageCount > 0 ? static_cast<float>(section->currentPage) / section->pageCount : 0;
+      bookProgress = epub->calculateProgress(currentSpineIndex, sectionProgress);
+    }
+    LibraryCatalog::updateBook(epub->getPath(), epub->getTitle(), epub->getAuthor(),
+                               SdMan.exists(epub->getCoverBmpPath().c_str()), bookProgress);
+    CacheManager::bookClosed(epub->getCachePath());
+  }
   section.reset();
   epub.reset();
 }
@@ -114,6 +149,12 @@ void EpubReaderActivity::loop() {
     return;
   }
 
+  // Persist the reading position once it settles, only between renders so the SD card is free
+  if (progress.hasUnsavedChanges() && xSemaphoreTake(renderingMutex, 0) == pdTRUE) {
+    progress.flushIfDue();
+    xSemaphoreGive(renderingMutex);
+  }
+
   // Enter chapter selection activity
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
     // Don't start activity transition while rendering
@@ -149,12 +190,17 @@ void EpubReaderActivity::loop() {
     return;
   }
 
-  const bool prevReleased = mappedInput.wasReleased(MappedInputManager::Button::PageBack) ||
-                            mappedInput.wasReleased(MappedInputManager::Button::Left);
-  const bool nextReleased = mappedInput.wasReleased(MappedInputManager::Button::PageForward) ||
-                            mappedInput.wasReleased(MappedInputManager::Button::Right);
+  // Page turns stay queued while a page is being drawn. Everything pressed in the meantime is then applied as a
+  // single jump, so only the page the reader ends up on gets rendered. Holding the mutex while applying it also keeps
+  // the section from being deleted mid-render.
+  if (xSemaphoreTake(renderingMutex, 0) != pdTRUE) {
+    return;
+  }
 
-  if (!prevReleased && !nextReleased) {
+  int turns;
+  int chapterSkips;
+  if (!mappedInput.takePageTurns(skipChapterMs, turns, chapterSkips)) {
+    xSemaphoreGive(renderingMutex);
     return;
   }
 
@@ -163,53 +209,25 @@ void EpubReaderActivity::loop() {
     currentSpineIndex = epub->getSpineItemsCount() - 1;
     nextPageNumber = UINT16_MAX;
     updateRequired = true;
-    return;
-  }
-
-  const bool skipChapter = mappedInput.getHeldTime() > skipChapterMs;
-
-  if (skipChapter) {
-    // We don't want to delete the section mid-render, so grab the semaphore
-    xSemaphoreTake(renderingMutex, portMAX_DELAY);
-    nextPageNumber = 0;
-    currentSpineIndex = nextReleased ? currentSpineIndex + 1 : currentSpineIndex - 1;
-    section.reset();
-    xSemaphoreGive(renderingMutex);
-    updateRequired = true;
-    return;
-  }
-
-  // No current section, attempt to rerender the book
-  if (!section) {
+  } else if (!section && chapterSkips == 0) {
+    // No current section, attempt to rerender the book
     updateRequired = true;
-    return;
-  }
-
-  if (prevReleased) {
-    if (section->currentPage > 0) {
-      section->currentPage--;
-    } else {
-      // We don't want to delete the section mid-render, so grab the semaphore
-      xSemaphoreTake(renderingMutex, portMAX_DELAY);
-      nextPageNumber = UINT16_MAX;
-      currentSpineIndex--;
+  } else if (turns != 0 || chapterSkips != 0) {
+    // Without a section only chapter skips get here, and they do not depend on the page
+    const int currentPage = section ? section->currentPage : 0;
+    const int pageCount = section ? section->pageCount : 0;
+    const auto target = EpubPageTurns::resolve(currentPage, pageCount, turns, chapterSkips);
+    if (target.reload) {
+      // renderScreen() clamps the spine index to the book and the page to the section
+      currentSpineIndex += target.spineDelta;
+      nextPageNumber = target.page;
       section.reset();
-      xSemaphoreGive(renderingMutex);
-    }
-    updateRequired = true;
-  } else {
-    if (section->currentPage < section->pageCount - 1) {
-      section->currentPage++;
     } else {
-      // We don't want to delete the section mid-render, so grab the semaphore
-      xSemaphoreTake(renderingMutex, portMAX_DELAY);
-      nextPageNumber = 0;
-      currentSpineIndex++;
-      section.reset();
-      xSemaphoreGive(renderingMutex);
+      section->currentPage = target.page;
     }
     updateRequired = true;
   }
+  xSemaphoreGive(renderingMutex);
 }
 
 void EpubReaderActivity::displayTaskLoop() {
@@ -220,7 +238,7 @@ void EpubReaderActivity::displayTaskLoop() {
       renderScreen();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -247,23 +265,32 @@ void EpubReaderActivity::renderScreen() {
     return;
   }
 
-  // Apply screen viewable areas and additional padding
   int orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft;
-  renderer.getOrientedViewableTRBL(&orientedMarginTop, &orientedMarginRight, &orientedMarginBottom,
-                                   &orientedMarginLeft);
-  orientedMarginTop += SETTINGS.screenMargin;
-  orientedMarginLeft += SETTINGS.screenMargin;
-  orientedMarginRight += SETTINGS.screenMargin;
-  orientedMarginBottom += statusBarMargin;
+  getOrientedMargins(&orientedMarginTop, &orientedMarginRight, &orientedMarginBottom, &orientedMarginLeft);
+
+  const uint16_t viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
+  const uint16_t viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
 
   if (!section) {
+    // A background build of this chapter is already under way, let it finish rather than start over.
+    // A build of any other chapter is no longer needed.
+    if (preindexTaskHandle) {
+      if (preindexSpineIndex == currentSpineIndex) {
+        showIndexingMessage();
+        waitForPreindex();
+        // loop() may have turned the page or chapter while the mutex was released, render again from the top
+        updateRequired = true;
+        return;
+      } else {
+        preindexCancelRequested = true;
+        lastPreindexCheckSpineIndex = -1;
+      }
+    }
+
     const auto filepath = epub->getSpineItem(currentSpineIndex).href;
     Serial.printf("[%lu] [ERS] Loading file: %s, index: %d\n", millis(), filepath.c_str(), currentSpineIndex);
     section = std::unique_ptr<Section>(new Section(epub, currentSpineIndex, renderer));
 
-    const uint16_t viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
-    const uint16_t viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
-
     if (!section->loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
                                   SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
                                   viewportHeight)) {
@@ -275,23 +302,14 @@ void EpubReaderActivity::renderScreen() {
       constexpr int boxMargin = 20;
       const int textWidth = renderer.getTextWidth(UI_12_FONT_ID, "Indexing...");
       const int boxWidthWithBar = (barWidth > textWidth ? barWidth : textWidth) + boxMargin * 2;
-      const int boxWidthNoBar = textWidth + boxMargin * 2;
       const int boxHeightWithBar = renderer.getLineHeight(UI_12_FONT_ID) + barHeight + boxMargin * 3;
-      const int boxHeightNoBar = renderer.getLineHeight(UI_12_FONT_ID) + boxMargin * 2;
       const int boxXWithBar = (renderer.getScreenWidth() - boxWidthWithBar) / 2;
-      const int boxXNoBar = (renderer.getScreenWidth() - boxWidthNoBar) / 2;
       constexpr int boxY = 50;
       const int barX = boxXWithBar + (boxWidthWithBar - barWidth) / 2;
       const int barY = boxY + renderer.getLineHeight(UI_12_FONT_ID) + boxMargin * 2;
 
       // Always show "Indexing..." text first
-      {
-        renderer.fillRect(boxXNoBar, boxY, boxWidthNoBar, boxHeightNoBar, false);
-        renderer.drawText(UI_12_FONT_ID, boxXNoBar + boxMargin, boxY + boxMargin, "Indexing...");
-        renderer.drawRect(boxXNoBar + 5, boxY + 5, boxWidthNoBar - 10, boxHeightNoBar - 10);
-        renderer.displayBuffer();
-        pagesUntilFullRefresh = 0;
-      }
+      showIndexingMessage();
 
       // Setup callback - only called for chapters >= 50KB, redraws with progress bar
       auto progressSetup = [this, boxXWithBar, boxWidthWithBar, boxHeightWithBar, barX, barY] {
@@ -320,11 +338,12 @@ void EpubReaderActivity::renderScreen() {
       Serial.printf("[%lu] [ERS] Cache found, skipping build...\n", millis());
     }
 
-    if (nextPageNumber == UINT16_MAX) {
+    if (nextPageNumber >= section->pageCount) {
       section->currentPage = section->pageCount - 1;
     } else {
       section->currentPage = nextPageNumber;
     }
+    CacheManager::sectionUsed(epub->getCachePath(), currentSpineIndex);
   }
 
   renderer.clearScreen();
@@ -358,23 +377,197 @@ void EpubReaderActivity::renderScreen() {
     Serial.printf("[%lu] [ERS] Rendered page in %dms\n", millis(), millis() - start);
   }
 
-  FsFile f;
-  if (SdMan.openFileForWrite("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentSpineIndex & 0xFF;
-    data[1] = (currentSpineIndex >> 8) & 0xFF;
-    data[2] = section->currentPage & 0xFF;
-    data[3] = (section->currentPage >> 8) & 0xFF;
-    f.write(data, 4);
-    f.close();
+  // Written to the SD card later by loop(), off the page turn path
+  uint8_t data[4];
+  encodePosition(data);
+  progress.set(data, sizeof(data));
+
+  startPreindexIfNeeded(viewportWidth, viewportHeight);
+  coverFrame.start(renderingMutex, SleepFrame::coverFramePath(epub->getCachePath()),
+                   [this](const std::function<bool()>& yield) {
+                     return epub->generateCoverBmp(yield) ? epub->getCoverBmpPath() : std::string();
+                   });
+}
+
+void EpubReaderActivity::getOrientedMargins(int* top, int* right, int* bottom, int* left) const {
+  // Apply screen viewable areas and additional padding
+  renderer.getOrientedViewableTRBL(top, right, bottom, left);
+  *top += SETTINGS.screenMargin;
+  *left += SETTINGS.screenMargin;
+  *right += SETTINGS.screenMargin;
+  *bottom += statusBarMargin;
+}
+
+void EpubReaderActivity::encodePosition(uint8_t* data) const {
+  data[0] = currentSpineIndex & 0xFF;
+  data[1] = (currentSpineIndex >> 8) & 0xFF;
+  data[2] = section->currentPage & 0xFF;
+  data[3] = (section->currentPage >> 8) & 0xFF;
+}
+
+void EpubReaderActivity::saveResumeSnapshot() {
+  if (!section || section->currentPage < 0 || section->currentPage >= section->pageCount) {
+    return;
+  }
+  auto page = section->loadPageFromSectionFile();
+  if (!page) {
+    return;
+  }
+
+  const auto start = millis();
+  uint8_t position[4];
+  encodePosition(position);
+  ResumeSnapshot::Writer snapshot;
+  if (!snapshot.open(epub->getPath(), epub->getCachePath(), position, sizeof(position))) {
+    return;
+  }
+
+  // Drawn again instead of taken from the framebuffer, which may hold a menu or only the last greyscale plane
+  int orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft;
+  getOrientedMargins(&orientedMarginTop, &orientedMarginRight, &orientedMarginBottom, &orientedMarginLeft);
+  renderer.clearScreen();
+  page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+  renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
+  snapshot.addPlane(renderer.getFrameBuffer());
+
+  if (SETTINGS.textAntiAliasing) {
+    renderer.storeBwBuffer();
+    renderer.clearScreen(0x00);
+    renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+    page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+    snapshot.addPlane(renderer.getFrameBuffer());
+
+    renderer.clearScreen(0x00);
+    renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+    page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+    snapshot.addPlane(renderer.getFrameBuffer());
+
+    renderer.setRenderMode(GfxRenderer::BW);
+    renderer.restoreBwBuffer();
+  }
+
+  if (snapshot.close()) {
+    Serial.printf("[%lu] [ERS] Saved resume snapshot in %lu ms\n", millis(), millis() - start);
   }
 }
 
+void EpubReaderActivity::showIndexingMessage() {
+  constexpr int boxMargin = 20;
+  constexpr int boxY = 50;
+  const int boxWidth = renderer.getTextWidth(UI_12_FONT_ID, "Indexing...") + boxMargin * 2;
+  const int boxHeight = renderer.getLineHeight(UI_12_FONT_ID) + boxMargin * 2;
+  const int boxX = (renderer.getScreenWidth() - boxWidth) / 2;
+
+  renderer.fillRect(boxX, boxY, boxWidth, boxHeight, false);
+  renderer.drawText(UI_12_FONT_ID, boxX + boxMargin, boxY + boxMargin, "Indexing...");
+  renderer.drawRect(boxX + 5, boxY + 5, boxWidth - 10, boxHeight - 10);
+  renderer.displayBuffer();
+  pagesUntilFullRefresh = 0;
+}
+
+void EpubReaderActivity::startPreindexIfNeeded(const uint16_t viewportWidth, const uint16_t viewportHeight) {
+  const int nextSpineIndex = currentSpineIndex + 1;
+  if (preindexTaskHandle || nextSpineIndex >= epub->getSpineItemsCount() ||
+      nextSpineIndex == lastPreindexCheckSpineIndex ||
+      section->pageCount - section->currentPage > preindexPagesBeforeEnd) {
+    return;
+  }
+  lastPreindexCheckSpineIndex = nextSpineIndex;
+
+  // Nothing to do if the next chapter is already indexed for the current settings
+  {
+    Section nextSection(epub, nextSpineIndex, renderer);
+    if (nextSection.loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                                    SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
+                                    viewportHeight)) {
+      return;
+    }
+  }
+
+  if (ESP.getMaxAllocHeap() < preindexMinFreeBlock) {
+    Serial.printf("[%lu] [ERS] Not pre-indexing chapter %d, low memory (%d bytes free)\n", millis(), nextSpineIndex,
+                  ESP.getFreeHeap());
+    return;
+  }
+
+  preindexSpineIndex = nextSpineIndex;
+  preindexCancelRequested = false;
+  preindexViewportWidth = viewportWidth;
+  preindexViewportHeight = viewportHeight;
+
+  // Lowest priority: it only runs while the display task and the main loop are idle
+  if (xTaskCreate(&EpubReaderActivity::preindexTaskTrampoline, "EpubPreindexTask",
+                  8192,                // Stack size (same as the display task, which builds sections too)
+                  this,                // Parameters
+                  tskIDLE_PRIORITY,    // Priority
+                  &preindexTaskHandle  // Task handle
+                  ) != pdPASS) {
+    Serial.printf("[%lu] [ERS] Failed to start pre-index task\n", millis());
+    preindexTaskHandle = nullptr;
+    preindexSpineIndex = -1;
+  }
+}
+
+void EpubReaderActivity::preindexTaskTrampoline(void* param) {
+  auto* self = static_cast<EpubReaderActivity*>(param);
+  self->preindexTask();
+}
+
+void EpubReaderActivity::preindexTask() {
+  const int spineIndex = preindexSpineIndex;
+  const unsigned long start = millis();
+  Serial.printf("[%lu] [ERS] Pre-indexing chapter %d\n", millis(), spineIndex);
+
+  // The build shares the SD card and renderer with the display task, so it only runs while holding the rendering
+  // mutex and hands it back between input chunks (see yieldPreindex)
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  bool built = false;
+  if (!preindexCancelRequested) {
+    Section nextSection(epub, spineIndex, renderer);
+    built = nextSection.createSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                                          SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment,
+                                          preindexViewportWidth, preindexViewportHeight, nullptr, nullptr,
+                                          [this] { return yieldPreindex(); });
+  }
+  xSemaphoreGive(renderingMutex);
+
+  if (built) {
+    Serial.printf("[%lu] [ERS] Pre-indexed chapter %d in %lu ms\n", millis(), spineIndex, millis() - start);
+  } else {
+    Serial.printf("[%lu] [ERS] Pre-indexing chapter %d stopped\n", millis(), spineIndex);
+  }
+
+  preindexSpineIndex = -1;
+  preindexTaskHandle = nullptr;
+  vTaskDelete(nullptr);
+}
+
+bool EpubReaderActivity::yieldPreindex() {
+  xSemaphoreGive(renderingMutex);
+  vTaskDelay(1);
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  return !preindexCancelRequested;
+}
+
+void EpubReaderActivity::waitForPreindex() {
+  // Called from the display task with the rendering mutex held, which the background build needs to finish
+  xSemaphoreGive(renderingMutex);
+  while (preindexTaskHandle) {
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+  }
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+}
+
 void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int orientedMarginTop,
                                         const int orientedMarginRight, const int orientedMarginBottom,
                                         const int orientedMarginLeft) {
   page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
+  if (const unsigned long shownAt = ResumeSnapshot::takeShownTime()) {
+    // The snapshot shown at boot already put this page on the panel, a fast refresh only updates the status bar
+    Serial.printf("[%lu] [ERS] Resumed: page on screen at %lu ms, book ready at %lu ms\n", millis(), shownAt, millis());
+    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
+  }
   if (pagesUntilFullRefresh <= 1) {
     renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
     pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
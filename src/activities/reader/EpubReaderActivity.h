@@ -5,7 +5,10 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include "CoverFramePrerenderer.h"
+#include "ProgressStore.h"
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 
 class EpubReaderActivity final : public ActivityWithSubactivity {
   std::shared_ptr<Epub> epub;
@@ -15,7 +18,17 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   int currentSpineIndex = 0;
   int nextPageNumber = 0;
   int pagesUntilFullRefresh = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
+  ProgressStore progress;
+  // Background build of the next chapter's section file, started near the end of the current one
+  TaskHandle_t preindexTaskHandle = nullptr;
+  volatile int preindexSpineIndex = -1;  // Spine item being built
+  volatile bool preindexCancelRequested = false;
+  int lastPreindexCheckSpineIndex = -1;  // Avoids re-checking the same chapter on every page
+  uint16_t preindexViewportWidth = 0;
+  uint16_t preindexViewportHeight = 0;
+  CoverFramePrerenderer coverFrame{renderer};
+  bool goingToSleep = false;  // Set by onSleep(), onExit() then saves the resume snapshot
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
@@ -25,6 +38,15 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   void renderContents(std::unique_ptr<Page> page, int orientedMarginTop, int orientedMarginRight,
                       int orientedMarginBottom, int orientedMarginLeft);
   void renderStatusBar(int orientedMarginRight, int orientedMarginBottom, int orientedMarginLeft) const;
+  void getOrientedMargins(int* top, int* right, int* bottom, int* left) const;
+  void encodePosition(uint8_t* data) const;
+  void saveResumeSnapshot();
+  void showIndexingMessage();
+  static void preindexTaskTrampoline(void* param);
+  void preindexTask();
+  bool yieldPreindex();
+  void startPreindexIfNeeded(uint16_t viewportWidth, uint16_t viewportHeight);
+  void waitForPreindex();
 
  public:
   explicit EpubReaderActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, std::unique_ptr<Epub> epub,
@@ -35,5 +57,10 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
         onGoHome(onGoHome) {}
   void onEnter() override;
   void onExit() override;
+  void onSleep() override { goingToSleep = true; }
   void loop() override;
+  // Keeps the device awake (no light or deep sleep) while the next chapter is indexed or the cover sleep screen is
+  // rendered in the background
+  bool preventAutoSleep() override { return preindexTaskHandle != nullptr || coverFrame.isRunning(); }
+  bool isSdBusy() override { return preindexTaskHandle != nullptr || coverFrame.isRunning(); }
 };
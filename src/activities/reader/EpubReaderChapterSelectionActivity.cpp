@@ -2,6 +2,8 @@
 
 #include <GfxRenderer.h>
 
+#include <cstdlib>
+
 #include "MappedInputManager.h"
 #include "fontIds.h"
 
@@ -26,6 +28,32 @@ int EpubReaderChapterSelectionActivity::getPageItems() const {
   return items;
 }
 
+int EpubReaderChapterSelectionActivity::getPageCount() const {
+  const int pageItems = getPageItems();
+  return (tocItemsCount + pageItems - 1) / pageItems;
+}
+
+const EpubReaderChapterSelectionActivity::TocPage& EpubReaderChapterSelectionActivity::getTocPage(
+    const int pageIndex) {
+  // Reuse the page if cached, otherwise replace the one furthest from the cursor
+  const int cursorPage = selectorIndex / getPageItems();
+  TocPage* slot = &tocPages[0];
+  for (auto& page : tocPages) {
+    if (page.pageIndex == pageIndex) {
+      return page;
+    }
+    if (page.pageIndex == -1 || (slot->pageIndex != -1 && std::abs(page.pageIndex - cursorPage) >
+                                                              std::abs(slot->pageIndex - cursorPage))) {
+      slot = &page;
+    }
+  }
+
+  const int pageItems = getPageItems();
+  slot->pageIndex = pageIndex;
+  epub->getTocItems(pageIndex * pageItems, pageItems, slot->entries);
+  return *slot;
+}
+
 void EpubReaderChapterSelectionActivity::taskTrampoline(void* param) {
   auto* self = static_cast<EpubReaderChapterSelectionActivity*>(param);
   self->displayTaskLoop();
@@ -39,6 +67,7 @@ void EpubReaderChapterSelectionActivity::onEnter() {
   }
 
   renderingMutex = xSemaphoreCreateMutex();
+  tocItemsCount = epub->getTocItemsCount();
   selectorIndex = epub->getTocIndexForSpineIndex(currentSpineIndex);
   if (selectorIndex == -1) {
     selectorIndex = 0;
@@ -65,6 +94,9 @@ void EpubReaderChapterSelectionActivity::onExit() {
   }
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
+  for (auto& page : tocPages) {
+    page = TocPage();
+  }
 }
 
 void EpubReaderChapterSelectionActivity::loop() {
@@ -77,7 +109,12 @@ void EpubReaderChapterSelectionActivity::loop() {
   const int pageItems = getPageItems();
 
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
-    const auto newSpineIndex = epub->getSpineIndexForTocIndex(selectorIndex);
+    // The selected entry is on the visible page, which is cached
+    xSemaphoreTake(renderingMutex, portMAX_DELAY);
+    const auto& page = getTocPage(selectorIndex / pageItems);
+    const size_t entryIndex = selectorIndex % pageItems;
+    const int newSpineIndex = entryIndex < page.entries.size() ? page.entries[entryIndex].spineIndex : -1;
+    xSemaphoreGive(renderingMutex);
     if (newSpineIndex == -1) {
       onGoBack();
     } else {
@@ -85,19 +122,20 @@ void EpubReaderChapterSelectionActivity::loop() {
     }
   } else if (mappedInput.wasReleased(MappedInputManager::Button::Back)) {
     onGoBack();
+  } else if (tocItemsCount == 0) {
+    // Nothing to move between
   } else if (prevReleased) {
     if (skipPage) {
-      selectorIndex =
-          ((selectorIndex / pageItems - 1) * pageItems + epub->getTocItemsCount()) % epub->getTocItemsCount();
+      selectorIndex = ((selectorIndex / pageItems - 1) * pageItems + tocItemsCount) % tocItemsCount;
     } else {
-      selectorIndex = (selectorIndex + epub->getTocItemsCount() - 1) % epub->getTocItemsCount();
+      selectorIndex = (selectorIndex + tocItemsCount - 1) % tocItemsCount;
     }
     updateRequired = true;
   } else if (nextReleased) {
     if (skipPage) {
-      selectorIndex = ((selectorIndex / pageItems + 1) * pageItems) % epub->getTocItemsCount();
+      selectorIndex = ((selectorIndex / pageItems + 1) * pageItems) % tocItemsCount;
     } else {
-      selectorIndex = (selectorIndex + 1) % epub->getTocItemsCount();
+      selectorIndex = (selectorIndex + 1) % tocItemsCount;
     }
     updateRequired = true;
   }
@@ -111,7 +149,7 @@ void EpubReaderChapterSelectionActivity::displayTaskLoop() {
       renderScreen();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -125,14 +163,23 @@ void EpubReaderChapterSelectionActivity::renderScreen() {
       renderer.truncatedText(UI_12_FONT_ID, epub->getTitle().c_str(), pageWidth - 40, EpdFontFamily::BOLD);
   renderer.drawCenteredText(UI_12_FONT_ID, 15, title.c_str(), true, EpdFontFamily::BOLD);
 
-  const auto pageStartIndex = selectorIndex / pageItems * pageItems;
+  const int pageIndex = selectorIndex / pageItems;
+  const int pageStartIndex = pageIndex * pageItems;
+  const auto& page = getTocPage(pageIndex);
   renderer.fillRect(0, 60 + (selectorIndex % pageItems) * 30 - 2, pageWidth - 1, 30);
-  for (int tocIndex = pageStartIndex; tocIndex < epub->getTocItemsCount() && tocIndex < pageStartIndex + pageItems;
-       tocIndex++) {
-    auto item = epub->getTocItem(tocIndex);
+  for (size_t i = 0; i < page.entries.size(); i++) {
+    const auto& item = page.entries[i];
+    const int tocIndex = pageStartIndex + static_cast<int>(i);
     renderer.drawText(UI_10_FONT_ID, 20 + (item.level - 1) * 15, 60 + (tocIndex % pageItems) * 30, item.title.c_str(),
                       tocIndex != selectorIndex);
   }
 
   renderer.displayBuffer();
+
+  // Have the neighbouring pages ready for paging up/down (the list wraps around)
+  const int pageCount = getPageCount();
+  if (pageCount > 1) {
+    getTocPage((pageIndex + 1) % pageCount);
+    getTocPage((pageIndex + pageCount - 1) % pageCount);
+  }
 }
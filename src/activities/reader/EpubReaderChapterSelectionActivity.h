@@ -5,22 +5,36 @@
 #include <freertos/task.h>
 
 #include <memory>
+#include <vector>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 class EpubReaderChapterSelectionActivity final : public Activity {
+  // One screen worth of TOC entries, read from book.bin in a single pass
+  struct TocPage {
+    int pageIndex = -1;
+    std::vector<BookMetadataCache::TocEntry> entries;
+  };
+  // The visible page and its neighbours, so moving between them doesn't touch the SD card
+  static constexpr int CACHED_TOC_PAGES = 3;
+
   std::shared_ptr<Epub> epub;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   int currentSpineIndex = 0;
   int selectorIndex = 0;
-  bool updateRequired = false;
+  int tocItemsCount = 0;
+  TocPage tocPages[CACHED_TOC_PAGES];
+  RenderSignal updateRequired{displayTaskHandle};
   const std::function<void()> onGoBack;
   const std::function<void(int newSpineIndex)> onSelectSpineIndex;
 
   // Number of items that fit on a page, derived from logical screen height.
   // This adapts automatically when switching between portrait and landscape.
   int getPageItems() const;
+  int getPageCount() const;
+  const TocPage& getTocPage(int pageIndex);
 
   static void taskTrampoline(void* param);
   [[noreturn]] void displayTaskLoop();
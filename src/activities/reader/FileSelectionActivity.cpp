@@ -3,9 +3,9 @@
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
 
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
 #include "fontIds.h"
-#include "util/StringUtils.h"
 
 namespace {
 constexpr int PAGE_ITEMS = 23;
@@ -13,53 +13,47 @@ constexpr int SKIP_PAGE_MS = 700;
 constexpr unsigned long GO_HOME_MS = 1000;
 }  // namespace
 
-void sortFileList(std::vector<std::string>& strs) {
-  std::sort(begin(strs), end(strs), [](const std::string& str1, const std::string& str2) {
-    if (str1.back() == '/' && str2.back() != '/') return true;
-    if (str1.back() != '/' && str2.back() == '/') return false;
-    return lexicographical_compare(
-        begin(str1), end(str1), begin(str2), end(str2),
-        [](const char& char1, const char& char2) { return tolower(char1) < tolower(char2); });
-  });
-}
-
 void FileSelectionActivity::taskTrampoline(void* param) {
   auto* self = static_cast<FileSelectionActivity*>(param);
   self->displayTaskLoop();
 }
 
 void FileSelectionActivity::loadFiles() {
-  files.clear();
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  if (!listing.load(basepath)) {
+    Serial.printf("[%lu] [FSA] Not a directory: %s\n", millis(), basepath.c_str());
+  }
+  pageEntries.clear();
+  pageTitles.clear();
+  loadedPageStart = SIZE_MAX;
+  xSemaphoreGive(renderingMutex);
+}
 
-  auto root = SdMan.open(basepath.c_str());
-  if (!root || !root.isDirectory()) {
-    if (root) root.close();
+void FileSelectionActivity::loadPage() {
+  const size_t pageStart = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
+  if (pageStart == loadedPageStart) {
     return;
   }
 
-  root.rewindDirectory();
-
-  char name[500];
-  for (auto file = root.openNextFile(); file; file = root.openNextFile()) {
-    file.getName(name, sizeof(name));
-    if (name[0] == '.' || strcmp(name, "System Volume Information") == 0) {
-      file.close();
-      continue;
-    }
+  // Only the rows on screen are read from the listing, titles for them come from the library catalog
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  std::vector<DirectoryListing::Entry> entries;
+  listing.read(pageStart, PAGE_ITEMS, entries);
+  std::vector<std::string> bookPaths;
+  const std::string dir = basepath.back() == '/' ? basepath : basepath + "/";
+  for (const auto& entry : entries) {
+    if (!entry.isDirectory) bookPaths.push_back(dir + entry.name);
+  }
+  std::vector<std::string> bookTitles;
+  LibraryCatalog::findTitles(bookPaths, bookTitles);
 
-    if (file.isDirectory()) {
-      files.emplace_back(std::string(name) + "/");
-    } else {
-      auto filename = std::string(name);
-      if (StringUtils::checkFileExtension(filename, ".epub") || StringUtils::checkFileExtension(filename, ".xtch") ||
-          StringUtils::checkFileExtension(filename, ".xtc")) {
-        files.emplace_back(filename);
-      }
-    }
-    file.close();
+  pageEntries = std::move(entries);
+  pageTitles.assign(pageEntries.size(), std::string());
+  for (size_t i = 0, book = 0; i < pageEntries.size(); i++) {
+    if (!pageEntries[i].isDirectory) pageTitles[i] = std::move(bookTitles[book++]);
   }
-  root.close();
-  sortFileList(files);
+  loadedPageStart = pageStart;
+  xSemaphoreGive(renderingMutex);
 }
 
 void FileSelectionActivity::onEnter() {
@@ -70,6 +64,7 @@ void FileSelectionActivity::onEnter() {
   // basepath is set via constructor parameter (defaults to "/" if not specified)
   loadFiles();
   selectorIndex = 0;
+  loadPage();
 
   // Trigger first update
   updateRequired = true;
@@ -93,7 +88,8 @@ void FileSelectionActivity::onExit() {
   }
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
-  files.clear();
+  pageEntries.clear();
+  pageTitles.clear();
 }
 
 void FileSelectionActivity::loop() {
@@ -102,6 +98,8 @@ void FileSelectionActivity::loop() {
     if (basepath != "/") {
       basepath = "/";
       loadFiles();
+      selectorIndex = 0;
+      loadPage();
       updateRequired = true;
     }
     return;
@@ -115,18 +113,20 @@ void FileSelectionActivity::loop() {
   const bool skipPage = mappedInput.getHeldTime() > SKIP_PAGE_MS;
 
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
-    if (files.empty()) {
+    if (listing.empty() || selectorIndex < loadedPageStart || selectorIndex - loadedPageStart >= pageEntries.size()) {
       return;
     }
 
+    const auto& entry = pageEntries[selectorIndex - loadedPageStart];
     if (basepath.back() != '/') basepath += "/";
-    if (files[selectorIndex].back() == '/') {
-      basepath += files[selectorIndex].substr(0, files[selectorIndex].length() - 1);
+    if (entry.isDirectory) {
+      basepath += entry.name.substr(0, entry.name.length() - 1);
       loadFiles();
       selectorIndex = 0;
+      loadPage();
       updateRequired = true;
     } else {
-      onSelect(basepath + files[selectorIndex]);
+      onSelect(basepath + entry.name);
     }
   } else if (mappedInput.wasReleased(MappedInputManager::Button::Back)) {
     // Short press: go up one directory, or go home if at root
@@ -140,26 +140,33 @@ void FileSelectionActivity::loop() {
 
         const auto pos = oldPath.find_last_of('/');
         const std::string dirName = oldPath.substr(pos + 1) + "/";
-        selectorIndex = findEntry(dirName);
+        selectorIndex = listing.find(dirName);
+        loadPage();
 
         updateRequired = true;
       } else {
         onGoHome();
       }
     }
+  } else if (listing.empty()) {
+    return;
   } else if (prevReleased) {
+    const size_t count = listing.size();
     if (skipPage) {
-      selectorIndex = ((selectorIndex / PAGE_ITEMS - 1) * PAGE_ITEMS + files.size()) % files.size();
+      selectorIndex = ((selectorIndex / PAGE_ITEMS - 1) * PAGE_ITEMS + count) % count;
     } else {
-      selectorIndex = (selectorIndex + files.size() - 1) % files.size();
+      selectorIndex = (selectorIndex + count - 1) % count;
     }
+    loadPage();
     updateRequired = true;
   } else if (nextReleased) {
+    const size_t count = listing.size();
     if (skipPage) {
-      selectorIndex = ((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS) % files.size();
+      selectorIndex = ((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS) % count;
     } else {
-      selectorIndex = (selectorIndex + 1) % files.size();
+      selectorIndex = (selectorIndex + 1) % count;
     }
+    loadPage();
     updateRequired = true;
   }
 }
@@ -172,7 +179,7 @@ void FileSelectionActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -186,24 +193,19 @@ void FileSelectionActivity::render() const {
   const auto labels = mappedInput.mapLabels("« Home", "Open", "", "");
   renderer.drawButtonHints(UI_10_FONT_ID, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
 
-  if (files.empty()) {
+  if (pageEntries.empty()) {
     renderer.drawText(UI_10_FONT_ID, 20, 60, "No books found");
     renderer.displayBuffer();
     return;
   }
 
-  const auto pageStartIndex = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
   renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 - 2, pageWidth - 1, 30);
-  for (size_t i = pageStartIndex; i < files.size() && i < pageStartIndex + PAGE_ITEMS; i++) {
-    auto item = renderer.truncatedText(UI_10_FONT_ID, files[i].c_str(), renderer.getScreenWidth() - 40);
-    renderer.drawText(UI_10_FONT_ID, 20, 60 + (i % PAGE_ITEMS) * 30, item.c_str(), i != selectorIndex);
+  for (size_t row = 0; row < pageEntries.size(); row++) {
+    // Books the catalog knows are shown by title
+    const auto& label = pageTitles[row].empty() ? pageEntries[row].name : pageTitles[row];
+    auto item = renderer.truncatedText(UI_10_FONT_ID, label.c_str(), renderer.getScreenWidth() - 40);
+    renderer.drawText(UI_10_FONT_ID, 20, 60 + row * 30, item.c_str(), loadedPageStart + row != selectorIndex);
   }
 
   renderer.displayBuffer();
 }
-
-size_t FileSelectionActivity::findEntry(const std::string& name) const {
-  for (size_t i = 0; i < files.size(); i++)
-    if (files[i] == name) return i;
-  return 0;
-}
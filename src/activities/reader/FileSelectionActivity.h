@@ -8,14 +8,20 @@
 #include <vector>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
+#include "DirectoryListing.h"
 
 class FileSelectionActivity final : public Activity {
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   std::string basepath = "/";
-  std::vector<std::string> files;
+  DirectoryListing listing;
+  // Rows of the page on screen, read from the listing when the selection moves to another page
+  std::vector<DirectoryListing::Entry> pageEntries;
+  std::vector<std::string> pageTitles;  // Per row, empty if unknown
+  size_t loadedPageStart = SIZE_MAX;
   size_t selectorIndex = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   const std::function<void(const std::string&)> onSelect;
   const std::function<void()> onGoHome;
 
@@ -23,8 +29,7 @@ class FileSelectionActivity final : public Activity {
   [[noreturn]] void displayTaskLoop();
   void render() const;
   void loadFiles();
-
-  size_t findEntry(const std::string& name) const;
+  void loadPage();
 
  public:
   explicit FileSelectionActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
@@ -0,0 +1,176 @@
+#include "XtcPageRenderer.h"
+
+#include <EInkDisplay.h>
+#include <GfxRenderer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+using XthPass = XtcPageRenderer::XthPass;
+
+// Combines the two XTH bit planes (pixel value = (bit1 << 1) | bit2) into one framebuffer pass, 32 pixels at a time.
+// The framebuffer uses 0 = black for BW, and 1 = apply gray effect for the grayscale passes.
+// frameBuffer may alias plane1 to combine in place.
+void composeXthPlanes(uint8_t* frameBuffer, const uint8_t* plane1, const uint8_t* plane2, const size_t size,
+                      const XthPass pass) {
+  size_t i = 0;
+  for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+    uint32_t bit1, bit2, out;
+    memcpy(&bit1, plane1 + i, sizeof(bit1));
+    memcpy(&bit2, plane2 + i, sizeof(bit2));
+    switch (pass) {
+      case XthPass::BW:
+        out = ~(bit1 | bit2);  // Any non-white value is black
+        break;
+      case XthPass::GRAYSCALE_LSB:
+        out = ~bit1 & bit2;  // Dark grey (1) only
+        break;
+      case XthPass::GRAYSCALE_MSB:
+      default:
+        out = bit1 ^ bit2;  // Dark grey (1) or light grey (2)
+        break;
+    }
+    memcpy(frameBuffer + i, &out, sizeof(out));
+  }
+  for (; i < size; i++) {
+    const uint8_t bit1 = plane1[i];
+    const uint8_t bit2 = plane2[i];
+    frameBuffer[i] = pass == XthPass::BW              ? ~(bit1 | bit2)
+                     : pass == XthPass::GRAYSCALE_LSB ? (~bit1 & bit2)
+                                                      : (bit1 ^ bit2);
+  }
+}
+
+// Transposes an 8x8 bit block held one row per byte (row 0 in the most significant byte, MSB = leftmost pixel), so
+// that each output byte holds one column (column 0 in the most significant byte, MSB = top pixel).
+uint64_t transpose8x8(uint64_t x) {
+  uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ (t << 28);
+  return x;
+}
+}  // namespace
+
+bool XtcPageRenderer::isPanelNative() const {
+  return renderer.getOrientation() == GfxRenderer::Portrait && pageWidth == EInkDisplay::DISPLAY_HEIGHT &&
+         pageHeight == EInkDisplay::DISPLAY_WIDTH;
+}
+
+bool XtcPageRenderer::drawXtgPage(const PageStream& stream) const {
+  // 1-bit mode: Row-major, 8 pixels per byte, MSB first, 0 = black, 1 = white
+  // Rows are gathered in bands of 8 so that each 8x8 pixel block can be transposed into the panel's orientation
+  const bool panelNative = isPanelNative();
+  const size_t srcRowBytes = (pageWidth + 7) / 8;  // 60 bytes for 480 width
+  const size_t bandSize = srcRowBytes * 8;
+  std::vector<uint8_t> band(bandSize);
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+
+  auto flushBand = [&](const uint16_t bandY, const uint16_t rows) {
+    if (panelNative) {
+      // Page column x lands on panel row (width - 1 - x), page row y on panel column y
+      for (size_t col = 0; col < srcRowBytes; col++) {
+        uint64_t block = 0;
+        for (uint16_t r = 0; r < 8; r++) {
+          block = (block << 8) | (r < rows ? band[r * srcRowBytes + col] : 0xFF);
+        }
+        block = transpose8x8(block);
+        for (int i = 0; i < 8; i++) {
+          const size_t panelRow = pageWidth - 1 - (col * 8 + i);
+          frameBuffer[panelRow * EInkDisplay::DISPLAY_WIDTH_BYTES + bandY / 8] = block >> (56 - i * 8);
+        }
+      }
+      return;
+    }
+
+    for (uint16_t r = 0; r < rows; r++) {
+      const uint8_t* row = band.data() + r * srcRowBytes;
+      for (uint16_t x = 0; x < pageWidth; x++) {
+        if (!((row[x / 8] >> (7 - x % 8)) & 1)) {
+          renderer.drawPixel(x, bandY + r, true);
+        }
+      }
+    }
+  };
+
+  // A native page covers every framebuffer byte, otherwise white pixels are left to clearScreen()
+  if (!panelNative) {
+    renderer.clearScreen();
+  }
+
+  size_t bandStart = 0;
+  const bool read = stream([&](const uint8_t* data, size_t size, size_t offset) {
+    while (size > 0) {
+      const size_t toCopy = std::min(size, bandStart + bandSize - offset);
+      memcpy(band.data() + (offset - bandStart), data, toCopy);
+      data += toCopy;
+      size -= toCopy;
+      offset += toCopy;
+      if (offset == bandStart + bandSize) {
+        flushBand(bandStart / srcRowBytes, 8);
+        bandStart += bandSize;
+      }
+    }
+  });
+  if (!read) {
+    return false;
+  }
+  if (pageHeight % 8 != 0) {
+    flushBand(bandStart / srcRowBytes, pageHeight % 8);
+  }
+  return true;
+}
+
+bool XtcPageRenderer::drawXthPass(const PageStream& stream, const XthPass pass) const {
+  // XTH 2-bit mode: Two bit planes, column-major order, laid out exactly like the panel framebuffer (see
+  // isPanelNative). The first plane is streamed into the framebuffer, then the second plane is combined into it in
+  // place, so no page-sized buffer is ever needed.
+  const size_t planeSize = GfxRenderer::getBufferSize();
+  uint8_t* frameBuffer = renderer.getFrameBuffer();
+
+  return stream([&](const uint8_t* data, size_t size, size_t offset) {
+    if (offset < planeSize) {
+      const size_t toCopy = std::min(size, planeSize - offset);
+      memcpy(frameBuffer + offset, data, toCopy);
+      data += toCopy;
+      size -= toCopy;
+      offset += toCopy;
+    }
+    if (size > 0) {
+      uint8_t* dst = frameBuffer + (offset - planeSize);
+      composeXthPlanes(dst, dst, data, size, pass);
+    }
+  });
+}
+
+void XtcPageRenderer::drawXthPassBuffered(const uint8_t* page, const XthPass pass) const {
+  // - Columns scanned right to left (x = width-1 down to 0)
+  // - 8 vertical pixels per byte (MSB = topmost pixel in group)
+  // - First plane: Bit1, Second plane: Bit2
+  // - Pixel value = (bit1 << 1) | bit2
+  // - Grayscale: 0=White, 1=Dark Grey, 2=Light Grey, 3=Black
+  const size_t planeSize = (static_cast<size_t>(pageWidth) * pageHeight + 7) / 8;
+  const uint8_t* plane1 = page;              // Bit1 plane
+  const uint8_t* plane2 = page + planeSize;  // Bit2 plane
+  const size_t colBytes = (pageHeight + 7) / 8;  // Bytes per column (100 for 800 height)
+
+  // In LUT: 0 bit = apply gray effect, 1 bit = untouched
+  renderer.clearScreen(pass == XthPass::BW ? 0xFF : 0x00);
+  for (uint16_t y = 0; y < pageHeight; y++) {
+    for (uint16_t x = 0; x < pageWidth; x++) {
+      const size_t byteOffset = (pageWidth - 1 - x) * colBytes + y / 8;
+      const size_t bitInByte = 7 - (y % 8);
+      const uint8_t pv = (((plane1[byteOffset] >> bitInByte) & 1) << 1) | ((plane2[byteOffset] >> bitInByte) & 1);
+      if (pass == XthPass::BW && pv >= 1) {
+        renderer.drawPixel(x, y, true);
+      } else if ((pass == XthPass::GRAYSCALE_LSB && pv == 1) ||
+                 (pass == XthPass::GRAYSCALE_MSB && (pv == 1 || pv == 2))) {
+        renderer.drawPixel(x, y, false);
+      }
+    }
+  }
+}
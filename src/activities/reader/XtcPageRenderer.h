@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+class GfxRenderer;
+
+/**
+ * Draws XTC pages into the renderer's framebuffer, without displaying them.
+ *
+ * Pages are read through a PageStream, which hands the inflated bitmap over in chunks (from the SD card or from a
+ * page held in RAM). A page whose size and orientation match the panel is written straight into the framebuffer,
+ * any other page is plotted pixel by pixel.
+ */
+class XtcPageRenderer {
+ public:
+  // Framebuffer contents for each display pass of a 2-bit page
+  enum class XthPass { BW, GRAYSCALE_LSB, GRAYSCALE_MSB };
+
+  using ChunkCallback = std::function<void(const uint8_t* data, size_t size, size_t offset)>;
+  // Streams the whole page through the callback, false if the page could not be read
+  using PageStream = std::function<bool(const ChunkCallback& callback)>;
+
+ private:
+  GfxRenderer& renderer;
+  uint16_t pageWidth;
+  uint16_t pageHeight;
+
+ public:
+  explicit XtcPageRenderer(GfxRenderer& renderer, const uint16_t pageWidth, const uint16_t pageHeight)
+      : renderer(renderer), pageWidth(pageWidth), pageHeight(pageHeight) {}
+
+  // A full-size page in portrait maps onto the panel's native framebuffer layout
+  bool isPanelNative() const;
+
+  // 1-bit page, streamed in bands of 8 rows
+  bool drawXtgPage(const PageStream& stream) const;
+  // One pass of a 2-bit page, streamed. Only for panel-native pages.
+  bool drawXthPass(const PageStream& stream, XthPass pass) const;
+  // One pass of a 2-bit page held in RAM (both planes, as stored), for any page size and orientation
+  void drawXthPassBuffered(const uint8_t* page, XthPass pass) const;
+};
@@ -7,19 +7,29 @@
 
 #include "XtcReaderActivity.h"
 
+#include <Esp.h>
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
 #include <SDCardManager.h>
 
+#include <algorithm>
+
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
+#include "SleepFrame.h"
 #include "XtcReaderChapterSelectionActivity.h"
 #include "fontIds.h"
 
 namespace {
 constexpr unsigned long skipPageMs = 700;
 constexpr unsigned long goHomeMs = 1000;
+// Largest stored page kept in RAM. Uncompressed 2-bit pages (96KB) are streamed from the SD card instead.
+constexpr size_t maxCachedPageSize = 48 * 1024;
+// Heap that must stay allocatable after caching a page, enough for inflating a compressed page
+constexpr size_t cachedPageHeapReserve = 64 * 1024;
 }  // namespace
 
 void XtcReaderActivity::taskTrampoline(void* param) {
@@ -37,6 +47,7 @@ void XtcReaderActivity::onEnter() {
   renderingMutex = xSemaphoreCreateMutex();
 
   xtc->setupCacheDir();
+  CacheManager::bookOpened(xtc->getCachePath());
 
   // Load saved progress
   loadProgress();
@@ -59,14 +70,31 @@ void XtcReaderActivity::onEnter() {
 void XtcReaderActivity::onExit() {
   ActivityWithSubactivity::onExit();
 
-  // Wait until not rendering to delete task
+  // Wait until not rendering to delete task, a prefetch stops early
+  inputWaiting = true;
   xSemaphoreTake(renderingMutex, portMAX_DELAY);
   if (displayTaskHandle) {
     vTaskDelete(displayTaskHandle);
     displayTaskHandle = nullptr;
   }
+  // The cover task only stops at its next yield, which needs the mutex
+  xSemaphoreGive(renderingMutex);
+  coverFrame.stop();
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
+  // Also reached when going to sleep, so this is the last chance to persist the position
+  progress.flush();
+  if (xtc && xtc->getPageCount() > 0) {
+    const uint32_t pageCount = xtc->getPageCount();
+    const auto bookProgress = static_cast<uint8_t>(std::min<uint64_t>(100, uint64_t{currentPage} * 100 / pageCount));
+    LibraryCatalog::updateBook(xtc->getPath(), xtc->getTitle(), "", SdMan.exists(xtc->getCoverBmpPath().c_str()),
+                               bookProgress);
+  }
+  if (xtc) {
+    CacheManager::bookClosed(xtc->getCachePath());
+  }
+  freeCachedPage(shownPage);
+  freeCachedPage(prefetchedPage);
   xtc.reset();
 }
 
@@ -77,10 +105,18 @@ void XtcReaderActivity::loop() {
     return;
   }
 
+  // Persist the reading position once it settles, only between renders so the SD card is free
+  if (progress.hasUnsavedChanges() && xSemaphoreTake(renderingMutex, 0) == pdTRUE) {
+    progress.flushIfDue();
+    xSemaphoreGive(renderingMutex);
+  }
+
   // Enter chapter selection activity
   if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
     if (xtc && xtc->hasChapters() && !xtc->getChapters().empty()) {
+      inputWaiting = true;
       xSemaphoreTake(renderingMutex, portMAX_DELAY);
+      inputWaiting = false;
       exitActivity();
       enterNewActivity(new XtcReaderChapterSelectionActivity(
           this->renderer, this->mappedInput, xtc, currentPage,
@@ -109,39 +145,44 @@ void XtcReaderActivity::loop() {
     return;
   }
 
-  const bool prevReleased = mappedInput.wasReleased(MappedInputManager::Button::PageBack) ||
-                            mappedInput.wasReleased(MappedInputManager::Button::Left);
-  const bool nextReleased = mappedInput.wasReleased(MappedInputManager::Button::PageForward) ||
-                            mappedInput.wasReleased(MappedInputManager::Button::Right);
-
-  if (!prevReleased && !nextReleased) {
+  // Page turns stay queued while a page is being drawn. Everything pressed in the meantime is then applied as a
+  // single jump, so only the page the reader ends up on gets rendered.
+  if (xSemaphoreTake(renderingMutex, 0) != pdTRUE) {
+    // A prefetch gives the mutex up at its next chunk, a render finishes first
+    if (mappedInput.hasEvents()) {
+      inputWaiting = true;
+    }
     return;
   }
+  inputWaiting = false;
 
-  // Handle end of book
-  if (currentPage >= xtc->getPageCount()) {
-    currentPage = xtc->getPageCount() - 1;
-    updateRequired = true;
+  int turns;
+  int skips;
+  if (!mappedInput.takePageTurns(skipPageMs, turns, skips)) {
+    xSemaphoreGive(renderingMutex);
     return;
   }
 
-  const bool skipPages = mappedInput.getHeldTime() > skipPageMs;
-  const int skipAmount = skipPages ? 10 : 1;
+  const uint32_t pageCount = xtc->getPageCount();
+  const int64_t jump = static_cast<int64_t>(turns) + static_cast<int64_t>(skips) * 10;
 
-  if (prevReleased) {
-    if (currentPage >= static_cast<uint32_t>(skipAmount)) {
-      currentPage -= skipAmount;
-    } else {
-      currentPage = 0;
-    }
+  if (currentPage >= pageCount) {
+    // Handle end of book
+    currentPage = pageCount - 1;
     updateRequired = true;
-  } else if (nextReleased) {
-    currentPage += skipAmount;
-    if (currentPage >= xtc->getPageCount()) {
-      currentPage = xtc->getPageCount();  // Allow showing "End of book"
+  } else if (jump != 0) {
+    readingDirection = jump < 0 ? -1 : 1;
+    const int64_t target = static_cast<int64_t>(currentPage) + jump;
+    if (target < 0) {
+      currentPage = 0;
+    } else if (target >= pageCount) {
+      currentPage = pageCount;  // Allow showing "End of book"
+    } else {
+      currentPage = static_cast<uint32_t>(target);
     }
     updateRequired = true;
   }
+  xSemaphoreGive(renderingMutex);
 }
 
 void XtcReaderActivity::displayTaskLoop() {
@@ -150,9 +191,14 @@ void XtcReaderActivity::displayTaskLoop() {
       updateRequired = false;
       xSemaphoreTake(renderingMutex, portMAX_DELAY);
       renderScreen();
+      // The refresh has finished, so the SD card is free until the next button press: read the next page now,
+      // unless another turn is already waiting. Input arriving meanwhile stops the read.
+      if (!updateRequired && !inputWaiting) {
+        prefetchNextPage();
+      }
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
@@ -172,216 +218,243 @@ void XtcReaderActivity::renderScreen() {
 
   renderPage();
   saveProgress();
+  coverFrame.start(renderingMutex, SleepFrame::coverFramePath(xtc->getCachePath()),
+                   [this](const std::function<bool()>& yield) {
+                     return xtc->generateCoverBmp(yield) ? xtc->getCoverBmpPath() : std::string();
+                   });
 }
 
 void XtcReaderActivity::renderPage() {
-  const uint16_t pageWidth = xtc->getPageWidth();
-  const uint16_t pageHeight = xtc->getPageHeight();
   const uint8_t bitDepth = xtc->getBitDepth();
+  const XtcPageRenderer pageRenderer(renderer, xtc->getPageWidth(), xtc->getPageHeight());
+  // A full-size page in portrait maps onto the panel's native framebuffer layout, so it can be streamed straight in
+  const bool panelNative = pageRenderer.isPanelNative();
+
+  // Use the prefetched copy if the reader turned onto it, otherwise read the page into RAM once for all passes.
+  // If it can't be cached (read only once, too large, low memory), the page is streamed from the SD card as before.
+  if (prefetchedPage.page == currentPage) {
+    std::swap(shownPage, prefetchedPage);
+  } else if (shownPage.page != currentPage) {
+    if ((bitDepth == 1 || panelNative) && isWorthCaching(currentPage)) {
+      cachePage(shownPage, currentPage);
+    } else {
+      // Streamed from the SD card, so the previous page's buffer is not needed
+      freeCachedPage(shownPage);
+    }
+  }
 
-  // Calculate buffer size for one page
-  // XTG (1-bit): Row-major, ((width+7)/8) * height bytes
-  // XTH (2-bit): Two bit planes, column-major, ((width * height + 7) / 8) * 2 bytes
-  size_t pageBufferSize;
+  bool rendered;
   if (bitDepth == 2) {
-    pageBufferSize = ((static_cast<size_t>(pageWidth) * pageHeight + 7) / 8) * 2;
+    rendered = panelNative ? renderXthPageStreaming(pageRenderer) : renderXthPageBuffered(pageRenderer);
   } else {
-    pageBufferSize = ((pageWidth + 7) / 8) * pageHeight;
+    rendered = renderXtgPageStreaming(pageRenderer);
   }
 
-  // Allocate page buffer
-  uint8_t* pageBuffer = static_cast<uint8_t*>(malloc(pageBufferSize));
-  if (!pageBuffer) {
-    Serial.printf("[%lu] [XTR] Failed to allocate page buffer (%lu bytes)\n", millis(), pageBufferSize);
+  if (!rendered) {
+    Serial.printf("[%lu] [XTR] Failed to load page %lu\n", millis(), currentPage);
     renderer.clearScreen();
-    renderer.drawCenteredText(UI_12_FONT_ID, 300, "Memory error", true, EpdFontFamily::BOLD);
+    renderer.drawCenteredText(UI_12_FONT_ID, 300, "Page load error", true, EpdFontFamily::BOLD);
     renderer.displayBuffer();
     return;
   }
 
-  // Load page data
-  size_t bytesRead = xtc->loadPage(currentPage, pageBuffer, pageBufferSize);
-  if (bytesRead == 0) {
-    Serial.printf("[%lu] [XTR] Failed to load page %lu\n", millis(), currentPage);
-    free(pageBuffer);
-    renderer.clearScreen();
-    renderer.drawCenteredText(UI_12_FONT_ID, 300, "Page load error", true, EpdFontFamily::BOLD);
+  Serial.printf("[%lu] [XTR] Rendered page %lu/%lu (%u-bit)\n", millis(), currentPage + 1, xtc->getPageCount(),
+                bitDepth);
+}
+
+void XtcReaderActivity::displayPageBuffer() {
+  if (pagesUntilFullRefresh <= 1) {
+    renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
+    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
+  } else {
     renderer.displayBuffer();
-    return;
+    pagesUntilFullRefresh--;
   }
+}
 
-  // Clear screen first
-  renderer.clearScreen();
+bool XtcReaderActivity::renderXtgPageStreaming(const XtcPageRenderer& pageRenderer) {
+  if (!pageRenderer.drawXtgPage(currentPageStream())) {
+    return false;
+  }
+
+  // XTC pages already have status bar pre-rendered, no need to add our own
+  displayPageBuffer();
+  return true;
+}
 
-  // Copy page bitmap using GfxRenderer's drawPixel
-  // XTC/XTCH pages are pre-rendered with status bar included, so render full page
-  const uint16_t maxSrcY = pageHeight;
+bool XtcReaderActivity::renderXthPageStreaming(const XtcPageRenderer& pageRenderer) {
+  // Each pass re-streams the page, from RAM when it is cached
+  const auto stream = currentPageStream();
 
-  if (bitDepth == 2) {
-    // XTH 2-bit mode: Two bit planes, column-major order
-    // - Columns scanned right to left (x = width-1 down to 0)
-    // - 8 vertical pixels per byte (MSB = topmost pixel in group)
-    // - First plane: Bit1, Second plane: Bit2
-    // - Pixel value = (bit1 << 1) | bit2
-    // - Grayscale: 0=White, 1=Dark Grey, 2=Light Grey, 3=Black
-
-    const size_t planeSize = (static_cast<size_t>(pageWidth) * pageHeight + 7) / 8;
-    const uint8_t* plane1 = pageBuffer;              // Bit1 plane
-    const uint8_t* plane2 = pageBuffer + planeSize;  // Bit2 plane
-    const size_t colBytes = (pageHeight + 7) / 8;    // Bytes per column (100 for 800 height)
-
-    // Lambda to get pixel value at (x, y)
-    auto getPixelValue = [&](uint16_t x, uint16_t y) -> uint8_t {
-      const size_t colIndex = pageWidth - 1 - x;
-      const size_t byteInCol = y / 8;
-      const size_t bitInByte = 7 - (y % 8);
-      const size_t byteOffset = colIndex * colBytes + byteInCol;
-      const uint8_t bit1 = (plane1[byteOffset] >> bitInByte) & 1;
-      const uint8_t bit2 = (plane2[byteOffset] >> bitInByte) & 1;
-      return (bit1 << 1) | bit2;
-    };
-
-    // Optimized grayscale rendering without storeBwBuffer (saves 48KB peak memory)
-    // Flow: BW display → LSB/MSB passes → grayscale display → re-render BW for next frame
-
-    // Count pixel distribution for debugging
-    uint32_t pixelCounts[4] = {0, 0, 0, 0};
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        pixelCounts[getPixelValue(x, y)]++;
-      }
-    }
-    Serial.printf("[%lu] [XTR] Pixel distribution: White=%lu, DarkGrey=%lu, LightGrey=%lu, Black=%lu\n", millis(),
-                  pixelCounts[0], pixelCounts[1], pixelCounts[2], pixelCounts[3]);
-
-    // Pass 1: BW buffer - draw all non-white pixels as black
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) >= 1) {
-          renderer.drawPixel(x, y, true);
-        }
-      }
-    }
+  // Flow: BW display → LSB/MSB passes → grayscale display → re-render BW for next frame
+  if (!pageRenderer.drawXthPass(stream, XtcPageRenderer::XthPass::BW)) {
+    return false;
+  }
+  displayPageBuffer();
 
-    // Display BW with conditional refresh based on pagesUntilFullRefresh
-    if (pagesUntilFullRefresh <= 1) {
-      renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
-      pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
-    } else {
-      renderer.displayBuffer();
-      pagesUntilFullRefresh--;
-    }
+  if (!pageRenderer.drawXthPass(stream, XtcPageRenderer::XthPass::GRAYSCALE_LSB)) {
+    return false;
+  }
+  renderer.copyGrayscaleLsbBuffers();
 
-    // Pass 2: LSB buffer - mark DARK gray only (XTH value 1)
-    // In LUT: 0 bit = apply gray effect, 1 bit = untouched
-    renderer.clearScreen(0x00);
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) == 1) {  // Dark grey only
-          renderer.drawPixel(x, y, false);
-        }
-      }
-    }
-    renderer.copyGrayscaleLsbBuffers();
-
-    // Pass 3: MSB buffer - mark LIGHT AND DARK gray (XTH value 1 or 2)
-    // In LUT: 0 bit = apply gray effect, 1 bit = untouched
-    renderer.clearScreen(0x00);
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        const uint8_t pv = getPixelValue(x, y);
-        if (pv == 1 || pv == 2) {  // Dark grey or Light grey
-          renderer.drawPixel(x, y, false);
-        }
-      }
-    }
-    renderer.copyGrayscaleMsbBuffers();
+  if (!pageRenderer.drawXthPass(stream, XtcPageRenderer::XthPass::GRAYSCALE_MSB)) {
+    return false;
+  }
+  renderer.copyGrayscaleMsbBuffers();
 
-    // Display grayscale overlay
-    renderer.displayGrayBuffer();
+  renderer.displayGrayBuffer();
 
-    // Pass 4: Re-render BW to framebuffer (restore for next frame, instead of restoreBwBuffer)
-    renderer.clearScreen();
-    for (uint16_t y = 0; y < pageHeight; y++) {
-      for (uint16_t x = 0; x < pageWidth; x++) {
-        if (getPixelValue(x, y) >= 1) {
-          renderer.drawPixel(x, y, true);
-        }
-      }
-    }
+  // Restore the BW frame for the next page (instead of restoreBwBuffer, saves 48KB peak memory)
+  if (!pageRenderer.drawXthPass(stream, XtcPageRenderer::XthPass::BW)) {
+    return false;
+  }
+  renderer.cleanupGrayscaleWithFrameBuffer();
+  return true;
+}
+
+bool XtcReaderActivity::renderXthPageBuffered(const XtcPageRenderer& pageRenderer) {
+  // Fallback for pages that don't match the panel layout: plot each pixel through GfxRenderer
+  const size_t planeSize = (static_cast<size_t>(xtc->getPageWidth()) * xtc->getPageHeight() + 7) / 8;
+  const size_t pageBufferSize = planeSize * 2;
 
-    // Cleanup grayscale buffers with current frame buffer
-    renderer.cleanupGrayscaleWithFrameBuffer();
+  uint8_t* pageBuffer = static_cast<uint8_t*>(malloc(pageBufferSize));
+  if (!pageBuffer) {
+    Serial.printf("[%lu] [XTR] Failed to allocate page buffer (%lu bytes)\n", millis(), pageBufferSize);
+    return false;
+  }
 
+  if (xtc->loadPage(currentPage, pageBuffer, pageBufferSize) == 0) {
     free(pageBuffer);
+    return false;
+  }
 
-    Serial.printf("[%lu] [XTR] Rendered page %lu/%lu (2-bit grayscale)\n", millis(), currentPage + 1,
-                  xtc->getPageCount());
-    return;
-  } else {
-    // 1-bit mode: 8 pixels per byte, MSB first
-    const size_t srcRowBytes = (pageWidth + 7) / 8;  // 60 bytes for 480 width
+  pageRenderer.drawXthPassBuffered(pageBuffer, XtcPageRenderer::XthPass::BW);
+  displayPageBuffer();
 
-    for (uint16_t srcY = 0; srcY < maxSrcY; srcY++) {
-      const size_t srcRowStart = srcY * srcRowBytes;
+  pageRenderer.drawXthPassBuffered(pageBuffer, XtcPageRenderer::XthPass::GRAYSCALE_LSB);
+  renderer.copyGrayscaleLsbBuffers();
+  pageRenderer.drawXthPassBuffered(pageBuffer, XtcPageRenderer::XthPass::GRAYSCALE_MSB);
+  renderer.copyGrayscaleMsbBuffers();
+  renderer.displayGrayBuffer();
 
-      for (uint16_t srcX = 0; srcX < pageWidth; srcX++) {
-        // Read source pixel (MSB first, bit 7 = leftmost pixel)
-        const size_t srcByte = srcRowStart + srcX / 8;
-        const size_t srcBit = 7 - (srcX % 8);
-        const bool isBlack = !((pageBuffer[srcByte] >> srcBit) & 1);  // XTC: 0 = black, 1 = white
+  pageRenderer.drawXthPassBuffered(pageBuffer, XtcPageRenderer::XthPass::BW);
+  renderer.cleanupGrayscaleWithFrameBuffer();
 
-        if (isBlack) {
-          renderer.drawPixel(srcX, srcY, true);
-        }
-      }
-    }
+  free(pageBuffer);
+  return true;
+}
+
+XtcPageRenderer::PageStream XtcReaderActivity::currentPageStream() {
+  return [this](const XtcPageRenderer::ChunkCallback& callback) {
+    return streamCurrentPage(callback) == xtc::XtcError::OK;
+  };
+}
+
+xtc::XtcError XtcReaderActivity::streamCurrentPage(
+    const std::function<void(const uint8_t* data, size_t size, size_t offset)>& callback) {
+  if (shownPage.page == currentPage) {
+    return xtc->decodeStoredPage(currentPage, shownPage.data, shownPage.size, callback);
   }
-  // White pixels are already cleared by clearScreen()
+  return xtc->loadPageStreaming(currentPage, callback);
+}
 
-  free(pageBuffer);
+bool XtcReaderActivity::isWorthCaching(const uint32_t page) const {
+  // XTH pages are streamed once per grayscale pass, so even uncompressed ones are read several times
+  if (xtc->getBitDepth() == 2) {
+    return true;
+  }
+  // An uncompressed 1-bit page on screen is read once, straight into the framebuffer, so reading it into RAM first
+  // saves nothing. Compressed pages are read whole before they are inflated anyway.
+  const size_t bitmapSize = static_cast<size_t>((xtc->getPageWidth() + 7) / 8) * xtc->getPageHeight();
+  const size_t storedSize = xtc->getStoredPageSize(page);
+  return storedSize != 0 && storedSize != sizeof(xtc::XtgPageHeader) + bitmapSize;
+}
 
-  // XTC pages already have status bar pre-rendered, no need to add our own
+bool XtcReaderActivity::cachePage(CachedPage& slot, const uint32_t page, const std::function<bool()>& yieldFn) {
+  slot.page = UINT32_MAX;
 
-  // Display with appropriate refresh
-  if (pagesUntilFullRefresh <= 1) {
-    renderer.displayBuffer(EInkDisplay::HALF_REFRESH);
-    pagesUntilFullRefresh = SETTINGS.getRefreshFrequency();
-  } else {
-    renderer.displayBuffer();
-    pagesUntilFullRefresh--;
+  const size_t storedSize = xtc->getStoredPageSize(page);
+  if (storedSize == 0 || storedSize > maxCachedPageSize) {
+    return false;
   }
 
-  Serial.printf("[%lu] [XTR] Rendered page %lu/%lu (%u-bit)\n", millis(), currentPage + 1, xtc->getPageCount(),
-                bitDepth);
+  if (slot.capacity < storedSize) {
+    freeCachedPage(slot);
+    if (static_cast<size_t>(ESP.getMaxAllocHeap()) < storedSize + cachedPageHeapReserve) {
+      Serial.printf("[%lu] [XTR] Not caching page %lu, low memory (%d bytes free)\n", millis(), page,
+                    ESP.getFreeHeap());
+      return false;
+    }
+    slot.data = static_cast<uint8_t*>(malloc(storedSize));
+    if (!slot.data) {
+      Serial.printf("[%lu] [XTR] Failed to allocate page cache (%lu bytes)\n", millis(), storedSize);
+      return false;
+    }
+    slot.capacity = storedSize;
+  }
+
+  slot.size = xtc->readStoredPage(page, slot.data, slot.capacity, yieldFn);
+  if (slot.size == 0) {
+    return false;
+  }
+  slot.page = page;
+  return true;
 }
 
-void XtcReaderActivity::saveProgress() const {
-  FsFile f;
-  if (SdMan.openFileForWrite("XTR", xtc->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentPage & 0xFF;
-    data[1] = (currentPage >> 8) & 0xFF;
-    data[2] = (currentPage >> 16) & 0xFF;
-    data[3] = (currentPage >> 24) & 0xFF;
-    f.write(data, 4);
-    f.close();
+void XtcReaderActivity::freeCachedPage(CachedPage& slot) {
+  free(slot.data);
+  slot = CachedPage();
+}
+
+void XtcReaderActivity::prefetchNextPage() {
+  // Every page that fits the cache is prefetched: on the next turn even an uncompressed one then goes from RAM to the
+  // framebuffer without waiting for the SD card
+  if (!xtc) {
+    return;
+  }
+
+  const uint32_t nextPage = currentPage + readingDirection;
+  if ((readingDirection < 0 && currentPage == 0) || nextPage >= xtc->getPageCount() ||
+      prefetchedPage.page == nextPage) {
+    return;
+  }
+
+  const unsigned long start = millis();
+  if (!cachePage(prefetchedPage, nextPage, [this] { return !inputWaiting; })) {
+    if (inputWaiting) {
+      // Stopped for a turn or jump, the buffer is kept for the next prefetch
+      Serial.printf("[%lu] [XTR] Stopped prefetching page %lu after %lu ms\n", millis(), nextPage + 1,
+                    millis() - start);
+      return;
+    }
+    // Give the memory back rather than hold a buffer that can't be filled
+    freeCachedPage(prefetchedPage);
+    return;
   }
+  Serial.printf("[%lu] [XTR] Prefetched page %lu (%lu bytes) in %lu ms\n", millis(), nextPage + 1,
+                prefetchedPage.size, millis() - start);
+}
+
+void XtcReaderActivity::saveProgress() {
+  // Written to the SD card later by loop(), off the page turn path
+  uint8_t data[4];
+  data[0] = currentPage & 0xFF;
+  data[1] = (currentPage >> 8) & 0xFF;
+  data[2] = (currentPage >> 16) & 0xFF;
+  data[3] = (currentPage >> 24) & 0xFF;
+  progress.set(data, sizeof(data));
 }
 
 void XtcReaderActivity::loadProgress() {
-  FsFile f;
-  if (SdMan.openFileForRead("XTR", xtc->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
-      currentPage = data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
-      Serial.printf("[%lu] [XTR] Loaded progress: page %lu\n", millis(), currentPage);
-
-      // Validate page number
-      if (currentPage >= xtc->getPageCount()) {
-        currentPage = 0;
-      }
+  progress.setPath(xtc->getCachePath() + "/progress.bin");
+  uint8_t data[4];
+  if (progress.load(data, sizeof(data))) {
+    currentPage = data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+    Serial.printf("[%lu] [XTR] Loaded progress: page %lu\n", millis(), currentPage);
+
+    // Validate page number
+    if (currentPage >= xtc->getPageCount()) {
+      currentPage = 0;
     }
-    f.close();
   }
 }
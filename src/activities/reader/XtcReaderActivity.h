@@ -12,15 +12,37 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <atomic>
+
+#include "CoverFramePrerenderer.h"
+#include "ProgressStore.h"
+#include "XtcPageRenderer.h"
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 
 class XtcReaderActivity final : public ActivityWithSubactivity {
+  // A page exactly as stored in the file (still compressed if the page is), held in RAM so it can be decoded
+  // without going back to the SD card
+  struct CachedPage {
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    size_t size = 0;
+    uint32_t page = UINT32_MAX;
+  };
+
   std::shared_ptr<Xtc> xtc;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
   uint32_t currentPage = 0;
   int pagesUntilFullRefresh = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
+  ProgressStore progress;
+  CachedPage shownPage;       // Page on screen, reused by every XTH pass
+  CachedPage prefetchedPage;  // Neighbour in the reading direction, read while the reader looks at shownPage
+  int readingDirection = 1;
+  // Set by loop() when input is waiting for the rendering mutex, stops a prefetch between chunks
+  std::atomic<bool> inputWaiting{false};
+  CoverFramePrerenderer coverFrame{renderer};
   const std::function<void()> onGoBack;
   const std::function<void()> onGoHome;
 
@@ -28,7 +50,17 @@ class XtcReaderActivity final : public ActivityWithSubactivity {
   [[noreturn]] void displayTaskLoop();
   void renderScreen();
   void renderPage();
-  void saveProgress() const;
+  void displayPageBuffer();
+  bool renderXtgPageStreaming(const XtcPageRenderer& pageRenderer);
+  bool renderXthPageStreaming(const XtcPageRenderer& pageRenderer);
+  bool renderXthPageBuffered(const XtcPageRenderer& pageRenderer);
+  XtcPageRenderer::PageStream currentPageStream();
+  xtc::XtcError streamCurrentPage(const std::function<void(const uint8_t* data, size_t size, size_t offset)>& callback);
+  bool isWorthCaching(uint32_t page) const;
+  bool cachePage(CachedPage& slot, uint32_t page, const std::function<bool()>& yieldFn = nullptr);
+  static void freeCachedPage(CachedPage& slot);
+  void prefetchNextPage();
+  void saveProgress();
   void loadProgress();
 
  public:
@@ -41,4 +73,7 @@ class XtcReaderActivity final : public ActivityWithSubactivity {
   void onEnter() override;
   void onExit() override;
   void loop() override;
+  // Keeps the device awake (no light or deep sleep) while the cover sleep screen is rendered in the background
+  bool preventAutoSleep() override { return coverFrame.isRunning(); }
+  bool isSdBusy() override { return coverFrame.isRunning(); }
 };
@@ -121,7 +121,7 @@ void XtcReaderChapterSelectionActivity::displayTaskLoop() {
       renderScreen();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    updateRequired.wait();
   }
 }
 
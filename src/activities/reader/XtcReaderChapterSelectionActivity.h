@@ -7,6 +7,7 @@
 #include <memory>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 class XtcReaderChapterSelectionActivity final : public Activity {
   std::shared_ptr<Xtc> xtc;
@@ -14,7 +15,7 @@ class XtcReaderChapterSelectionActivity final : public Activity {
   SemaphoreHandle_t renderingMutex = nullptr;
   uint32_t currentPage = 0;
   int selectorIndex = 0;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   const std::function<void()> onGoBack;
   const std::function<void(uint32_t newPage)> onSelectPage;
 
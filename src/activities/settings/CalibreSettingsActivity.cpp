@@ -131,7 +131,8 @@ void CalibreSettingsActivity::displayTaskLoop() {
       render();
       xSemaphoreGive(renderingMutex);
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS);
+    // A request made while a sub activity was open is picked up on the next timeout
+    updateRequired.wait(100 / portTICK_PERIOD_MS);
   }
 }
 
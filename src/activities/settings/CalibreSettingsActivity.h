@@ -6,6 +6,7 @@
 #include <functional>
 
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 
 /**
  * Submenu for Calibre settings.
@@ -24,7 +25,7 @@ class CalibreSettingsActivity final : public ActivityWithSubactivity {
  private:
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
 
   int selectedIndex = 0;
   const std::function<void()> onBack;
@@ -4,6 +4,7 @@
 #include <freertos/task.h>
 
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 #include "network/OtaUpdater.h"
 
 class OtaUpdateActivity : public ActivityWithSubactivity {
@@ -23,7 +24,7 @@ class OtaUpdateActivity : public ActivityWithSubactivity {
 
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   const std::function<void()> goBack;
   State state = WIFI_SELECTION;
   unsigned int lastUpdaterPercentage = UNINITIALIZED_PERCENTAGE;
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "activities/ActivityWithSubactivity.h"
+#include "activities/RenderSignal.h"
 
 class CrossPointSettings;
 
@@ -47,7 +48,7 @@ struct SettingInfo {
 class SettingsActivity final : public ActivityWithSubactivity {
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
   int selectedSettingIndex = 0;  // Currently selected setting
   const std::function<void()> onGoHome;
 
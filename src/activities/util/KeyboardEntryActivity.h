@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "../Activity.h"
+#include "../RenderSignal.h"
 
 /**
  * Reusable keyboard entry activity for text input.
@@ -65,7 +66,7 @@ class KeyboardEntryActivity : public Activity {
   bool isPassword;
   TaskHandle_t displayTaskHandle = nullptr;
   SemaphoreHandle_t renderingMutex = nullptr;
-  bool updateRequired = false;
+  RenderSignal updateRequired{displayTaskHandle};
 
   // Keyboard state
   int selectedRow = 0;
@@ -5,23 +5,30 @@
 #include <InputManager.h>
 #include <SDCardManager.h>
 #include <SPI.h>
-#include <builtinFonts/all.h>
+#include <WiFi.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
 
 #include <cstring>
 
 #include "Battery.h"
+#include "BuiltinFonts.h"
+#include "CacheManager.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "MappedInputManager.h"
+#include "ResumeSnapshot.h"
 #include "activities/boot_sleep/BootActivity.h"
 #include "activities/boot_sleep/SleepActivity.h"
 #include "activities/browser/OpdsBookBrowserActivity.h"
 #include "activities/home/HomeActivity.h"
 #include "activities/network/CrossPointWebServerActivity.h"
+#include "activities/RenderSignal.h"
 #include "activities/reader/ReaderActivity.h"
 #include "activities/settings/SettingsActivity.h"
 #include "activities/util/FullScreenMessageActivity.h"
-#include "fontIds.h"
+#include "util/LoopPacer.h"
+#include "util/StringUtils.h"
 
 #define SPI_FQ 40000000
 // Display SPI pins (custom pins for XteinkX4, not hardware SPI defaults)
@@ -36,102 +43,42 @@
 
 #define SD_SPI_MISO 7
 
+// Time without input before the book caches are measured and trimmed
+constexpr unsigned long CACHE_UPKEEP_IDLE_MS = 2000;
+
 EInkDisplay einkDisplay(EPD_SCLK, EPD_MOSI, EPD_CS, EPD_DC, EPD_RST, EPD_BUSY);
 InputManager inputManager;
 MappedInputManager mappedInputManager(inputManager);
 GfxRenderer renderer(einkDisplay);
 Activity* currentActivity;
 
-// Fonts
-EpdFont bookerly12RegularFont(&bookerly_12_regular);
-EpdFont bookerly12BoldFont(&bookerly_12_bold);
-EpdFont bookerly12ItalicFont(&bookerly_12_italic);
-EpdFont bookerly12BoldItalicFont(&bookerly_12_bolditalic);
-EpdFontFamily bookerly12FontFamily(&bookerly12RegularFont, &bookerly12BoldFont, &bookerly12ItalicFont,
-                                   &bookerly12BoldItalicFont);
-EpdFont bookerly14RegularFont(&bookerly_14_regular);
-EpdFont bookerly14BoldFont(&bookerly_14_bold);
-EpdFont bookerly14ItalicFont(&bookerly_14_italic);
-EpdFont bookerly14BoldItalicFont(&bookerly_14_bolditalic);
-EpdFontFamily bookerly14FontFamily(&bookerly14RegularFont, &bookerly14BoldFont, &bookerly14ItalicFont,
-                                   &bookerly14BoldItalicFont);
-EpdFont bookerly16RegularFont(&bookerly_16_regular);
-EpdFont bookerly16BoldFont(&bookerly_16_bold);
-EpdFont bookerly16ItalicFont(&bookerly_16_italic);
-EpdFont bookerly16BoldItalicFont(&bookerly_16_bolditalic);
-EpdFontFamily bookerly16FontFamily(&bookerly16RegularFont, &bookerly16BoldFont, &bookerly16ItalicFont,
-                                   &bookerly16BoldItalicFont);
-EpdFont bookerly18RegularFont(&bookerly_18_regular);
-EpdFont bookerly18BoldFont(&bookerly_18_bold);
-EpdFont bookerly18ItalicFont(&bookerly_18_italic);
-EpdFont bookerly18BoldItalicFont(&bookerly_18_bolditalic);
-EpdFontFamily bookerly18FontFamily(&bookerly18RegularFont, &bookerly18BoldFont, &bookerly18ItalicFont,
-                                   &bookerly18BoldItalicFont);
-
-EpdFont notosans12RegularFont(&notosans_12_regular);
-EpdFont notosans12BoldFont(&notosans_12_bold);
-EpdFont notosans12ItalicFont(&notosans_12_italic);
-EpdFont notosans12BoldItalicFont(&notosans_12_bolditalic);
-EpdFontFamily notosans12FontFamily(&notosans12RegularFont, &notosans12BoldFont, &notosans12ItalicFont,
-                                   &notosans12BoldItalicFont);
-EpdFont notosans14RegularFont(&notosans_14_regular);
-EpdFont notosans14BoldFont(&notosans_14_bold);
-EpdFont notosans14ItalicFont(&notosans_14_italic);
-EpdFont notosans14BoldItalicFont(&notosans_14_bolditalic);
-EpdFontFamily notosans14FontFamily(&notosans14RegularFont, &notosans14BoldFont, &notosans14ItalicFont,
-                                   &notosans14BoldItalicFont);
-EpdFont notosans16RegularFont(&notosans_16_regular);
-EpdFont notosans16BoldFont(&notosans_16_bold);
-EpdFont notosans16ItalicFont(&notosans_16_italic);
-EpdFont notosans16BoldItalicFont(&notosans_16_bolditalic);
-EpdFontFamily notosans16FontFamily(&notosans16RegularFont, &notosans16BoldFont, &notosans16ItalicFont,
-                                   &notosans16BoldItalicFont);
-EpdFont notosans18RegularFont(&notosans_18_regular);
-EpdFont notosans18BoldFont(&notosans_18_bold);
-EpdFont notosans18ItalicFont(&notosans_18_italic);
-EpdFont notosans18BoldItalicFont(&notosans_18_bolditalic);
-EpdFontFamily notosans18FontFamily(&notosans18RegularFont, &notosans18BoldFont, &notosans18ItalicFont,
-                                   &notosans18BoldItalicFont);
-
-EpdFont opendyslexic8RegularFont(&opendyslexic_8_regular);
-EpdFont opendyslexic8BoldFont(&opendyslexic_8_bold);
-EpdFont opendyslexic8ItalicFont(&opendyslexic_8_italic);
-EpdFont opendyslexic8BoldItalicFont(&opendyslexic_8_bolditalic);
-EpdFontFamily opendyslexic8FontFamily(&opendyslexic8RegularFont, &opendyslexic8BoldFont, &opendyslexic8ItalicFont,
-                                      &opendyslexic8BoldItalicFont);
-EpdFont opendyslexic10RegularFont(&opendyslexic_10_regular);
-EpdFont opendyslexic10BoldFont(&opendyslexic_10_bold);
-EpdFont opendyslexic10ItalicFont(&opendyslexic_10_italic);
-EpdFont opendyslexic10BoldItalicFont(&opendyslexic_10_bolditalic);
-EpdFontFamily opendyslexic10FontFamily(&opendyslexic10RegularFont, &opendyslexic10BoldFont, &opendyslexic10ItalicFont,
-                                       &opendyslexic10BoldItalicFont);
-EpdFont opendyslexic12RegularFont(&opendyslexic_12_regular);
-EpdFont opendyslexic12BoldFont(&opendyslexic_12_bold);
-EpdFont opendyslexic12ItalicFont(&opendyslexic_12_italic);
-EpdFont opendyslexic12BoldItalicFont(&opendyslexic_12_bolditalic);
-EpdFontFamily opendyslexic12FontFamily(&opendyslexic12RegularFont, &opendyslexic12BoldFont, &opendyslexic12ItalicFont,
-                                       &opendyslexic12BoldItalicFont);
-EpdFont opendyslexic14RegularFont(&opendyslexic_14_regular);
-EpdFont opendyslexic14BoldFont(&opendyslexic_14_bold);
-EpdFont opendyslexic14ItalicFont(&opendyslexic_14_italic);
-EpdFont opendyslexic14BoldItalicFont(&opendyslexic_14_bolditalic);
-EpdFontFamily opendyslexic14FontFamily(&opendyslexic14RegularFont, &opendyslexic14BoldFont, &opendyslexic14ItalicFont,
-                                       &opendyslexic14BoldItalicFont);
-
-EpdFont smallFont(&notosans_8_regular);
-EpdFontFamily smallFontFamily(&smallFont);
-
-EpdFont ui10RegularFont(&ubuntu_10_regular);
-EpdFont ui10BoldFont(&ubuntu_10_bold);
-EpdFontFamily ui10FontFamily(&ui10RegularFont, &ui10BoldFont);
-
-EpdFont ui12RegularFont(&ubuntu_12_regular);
-EpdFont ui12BoldFont(&ubuntu_12_bold);
-EpdFontFamily ui12FontFamily(&ui12RegularFont, &ui12BoldFont);
-
 // measurement of power button press duration calibration value
 unsigned long t1 = 0;
 unsigned long t2 = 0;
+TaskHandle_t loopTaskHandle = nullptr;
+
+// Ends the main loop's wait as soon as the power button changes, instead of on the next poll
+void IRAM_ATTR onPowerButtonChange() {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  if (loopTaskHandle) {
+    vTaskNotifyGiveFromISR(loopTaskHandle, &higherPriorityTaskWoken);
+  }
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+// Light sleep between button polls. The front buttons are read through the ADC and cannot wake the chip, so the timer
+// brings it back for the next poll. The power button wakes it straight away.
+void lightSleep(const uint32_t ms) {
+  const auto powerPin = static_cast<gpio_num_t>(InputManager::POWER_BUTTON_PIN);
+  esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(ms) * 1000);
+  gpio_wakeup_enable(powerPin, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_light_sleep_start();
+  // The wakeup level trigger replaced the edge interrupt, put it back
+  gpio_wakeup_disable(powerPin);
+  gpio_set_intr_type(powerPin, GPIO_INTR_ANYEDGE);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+}
 
 void exitActivity() {
   if (currentActivity) {
@@ -142,6 +89,8 @@ void exitActivity() {
 }
 
 void enterNewActivity(Activity* activity) {
+  // Presses queued for the previous activity must not leak into the new one
+  mappedInputManager.clearEvents();
   currentActivity = activity;
   currentActivity->onEnter();
 }
@@ -194,6 +143,9 @@ void waitForPowerRelease() {
 
 // Enter deep sleep mode
 void enterDeepSleep() {
+  if (currentActivity) {
+    currentActivity->onSleep();
+  }
   exitActivity();
   enterNewActivity(new SleepActivity(renderer, mappedInputManager));
 
@@ -239,21 +191,7 @@ void onGoHome() {
 void setupDisplayAndFonts() {
   einkDisplay.begin();
   Serial.printf("[%lu] [   ] Display initialized\n", millis());
-  renderer.insertFont(BOOKERLY_12_FONT_ID, bookerly12FontFamily);
-  renderer.insertFont(BOOKERLY_14_FONT_ID, bookerly14FontFamily);
-  renderer.insertFont(BOOKERLY_16_FONT_ID, bookerly16FontFamily);
-  renderer.insertFont(BOOKERLY_18_FONT_ID, bookerly18FontFamily);
-  renderer.insertFont(NOTOSANS_12_FONT_ID, notosans12FontFamily);
-  renderer.insertFont(NOTOSANS_14_FONT_ID, notosans14FontFamily);
-  renderer.insertFont(NOTOSANS_16_FONT_ID, notosans16FontFamily);
-  renderer.insertFont(NOTOSANS_18_FONT_ID, notosans18FontFamily);
-  renderer.insertFont(OPENDYSLEXIC_8_FONT_ID, opendyslexic8FontFamily);
-  renderer.insertFont(OPENDYSLEXIC_10_FONT_ID, opendyslexic10FontFamily);
-  renderer.insertFont(OPENDYSLEXIC_12_FONT_ID, opendyslexic12FontFamily);
-  renderer.insertFont(OPENDYSLEXIC_14_FONT_ID, opendyslexic14FontFamily);
-  renderer.insertFont(UI_10_FONT_ID, ui10FontFamily);
-  renderer.insertFont(UI_12_FONT_ID, ui12FontFamily);
-  renderer.insertFont(SMALL_FONT_ID, smallFontFamily);
+  insertBuiltinFonts(renderer);
   Serial.printf("[%lu] [   ] Fonts setup\n", millis());
 }
 
@@ -267,6 +205,8 @@ void setup() {
   }
 
   inputManager.begin();
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  attachInterrupt(InputManager::POWER_BUTTON_PIN, onPowerButtonChange, CHANGE);
   // Initialize pins
   pinMode(BAT_GPIO0, INPUT);
 
@@ -293,10 +233,15 @@ void setup() {
 
   setupDisplayAndFonts();
 
-  exitActivity();
-  enterNewActivity(new BootActivity(renderer, mappedInputManager));
-
+  // Waking up into an EPUB puts its last page back on screen straight away, the book loads behind it
   APP_STATE.loadFromFile();
+  const bool resumed = StringUtils::checkFileExtension(APP_STATE.openEpubPath, ".epub") &&
+                       ResumeSnapshot::show(renderer, APP_STATE.openEpubPath);
+  if (!resumed) {
+    exitActivity();
+    enterNewActivity(new BootActivity(renderer, mappedInputManager));
+  }
+
   if (APP_STATE.openEpubPath.empty()) {
     onGoHome();
   } else {
@@ -316,7 +261,7 @@ void loop() {
   const unsigned long loopStartTime = millis();
   static unsigned long lastMemPrint = 0;
 
-  inputManager.update();
+  mappedInputManager.update();
 
   if (Serial && millis() - lastMemPrint >= 10000) {
     Serial.printf("[%lu] [MEM] Free: %d bytes, Total: %d bytes, Min Free: %d bytes\n", millis(), ESP.getFreeHeap(),
@@ -361,12 +306,29 @@ void loop() {
     }
   }
 
-  // Add delay at the end of the loop to prevent tight spinning
-  // When an activity requests skip loop delay (e.g., webserver running), use yield() for faster response
-  // Otherwise, use longer delay to save power
-  if (currentActivity && currentActivity->skipLoopDelay()) {
-    yield();  // Give FreeRTOS a chance to run tasks, but return immediately
-  } else {
-    delay(10);  // Normal delay when no activity requires fast response
+  // Cache upkeep runs on this task between polls once the user pauses. Display tasks only draw when this task asks
+  // them to, so none can start touching the SD card during a step. Background tasks (chapter preindexing, cover
+  // prerendering, book transfers) run on their own, so upkeep also waits for the activity to report them done.
+  if (millis() - lastActivityTime >= CACHE_UPKEEP_IDLE_MS && !RenderSignal::anyBusy() &&
+      !(currentActivity && currentActivity->isSdBusy()) && CacheManager::hasWork()) {
+    CacheManager::idleStep();
+  }
+
+  // Wait for the next poll. Display tasks block on their own notifications, so once nothing is drawing and the
+  // buttons have been quiet for a while, the chip can light sleep between polls.
+  const bool canLightSleep = !RenderSignal::anyBusy() && !mappedInputManager.isAnyPressed() &&
+                             WiFi.getMode() == WIFI_OFF && digitalRead(UART0_RXD) == LOW;
+  const auto wait = LoopPacer::nextWait({millis() - lastActivityTime,
+                                         currentActivity && currentActivity->skipLoopDelay(), canLightSleep});
+  switch (wait.kind) {
+    case LoopPacer::WaitKind::Yield:
+      yield();  // Give FreeRTOS a chance to run tasks, but return immediately
+      break;
+    case LoopPacer::WaitKind::Block:
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait.ms));
+      break;
+    case LoopPacer::WaitKind::LightSleep:
+      lightSleep(wait.ms);
+      break;
   }
 }
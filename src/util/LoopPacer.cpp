@@ -0,0 +1,15 @@
+#include "LoopPacer.h"
+
+namespace LoopPacer {
+
+Wait nextWait(const LoopState& state) {
+  if (state.fastLoop) {
+    return {WaitKind::Yield, 0};
+  }
+  if (!state.canLightSleep || state.idleMs < LIGHT_SLEEP_AFTER_MS) {
+    return {WaitKind::Block, ACTIVE_POLL_MS};
+  }
+  return {WaitKind::LightSleep, IDLE_POLL_MS};
+}
+
+}  // namespace LoopPacer
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Decides how the main loop waits between iterations. Kept free of Arduino/FreeRTOS calls so it can be built and
+ * exercised on the host.
+ */
+namespace LoopPacer {
+
+enum class WaitKind : uint8_t {
+  Yield,       // Return to the loop right away (e.g. a web server is running)
+  Block,       // Block the main task for up to `ms`, a power button interrupt ends the wait early
+  LightSleep,  // Light sleep for up to `ms`, the power button or the timer wakes the chip
+};
+
+struct Wait {
+  WaitKind kind;
+  uint32_t ms;
+};
+
+struct LoopState {
+  unsigned long idleMs;  // Time since the last button change or requested keep-awake
+  bool fastLoop;         // The activity asked to skip the loop delay
+  bool canLightSleep;    // Nothing is drawing, no button is down, WiFi and USB are off
+};
+
+// Button polls right after input, and the delay the loop used before. The front buttons sit on an ADC ladder, so
+// they cannot raise an interrupt and have to be polled: their input latency is the same as before, only the power
+// button wakes the loop early.
+constexpr uint32_t ACTIVE_POLL_MS = 10;
+// With no input for this long, the device light sleeps between polls instead of idling awake
+constexpr unsigned long LIGHT_SLEEP_AFTER_MS = 3000;
+// Poll interval while light sleeping. A button press lasts far longer, so none is missed.
+constexpr uint32_t IDLE_POLL_MS = 30;
+
+Wait nextWait(const LoopState& state);
+
+}  // namespace LoopPacer
@@ -1,5 +1,6 @@
 #include "StringUtils.h"
 
+#include <cctype>
 #include <cstring>
 
 namespace StringUtils {
@@ -49,4 +50,30 @@ bool checkFileExtension(const std::string& fileName, const char* extension) {
   return true;
 }
 
+std::string naturalSortKey(const std::string& name) {
+  std::string key;
+  key.reserve(name.length() + 4);
+  size_t i = 0;
+  while (i < name.length()) {
+    const char c = name[i];
+    if (!isdigit(static_cast<unsigned char>(c))) {
+      key += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+      i++;
+      continue;
+    }
+
+    // Digit run: drop leading zeros, then prefix the length so shorter numbers sort first. The prefix is itself
+    // digits, which keeps numbers ordered against the surrounding characters the same way a plain digit would. A
+    // length of 9 or more is a '9' for every 9 digits followed by the rest, so that longer always sorts after shorter.
+    size_t start = i;
+    while (i < name.length() && isdigit(static_cast<unsigned char>(name[i]))) i++;
+    while (start + 1 < i && name[start] == '0') start++;
+    const size_t length = i - start;
+    key.append(length / 9, '9');
+    key += static_cast<char>('0' + length % 9);
+    key.append(name, start, length);
+  }
+  return key;
+}
+
 }  // namespace StringUtils
@@ -16,4 +16,11 @@ std::string sanitizeFilename(const std::string& name, size_t maxLength = 100);
  */
 bool checkFileExtension(const std::string& fileName, const char* extension);
 
+/**
+ * Build a key whose byte order is the natural order of the names: ASCII letters are folded to lower case and every
+ * run of digits compares by its numeric value ("2" < "10"), so sorting by key gives "Vol 2" before "Vol 10".
+ * Leading zeros are ignored, "007" sorts as "7".
+ */
+std::string naturalSortKey(const std::string& name);
+
 }  // namespace StringUtils
@@ -0,0 +1,199 @@
+// Interrupts the book.bin build of a generated EPUB right after each build.journal write, the way a reset or power loss
+// would, by ending a child process on the spot. Resuming must skip the passes the journal records and give a book.bin
+// identical to a clean build. Prints the time each resume saves. A build with too little heap for the href hashes must
+// give the same book.bin by sorting them on the card.
+#include <Arduino.h>
+#include <Epub.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char BOOK_PATH[] = "/book.epub";
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char JOURNAL_NAME[] = "/build.journal";
+// Enough chapters and TOC entries for the passes to take measurable time
+constexpr int CHAPTERS = 500;
+// Journal writes of a clean build: after the content.opf pass and after the TOC pass
+constexpr int JOURNAL_SAVES = 2;
+
+bool endsWith(const std::string& text, const char* suffix) {
+  const size_t length = strlen(suffix);
+  return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+bool addFile(mz_zip_archive& zip, const char* name, const std::string& content) {
+  return mz_zip_writer_add_mem(&zip, name, content.data(), content.size(), MZ_DEFAULT_COMPRESSION);
+}
+
+std::string chapterName(const int i) { return "chapter" + std::to_string(i) + ".xhtml"; }
+
+bool writeEpub(const std::string& hostPath) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+
+  std::string manifest;
+  std::string spine;
+  std::string navPoints;
+  std::string navItems;
+  bool ok = mz_zip_writer_add_mem(&zip, "mimetype", "application/epub+zip", 20, MZ_NO_COMPRESSION) &&
+            addFile(zip, "META-INF/container.xml",
+                    "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                    "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                    "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                    "</container>");
+  for (int i = 0; ok && i < CHAPTERS; i++) {
+    const std::string id = "c" + std::to_string(i);
+    const std::string name = chapterName(i);
+    manifest += "<item id=\"" + id + "\" href=\"text/" + name + "\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    navPoints += "<navPoint id=\"n" + std::to_string(i) + "\"><navLabel><text>Chapter " + std::to_string(i) +
+                 "</text></navLabel><content src=\"text/" + name + "\"/></navPoint>";
+    navItems += "<li><a href=\"text/" + name + "\">Chapter " + std::to_string(i) + "</a></li>";
+    ok = addFile(zip, ("OEBPS/text/" + name).c_str(),
+                 "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body><h1>Chapter " + std::to_string(i) +
+                     "</h1><p>Some text.</p></body></html>");
+  }
+  ok = ok &&
+       addFile(zip, "OEBPS/content.opf",
+               "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"3.0\"><metadata "
+               "xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Resume</dc:title><dc:creator>Host Test"
+               "</dc:creator></metadata><manifest><item id=\"ncx\" href=\"toc.ncx\" "
+               "media-type=\"application/x-dtbncx+xml\"/><item id=\"nav\" href=\"nav.xhtml\" "
+               "media-type=\"application/xhtml+xml\" properties=\"nav\"/>" +
+                   manifest + "</manifest><spine toc=\"ncx\">" + spine + "</spine></package>") &&
+       addFile(zip, "OEBPS/toc.ncx",
+               "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\"><navMap>" + navPoints +
+                   "</navMap></ncx>") &&
+       addFile(zip, "OEBPS/nav.xhtml",
+               "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\"><body>"
+               "<nav epub:type=\"toc\"><ol>" +
+                   navItems + "</ol></nav></body></html>");
+
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  return mz_zip_writer_end(&zip) && ok;
+}
+
+std::string readCard(const std::string& path) {
+  std::string data;
+  FsFile file;
+  if (SdMan.openFileForRead("TST", path, file)) {
+    data.resize(file.size());
+    file.read(&data[0], data.size());
+    file.close();
+  }
+  return data;
+}
+
+struct Build {
+  bool loaded = false;
+  std::string bookBin;
+  int journalSaves = 0;
+  double ms = 0;
+};
+
+Build build() {
+  Build result;
+  FsFile::onSync = [&result](const std::string& hostPath) {
+    if (endsWith(hostPath, JOURNAL_NAME)) {
+      result.journalSaves++;
+    }
+  };
+  const auto start = std::chrono::steady_clock::now();
+  Epub epub(BOOK_PATH, CACHE_DIR);
+  result.loaded = epub.load();
+  result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  FsFile::onSync = nullptr;
+  result.bookBin = readCard(epub.getCachePath() + "/book.bin");
+  CHECK(!SdMan.exists((epub.getCachePath() + JOURNAL_NAME).c_str()));
+  return result;
+}
+
+// Builds in a child process that ends the moment the given journal write reaches the card. Returns the cache dir.
+std::string interruptedBuild(const int journalSave) {
+  fflush(stdout);
+  fflush(stderr);
+  const pid_t pid = fork();
+  if (pid == 0) {
+    int saves = 0;
+    FsFile::onSync = [&saves, journalSave](const std::string& hostPath) {
+      if (endsWith(hostPath, JOURNAL_NAME) && ++saves == journalSave) {
+        _exit(0);
+      }
+    };
+    Epub(BOOK_PATH, CACHE_DIR).load();
+    _exit(1);
+  }
+  int status = 0;
+  CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  Epub epub(BOOK_PATH, CACHE_DIR);
+  return epub.getCachePath();
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/BookBinResumeTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  if (!writeEpub(SdMan.hostPath(BOOK_PATH))) {
+    fprintf(stderr, "Could not write the test EPUB\n");
+    return 1;
+  }
+
+  const Build clean = build();
+  CHECK(clean.loaded);
+  CHECK(!clean.bookBin.empty());
+  CHECK(clean.journalSaves == JOURNAL_SAVES);
+  printf("Clean build: %.0f ms\n", clean.ms);
+
+  const uint32_t maxAllocHeap = ESP.maxAllocHeap;
+  ESP.maxAllocHeap = 8 * 1024;
+  fs::remove_all(SdMan.hostPath(CACHE_DIR));
+  const Build lowMemory = build();
+  ESP.maxAllocHeap = maxAllocHeap;
+  CHECK(lowMemory.loaded);
+  CHECK(lowMemory.bookBin == clean.bookBin);
+  printf("Low memory build: %.0f ms\n", lowMemory.ms);
+
+  const char* passes[] = {"content.opf pass", "content.opf and TOC passes"};
+  for (int journalSave = 1; journalSave <= JOURNAL_SAVES; journalSave++) {
+    fs::remove_all(SdMan.hostPath(CACHE_DIR));
+    const std::string cachePath = interruptedBuild(journalSave);
+    CHECK(SdMan.exists((cachePath + JOURNAL_NAME).c_str()));
+    CHECK(!SdMan.exists((cachePath + "/book.bin").c_str()));
+
+    const Build resumed = build();
+    CHECK(resumed.loaded);
+    // Only the passes after the interruption ran, and saved their journal
+    CHECK(resumed.journalSaves == JOURNAL_SAVES - journalSave);
+    if (resumed.bookBin != clean.bookBin) {
+      fprintf(stderr, "Resumed after the %s: book.bin differs from a clean build\n", passes[journalSave - 1]);
+      CHECK(false);
+    }
+    printf("Resumed after the %s: %.0f ms, %.0f ms saved\n", passes[journalSave - 1], resumed.ms,
+           clean.ms - resumed.ms);
+  }
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,365 @@
+// Builds the caches of a generated EPUB with the firmware code and reads book.bin and the section files back by hand,
+// following the layouts in docs/file-formats.md: version bytes, header fields, lookup tables pointing at the entries
+// they index, the href index, and the layout settings a section is stored with. A section must not load with other
+// settings.
+#include <BuiltinFonts.h>
+#include <EInkDisplay.h>
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "fontIds.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char BOOK_PATH[] = "/book.epub";
+constexpr char CACHE_DIR[] = "/.crosspoint";
+// Versions the device expects, see docs/file-formats.md
+constexpr uint8_t BOOK_CACHE_VERSION = 4;
+constexpr uint8_t SECTION_FILE_VERSION = 10;
+constexpr uint32_t SECTION_HEADER_SIZE = 1 + 4 + 4 + 1 + 1 + 2 + 2 + 2 + 4;
+constexpr uint8_t PAGE_ELEMENT_LINE = 1;
+
+// Layout settings of the sections, not the defaults so that a mix-up shows
+constexpr int FONT_ID = NOTOSANS_14_FONT_ID;
+constexpr float LINE_COMPRESSION = 0.95f;
+constexpr bool EXTRA_PARAGRAPH_SPACING = false;
+constexpr uint8_t PARAGRAPH_ALIGNMENT = 2;
+constexpr uint16_t VIEWPORT_WIDTH = 440;
+constexpr uint16_t VIEWPORT_HEIGHT = 740;
+
+struct Chapter {
+  const char* name;
+  const char* title;  // nullptr if not in the TOC
+  int paragraphs;
+};
+
+// The second chapter spans several pages, the third has no TOC entry, the last one has two
+const Chapter CHAPTERS[] = {
+    {"one.xhtml", "One", 1},
+    {"two.xhtml", "Two", 60},
+    {"untitled.xhtml", nullptr, 2},
+    {"four.xhtml", "Four", 3},
+};
+constexpr int SPINE_COUNT = sizeof(CHAPTERS) / sizeof(CHAPTERS[0]);
+constexpr int TOC_COUNT = 4;
+
+bool addFile(mz_zip_archive& zip, const char* name, const std::string& content) {
+  return mz_zip_writer_add_mem(&zip, name, content.data(), content.size(), MZ_DEFAULT_COMPRESSION);
+}
+
+bool writeEpub(const std::string& hostPath) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+
+  std::string manifest;
+  std::string spine;
+  std::string navPoints;
+  bool ok = mz_zip_writer_add_mem(&zip, "mimetype", "application/epub+zip", 20, MZ_NO_COMPRESSION) &&
+            addFile(zip, "META-INF/container.xml",
+                    "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                    "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                    "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                    "</container>");
+  for (int i = 0; ok && i < SPINE_COUNT; i++) {
+    const Chapter& chapter = CHAPTERS[i];
+    const std::string id = "c" + std::to_string(i);
+    manifest += "<item id=\"" + id + "\" href=\"text/" + chapter.name + "\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    if (chapter.title) {
+      navPoints += "<navPoint id=\"n" + id + "\"><navLabel><text>" + chapter.title +
+                   "</text></navLabel><content src=\"text/" + chapter.name + "\"/>";
+      // A nested entry pointing into the middle of the last chapter
+      if (i == SPINE_COUNT - 1) {
+        navPoints += "<navPoint id=\"n" + id + "b\"><navLabel><text>Four, part two</text></navLabel>" +
+                     "<content src=\"text/" + chapter.name + "#part2\"/></navPoint>";
+      }
+      navPoints += "</navPoint>";
+    }
+    std::string body = "<h1>" + std::string(chapter.title ? chapter.title : "Interlude") + "</h1>";
+    for (int p = 0; p < chapter.paragraphs; p++) {
+      body += std::string(p == 1 ? "<p id=\"part2\">" : "<p>") +
+              "Some <b>bold</b> and <i>italic</i> text that wraps over a few lines of the page, paragraph " +
+              std::to_string(p) + ".</p>";
+    }
+    ok = addFile(zip, ("OEBPS/text/" + std::string(chapter.name)).c_str(),
+                 "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body>" + body + "</body></html>");
+  }
+  ok = ok &&
+       addFile(zip, "OEBPS/content.opf",
+               "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\"><metadata "
+               "xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Formats</dc:title><dc:creator>Host Test"
+               "</dc:creator></metadata><manifest><item id=\"ncx\" href=\"toc.ncx\" "
+               "media-type=\"application/x-dtbncx+xml\"/>" +
+                   manifest + "</manifest><spine toc=\"ncx\">" + spine + "</spine></package>") &&
+       addFile(zip, "OEBPS/toc.ncx",
+               "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\"><navMap>" + navPoints +
+                   "</navMap></ncx>");
+
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  return mz_zip_writer_end(&zip) && ok;
+}
+
+std::string readCard(const std::string& path) {
+  std::string data;
+  FsFile file;
+  if (SdMan.openFileForRead("TST", path, file)) {
+    data.resize(file.size());
+    file.read(&data[0], data.size());
+    file.close();
+  }
+  return data;
+}
+
+// Little-endian reads from a file held in memory. A read past the end sets failed and gives zeros.
+struct Reader {
+  const std::string& data;
+  size_t position = 0;
+  bool failed = false;
+
+  template <typename T>
+  T pod() {
+    T value{};
+    if (position + sizeof(T) > data.size()) {
+      failed = true;
+      return value;
+    }
+    memcpy(&value, data.data() + position, sizeof(T));
+    position += sizeof(T);
+    return value;
+  }
+
+  std::string string() {
+    const uint32_t length = pod<uint32_t>();
+    if (position + length > data.size()) {
+      failed = true;
+      return {};
+    }
+    position += length;
+    return data.substr(position - length, length);
+  }
+};
+
+// Same hash as BookMetadataCache: 32-bit FNV-1a of the href without any #fragment
+uint32_t hrefHash(const std::string& href) {
+  uint32_t hash = 2166136261u;
+  for (const char c : href) {
+    if (c == '#') break;
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+struct SpineEntry {
+  std::string href;
+  uint32_t cumulativeSize;
+  int16_t tocIndex;
+};
+
+struct TocEntry {
+  std::string title;
+  std::string href;
+  std::string anchor;
+  uint8_t level;
+  int16_t spineIndex;
+};
+
+void checkBookBin(const std::string& data) {
+  Reader reader{data};
+  CHECK(reader.pod<uint8_t>() == BOOK_CACHE_VERSION);
+  const uint32_t lutOffset = reader.pod<uint32_t>();
+  const uint16_t spineCount = reader.pod<uint16_t>();
+  const uint16_t tocCount = reader.pod<uint16_t>();
+  CHECK(spineCount == SPINE_COUNT);
+  CHECK(tocCount == TOC_COUNT);
+
+  CHECK(reader.string() == "Formats");
+  CHECK(reader.string() == "Host Test");
+  reader.string();  // Cover
+  reader.string();  // Text reference
+  // The lookup tables start right after the metadata
+  CHECK(reader.position == lutOffset);
+
+  std::vector<uint32_t> spineLut, tocLut;
+  for (int i = 0; i < spineCount; i++) spineLut.push_back(reader.pod<uint32_t>());
+  for (int i = 0; i < tocCount; i++) tocLut.push_back(reader.pod<uint32_t>());
+  std::vector<std::pair<uint32_t, uint16_t>> hrefIndex;
+  for (int i = 0; i < spineCount; i++) {
+    const uint32_t hash = reader.pod<uint32_t>();
+    hrefIndex.emplace_back(hash, reader.pod<uint16_t>());
+  }
+
+  // Entries follow in order, each where its lookup table slot points
+  std::vector<SpineEntry> spine;
+  for (int i = 0; i < spineCount; i++) {
+    CHECK(reader.position == spineLut[i]);
+    const std::string href = reader.string();
+    const uint32_t cumulativeSize = reader.pod<uint32_t>();
+    spine.push_back({href, cumulativeSize, reader.pod<int16_t>()});
+  }
+  std::vector<TocEntry> toc;
+  for (int i = 0; i < tocCount; i++) {
+    CHECK(reader.position == tocLut[i]);
+    TocEntry entry;
+    entry.title = reader.string();
+    entry.href = reader.string();
+    entry.anchor = reader.string();
+    entry.level = reader.pod<uint8_t>();
+    entry.spineIndex = reader.pod<int16_t>();
+    toc.push_back(entry);
+  }
+  CHECK(!reader.failed);
+  CHECK(reader.position == data.size());
+
+  // The first TOC entry of each chapter, or the one before for a chapter without any
+  const int16_t spineTocIndexes[SPINE_COUNT] = {0, 1, 1, 2};
+  uint32_t previousSize = 0;
+  for (int i = 0; i < spineCount; i++) {
+    CHECK(spine[i].href == "OEBPS/text/" + std::string(CHAPTERS[i].name));
+    CHECK(spine[i].cumulativeSize > previousSize);
+    previousSize = spine[i].cumulativeSize;
+    CHECK(spine[i].tocIndex == spineTocIndexes[i]);
+  }
+
+  const char* titles[TOC_COUNT] = {"One", "Two", "Four", "Four, part two"};
+  const int16_t spineIndexes[TOC_COUNT] = {0, 1, 3, 3};
+  const uint8_t levels[TOC_COUNT] = {1, 1, 1, 2};
+  for (int i = 0; i < tocCount; i++) {
+    CHECK(toc[i].title == titles[i]);
+    CHECK(toc[i].spineIndex == spineIndexes[i]);
+    CHECK(toc[i].level == levels[i]);
+    CHECK(toc[i].href == spine[toc[i].spineIndex].href);
+  }
+  CHECK(toc[3].anchor == "part2");
+
+  // Sorted by hash, one record per spine entry, each with the hash of its entry's href
+  std::vector<bool> indexed(spineCount, false);
+  for (int i = 0; i < spineCount; i++) {
+    if (i > 0) CHECK(hrefIndex[i - 1].first <= hrefIndex[i].first);
+    const uint16_t spineIndex = hrefIndex[i].second;
+    CHECK(spineIndex < spineCount && !indexed[spineIndex]);
+    if (spineIndex >= spineCount) continue;
+    indexed[spineIndex] = true;
+    CHECK(hrefIndex[i].first == hrefHash(spine[spineIndex].href));
+  }
+}
+
+// Returns the page count stored in the header
+uint16_t checkSectionFile(const std::string& data) {
+  Reader reader{data};
+  CHECK(reader.pod<uint8_t>() == SECTION_FILE_VERSION);
+  CHECK(reader.pod<int32_t>() == FONT_ID);
+  CHECK(reader.pod<float>() == LINE_COMPRESSION);
+  CHECK(reader.pod<bool>() == EXTRA_PARAGRAPH_SPACING);
+  CHECK(reader.pod<uint8_t>() == PARAGRAPH_ALIGNMENT);
+  CHECK(reader.pod<uint16_t>() == VIEWPORT_WIDTH);
+  CHECK(reader.pod<uint16_t>() == VIEWPORT_HEIGHT);
+  const uint16_t pageCount = reader.pod<uint16_t>();
+  const uint32_t lutOffset = reader.pod<uint32_t>();
+  CHECK(reader.position == SECTION_HEADER_SIZE);
+  CHECK(pageCount > 0);
+
+  // Pages follow the header back to back, then the lookup table of their offsets ends the file
+  std::vector<uint32_t> pageOffsets;
+  for (int page = 0; page < pageCount; page++) {
+    pageOffsets.push_back(static_cast<uint32_t>(reader.position));
+    const uint16_t elementCount = reader.pod<uint16_t>();
+    for (int element = 0; element < elementCount && !reader.failed; element++) {
+      CHECK(reader.pod<uint8_t>() == PAGE_ELEMENT_LINE);
+      reader.pod<int16_t>();  // x
+      const int16_t y = reader.pod<int16_t>();
+      CHECK(y >= 0 && y < VIEWPORT_HEIGHT);
+      const uint16_t wordCount = reader.pod<uint16_t>();
+      for (int word = 0; word < wordCount; word++) reader.string();
+      for (int word = 0; word < wordCount; word++) CHECK(reader.pod<uint16_t>() < VIEWPORT_WIDTH);
+      for (int word = 0; word < wordCount; word++) CHECK(reader.pod<uint8_t>() <= 3);
+      CHECK(reader.pod<uint8_t>() <= 3);  // Block style
+    }
+  }
+  CHECK(reader.position == lutOffset);
+  for (int page = 0; page < pageCount; page++) {
+    CHECK(reader.pod<uint32_t>() == pageOffsets[page]);
+  }
+  CHECK(!reader.failed);
+  CHECK(reader.position == data.size());
+  return pageCount;
+}
+
+void checkSections(const std::shared_ptr<Epub>& epub, GfxRenderer& renderer) {
+  for (int i = 0; i < SPINE_COUNT; i++) {
+    Section section(epub, i, renderer);
+    CHECK(section.createSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                                    VIEWPORT_WIDTH, VIEWPORT_HEIGHT));
+    const std::string data = readCard(epub->getCachePath() + "/sections/" + std::to_string(i) + ".bin");
+    const uint16_t pageCount = checkSectionFile(data);
+    CHECK(pageCount == section.pageCount);
+    if (CHAPTERS[i].paragraphs > 10) CHECK(pageCount > 1);
+
+    // Loads with the settings it was built for and with no others
+    CHECK(Section(epub, i, renderer)
+              .loadSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                               VIEWPORT_WIDTH, VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(BOOKERLY_14_FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                                VIEWPORT_WIDTH, VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(FONT_ID, 1.0f, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT, VIEWPORT_WIDTH,
+                                VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(FONT_ID, LINE_COMPRESSION, !EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                                VIEWPORT_WIDTH, VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, 0, VIEWPORT_WIDTH,
+                                VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                                VIEWPORT_WIDTH - 1, VIEWPORT_HEIGHT));
+    CHECK(!Section(epub, i, renderer)
+               .loadSectionFile(FONT_ID, LINE_COMPRESSION, EXTRA_PARAGRAPH_SPACING, PARAGRAPH_ALIGNMENT,
+                                VIEWPORT_WIDTH, VIEWPORT_HEIGHT - 1));
+  }
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/CacheFormatTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  SdMan.mkdir(CACHE_DIR);
+  if (!writeEpub(SdMan.hostPath(BOOK_PATH))) {
+    fprintf(stderr, "Could not write the test EPUB\n");
+    return 1;
+  }
+
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  insertBuiltinFonts(renderer);
+
+  auto epub = std::make_shared<Epub>(BOOK_PATH, CACHE_DIR);
+  CHECK(epub->load());
+  epub->setupCacheDir();
+  checkBookBin(readCard(epub->getCachePath() + "/book.bin"));
+  checkSections(epub, renderer);
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,286 @@
+// Runs CacheManager's idle steps over a simulated card: a temporary host directory with book caches made of sparse
+// files, so that budgets of tens of MB cost no disk space. One boot, in order: eviction takes sections before books and
+// least recently used first, the open book is never touched, a budget change starts a new pass, a truncated
+// cache.bin is rebuilt from the directories on the card, and evicted books keep their reading position.
+#include <SDCardManager.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "CacheManager.h"
+#include "CrossPointSettings.h"
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint64_t MB = 1024 * 1024;
+constexpr char CACHE_DIR[] = "/.crosspoint";
+// cache.bin layout, see docs/file-formats.md
+constexpr size_t INDEX_HEADER_SIZE = 12;
+constexpr size_t INDEX_RECORD_SIZE = 32;
+
+std::string cachePath(const std::string& dir) { return std::string(CACHE_DIR) + "/" + dir; }
+
+std::string sectionPath(const std::string& dir, const int spineIndex) {
+  return cachePath(dir) + "/sections/" + std::to_string(spineIndex) + ".bin";
+}
+
+void makeFile(const std::string& path, const uint64_t size) {
+  const fs::path hostPath = SdMan.hostPath(path);
+  fs::create_directories(hostPath.parent_path());
+  FsFile::openHost(hostPath, O_WRONLY | O_CREAT | O_TRUNC).close();
+  fs::resize_file(hostPath, size);
+}
+
+// A book cache as the reader leaves it: book.bin and the given number of sections
+void makeBook(const std::string& dir, const uint64_t bookBytes, const int sections, const uint64_t sectionBytes) {
+  makeFile(cachePath(dir) + "/book.bin", bookBytes);
+  for (int i = 0; i < sections; i++) {
+    makeFile(sectionPath(dir, i), sectionBytes);
+  }
+}
+
+bool exists(const std::string& path) { return SdMan.exists(path.c_str()); }
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(SdMan.hostPath(path), std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+// Names of the files and directories in a book cache directory, sorted
+std::vector<std::string> listDir(const std::string& dir) {
+  std::vector<std::string> names;
+  for (const auto& entry : fs::directory_iterator(SdMan.hostPath(cachePath(dir)))) {
+    names.push_back(entry.path().filename().string());
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+// Total size of the files in the book cache directories, the way CacheManager counts it
+uint64_t cachedBytes() {
+  uint64_t total = 0;
+  for (const auto& entry : fs::recursive_directory_iterator(SdMan.hostPath(CACHE_DIR))) {
+    if (entry.is_regular_file() && entry.path().parent_path() != SdMan.hostPath(CACHE_DIR)) {
+      total += entry.file_size();
+    }
+  }
+  return total;
+}
+
+// Every file removed by one idle step, in the order of the steps
+std::vector<std::string> runIdle(const std::vector<std::string>& watched) {
+  std::vector<std::string> removed;
+  for (int step = 0; step < 1000 && CacheManager::hasWork(); step++) {
+    CacheManager::idleStep();
+    for (const auto& path : watched) {
+      if (!exists(path) && std::find(removed.begin(), removed.end(), path) == removed.end()) {
+        removed.push_back(path);
+      }
+    }
+  }
+  CHECK(!CacheManager::hasWork());
+  return removed;
+}
+
+std::vector<std::string> indexedDirs() {
+  std::vector<std::string> dirs;
+  FsFile index;
+  if (!SdMan.openFileForRead("TST", std::string(CACHE_DIR) + "/cache.bin", index)) {
+    return dirs;
+  }
+  index.seek(INDEX_HEADER_SIZE);
+  char record[INDEX_RECORD_SIZE];
+  while (index.read(record, sizeof(record)) == sizeof(record)) {
+    dirs.emplace_back(record);
+  }
+  index.close();
+  return dirs;
+}
+
+void setBudget(const CrossPointSettings::CACHE_BUDGET budget) { SETTINGS.cacheBudget = budget; }
+
+// A, B and C hold 30 MB each and the limit is 64 MB. C is open. A's four sections go first, never-shown section 1
+// ahead of the others in order of last use, then B's least recently used section.
+void testSectionsFirstInLruOrder() {
+  makeBook("epub_1", 6 * MB, 4, 6 * MB);
+  makeBook("epub_2", 6 * MB, 4, 6 * MB);
+  makeBook("xtc_3", 6 * MB, 4, 6 * MB);
+  setBudget(CrossPointSettings::CACHE_64_MB);
+
+  CacheManager::bookOpened(cachePath("epub_1"));
+  CacheManager::sectionUsed(cachePath("epub_1"), 2);
+  CacheManager::sectionUsed(cachePath("epub_1"), 0);
+  CacheManager::sectionUsed(cachePath("epub_1"), 3);
+  CacheManager::bookClosed(cachePath("epub_1"));
+  CacheManager::bookOpened(cachePath("epub_2"));
+  CacheManager::sectionUsed(cachePath("epub_2"), 3);
+  CacheManager::sectionUsed(cachePath("epub_2"), 1);
+  CacheManager::sectionUsed(cachePath("epub_2"), 0);
+  CacheManager::sectionUsed(cachePath("epub_2"), 2);
+  CacheManager::bookClosed(cachePath("epub_2"));
+  CacheManager::bookOpened(cachePath("xtc_3"));
+
+  std::vector<std::string> watched;
+  for (const auto* dir : {"epub_1", "epub_2", "xtc_3"}) {
+    watched.push_back(cachePath(dir) + "/book.bin");
+    for (int i = 0; i < 4; i++) {
+      watched.push_back(sectionPath(dir, i));
+    }
+  }
+  const auto removed = runIdle(watched);
+  const std::vector<std::string> expected = {sectionPath("epub_1", 1), sectionPath("epub_1", 2),
+                                             sectionPath("epub_1", 0), sectionPath("epub_1", 3),
+                                             sectionPath("epub_2", 3)};
+  CHECK(removed == expected);
+  CHECK(cachedBytes() <= 64 * MB);
+}
+
+// The open book grows past the limit on its own: every other book goes, least recently opened first, and the open
+// one is left whole even though the caches stay over the limit
+void testOpenBookNeverEvicted() {
+  for (int i = 4; i < 16; i++) {
+    makeFile(sectionPath("xtc_3", i), 6 * MB);
+  }
+  // Reopened, so that its new sections are measured
+  CacheManager::bookClosed(cachePath("xtc_3"));
+  CacheManager::bookOpened(cachePath("xtc_3"));
+
+  std::vector<std::string> watched = {cachePath("epub_1"), cachePath("epub_2"), cachePath("xtc_3") + "/book.bin"};
+  for (int i = 0; i < 16; i++) {
+    watched.push_back(sectionPath("xtc_3", i));
+  }
+  const auto removed = runIdle(watched);
+  const std::vector<std::string> expected = {cachePath("epub_1"), cachePath("epub_2")};
+  CHECK(removed == expected);
+  CHECK(cachedBytes() == 6 * MB + 16 * 6 * MB);
+  CHECK(indexedDirs() == std::vector<std::string>{"xtc_3"});
+}
+
+// Nothing else changes: raising the limit only needs a check, lowering it again evicts the now closed book
+void testBudgetChangeTriggersWork() {
+  CacheManager::bookClosed(cachePath("xtc_3"));
+  setBudget(CrossPointSettings::CACHE_1_GB);
+  CHECK(CacheManager::hasWork());
+  CHECK(runIdle({cachePath("xtc_3") + "/book.bin"}).empty());
+
+  setBudget(CrossPointSettings::CACHE_256_MB);
+  CHECK(CacheManager::hasWork());
+  CHECK(runIdle({cachePath("xtc_3") + "/book.bin"}).empty());
+
+  setBudget(CrossPointSettings::CACHE_64_MB);
+  CHECK(CacheManager::hasWork());
+  runIdle({});
+  CHECK(cachedBytes() <= 64 * MB);
+  CHECK(exists(cachePath("xtc_3") + "/book.bin"));
+}
+
+// cache.bin cut short by a power loss: the books it lost track of are found again on the card and still evicted
+void testTruncatedIndex(const size_t truncatedSize) {
+  fs::remove_all(SdMan.hostPath(CACHE_DIR));
+  makeBook("epub_4", 30 * MB, 0, 0);
+  makeBook("epub_5", 30 * MB, 0, 0);
+  makeBook("epub_6", 30 * MB, 0, 0);
+  setBudget(CrossPointSettings::CACHE_1_GB);
+  CacheManager::bookOpened(cachePath("epub_4"));
+  CacheManager::bookClosed(cachePath("epub_4"));
+  CacheManager::bookOpened(cachePath("epub_5"));
+  CacheManager::bookClosed(cachePath("epub_5"));
+  CacheManager::bookOpened(cachePath("epub_6"));
+  runIdle({});
+  CHECK(indexedDirs().size() == 3);
+
+  fs::resize_file(SdMan.hostPath(std::string(CACHE_DIR) + "/cache.bin"), truncatedSize);
+  makeBook("epub_7", 30 * MB, 0, 0);
+  CacheManager::bookClosed(cachePath("epub_6"));
+  CacheManager::bookOpened(cachePath("epub_7"));
+  setBudget(CrossPointSettings::CACHE_64_MB);
+  runIdle({});
+
+  auto dirs = indexedDirs();
+  std::sort(dirs.begin(), dirs.end());
+  CHECK(cachedBytes() <= 64 * MB);
+  CHECK(exists(cachePath("epub_7")));
+  CHECK(dirs.size() == 2 && dirs.back() == "epub_7");
+  CacheManager::bookClosed(cachePath("epub_7"));
+}
+// A read book evicted for space keeps progress.bin while book.bin, its sections, the cover and the resume snapshot go.
+// It is not evicted again until it has been opened, and a book that was never read loses its whole directory.
+void testProgressSurvivesEviction() {
+  fs::remove_all(SdMan.hostPath(CACHE_DIR));
+  const std::string progressPath = cachePath("epub_8") + "/progress.bin";
+  const std::string progress = "\x03\x00\x2a\x00";
+  makeBook("epub_8", 30 * MB, 2, 6 * MB);
+  makeFile(cachePath("epub_8") + "/cover.bmp", MB);
+  makeFile(cachePath("epub_8") + "/resume.bin", MB);
+  std::ofstream(SdMan.hostPath(progressPath), std::ios::binary) << progress;
+  makeBook("epub_9", 30 * MB, 0, 0);
+  makeBook("xtc_10", 50 * MB, 0, 0);
+  setBudget(CrossPointSettings::CACHE_1_GB);
+  CacheManager::bookOpened(cachePath("epub_8"));
+  CacheManager::bookClosed(cachePath("epub_8"));
+  CacheManager::bookOpened(cachePath("epub_9"));
+  CacheManager::bookClosed(cachePath("epub_9"));
+  CacheManager::bookOpened(cachePath("xtc_10"));
+  runIdle({});
+
+  setBudget(CrossPointSettings::CACHE_64_MB);
+  runIdle({});
+  CHECK(listDir("epub_8") == std::vector<std::string>{"progress.bin"});
+  CHECK(readFile(progressPath) == progress);
+  CHECK(!exists(cachePath("epub_9")));
+  CHECK(exists(cachePath("xtc_10") + "/book.bin"));
+  auto dirs = indexedDirs();
+  std::sort(dirs.begin(), dirs.end());
+  CHECK((dirs == std::vector<std::string>{"epub_8", "xtc_10"}));
+
+  // The open book grows past the limit: only a reading position is left to take, so the pass ends
+  for (int i = 0; i < 4; i++) {
+    makeFile(sectionPath("xtc_10", i), 6 * MB);
+  }
+  CacheManager::bookClosed(cachePath("xtc_10"));
+  CacheManager::bookOpened(cachePath("xtc_10"));
+  runIdle({});
+  CHECK(readFile(progressPath) == progress);
+  CHECK(exists(sectionPath("xtc_10", 3)));
+
+  // Opened again, the reader rebuilds book.bin, which can then be evicted again
+  CacheManager::bookClosed(cachePath("xtc_10"));
+  CacheManager::bookOpened(cachePath("epub_8"));
+  makeBook("epub_8", 10 * MB, 1, MB);
+  CacheManager::bookClosed(cachePath("epub_8"));
+  CacheManager::bookOpened(cachePath("xtc_10"));
+  runIdle({});
+  CHECK(listDir("epub_8") == std::vector<std::string>{"progress.bin"});
+  CHECK(readFile(progressPath) == progress);
+  CacheManager::bookClosed(cachePath("xtc_10"));
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/CacheManagerTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  fs::create_directories(SdMan.hostPath(CACHE_DIR));
+
+  testSectionsFirstInLruOrder();
+  testOpenBookNeverEvicted();
+  testBudgetChangeTriggersWork();
+  // Inside the header, and part way into the second record
+  testTruncatedIndex(5);
+  testTruncatedIndex(INDEX_HEADER_SIZE + INDEX_RECORD_SIZE + INDEX_RECORD_SIZE / 2);
+  testProgressSurvivesEviction();
+
+  fs::remove_all(root);
+  return testResult();
+}
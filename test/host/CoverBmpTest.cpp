@@ -0,0 +1,180 @@
+// Converts the 2000x2000 JPEG in docs/images/cover.jpg, stored and deflated in a zip, to the cover BMP both ways the
+// firmware has done it: extracted to .cover.jpg on the card and decoded from there, and decoded while the zip item is
+// read. Both must give the same BMP. Prints the time each takes on the host, the card traffic each causes, and what
+// that traffic costs at a typical SPI SD card speed, which is where the device saves time.
+#include <JpegToBmpConverter.h>
+#include <SDCardManager.h>
+#include <ZipFile.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char ITEM_NAME[] = "OEBPS/images/cover.jpg";
+constexpr char EXTRACTED_JPEG[] = "/.cover.jpg";
+constexpr char EXTRACTED_BMP[] = "/extracted.bmp";
+constexpr char STREAMED_BMP[] = "/streamed.bmp";
+// Read size of Epub::readItemContentsToStream and of the zip item reader
+constexpr size_t CHUNK_SIZE = 1024;
+// Assumed card speed over SPI, only to put the traffic in device terms
+constexpr double CARD_READ_KB_PER_S = 1000;
+constexpr double CARD_WRITE_KB_PER_S = 500;
+constexpr int RUNS = 3;
+
+struct Traffic {
+  size_t readBytes = 0;
+  size_t writtenBytes = 0;
+
+  double cardMs() const {
+    return (readBytes / 1024.0 / CARD_READ_KB_PER_S + writtenBytes / 1024.0 / CARD_WRITE_KB_PER_S) * 1000;
+  }
+};
+
+struct Result {
+  double ms = 0;
+  Traffic traffic;
+};
+
+std::string readHost(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+bool writeZip(const std::string& zipPath, const std::string& jpeg, const bool deflate) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, SdMan.hostPath(zipPath).c_str(), 0)) {
+    return false;
+  }
+  const bool ok = mz_zip_writer_add_mem(&zip, "mimetype", "application/epub+zip", 20, MZ_NO_COMPRESSION) &&
+                  mz_zip_writer_add_mem(&zip, ITEM_NAME, jpeg.data(), jpeg.size(),
+                                        deflate ? MZ_DEFAULT_COMPRESSION : MZ_NO_COMPRESSION) &&
+                  mz_zip_writer_finalize_archive(&zip);
+  return mz_zip_writer_end(&zip) && ok;
+}
+
+// Runs convert with the card traffic counted
+Result measure(const std::function<bool()>& convert) {
+  Result result;
+  FsFile::onTransfer = [&result](const size_t count, const bool write) {
+    (write ? result.traffic.writtenBytes : result.traffic.readBytes) += count;
+  };
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(convert());
+  result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  FsFile::onTransfer = nullptr;
+  return result;
+}
+
+// As Epub::generateCoverBmp did before: the JPEG goes to the card and is read back
+bool convertExtracted(const std::string& zipPath) {
+  FsFile jpeg;
+  if (!SdMan.openFileForWrite("TST", EXTRACTED_JPEG, jpeg)) {
+    return false;
+  }
+  const bool extracted = ZipFile(zipPath).readFileToStream(ITEM_NAME, jpeg, CHUNK_SIZE);
+  jpeg.close();
+
+  FsFile bmp;
+  bool converted = false;
+  if (extracted && SdMan.openFileForRead("TST", EXTRACTED_JPEG, jpeg) &&
+      SdMan.openFileForWrite("TST", EXTRACTED_BMP, bmp)) {
+    converted = JpegToBmpConverter::jpegFileToBmpStream(jpeg, bmp);
+    bmp.close();
+    jpeg.close();
+  }
+  SdMan.remove(EXTRACTED_JPEG);
+  return converted;
+}
+
+// As Epub::generateCoverBmp does now
+bool convertStreamed(const std::string& zipPath) {
+  ZipFile zip(zipPath);
+  ZipFile::ItemReader jpeg(zip);
+  FsFile bmp;
+  if (!jpeg.open(ITEM_NAME, CHUNK_SIZE) || !SdMan.openFileForWrite("TST", STREAMED_BMP, bmp)) {
+    return false;
+  }
+  const bool converted = JpegToBmpConverter::jpegZipItemToBmpStream(jpeg, bmp);
+  bmp.close();
+  return converted;
+}
+
+void testZip(const std::string& jpeg, const bool deflate) {
+  const std::string zipPath = deflate ? "/deflated.epub" : "/stored.epub";
+  CHECK(writeZip(zipPath, jpeg, deflate));
+
+  Result extracted;
+  Result streamed;
+  for (int run = 0; run < RUNS; run++) {
+    const Result e = measure([&zipPath] { return convertExtracted(zipPath); });
+    const Result s = measure([&zipPath] { return convertStreamed(zipPath); });
+    // Best run for the time, the traffic is the same every run
+    extracted.ms = run == 0 ? e.ms : std::min(extracted.ms, e.ms);
+    streamed.ms = run == 0 ? s.ms : std::min(streamed.ms, s.ms);
+    extracted.traffic = e.traffic;
+    streamed.traffic = s.traffic;
+  }
+
+  const std::string extractedBmp = readHost(SdMan.hostPath(EXTRACTED_BMP));
+  const std::string streamedBmp = readHost(SdMan.hostPath(STREAMED_BMP));
+  CHECK(extractedBmp.size() > 54);
+  CHECK(streamedBmp == extractedBmp);
+  CHECK(!SdMan.exists(EXTRACTED_JPEG));
+  if (extractedBmp.size() > 54) {
+    int32_t width;
+    int32_t height;
+    memcpy(&width, extractedBmp.data() + 18, sizeof(width));
+    memcpy(&height, extractedBmp.data() + 22, sizeof(height));
+    // Scaled down to cover the screen, the reader crops what is left over
+    CHECK(width >= 480 && width <= 800);
+    CHECK(std::abs(height) >= 480 && std::abs(height) <= 800);
+  }
+
+  // Both read the zip and write the BMP, only extracting writes and reads the JPEG on top
+  CHECK(extracted.traffic.writtenBytes >= streamed.traffic.writtenBytes + jpeg.size());
+  CHECK(extracted.traffic.readBytes >= streamed.traffic.readBytes + jpeg.size());
+
+  printf("%s cover, %zu KB\n", deflate ? "Deflated" : "Stored", jpeg.size() / 1024);
+  const std::pair<const char*, const Result&> results[] = {{"extracted", extracted}, {"streamed", streamed}};
+  for (const auto& [name, result] : results) {
+    printf("  %-9s %4.0f ms on the host, %4zu KB read and %4zu KB written (%4.0f ms on a card)\n", name, result.ms,
+           result.traffic.readBytes / 1024, result.traffic.writtenBytes / 1024, result.traffic.cardMs());
+  }
+}
+}  // namespace
+
+int main() {
+  const std::string jpeg = readHost(COVER_JPEG);
+  if (jpeg.empty()) {
+    fprintf(stderr, "Could not read %s\n", COVER_JPEG);
+    return 1;
+  }
+
+  char rootTemplate[] = "/tmp/CoverBmpTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+
+  testZip(jpeg, false);
+  testZip(jpeg, true);
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,180 @@
+// Runs epub2xtc on a generated EPUB, to both XTC and XTCH, and reads the output back through XtcParser the way the XTC
+// reader opens it: title and author from the metadata at 0x38 next to a chapter table, one chapter per table of
+// contents entry spanning the pages of its sections, and every page loading at the bit depth of the format.
+#include <SDCardManager.h>
+#include <Xtc/XtcParser.h>
+#include <miniz.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char BOOK_PATH[] = "/book.epub";
+constexpr char TITLE[] = "Round Trip";
+constexpr char AUTHOR[] = "Host Test";
+
+struct Chapter {
+  const char* name;
+  const char* title;  // nullptr if not in the TOC
+  int paragraphs;
+};
+
+// A cover before the first TOC entry, a chapter over several pages and an untitled section that belongs to it
+const Chapter CHAPTERS[] = {
+    {"cover.xhtml", nullptr, 1},
+    {"one.xhtml", "One", 2},
+    {"two.xhtml", "Two", 40},
+    {"interlude.xhtml", nullptr, 3},
+    {"three.xhtml", "Three", 2},
+};
+constexpr int SPINE_COUNT = sizeof(CHAPTERS) / sizeof(CHAPTERS[0]);
+// What the XTC chapter list should hold: the cover has no TOC entry, the interlude is part of "Two"
+const char* const XTC_CHAPTERS[] = {"Unnamed", "One", "Two", "Three"};
+constexpr size_t XTC_CHAPTER_COUNT = sizeof(XTC_CHAPTERS) / sizeof(XTC_CHAPTERS[0]);
+
+bool addFile(mz_zip_archive& zip, const char* name, const std::string& content) {
+  return mz_zip_writer_add_mem(&zip, name, content.data(), content.size(), MZ_DEFAULT_COMPRESSION);
+}
+
+bool writeEpub(const std::string& hostPath) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+
+  std::string manifest;
+  std::string spine;
+  std::string navPoints;
+  bool ok = mz_zip_writer_add_mem(&zip, "mimetype", "application/epub+zip", 20, MZ_NO_COMPRESSION) &&
+            addFile(zip, "META-INF/container.xml",
+                    "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                    "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                    "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                    "</container>");
+  for (int i = 0; ok && i < SPINE_COUNT; i++) {
+    const Chapter& chapter = CHAPTERS[i];
+    const std::string id = "c" + std::to_string(i);
+    manifest += "<item id=\"" + id + "\" href=\"text/" + chapter.name + "\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    if (chapter.title) {
+      navPoints += "<navPoint id=\"n" + id + "\"><navLabel><text>" + chapter.title +
+                   "</text></navLabel><content src=\"text/" + chapter.name + "\"/></navPoint>";
+    }
+    std::string body = "<h1>" + std::string(chapter.title ? chapter.title : chapter.name) + "</h1>";
+    for (int p = 0; p < chapter.paragraphs; p++) {
+      body += "<p>Some <b>bold</b> and <i>italic</i> text that wraps over a few lines of the page, paragraph " +
+              std::to_string(p) + ".</p>";
+    }
+    ok = addFile(zip, ("OEBPS/text/" + std::string(chapter.name)).c_str(),
+                 "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body>" + body + "</body></html>");
+  }
+  ok = ok &&
+       addFile(zip, "OEBPS/content.opf",
+               "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\"><metadata "
+               "xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>" +
+                   std::string(TITLE) + "</dc:title><dc:creator>" + AUTHOR +
+                   "</dc:creator></metadata><manifest><item id=\"ncx\" href=\"toc.ncx\" "
+                   "media-type=\"application/x-dtbncx+xml\"/>" +
+                   manifest + "</manifest><spine toc=\"ncx\">" + spine + "</spine></package>") &&
+       addFile(zip, "OEBPS/toc.ncx",
+               "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\"><navMap>" + navPoints +
+                   "</navMap></ncx>");
+
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  return mz_zip_writer_end(&zip) && ok;
+}
+
+bool convert(const std::string& book, const std::string& output) {
+  const std::string command = std::string("\"") + EPUB2XTC + "\" --check \"" + book + "\" \"" + output + "\"";
+  return std::system(command.c_str()) == 0;
+}
+
+// Null terminated string at a fixed offset of the file, as the metadata stores it
+std::string readString(const std::string& hostPath, const long offset, const size_t size) {
+  std::string value(size, '\0');
+  FILE* file = fopen(hostPath.c_str(), "rb");
+  if (!file) {
+    return {};
+  }
+  const bool ok = fseek(file, offset, SEEK_SET) == 0 && fread(&value[0], 1, size, file) == size;
+  fclose(file);
+  return ok ? value.c_str() : std::string();
+}
+
+bool hasInk(const std::vector<uint8_t>& bitmap, const bool grayscale) {
+  // XTG pages are 1 = white, XTH planes are 0 = white
+  for (const uint8_t byte : bitmap) {
+    if (byte != (grayscale ? 0x00 : 0xFF)) return true;
+  }
+  return false;
+}
+
+void testFormat(const char* path, const bool grayscale) {
+  CHECK(convert(SdMan.hostPath(BOOK_PATH), SdMan.hostPath(path)));
+
+  xtc::XtcParser parser;
+  CHECK(parser.open(path) == xtc::XtcError::OK);
+  if (!parser.isOpen()) return;
+  CHECK(parser.getBitDepth() == (grayscale ? 2 : 1));
+  CHECK(parser.getWidth() == xtc::DISPLAY_WIDTH && parser.getHeight() == xtc::DISPLAY_HEIGHT);
+  // The field at 0x30 holds the chapter table offset, the title comes from 0x38
+  CHECK(parser.hasChapters());
+  CHECK(parser.getTitle() == TITLE);
+  CHECK(readString(SdMan.hostPath(path), 0x38 + 128, 64) == AUTHOR);
+
+  const uint32_t pageCount = parser.getPageCount();
+  const auto& chapters = parser.getChapters();
+  CHECK(chapters.size() == XTC_CHAPTER_COUNT);
+  if (chapters.size() != XTC_CHAPTER_COUNT) return;
+  // Back to back over every page, the long chapter over several
+  uint32_t nextPage = 0;
+  for (size_t i = 0; i < chapters.size(); i++) {
+    CHECK(chapters[i].name == XTC_CHAPTERS[i]);
+    CHECK(chapters[i].startPage == nextPage && chapters[i].endPage >= chapters[i].startPage);
+    nextPage = chapters[i].endPage + 1;
+  }
+  CHECK(nextPage == pageCount);
+  CHECK(chapters[2].endPage - chapters[2].startPage >= 2);
+
+  const size_t bitmapSize =
+      grayscale ? xtc::DISPLAY_WIDTH * xtc::DISPLAY_HEIGHT / 8 * 2 : xtc::DISPLAY_WIDTH / 8 * xtc::DISPLAY_HEIGHT;
+  std::vector<uint8_t> bitmap(bitmapSize);
+  std::vector<uint8_t> previous;
+  for (uint32_t page = 0; page < pageCount; page++) {
+    CHECK(parser.loadPage(page, bitmap.data(), bitmap.size()) == bitmapSize);
+    CHECK(hasInk(bitmap, grayscale));
+    // The status bar numbers every page, so no two pages are the same
+    CHECK(bitmap != previous);
+    previous = bitmap;
+  }
+  printf("%s: %u pages, %zu chapters\n", grayscale ? "XTCH" : "XTC", pageCount, chapters.size());
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/Epub2XtcTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  if (!writeEpub(SdMan.hostPath(BOOK_PATH))) {
+    fprintf(stderr, "Could not write the test EPUB\n");
+    return 1;
+  }
+
+  testFormat("/book.xtc", false);
+  testFormat("/book.xtch", true);
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,63 @@
+// The firmware's ChapterHtmlSlimParser.cpp compiled a second time, under other names and with XhtmlTokenizer replaced
+// by the expat parser it had before, set up the same way: so that the layout code compared is the same.
+#include "ExpatChapterParser.h"
+
+#include <Epub/Page.h>
+#include <Epub/parsers/XhtmlTokenizer.h>
+#include <GfxRenderer.h>
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <XmlNames.h>
+#include <expat.h>
+
+namespace {
+// XhtmlTokenizer's interface over expat
+class ExpatTokenizer {
+  XML_Parser parser;
+
+ public:
+  ExpatTokenizer(void* userData, const XML_StartElementHandler startElement,
+                 const XML_CharacterDataHandler characterData, const XML_EndElementHandler endElement)
+      : parser(XML_ParserCreate(nullptr)) {
+    if (parser) {
+      XML_SetUserData(parser, userData);
+      XML_SetElementHandler(parser, startElement, endElement);
+      XML_SetCharacterDataHandler(parser, characterData);
+    }
+  }
+  ~ExpatTokenizer() {
+    if (parser) {
+      XML_ParserFree(parser);
+    }
+  }
+  ExpatTokenizer(const ExpatTokenizer&) = delete;
+  ExpatTokenizer& operator=(const ExpatTokenizer&) = delete;
+
+  char* getBuffer(const size_t len) { return parser ? static_cast<char*>(XML_GetBuffer(parser, len)) : nullptr; }
+
+  bool parseBuffer(const size_t len, const bool isFinal) {
+    if (XML_ParseBuffer(parser, static_cast<int>(len), isFinal) == XML_STATUS_ERROR) {
+      Serial.printf("[%lu] [EHP] Parse error at line %lu:\n%s\n", millis(), XML_GetCurrentLineNumber(parser),
+                    XML_ErrorString(XML_GetErrorCode(parser)));
+      return false;
+    }
+    return true;
+  }
+};
+}  // namespace
+
+// XhtmlTokenizer.h is already included above, so the parser's own #include of it is skipped
+#define XhtmlTokenizer ExpatTokenizer
+#define ChapterHtmlSlimParser ExpatChapterHtmlSlimParser
+#define isWhitespace expatIsWhitespace
+#include <Epub/parsers/ChapterHtmlSlimParser.cpp>
+
+bool expatParseAndBuildPages(const std::string& path, GfxRenderer& renderer, const int fontId,
+                             const float lineCompression, const bool extraParagraphSpacing,
+                             const uint8_t paragraphAlignment, const uint16_t viewportWidth,
+                             const uint16_t viewportHeight,
+                             const std::function<void(std::unique_ptr<Page>)>& completePageFn) {
+  ExpatChapterHtmlSlimParser parser(path, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment,
+                                    viewportWidth, viewportHeight, completePageFn);
+  return parser.parseAndBuildPages();
+}
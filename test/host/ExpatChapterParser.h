@@ -0,0 +1,15 @@
+#pragma once
+// ChapterHtmlSlimParser as it was before XhtmlTokenizer, for XhtmlTokenizerTest to compare against
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+class GfxRenderer;
+class Page;
+
+// ChapterHtmlSlimParser::parseAndBuildPages() for the chapter at path on the card, reading it through expat
+bool expatParseAndBuildPages(const std::string& path, GfxRenderer& renderer, int fontId, float lineCompression,
+                             bool extraParagraphSpacing, uint8_t paragraphAlignment, uint16_t viewportWidth,
+                             uint16_t viewportHeight, const std::function<void(std::unique_ptr<Page>)>& completePageFn);
@@ -0,0 +1,26 @@
+#pragma once
+// Minimal checks for the host tests built by tools/CMakeLists.txt (see tools/README.md). A test is a program that
+// runs its CHECKs and returns testResult(), non-zero if any of them failed.
+
+#include <cstdio>
+
+namespace hosttest {
+inline int failures = 0;
+}  // namespace hosttest
+
+#define CHECK(condition)                                                        \
+  do {                                                                          \
+    if (!(condition)) {                                                         \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      hosttest::failures++;                                                     \
+    }                                                                           \
+  } while (0)
+
+inline int testResult() {
+  if (hosttest::failures > 0) {
+    fprintf(stderr, "%d check(s) failed\n", hosttest::failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
@@ -0,0 +1,190 @@
+// Builds book.bin for a generated EPUB of 5,000 spine items and 5,000 TOC entries, once with the heap for the href
+// hashes and once with too little, where they are sorted on the card in runs and merged. Both builds must give the same
+// book.bin, and the low heap build must read the card a bounded number of times per item rather than once per pair
+// of items. Then resolves every spine href through the href index. Prints the build times, the card traffic and the
+// lookup time.
+#include <Arduino.h>
+#include <Epub.h>
+#include <SDCardManager.h>
+#include <miniz.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char BOOK_PATH[] = "/book.epub";
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr int CHAPTERS = 5000;
+// Every CHAPTERS_PER_PART-th chapter has a second TOC entry into its middle, every UNLISTED_EVERY-th has none
+constexpr int CHAPTERS_PER_PART = 10;
+constexpr int UNLISTED_EVERY = 250;
+// A heap far too small for 5,000 href hashes
+constexpr uint32_t LOW_HEAP = 8 * 1024;
+// Card reads of the low heap build per spine item, beyond a clean build. Scanning the spine temp file for every TOC
+// entry took thousands.
+constexpr size_t MAX_EXTRA_READS_PER_ITEM = 200;
+
+std::string chapterHref(const int i) { return "text/chapter" + std::to_string(i) + ".xhtml"; }
+
+bool addFile(mz_zip_archive& zip, const char* name, const std::string& content) {
+  return mz_zip_writer_add_mem(&zip, name, content.data(), content.size(), MZ_DEFAULT_COMPRESSION);
+}
+
+bool writeEpub(const std::string& hostPath) {
+  mz_zip_archive zip = {};
+  if (!mz_zip_writer_init_file(&zip, hostPath.c_str(), 0)) {
+    return false;
+  }
+
+  std::string manifest;
+  std::string spine;
+  std::string navPoints;
+  bool ok = mz_zip_writer_add_mem(&zip, "mimetype", "application/epub+zip", 20, MZ_NO_COMPRESSION) &&
+            addFile(zip, "META-INF/container.xml",
+                    "<?xml version=\"1.0\"?><container version=\"1.0\" "
+                    "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+                    "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles>"
+                    "</container>");
+  for (int i = 0; ok && i < CHAPTERS; i++) {
+    const std::string id = "c" + std::to_string(i);
+    const std::string href = chapterHref(i);
+    manifest += "<item id=\"" + id + "\" href=\"" + href + "\" media-type=\"application/xhtml+xml\"/>";
+    spine += "<itemref idref=\"" + id + "\"/>";
+    if (i % UNLISTED_EVERY != UNLISTED_EVERY - 1) {
+      navPoints += "<navPoint id=\"n" + id + "\"><navLabel><text>Chapter " + std::to_string(i) +
+                   "</text></navLabel><content src=\"" + href + "\"/></navPoint>";
+    }
+    if (i % CHAPTERS_PER_PART == 0) {
+      navPoints += "<navPoint id=\"p" + id + "\"><navLabel><text>Part of " + std::to_string(i) +
+                   "</text></navLabel><content src=\"" + href + "#part\"/></navPoint>";
+    }
+    ok = addFile(zip, ("OEBPS/" + href).c_str(),
+                 "<html xmlns=\"http://www.w3.org/1999/xhtml\"><body><h1>Chapter " + std::to_string(i) +
+                     "</h1><p>Some text.</p><p id=\"part\">More text.</p></body></html>");
+  }
+  ok = ok &&
+       addFile(zip, "OEBPS/content.opf",
+               "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\"><metadata "
+               "xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Href Index</dc:title></metadata><manifest>"
+               "<item id=\"ncx\" href=\"toc.ncx\" media-type=\"application/x-dtbncx+xml\"/>" +
+                   manifest + "</manifest><spine toc=\"ncx\">" + spine +
+                   "</spine><guide><reference type=\"text\" href=\"" + chapterHref(CHAPTERS - 1) +
+                   "#start\"/></guide></package>") &&
+       addFile(zip, "OEBPS/toc.ncx",
+               "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\"><navMap>" + navPoints +
+                   "</navMap></ncx>");
+
+  ok = ok && mz_zip_writer_finalize_archive(&zip);
+  return mz_zip_writer_end(&zip) && ok;
+}
+
+std::string readCard(const std::string& path) {
+  std::string data;
+  FsFile file;
+  if (SdMan.openFileForRead("TST", path, file)) {
+    data.resize(file.size());
+    file.read(&data[0], data.size());
+    file.close();
+  }
+  return data;
+}
+
+struct Build {
+  bool loaded = false;
+  std::string bookBin;
+  double ms = 0;
+  size_t reads = 0;
+  size_t readBytes = 0;
+  size_t writeBytes = 0;
+};
+
+Build build(const uint32_t maxAllocHeap) {
+  fs::remove_all(SdMan.hostPath(CACHE_DIR));
+  Build result;
+  FsFile::onTransfer = [&result](const size_t count, const bool write) {
+    if (write) {
+      result.writeBytes += count;
+    } else {
+      result.reads++;
+      result.readBytes += count;
+    }
+  };
+  const uint32_t heap = ESP.maxAllocHeap;
+  ESP.maxAllocHeap = maxAllocHeap;
+  const auto start = std::chrono::steady_clock::now();
+  Epub epub(BOOK_PATH, CACHE_DIR);
+  result.loaded = epub.load();
+  result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  ESP.maxAllocHeap = heap;
+  FsFile::onTransfer = nullptr;
+  result.bookBin = readCard(epub.getCachePath() + "/book.bin");
+  // No temp file is left behind
+  for (const auto& entry : fs::directory_iterator(SdMan.hostPath(epub.getCachePath()))) {
+    CHECK(entry.path().extension() != ".tmp");
+  }
+  return result;
+}
+
+void testLookups() {
+  Epub epub(BOOK_PATH, CACHE_DIR);
+  CHECK(epub.load());
+  CHECK(epub.getSpineItemsCount() == CHAPTERS);
+  CHECK(epub.getSpineIndexForTextReference() == CHAPTERS - 1);
+
+  std::vector<std::string> hrefs;
+  for (int i = 0; i < CHAPTERS; i++) {
+    hrefs.push_back(epub.getSpineItem(i).href);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CHAPTERS; i++) {
+    CHECK(epub.getSpineIndexForHref(hrefs[i]) == i);
+    CHECK(epub.getSpineIndexForHref(hrefs[i] + "#part") == i);
+  }
+  const double us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (CHAPTERS * 2);
+  CHECK(epub.getSpineIndexForHref("OEBPS/text/missing.xhtml") == -1);
+  CHECK(epub.getSpineIndexForHref("") == -1);
+  printf("Lookups: %.1f us per href\n", us);
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/HrefIndexBenchmarkTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  if (!writeEpub(SdMan.hostPath(BOOK_PATH))) {
+    fprintf(stderr, "Could not write the test EPUB\n");
+    return 1;
+  }
+
+  const Build clean = build(ESP.maxAllocHeap);
+  CHECK(clean.loaded);
+  CHECK(!clean.bookBin.empty());
+  const Build lowHeap = build(LOW_HEAP);
+  CHECK(lowHeap.loaded);
+  CHECK(lowHeap.bookBin == clean.bookBin);
+  CHECK(lowHeap.reads <= clean.reads + CHAPTERS * MAX_EXTRA_READS_PER_ITEM);
+
+  printf("Build with the href hashes in memory: %.0f ms, %zu card reads of %zu KB, %zu KB written\n", clean.ms,
+         clean.reads, clean.readBytes / 1024, clean.writeBytes / 1024);
+  printf("Build with %u KB of heap: %.0f ms, %zu card reads of %zu KB, %zu KB written\n", LOW_HEAP / 1024, lowHeap.ms,
+         lowHeap.reads, lowHeap.readBytes / 1024, lowHeap.writeBytes / 1024);
+  printf("  %.0f more card reads per spine item\n",
+         (static_cast<double>(lowHeap.reads) - static_cast<double>(clean.reads)) / CHAPTERS);
+  testLookups();
+
+  fs::remove_all(root);
+  return testResult();
+}
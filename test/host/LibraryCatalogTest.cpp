@@ -0,0 +1,302 @@
+// Keeps the library catalog of a simulated card in line with directory listings and reader updates: new books get a
+// record, changed ones are reset, gone ones are freed and their slots reused, and other directories are left alone.
+#include <LibraryCatalog.h>
+#include <SDCardManager.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char CATALOG_FILE[] = "/.crosspoint/library.bin";
+constexpr size_t HEADER_SIZE = 8;
+
+using LibraryCatalog::FileInfo;
+using LibraryCatalog::Record;
+
+std::string readHost(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void writeHost(const std::string& path, const std::string& contents) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << contents;
+}
+
+// Every record in the file, free ones included
+std::vector<Record> readRecords() {
+  const std::string file = readHost(SdMan.hostPath(CATALOG_FILE));
+  std::vector<Record> records;
+  for (size_t offset = HEADER_SIZE; offset + sizeof(Record) <= file.size(); offset += sizeof(Record)) {
+    Record record;
+    memcpy(&record, file.data() + offset, sizeof(record));
+    records.push_back(record);
+  }
+  return records;
+}
+
+// Index of the record for path, or -1
+int indexOf(const std::string& path) {
+  Record wanted;
+  if (!LibraryCatalog::find(path, wanted)) {
+    return -1;
+  }
+  const std::vector<Record> records = readRecords();
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].format != LibraryCatalog::FORMAT_NONE && records[i].pathHash == wanted.pathHash) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+size_t freeRecords() {
+  size_t count = 0;
+  for (const Record& record : readRecords()) {
+    count += record.format == LibraryCatalog::FORMAT_NONE;
+  }
+  return count;
+}
+
+void testFormats() {
+  CHECK(LibraryCatalog::formatOf("/a.epub") == LibraryCatalog::FORMAT_EPUB);
+  CHECK(LibraryCatalog::formatOf("/a.XTC") == LibraryCatalog::FORMAT_XTC);
+  CHECK(LibraryCatalog::formatOf("/a.xtch") == LibraryCatalog::FORMAT_XTCH);
+  CHECK(LibraryCatalog::formatOf("/a.txt") == LibraryCatalog::FORMAT_NONE);
+}
+
+void testNewDirectory() {
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}, {"b.xtc", 200, 2}, {"c.xtch", 300, 3}});
+  CHECK(readRecords().size() == 3);
+  CHECK(freeRecords() == 0);
+
+  Record record;
+  CHECK(LibraryCatalog::find("/Books/b.xtc", record));
+  CHECK(record.format == LibraryCatalog::FORMAT_XTC);
+  CHECK(record.fileSize == 200);
+  CHECK(record.modified == 2);
+  CHECK(record.flags == 0);
+  CHECK(record.title[0] == '\0');
+  CHECK(!LibraryCatalog::find("/Books/d.epub", record));
+
+  // Nothing changed, so nothing is written. The trailing '/' of the directory is optional.
+  const std::string before = readHost(SdMan.hostPath(CATALOG_FILE));
+  size_t written = 0;
+  FsFile::onTransfer = [&written](const size_t count, const bool write) { written += write ? count : 0; };
+  LibraryCatalog::refreshDirectory("/Books/", {{"a.epub", 100, 1}, {"b.xtc", 200, 2}, {"c.xtch", 300, 3}});
+  FsFile::onTransfer = nullptr;
+  CHECK(written == 0);
+  CHECK(readHost(SdMan.hostPath(CATALOG_FILE)) == before);
+}
+
+// The readers fill in what they learn, and a changed file loses it again but keeps its slot
+void testChangedFileIsReset() {
+  LibraryCatalog::updateBook("/Books/a.epub", "Title A", "Author A", true, 42);
+  Record record;
+  CHECK(LibraryCatalog::find("/Books/a.epub", record));
+  CHECK(std::string(record.title) == "Title A");
+  CHECK(std::string(record.author) == "Author A");
+  CHECK(record.flags == (LibraryCatalog::FLAG_METADATA | LibraryCatalog::FLAG_COVER_CACHED));
+  CHECK(record.progressPercent == 42);
+  const int slot = indexOf("/Books/a.epub");
+
+  std::vector<std::string> titles;
+  LibraryCatalog::findTitles({"/Books/b.xtc", "/Books/a.epub", "/Books/missing.epub"}, titles);
+  CHECK(titles.size() == 3);
+  CHECK(titles[0].empty());
+  CHECK(titles[1] == "Title A");
+  CHECK(titles[2].empty());
+
+  // Same size, newer modification time
+  const FileInfo a = {"a.epub", record.fileSize, record.modified + 1};
+  LibraryCatalog::refreshDirectory("/Books", {a, {"b.xtc", 200, 2}, {"c.xtch", 300, 3}});
+  CHECK(LibraryCatalog::find("/Books/a.epub", record));
+  CHECK(indexOf("/Books/a.epub") == slot);
+  CHECK(record.format == LibraryCatalog::FORMAT_EPUB);
+  CHECK(record.modified == a.modified);
+  CHECK(record.flags == 0);
+  CHECK(record.progressPercent == 0);
+  CHECK(record.title[0] == '\0');
+  CHECK(record.author[0] == '\0');
+  CHECK(readRecords().size() == 3);
+}
+
+void testGoneFilesAreFreedAndReused() {
+  const int bSlot = indexOf("/Books/b.xtc");
+  const int cSlot = indexOf("/Books/c.xtch");
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}});
+  Record record;
+  CHECK(!LibraryCatalog::find("/Books/b.xtc", record));
+  CHECK(!LibraryCatalog::find("/Books/c.xtch", record));
+  CHECK(readRecords().size() == 3);
+  CHECK(freeRecords() == 2);
+  // Freed records are cleared, not only marked
+  const Record freed = readRecords()[bSlot];
+  CHECK(freed.pathHash == 0 && freed.dirHash == 0 && freed.fileSize == 0);
+
+  // New books take the free slots before the file grows
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}, {"d.epub", 400, 4}, {"e.epub", 500, 5}});
+  CHECK(readRecords().size() == 3);
+  CHECK(freeRecords() == 0);
+  const int dSlot = indexOf("/Books/d.epub");
+  const int eSlot = indexOf("/Books/e.epub");
+  CHECK((dSlot == bSlot && eSlot == cSlot) || (dSlot == cSlot && eSlot == bSlot));
+
+  // A book gone and another added in the same refresh: the freed slot is reused at once
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}, {"d.epub", 400, 4}, {"f.epub", 600, 6}});
+  CHECK(readRecords().size() == 3);
+  CHECK(freeRecords() == 0);
+  CHECK(!LibraryCatalog::find("/Books/e.epub", record));
+  CHECK(indexOf("/Books/f.epub") == eSlot);
+  CHECK(LibraryCatalog::find("/Books/f.epub", record) && record.fileSize == 600);
+}
+
+void testOtherDirectoriesAreKept() {
+  const std::vector<Record> books = readRecords();
+  LibraryCatalog::refreshDirectory("/Other", {{"a.epub", 700, 7}});
+  CHECK(readRecords().size() == books.size() + 1);
+  // Same name in another directory is another book
+  Record record;
+  CHECK(LibraryCatalog::find("/Other/a.epub", record) && record.fileSize == 700);
+  CHECK(LibraryCatalog::find("/Books/a.epub", record) && record.fileSize != 700);
+
+  // Emptying /Other leaves /Books as it was
+  LibraryCatalog::refreshDirectory("/Other", {});
+  const std::vector<Record> after = readRecords();
+  CHECK(after.size() == books.size() + 1);
+  CHECK(memcmp(after.data(), books.data(), books.size() * sizeof(Record)) == 0);
+  CHECK(after.back().format == LibraryCatalog::FORMAT_NONE);
+
+  // And the other way around
+  LibraryCatalog::refreshDirectory("/Other", {{"b.epub", 800, 8}});
+  LibraryCatalog::refreshDirectory("/Books", {});
+  CHECK(LibraryCatalog::find("/Other/b.epub", record) && record.fileSize == 800);
+  CHECK(freeRecords() == books.size());
+}
+
+// A record copied by hand is released on the next refresh of its directory
+void testDuplicateIsFreed() {
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}});
+  const int slot = indexOf("/Books/a.epub");
+  std::string file = readHost(SdMan.hostPath(CATALOG_FILE));
+  file.append(file, HEADER_SIZE + slot * sizeof(Record), sizeof(Record));
+  writeHost(SdMan.hostPath(CATALOG_FILE), file);
+  const size_t records = readRecords().size();
+  const size_t freeBefore = freeRecords();
+
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}});
+  CHECK(readRecords().size() == records);
+  CHECK(freeRecords() == freeBefore + 1);
+  CHECK(indexOf("/Books/a.epub") == slot);
+}
+
+// updateBook reads size and time from the book itself, and resets a record that disagrees with them
+void testUpdateBook() {
+  SdMan.mkdir("/Reader");
+  writeHost(SdMan.hostPath("/Reader/book.epub"), std::string(1234, 'x'));
+  const size_t freeBefore = freeRecords();
+  const size_t records = readRecords().size();
+
+  // No record yet: created in the first free slot
+  LibraryCatalog::updateBook("/Reader/book.epub", "Book", "Writer", false, 10);
+  Record record;
+  CHECK(LibraryCatalog::find("/Reader/book.epub", record));
+  CHECK(record.fileSize == 1234);
+  CHECK(record.modified != 0);
+  CHECK(record.flags == LibraryCatalog::FLAG_METADATA);
+  CHECK(record.progressPercent == 10);
+  CHECK(readRecords().size() == records);
+  CHECK(freeRecords() == freeBefore - 1);
+  const int slot = indexOf("/Reader/book.epub");
+  for (int i = 0; i < slot; i++) {
+    CHECK(readRecords()[i].format != LibraryCatalog::FORMAT_NONE);
+  }
+
+  // Progress only: title and author stay, the cover flag follows the call
+  LibraryCatalog::updateBook("/Reader/book.epub", "", "", true, 55);
+  CHECK(LibraryCatalog::find("/Reader/book.epub", record));
+  CHECK(std::string(record.title) == "Book");
+  CHECK(record.flags == (LibraryCatalog::FLAG_METADATA | LibraryCatalog::FLAG_COVER_CACHED));
+  CHECK(record.progressPercent == 55);
+
+  // The directory listing agrees with the book, so the record is kept
+  LibraryCatalog::refreshDirectory("/Reader", {{"book.epub", record.fileSize, record.modified}});
+  CHECK(LibraryCatalog::find("/Reader/book.epub", record) && record.progressPercent == 55);
+
+  // Replaced on the card: what was known is dropped before the new values are stored
+  writeHost(SdMan.hostPath("/Reader/book.epub"), std::string(999, 'y'));
+  LibraryCatalog::updateBook("/Reader/book.epub", "", "", false, 3);
+  CHECK(LibraryCatalog::find("/Reader/book.epub", record));
+  CHECK(indexOf("/Reader/book.epub") == slot);
+  CHECK(record.fileSize == 999);
+  CHECK(record.flags == 0);
+  CHECK(record.title[0] == '\0');
+  CHECK(record.progressPercent == 3);
+
+  // Long fields are cut to fit and stay terminated
+  LibraryCatalog::updateBook("/Reader/book.epub", std::string(200, 't'), std::string(200, 'a'), false, 3);
+  CHECK(LibraryCatalog::find("/Reader/book.epub", record));
+  CHECK(strnlen(record.title, sizeof(record.title)) == sizeof(record.title) - 1);
+  CHECK(strnlen(record.author, sizeof(record.author)) == sizeof(record.author) - 1);
+
+  // With no free slot the file grows
+  while (freeRecords() > 0) {
+    LibraryCatalog::updateBook("/Reader/filler" + std::to_string(freeRecords()) + ".epub", "", "", false, 0);
+  }
+  const size_t full = readRecords().size();
+  LibraryCatalog::updateBook("/Reader/last.epub", "Last", "", false, 0);
+  CHECK(readRecords().size() == full + 1);
+  CHECK(indexOf("/Reader/last.epub") == static_cast<int>(full));
+}
+
+// A catalog of another version is started afresh rather than misread
+void testOtherVersionIsReplaced() {
+  std::string file = readHost(SdMan.hostPath(CATALOG_FILE));
+  CHECK(file.size() > HEADER_SIZE);
+  file[4] = static_cast<char>(file[4] + 1);
+  writeHost(SdMan.hostPath(CATALOG_FILE), file);
+
+  Record record;
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}});
+  CHECK(readRecords().size() == 1);
+  CHECK(LibraryCatalog::find("/Books/a.epub", record));
+  CHECK(!LibraryCatalog::find("/Reader/last.epub", record));
+
+  writeHost(SdMan.hostPath(CATALOG_FILE), "junk");
+  CHECK(!LibraryCatalog::find("/Books/a.epub", record));
+  LibraryCatalog::refreshDirectory("/Books", {{"a.epub", 100, 1}});
+  CHECK(readRecords().size() == 1);
+  CHECK(LibraryCatalog::find("/Books/a.epub", record));
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/LibraryCatalogTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+
+  testFormats();
+  testNewDirectory();
+  testChangedFileIsReset();
+  testGoneFilesAreFreedAndReused();
+  testOtherDirectoriesAreKept();
+  testDuplicateIsFreed();
+  testUpdateBook();
+  testOtherVersionIsReplaced();
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,70 @@
+// Walks LoopPacer::nextWait through the main loop's states: an activity that skips the delay yields, recent input or
+// anything keeping the chip awake blocks for the active poll, and a quiet idle device light sleeps. Replays a minute
+// of idling to count the wakeups and the time spent awake.
+#include <cstdio>
+
+#include "HostTest.h"
+#include "util/LoopPacer.h"
+
+namespace {
+using LoopPacer::WaitKind;
+
+// Shortest press the front buttons see in practice, a light sleep poll must not be able to miss it
+constexpr uint32_t SHORTEST_PRESS_MS = 50;
+
+bool waits(const LoopPacer::LoopState& state, const WaitKind kind, const uint32_t ms) {
+  const LoopPacer::Wait wait = LoopPacer::nextWait(state);
+  return wait.kind == kind && wait.ms == ms;
+}
+
+void testSkipDelay() {
+  // Yields whatever else holds, even when the device could sleep
+  CHECK(waits({0, true, false}, WaitKind::Yield, 0));
+  CHECK(waits({0, true, true}, WaitKind::Yield, 0));
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS * 10, true, true}, WaitKind::Yield, 0));
+}
+
+void testActive() {
+  // Recent input: the front buttons are polled at the active rate
+  CHECK(waits({0, false, true}, WaitKind::Block, LoopPacer::ACTIVE_POLL_MS));
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS - 1, false, true}, WaitKind::Block, LoopPacer::ACTIVE_POLL_MS));
+  // Idle but something keeps the chip awake (drawing, a button down, WiFi or USB)
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS, false, false}, WaitKind::Block, LoopPacer::ACTIVE_POLL_MS));
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS * 100, false, false}, WaitKind::Block, LoopPacer::ACTIVE_POLL_MS));
+}
+
+void testLightSleep() {
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS, false, true}, WaitKind::LightSleep, LoopPacer::IDLE_POLL_MS));
+  CHECK(waits({LoopPacer::LIGHT_SLEEP_AFTER_MS * 100, false, true}, WaitKind::LightSleep, LoopPacer::IDLE_POLL_MS));
+  CHECK(LoopPacer::IDLE_POLL_MS >= LoopPacer::ACTIVE_POLL_MS);
+  CHECK(LoopPacer::IDLE_POLL_MS < SHORTEST_PRESS_MS);
+}
+
+// A minute after the last button press, with nothing drawing. The loop itself is taken to cost no time.
+void testIdleMinute() {
+  constexpr unsigned long MINUTE_MS = 60000;
+  unsigned long now = 0;
+  unsigned long awakeMs = 0;
+  unsigned long wakeups = 0;
+  while (now < MINUTE_MS) {
+    const LoopPacer::Wait wait = LoopPacer::nextWait({now, false, true});
+    CHECK(wait.kind != WaitKind::Yield && wait.ms > 0);
+    if (wait.kind == WaitKind::Block) awakeMs += wait.ms;
+    now += wait.ms;
+    wakeups++;
+  }
+  // Awake only until the light sleep threshold, then one wakeup per idle poll
+  CHECK(awakeMs <= LoopPacer::LIGHT_SLEEP_AFTER_MS + LoopPacer::ACTIVE_POLL_MS);
+  CHECK(wakeups < MINUTE_MS / LoopPacer::ACTIVE_POLL_MS / 2);
+  printf("Idle minute: %lu polls, %lu ms awake (was %lu polls, all awake)\n", wakeups, awakeMs,
+         MINUTE_MS / LoopPacer::ACTIVE_POLL_MS);
+}
+}  // namespace
+
+int main() {
+  testSkipDelay();
+  testActive();
+  testLightSleep();
+  testIdleMinute();
+  return testResult();
+}
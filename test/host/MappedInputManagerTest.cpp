@@ -0,0 +1,317 @@
+// Replays button sequences through MappedInputManager's event queue: events come out in order, a full queue drops
+// the oldest, and takePageTurns() sums what is queued into one jump in the current button layout. Then replays taps
+// against an EPUB reader whose renders take a while, to check that what is pressed meanwhile is applied in one go.
+#include <InputManager.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "CrossPointSettings.h"
+#include "HostTest.h"
+#include "MappedInputManager.h"
+#include "activities/reader/EpubPageTurns.h"
+
+namespace {
+// MappedInputManager::EVENT_QUEUE_SIZE
+constexpr int QUEUE_SIZE = 32;
+constexpr unsigned long LONG_PRESS_MS = 700;
+// EpubReaderActivity's loop delay while awake
+constexpr unsigned long POLL_MS = 10;
+
+using Button = MappedInputManager::Button;
+
+struct Replay {
+  InputManager buttons;
+  MappedInputManager input{buttons};
+
+  void press(const uint8_t button) {
+    buttons.press(button);
+    input.update();
+  }
+  void release(const uint8_t button, const unsigned long heldTime) {
+    buttons.release(button, heldTime);
+    input.update();
+  }
+  void tap(const uint8_t button, const unsigned long heldTime = 100) {
+    press(button);
+    release(button, heldTime);
+  }
+  int queued() {
+    int count = 0;
+    MappedInputManager::Event event;
+    while (input.popEvent(event)) {
+      count++;
+    }
+    return count;
+  }
+};
+
+void setLayout(const CrossPointSettings::FRONT_BUTTON_LAYOUT front, const CrossPointSettings::SIDE_BUTTON_LAYOUT side) {
+  SETTINGS.frontButtonLayout = front;
+  SETTINGS.sideButtonLayout = side;
+}
+
+void testEventOrder() {
+  Replay replay;
+  replay.press(InputManager::BTN_DOWN);
+  replay.press(InputManager::BTN_CONFIRM);
+  replay.release(InputManager::BTN_DOWN, 1200);
+  // A loop iteration with no change queues nothing
+  replay.input.update();
+  replay.release(InputManager::BTN_CONFIRM, 50);
+
+  MappedInputManager::Event event;
+  CHECK(replay.input.popEvent(event));
+  CHECK(event.button == InputManager::BTN_DOWN && event.pressed);
+  CHECK(replay.input.popEvent(event));
+  CHECK(event.button == InputManager::BTN_CONFIRM && event.pressed);
+  CHECK(replay.input.popEvent(event));
+  CHECK(event.button == InputManager::BTN_DOWN && !event.pressed && event.heldTime == 1200);
+  CHECK(replay.input.popEvent(event));
+  CHECK(event.button == InputManager::BTN_CONFIRM && !event.pressed && event.heldTime == 50);
+  CHECK(!replay.input.popEvent(event));
+
+  replay.tap(InputManager::BTN_BACK);
+  replay.input.clearEvents();
+  CHECK(!replay.input.popEvent(event));
+}
+
+void testOverflow() {
+  Replay replay;
+  // More events than the queue holds, each identified by its held time
+  constexpr int pushed = QUEUE_SIZE + 9;
+  for (int i = 0; i < pushed; i++) {
+    replay.release(InputManager::BTN_LEFT, i);
+  }
+
+  MappedInputManager::Event event;
+  for (int i = pushed - QUEUE_SIZE; i < pushed; i++) {
+    CHECK(replay.input.popEvent(event));
+    CHECK(event.heldTime == static_cast<unsigned long>(i));
+  }
+  CHECK(!replay.input.popEvent(event));
+
+  // The queue keeps working after its head has wrapped around
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < QUEUE_SIZE / 2 + 3; i++) {
+      replay.release(InputManager::BTN_RIGHT, 1000 + i);
+    }
+    for (int i = 0; i < QUEUE_SIZE / 2 + 3; i++) {
+      CHECK(replay.input.popEvent(event));
+      CHECK(event.heldTime == static_cast<unsigned long>(1000 + i));
+    }
+    CHECK(!replay.input.popEvent(event));
+  }
+}
+
+void testPageTurns() {
+  setLayout(CrossPointSettings::BACK_CONFIRM_LEFT_RIGHT, CrossPointSettings::PREV_NEXT);
+  Replay replay;
+  int turns = 0;
+  int longTurns = 0;
+
+  CHECK(!replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == 0 && longTurns == 0);
+
+  // Side and front buttons both turn pages, other buttons and presses are dropped
+  replay.tap(InputManager::BTN_DOWN);
+  replay.tap(InputManager::BTN_RIGHT);
+  replay.tap(InputManager::BTN_CONFIRM);
+  replay.tap(InputManager::BTN_DOWN);
+  replay.tap(InputManager::BTN_UP);
+  replay.tap(InputManager::BTN_DOWN, 900);
+  replay.tap(InputManager::BTN_LEFT, 2000);
+  replay.tap(InputManager::BTN_DOWN, LONG_PRESS_MS);
+  replay.press(InputManager::BTN_DOWN);
+  CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == 3);
+  CHECK(longTurns == 0);
+  CHECK(replay.queued() == 0);
+
+  // Only a button that is not a page turn
+  replay.release(InputManager::BTN_DOWN, 100);
+  replay.tap(InputManager::BTN_BACK);
+  CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == 1);
+  replay.tap(InputManager::BTN_BACK);
+  replay.tap(InputManager::BTN_POWER);
+  CHECK(!replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(replay.queued() == 0);
+
+  // Long presses are summed apart from short ones
+  replay.tap(InputManager::BTN_DOWN, 900);
+  replay.tap(InputManager::BTN_DOWN, 900);
+  replay.tap(InputManager::BTN_UP, 900);
+  replay.tap(InputManager::BTN_UP);
+  CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == -1 && longTurns == 1);
+}
+
+void testPageTurnLayouts() {
+  int turns = 0;
+  int longTurns = 0;
+
+  // Swapped side buttons
+  setLayout(CrossPointSettings::BACK_CONFIRM_LEFT_RIGHT, CrossPointSettings::NEXT_PREV);
+  {
+    Replay replay;
+    replay.tap(InputManager::BTN_UP);
+    replay.tap(InputManager::BTN_UP);
+    replay.tap(InputManager::BTN_DOWN);
+    replay.tap(InputManager::BTN_UP);
+    CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+    CHECK(turns == 2);
+  }
+
+  // Front buttons where Confirm is Right and Back is Left
+  setLayout(CrossPointSettings::LEFT_RIGHT_BACK_CONFIRM, CrossPointSettings::PREV_NEXT);
+  {
+    Replay replay;
+    replay.tap(InputManager::BTN_CONFIRM);
+    replay.tap(InputManager::BTN_CONFIRM);
+    replay.tap(InputManager::BTN_BACK);
+    replay.tap(InputManager::BTN_LEFT);
+    replay.tap(InputManager::BTN_RIGHT);
+    CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+    CHECK(turns == 1);
+  }
+
+  setLayout(CrossPointSettings::BACK_CONFIRM_LEFT_RIGHT, CrossPointSettings::PREV_NEXT);
+}
+
+void testPageTurnOverflow() {
+  setLayout(CrossPointSettings::BACK_CONFIRM_LEFT_RIGHT, CrossPointSettings::PREV_NEXT);
+  Replay replay;
+  int turns = 0;
+  int longTurns = 0;
+
+  // Taps queued while a page was being rendered: a press and a release each, so a full queue holds half as many turns
+  for (int i = 0; i < QUEUE_SIZE; i++) {
+    replay.tap(InputManager::BTN_DOWN);
+  }
+  CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == QUEUE_SIZE / 2);
+
+  // The dropped events are the oldest ones, so the newest taps decide the direction
+  for (int i = 0; i < QUEUE_SIZE; i++) {
+    replay.tap(InputManager::BTN_DOWN);
+  }
+  for (int i = 0; i < QUEUE_SIZE / 2 - 2; i++) {
+    replay.tap(InputManager::BTN_UP);
+  }
+  CHECK(replay.input.takePageTurns(LONG_PRESS_MS, turns, longTurns));
+  CHECK(turns == 2 - (QUEUE_SIZE / 2 - 2));
+  CHECK(longTurns == 0);
+}
+void testEpubPageTurns() {
+  using EpubPageTurns::LAST_PAGE;
+  const auto is = [](const EpubPageTurns::Target& target, const bool reload, const int spineDelta, const int page) {
+    return target.reload == reload && target.spineDelta == spineDelta && target.page == page;
+  };
+  // Within the section, and past either end of it
+  CHECK(is(EpubPageTurns::resolve(3, 10, 4, 0), false, 0, 7));
+  CHECK(is(EpubPageTurns::resolve(3, 10, -3, 0), false, 0, 0));
+  CHECK(is(EpubPageTurns::resolve(3, 10, -4, 0), true, -1, LAST_PAGE));
+  CHECK(is(EpubPageTurns::resolve(3, 10, 6, 0), false, 0, 9));
+  CHECK(is(EpubPageTurns::resolve(3, 10, 9, 0), true, 1, 2));
+  // Chapter skips, then the turns from the start of the chapter skipped to
+  CHECK(is(EpubPageTurns::resolve(3, 10, 0, 2), true, 2, 0));
+  CHECK(is(EpubPageTurns::resolve(3, 10, 3, 1), true, 1, 3));
+  CHECK(is(EpubPageTurns::resolve(3, 10, -1, 1), true, 0, LAST_PAGE));
+  CHECK(is(EpubPageTurns::resolve(3, 10, -2, -1), true, -2, LAST_PAGE));
+  CHECK(is(EpubPageTurns::resolve(0, 0, 100000, 1), true, 1, LAST_PAGE - 1));
+}
+
+// EpubReaderActivity over a book of the given chapter lengths: the loop takes page turns only while no render is
+// running, as the display task holds the rendering mutex meanwhile, and each batch it takes costs one render
+struct SlowEpubReader {
+  Replay replay;
+  std::vector<int> chapters;
+  unsigned long renderMs;
+  unsigned long now = 0;
+  unsigned long renderEnd = 0;
+  int spine = 0;
+  int page = 0;
+  int renders = 0;
+
+  SlowEpubReader(std::vector<int> chapters, const unsigned long renderMs)
+      : chapters(std::move(chapters)), renderMs(renderMs) {}
+
+  void loop() {
+    int turns;
+    int chapterSkips;
+    if (now >= renderEnd && replay.input.takePageTurns(LONG_PRESS_MS, turns, chapterSkips)) {
+      const auto target = EpubPageTurns::resolve(page, chapters[spine], turns, chapterSkips);
+      // What renderScreen() clamps when it loads the section
+      if (target.reload) {
+        spine = std::clamp(spine + target.spineDelta, 0, static_cast<int>(chapters.size()) - 1);
+      }
+      page = std::min(target.page, chapters[spine] - 1);
+      renders++;
+      renderEnd = now + renderMs;
+    }
+    now += POLL_MS;
+  }
+  void waitFor(const unsigned long ms) {
+    for (const unsigned long end = now + ms; now < end;) loop();
+  }
+  void tap(const uint8_t button, const unsigned long heldTime = 100) {
+    replay.press(button);
+    waitFor(heldTime);
+    replay.release(button, heldTime);
+    waitFor(100);
+  }
+  void settle() { waitFor(renderMs + POLL_MS); }
+};
+
+void testSlowRender() {
+  setLayout(CrossPointSettings::BACK_CONFIRM_LEFT_RIGHT, CrossPointSettings::PREV_NEXT);
+
+  // Twelve quick taps across chapters of five pages, each render long enough for a few taps to queue up
+  {
+    SlowEpubReader reader({5, 5, 5, 5}, 600);
+    for (int i = 0; i < 12; i++) {
+      reader.tap(InputManager::BTN_DOWN);
+    }
+    reader.settle();
+    CHECK(reader.spine == 2 && reader.page == 2);
+    CHECK(reader.renders < 12);
+  }
+
+  // A chapter skip and page turns pressed while a chapter is being built: all of them count
+  {
+    SlowEpubReader reader({20, 20, 20}, 3000);
+    reader.tap(InputManager::BTN_DOWN);
+    reader.tap(InputManager::BTN_DOWN, LONG_PRESS_MS + 100);
+    reader.tap(InputManager::BTN_DOWN);
+    reader.tap(InputManager::BTN_DOWN);
+    reader.tap(InputManager::BTN_DOWN);
+    reader.tap(InputManager::BTN_UP);
+    reader.settle();
+    CHECK(reader.spine == 1 && reader.page == 2);
+    CHECK(reader.renders == 2);
+
+    // Skipping ahead and turning back in one batch ends on the last page of the chapter skipped from
+    reader.tap(InputManager::BTN_DOWN);
+    reader.tap(InputManager::BTN_DOWN, LONG_PRESS_MS + 100);
+    reader.tap(InputManager::BTN_UP);
+    reader.tap(InputManager::BTN_UP);
+    reader.tap(InputManager::BTN_UP);
+    reader.settle();
+    CHECK(reader.spine == 1 && reader.page == 19);
+    CHECK(reader.renders == 4);
+  }
+}
+}  // namespace
+
+int main() {
+  testEventOrder();
+  testOverflow();
+  testPageTurns();
+  testPageTurnLayouts();
+  testPageTurnOverflow();
+  testEpubPageTurns();
+  testSlowRender();
+  return testResult();
+}
@@ -0,0 +1,99 @@
+// Checks the natural sort order of StringUtils::naturalSortKey, which the file browser sorts directories by: numbers by
+// value however many digits or leading zeros they have, letters without case.
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "util/StringUtils.h"
+
+namespace {
+using StringUtils::naturalSortKey;
+
+bool sortsBefore(const std::string& a, const std::string& b) {
+  const bool before = naturalSortKey(a) < naturalSortKey(b);
+  if (!before) {
+    fprintf(stderr, "\"%s\" does not sort before \"%s\"\n", a.c_str(), b.c_str());
+  }
+  return before;
+}
+
+bool sortsEqual(const std::string& a, const std::string& b) { return naturalSortKey(a) == naturalSortKey(b); }
+
+void testNumbers() {
+  CHECK(sortsBefore("Vol 2", "Vol 10"));
+  CHECK(sortsBefore("Vol 9", "Vol 10"));
+  CHECK(sortsBefore("Vol 10", "Vol 11"));
+  CHECK(sortsBefore("Vol 99", "Vol 100"));
+  CHECK(sortsBefore("1", "2"));
+  CHECK(sortsBefore("file2.epub", "file10.epub"));
+  CHECK(sortsBefore("a1b2", "a1b10"));
+  CHECK(sortsBefore("a2b1", "a10b1"));
+  // A number sorts against letters the way its first digit would
+  CHECK(sortsBefore("Vol 2", "Vol A"));
+  CHECK(sortsBefore("Vol", "Vol 1"));
+  CHECK(sortsBefore("Vol 1", "Vol 1a"));
+  CHECK(sortsBefore("Vol 1.epub", "Vol 1a.epub"));
+}
+
+void testLeadingZeros() {
+  CHECK(sortsEqual("Vol 007", "Vol 7"));
+  CHECK(sortsEqual("0", "000"));
+  CHECK(sortsBefore("Vol 0", "Vol 1"));
+  CHECK(sortsBefore("Vol 02", "Vol 3"));
+  CHECK(sortsBefore("Vol 009", "Vol 10"));
+  CHECK(sortsBefore("Vol 7", "Vol 0010"));
+  CHECK(sortsBefore("Vol 00000000001", "Vol 2"));
+}
+
+void testCase() {
+  CHECK(sortsEqual("Book", "book"));
+  CHECK(sortsEqual("BOOK 2", "book 2"));
+  CHECK(sortsBefore("apple", "Banana"));
+  CHECK(sortsBefore("Apple", "banana"));
+  CHECK(sortsBefore("a", "B"));
+}
+
+// Runs of 9 digits and more, where the length prefix no longer fits one digit
+void testLongNumbers() {
+  CHECK(sortsBefore("99999999", "100000000"));
+  CHECK(sortsBefore("999999999", "1000000000"));
+  CHECK(sortsBefore("Vol 999999999", "Vol 1234567890"));
+  CHECK(sortsBefore("Vol 123456789", "Vol 123456790"));
+  CHECK(sortsBefore("Vol 12345678901234567", "Vol 123456789012345678"));
+  CHECK(sortsBefore("Vol 99999999999999999", "Vol 100000000000000000"));
+  CHECK(sortsBefore("Vol 123456789012345678", "Vol 123456789012345679"));
+  CHECK(sortsBefore("Vol 999999999999999999999999", "Vol 1000000000000000000000000"));
+  CHECK(sortsBefore("20240101123000 scan", "20240101123001 scan"));
+  CHECK(sortsEqual("Vol 0001234567890", "Vol 1234567890"));
+
+  // 1, 9, 10, 99, 100 and so on up to 20 digits sort by value
+  std::vector<std::string> numbers;
+  for (int digits = 1; digits <= 20; digits++) {
+    numbers.push_back("1" + std::string(digits - 1, '0'));
+    numbers.push_back(std::string(digits, '9'));
+  }
+  for (size_t i = 1; i < numbers.size(); i++) {
+    CHECK(sortsBefore("n" + numbers[i - 1] + ".epub", "n" + numbers[i] + ".epub"));
+  }
+}
+
+void testSorting() {
+  std::vector<std::string> names = {"Vol 10.epub", "vol 1.epub", "Vol 2.epub", "Extras", "Vol 002a.epub",
+                                    "Vol 1234567890.epub", "Vol 999999999.epub", "VOL 3.epub"};
+  std::sort(names.begin(), names.end(),
+            [](const std::string& a, const std::string& b) { return naturalSortKey(a) < naturalSortKey(b); });
+  const std::vector<std::string> expected = {"Extras",     "vol 1.epub",  "Vol 2.epub",        "Vol 002a.epub",
+                                             "VOL 3.epub", "Vol 10.epub", "Vol 999999999.epub", "Vol 1234567890.epub"};
+  CHECK(names == expected);
+}
+}  // namespace
+
+int main() {
+  testNumbers();
+  testLeadingZeros();
+  testCase();
+  testLongNumbers();
+  testSorting();
+  return testResult();
+}
@@ -0,0 +1,477 @@
+// Compares XhtmlTokenizer with expat, which chapters were parsed with before it. A generated corpus of chapters using
+// everything the layout code looks at must give the same elements, attributes and text, and the same pages byte for
+// byte, as ChapterHtmlSlimParser gave through expat. The tokenizer's intended differences are checked on their own, and
+// its throughput is printed next to expat's.
+#include <BuiltinFonts.h>
+#include <EInkDisplay.h>
+#include <Epub/Page.h>
+#include <Epub/parsers/ChapterHtmlSlimParser.h>
+#include <Epub/parsers/XhtmlTokenizer.h>
+#include <GfxRenderer.h>
+#include <SDCardManager.h>
+#include <expat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CrossPointSettings.h"
+#include "ExpatChapterParser.h"
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr int CHAPTERS = 120;
+constexpr int LATIN1_CHAPTERS = 8;
+// Read size of ChapterHtmlSlimParser
+constexpr size_t CHUNK_SIZE = 1024;
+constexpr char CHAPTER_PATH[] = "/chapter.xhtml";
+constexpr char PAGES_PATH[] = "/pages.bin";
+
+// Generates chapters the way books are written: headings, paragraphs, lists and quotes with inline styles, line
+// breaks, images, tables and page break markers the layout skips, comments, processing instructions, CDATA, character
+// references, soft hyphens and paragraphs of a thousand words, in both quote styles and with LF or CRLF line ends
+class ChapterWriter {
+  std::mt19937 random;
+  bool latin1 = false;
+  std::string newline = "\n";
+  std::string out;
+
+  int pick(const int count) { return static_cast<int>(random() % count); }
+  bool chance(const int percent) { return pick(100) < percent; }
+
+  std::string quoted(const std::string& value) {
+    const char quote = chance(30) ? '\'' : '"';
+    return quote + value + quote;
+  }
+
+  void word() {
+    static const char* ascii[] = {"the", "reader", "page", "of", "a", "book", "light", "and", "shadow", "quietly",
+                                  "turned", "Chapter", "river", "stone", "walked", "it", "was", "never", "again"};
+    static const char* utf8[] = {"caf\xC3\xA9",
+                                 "na\xC3\xAFve",
+                                 "Stra\xC3\x9F" "e",
+                                 "\xCE\x95\xCE\xBB\xCE\xBB\xCE\xAC\xCE\xB4\xCE\xB1",
+                                 "\xE2\x80\x9Cquoted\xE2\x80\x9D",
+                                 "hy\xC2\xAD" "phen\xC2\xAD" "ated"};
+    static const char* latin1Words[] = {"caf\xE9", "na\xEFve", "Stra\xDF" "e", "\xBFqu\xE9?", "se\xF1or"};
+    static const char* references[] = {"&amp;", "&lt;tag&gt;", "&quot;said&quot;", "it&apos;s", "&#8212;",
+                                       "&#x2019;s", "&#169;", "&#xE9;t&#xE9;"};
+
+    const int kind = pick(100);
+    if (kind < 70) {
+      out += ascii[pick(sizeof(ascii) / sizeof(ascii[0]))];
+    } else if (kind < 85) {
+      out += latin1 ? latin1Words[pick(sizeof(latin1Words) / sizeof(latin1Words[0]))]
+                    : utf8[pick(sizeof(utf8) / sizeof(utf8[0]))];
+    } else if (kind < 97) {
+      out += references[pick(sizeof(references) / sizeof(references[0]))];
+    } else {
+      // Longer than the layout's word buffer
+      out += std::string(150 + pick(200), 'w');
+    }
+  }
+
+  void space() {
+    const int kind = pick(20);
+    out += kind == 0 ? newline + "  " : kind == 1 ? "\t" : kind == 2 ? "  " : " ";
+  }
+
+  void words(const int count) {
+    for (int i = 0; i < count; i++) {
+      if (i > 0) {
+        space();
+      }
+      word();
+    }
+  }
+
+  void inlineContent(const int depth) {
+    const int count = 1 + pick(8);
+    for (int i = 0; i < count; i++) {
+      const int kind = pick(100);
+      if (kind < 50 || depth > 3) {
+        words(1 + pick(12));
+      } else if (kind < 75) {
+        static const char* tags[] = {"b", "i", "em", "strong", "span", "a", "small"};
+        const char* tag = tags[pick(sizeof(tags) / sizeof(tags[0]))];
+        out += std::string("<") + tag;
+        if (chance(40)) {
+          out += " class=" + quoted("c" + std::to_string(pick(5)));
+        }
+        out += ">";
+        inlineContent(depth + 1);
+        out += std::string("</") + tag + ">";
+      } else if (kind < 80) {
+        out += chance(50) ? "<br/>" : "<br />";
+      } else if (kind < 84) {
+        out += "<img src=" + quoted("images/i" + std::to_string(pick(50)) + ".png") + " alt=" + quoted("an image") +
+               "/>";
+      } else if (kind < 87) {
+        out += "<!-- a comment with <tags> & such -->";
+      } else if (kind < 89) {
+        out += "<![CDATA[if (a < b && c > d) return;]]>";
+      } else if (kind < 91) {
+        out += "<?page number=\"" + std::to_string(pick(400)) + "\"?>";
+      } else if (kind < 94) {
+        out += "<span epub:type=" + quoted("pagebreak") + " id=" + quoted("p" + std::to_string(pick(400))) + "/>";
+      } else if (kind < 96) {
+        out += "<span role=" + quoted("doc-pagebreak") + ">" + std::to_string(pick(400)) + "</span>";
+      } else {
+        out += "<sup><a href=" + quoted("#n" + std::to_string(pick(40))) + " epub:type=" + quoted("noteref") + ">" +
+               std::to_string(pick(40)) + "</a></sup>";
+      }
+      if (chance(80)) {
+        space();
+      }
+    }
+  }
+
+  void block(const int depth) {
+    const int kind = pick(100);
+    if (kind < 8) {
+      const std::string tag = "h" + std::to_string(1 + pick(6));
+      out += "<" + tag + ">";
+      inlineContent(3);
+      out += "</" + tag + ">";
+    } else if (kind < 70 || depth > 1) {
+      out += chance(20) ? "<p class=" + quoted("indent") + ">" : "<p>";
+      inlineContent(0);
+      out += "</p>";
+    } else if (kind < 78) {
+      out += "<div>" + newline;
+      for (int i = 1 + pick(3); i > 0; i--) {
+        block(depth + 1);
+        out += newline;
+      }
+      out += "</div>";
+    } else if (kind < 84) {
+      out += "<blockquote>";
+      block(depth + 1);
+      out += "</blockquote>";
+    } else if (kind < 92) {
+      out += "<ul>" + newline;
+      for (int i = 1 + pick(5); i > 0; i--) {
+        out += "<li>";
+        inlineContent(1);
+        out += "</li>" + newline;
+      }
+      out += "</ul>";
+    } else if (kind < 96) {
+      out += "<table><tr><td>";
+      words(3);
+      out += "</td><td>";
+      words(2);
+      out += "</td></tr></table>";
+    } else {
+      out += "<div epub:type=" + quoted("pagebreak") + " title=" + quoted(std::to_string(pick(400))) + "></div>";
+    }
+  }
+
+ public:
+  explicit ChapterWriter(const unsigned seed) : random(seed) {}
+
+  std::string chapter(const bool latin1Chapter, const int blocks) {
+    latin1 = latin1Chapter;
+    newline = chance(25) ? "\r\n" : "\n";
+    out = latin1 ? "<?xml version='1.0' encoding='ISO-8859-1'?>" : "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    out += newline;
+    out += chance(50) ? "<!DOCTYPE html>"
+                      : "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" "
+                        "\"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">";
+    out += newline + "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\">" +
+           newline + "<head>" + newline + "<title>Chapter</title>" + newline +
+           "<link rel=\"stylesheet\" type=\"text/css\" href=\"style.css\"/>" + newline +
+           "<style type=\"text/css\">p { margin: 0 }</style>" + newline + "</head>" + newline + "<body>" + newline;
+    for (int i = 0; i < blocks; i++) {
+      block(0);
+      out += newline;
+    }
+    if (chance(30)) {
+      // Past the 750 words after which the layout splits a text block into pages as it goes
+      out += "<p>";
+      words(1000 + pick(1000));
+      out += "</p>" + newline;
+    }
+    out += "</body>" + newline + "</html>" + newline;
+    return out;
+  }
+};
+
+// Elements, attributes and text as one string, with runs of text joined however the parser split them
+struct Events {
+  std::string log;
+  std::string text;
+
+  void flushText() {
+    if (!text.empty()) {
+      log += "\"" + text + "\"";
+      text.clear();
+    }
+  }
+
+  static void startElement(void* userData, const char* name, const char** atts) {
+    auto* self = static_cast<Events*>(userData);
+    self->flushText();
+    self->log += std::string("<") + name;
+    for (int i = 0; atts && atts[i]; i += 2) {
+      self->log += std::string(" ") + atts[i] + "=" + atts[i + 1];
+    }
+    self->log += ">";
+  }
+  static void characterData(void* userData, const char* s, const int len) {
+    static_cast<Events*>(userData)->text.append(s, len);
+  }
+  static void endElement(void* userData, const char* name) {
+    auto* self = static_cast<Events*>(userData);
+    self->flushText();
+    self->log += std::string("</") + name + ">";
+  }
+};
+
+std::string tokenizerEvents(const std::string& chapter, const size_t chunkSize = CHUNK_SIZE) {
+  Events events;
+  XhtmlTokenizer tokenizer(&events, Events::startElement, Events::characterData, Events::endElement);
+  size_t offset = 0;
+  do {
+    const size_t len = std::min(chunkSize, chapter.size() - offset);
+    char* buffer = tokenizer.getBuffer(chunkSize);
+    CHECK(buffer);
+    memcpy(buffer, chapter.data() + offset, len);
+    offset += len;
+    CHECK(tokenizer.parseBuffer(len, offset == chapter.size()));
+  } while (offset < chapter.size());
+  events.flushText();
+  return events.log;
+}
+
+std::string expatEvents(const std::string& chapter) {
+  Events events;
+  const XML_Parser parser = XML_ParserCreate(nullptr);
+  XML_SetUserData(parser, &events);
+  XML_SetElementHandler(parser, Events::startElement, Events::endElement);
+  XML_SetCharacterDataHandler(parser, Events::characterData);
+  size_t offset = 0;
+  do {
+    const size_t len = std::min(CHUNK_SIZE, chapter.size() - offset);
+    memcpy(XML_GetBuffer(parser, CHUNK_SIZE), chapter.data() + offset, len);
+    offset += len;
+    if (XML_ParseBuffer(parser, static_cast<int>(len), offset == chapter.size()) == XML_STATUS_ERROR) {
+      fprintf(stderr, "expat: %s at line %lu\n", XML_ErrorString(XML_GetErrorCode(parser)),
+              XML_GetCurrentLineNumber(parser));
+      CHECK(false);
+      break;
+    }
+  } while (offset < chapter.size());
+  XML_ParserFree(parser);
+  events.flushText();
+  return events.log;
+}
+
+// Expat normalises CRLF line ends in text to LF, the tokenizer passes them on: the layout treats both as whitespace
+std::string withLfLineEnds(std::string events) {
+  size_t pos = 0;
+  while ((pos = events.find("\r\n", pos)) != std::string::npos) {
+    events.erase(pos, 1);
+  }
+  return events;
+}
+
+std::string readCard(const std::string& path) {
+  std::string data;
+  FsFile file;
+  if (SdMan.openFileForRead("TST", path, file)) {
+    data.resize(file.size());
+    file.read(&data[0], data.size());
+    file.close();
+  }
+  return data;
+}
+
+struct Layout {
+  GfxRenderer& renderer;
+  int fontId;
+  uint16_t viewportWidth;
+  uint16_t viewportHeight;
+};
+
+// Every page of the chapter on the card, serialized as in a section file, and the time the layout took
+std::string layOut(const Layout& layout, const bool expat, double& ms) {
+  FsFile pagesFile;
+  CHECK(SdMan.openFileForWrite("TST", PAGES_PATH, pagesFile));
+  const auto completePage = [&pagesFile](std::unique_ptr<Page> page) { CHECK(page->serialize(pagesFile)); };
+  const std::string chapterPath = CHAPTER_PATH;
+
+  const auto start = std::chrono::steady_clock::now();
+  bool parsed;
+  if (expat) {
+    parsed = expatParseAndBuildPages(chapterPath, layout.renderer, layout.fontId, SETTINGS.getReaderLineCompression(),
+                                     SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, layout.viewportWidth,
+                                     layout.viewportHeight, completePage);
+  } else {
+    ChapterHtmlSlimParser parser(chapterPath, layout.renderer, layout.fontId, SETTINGS.getReaderLineCompression(),
+                                 SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, layout.viewportWidth,
+                                 layout.viewportHeight, completePage);
+    parsed = parser.parseAndBuildPages();
+  }
+  ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  CHECK(parsed);
+  pagesFile.close();
+  return readCard(PAGES_PATH);
+}
+
+void writeChapter(const std::string& chapter) {
+  FsFile file;
+  CHECK(SdMan.openFileForWrite("TST", CHAPTER_PATH, file));
+  CHECK(file.write(reinterpret_cast<const uint8_t*>(chapter.data()), chapter.size()) == chapter.size());
+  file.close();
+}
+
+void testCorpus(const std::vector<std::string>& corpus, const Layout& layout) {
+  double expatMs = 0;
+  double tokenizerMs = 0;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    const std::string& chapter = corpus[i];
+    if (withLfLineEnds(tokenizerEvents(chapter)) != expatEvents(chapter)) {
+      fprintf(stderr, "Chapter %zu: elements or text differ from expat\n", i);
+      CHECK(false);
+    }
+
+    writeChapter(chapter);
+    const std::string expatPages = layOut(layout, true, expatMs);
+    const std::string tokenizerPages = layOut(layout, false, tokenizerMs);
+    if (tokenizerPages != expatPages) {
+      fprintf(stderr, "Chapter %zu: pages differ from expat\n", i);
+      CHECK(false);
+    }
+    CHECK(!tokenizerPages.empty());
+  }
+  printf("Layout of %zu chapters: expat %.0f ms, XhtmlTokenizer %.0f ms\n", corpus.size(), expatMs, tokenizerMs);
+}
+
+// However the input is split into reads, the same events come out
+void testChunkSizes(const std::vector<std::string>& corpus) {
+  for (int i = 0; i < 4; i++) {
+    const std::string& chapter = corpus[i];
+    const std::string expected = tokenizerEvents(chapter);
+    for (const size_t chunkSize : {1, 2, 3, 7, 64, 1023, 4096}) {
+      if (tokenizerEvents(chapter, chunkSize) != expected) {
+        fprintf(stderr, "Chapter %d: events differ with %zu byte reads\n", i, chunkSize);
+        CHECK(false);
+      }
+    }
+  }
+}
+
+// Where the tokenizer does not do what expat did, on purpose
+void testIntendedDifferences() {
+  // Element and attribute names are lower cased, so that HTML written in upper case is laid out
+  const std::string upperCase = "<html><BODY><P Class=\"a\">Text</P></BODY></html>";
+  CHECK(tokenizerEvents(upperCase) == "<html><body><p class=a>\"Text\"</p></body></html>");
+  CHECK(expatEvents(upperCase) == "<html><BODY><P Class=a>\"Text\"</P></BODY></html>");
+
+  // HTML named references are decoded where expat, which does not read the DTD, dropped them
+  const std::string references =
+      "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML 1.1//EN\" \"http://www.w3.org/TR/xhtml11/DTD/xhtml11.dtd\">"
+      "<html><body><p>a&nbsp;b&mdash;c</p></body></html>";
+  CHECK(tokenizerEvents(references) == "<html><body><p>\"a\xC2\xA0" "b\xE2\x80\x94" "c\"</p></body></html>");
+  CHECK(expatEvents(references) == "<html><body><p>\"abc\"</p></body></html>");
+
+  // CRLF line ends in text are passed on rather than normalised to LF
+  const std::string crlf = "<html><body><p>one\r\ntwo</p></body></html>";
+  CHECK(tokenizerEvents(crlf) == "<html><body><p>\"one\r\ntwo\"</p></body></html>");
+  CHECK(expatEvents(crlf) == "<html><body><p>\"one\ntwo\"</p></body></html>");
+}
+
+struct Counts {
+  size_t elements = 0;
+  size_t textBytes = 0;
+
+  static void startElement(void* userData, const char*, const char**) { static_cast<Counts*>(userData)->elements++; }
+  static void characterData(void* userData, const char*, const int len) {
+    static_cast<Counts*>(userData)->textBytes += len;
+  }
+  static void endElement(void*, const char*) {}
+};
+
+// Parsing alone, in 1KB reads as the firmware reads chapters
+double throughput(const std::vector<std::string>& corpus, const size_t corpusBytes, const bool expat) {
+  constexpr int rounds = 5;
+  Counts counts;
+  const auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const auto& chapter : corpus) {
+      size_t offset = 0;
+      if (expat) {
+        const XML_Parser parser = XML_ParserCreate(nullptr);
+        XML_SetUserData(parser, &counts);
+        XML_SetElementHandler(parser, Counts::startElement, Counts::endElement);
+        XML_SetCharacterDataHandler(parser, Counts::characterData);
+        do {
+          const size_t len = std::min(CHUNK_SIZE, chapter.size() - offset);
+          memcpy(XML_GetBuffer(parser, CHUNK_SIZE), chapter.data() + offset, len);
+          offset += len;
+          XML_ParseBuffer(parser, static_cast<int>(len), offset == chapter.size());
+        } while (offset < chapter.size());
+        XML_ParserFree(parser);
+      } else {
+        XhtmlTokenizer tokenizer(&counts, Counts::startElement, Counts::characterData, Counts::endElement);
+        do {
+          const size_t len = std::min(CHUNK_SIZE, chapter.size() - offset);
+          memcpy(tokenizer.getBuffer(CHUNK_SIZE), chapter.data() + offset, len);
+          offset += len;
+          tokenizer.parseBuffer(len, offset == chapter.size());
+        } while (offset < chapter.size());
+      }
+    }
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CHECK(counts.elements > 0 && counts.textBytes > 0);
+  return rounds * corpusBytes / seconds / (1024 * 1024);
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/XhtmlTokenizerTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+
+  ChapterWriter writer(20240101);
+  std::vector<std::string> corpus;
+  size_t corpusBytes = 0;
+  for (int i = 0; i < CHAPTERS; i++) {
+    // From a few paragraphs up to chapters well past the 50KB that shows a progress bar
+    corpus.push_back(writer.chapter(i < LATIN1_CHAPTERS, 5 + (i * 37) % 100));
+    corpusBytes += corpus.back().size();
+  }
+
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  insertBuiltinFonts(renderer);
+  int top, right, bottom, left;
+  renderer.getOrientedViewableTRBL(&top, &right, &bottom, &left);
+  const Layout layout{renderer, SETTINGS.getReaderFontId(),
+                      static_cast<uint16_t>(renderer.getScreenWidth() - left - right - 2 * SETTINGS.screenMargin),
+                      static_cast<uint16_t>(renderer.getScreenHeight() - top - bottom - 2 * SETTINGS.screenMargin)};
+
+  testIntendedDifferences();
+  testChunkSizes(corpus);
+  testCorpus(corpus, layout);
+
+  const double expatMbs = throughput(corpus, corpusBytes, true);
+  const double tokenizerMbs = throughput(corpus, corpusBytes, false);
+  printf("Parsing %.1f MB in 1KB reads: expat %.0f MB/s, XhtmlTokenizer %.0f MB/s\n",
+         corpusBytes / (1024.0 * 1024.0), expatMbs, tokenizerMbs);
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,399 @@
+// Parsing speed of the six parsers that classify names with XmlNameTable: container.xml, content.opf, toc.ncx, the
+// EPUB 3 nav document, OPDS feeds and chapters. Each parses a generated document fed to it the way the firmware feeds
+// it, must find everything in it, and prints its throughput. Also checks the tables themselves, and times the chapter
+// parser's table against the strcmp chains it used before.
+#include <BuiltinFonts.h>
+#include <EInkDisplay.h>
+#include <Epub/BookMetadataCache.h>
+#include <Epub/Page.h>
+#include <Epub/parsers/ChapterHtmlSlimParser.h>
+#include <Epub/parsers/ContainerParser.h>
+#include <Epub/parsers/ContentOpfParser.h>
+#include <Epub/parsers/TocNavParser.h>
+#include <Epub/parsers/TocNcxParser.h>
+#include <Epub/parsers/XhtmlTokenizer.h>
+#include <GfxRenderer.h>
+#include <OpdsParser.h>
+#include <SDCardManager.h>
+#include <XmlNames.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "CrossPointSettings.h"
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char CACHE_PATH[] = "/.crosspoint/epub_bench";
+constexpr char BASE_PATH[] = "OEBPS/";
+constexpr char CHAPTER_PATH[] = "/chapter.xhtml";
+// Read size of Epub::readItemContentsToStream
+constexpr size_t CHUNK_SIZE = 1024;
+constexpr int SPINE_ITEMS = 300;
+constexpr int OPDS_ENTRIES = 500;
+
+double secondsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printThroughput(const char* name, const size_t bytes, const double seconds) {
+  printf("%-22s %8.1f KB in %7.2f ms, %6.1f MB/s\n", name, bytes / 1024.0, seconds * 1000,
+         bytes / seconds / (1024 * 1024));
+}
+
+// Writes the document in reads of CHUNK_SIZE, returns the time the parser took
+double feed(Print& parser, const std::string& document) {
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t offset = 0; offset < document.size(); offset += CHUNK_SIZE) {
+    const size_t len = std::min(CHUNK_SIZE, document.size() - offset);
+    CHECK(parser.write(reinterpret_cast<const uint8_t*>(document.data()) + offset, len) == len);
+  }
+  return secondsSince(start);
+}
+
+std::string chapterName(const int i) { return "text/chapter" + std::to_string(i) + ".xhtml"; }
+
+std::string containerXml() {
+  return "<?xml version=\"1.0\"?><container version=\"1.0\" "
+         "xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\"><rootfiles><rootfile "
+         "full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/></rootfiles></container>";
+}
+
+// Every other element carries the opf: prefix, which the table holds too
+std::string contentOpf() {
+  std::string opf =
+      "<?xml version=\"1.0\"?><package xmlns=\"http://www.idpf.org/2007/opf\" version=\"3.0\"><metadata "
+      "xmlns:dc=\"http://purl.org/dc/elements/1.1/\"><dc:title>Benchmark</dc:title><dc:creator>Host Test"
+      "</dc:creator><meta name=\"cover\" content=\"cover\"/></metadata><opf:manifest><item id=\"cover\" "
+      "href=\"cover.jpg\" media-type=\"image/jpeg\"/><item id=\"ncx\" href=\"toc.ncx\" "
+      "media-type=\"application/x-dtbncx+xml\"/><item id=\"nav\" href=\"nav.xhtml\" "
+      "media-type=\"application/xhtml+xml\" properties=\"nav\"/>";
+  for (int i = 0; i < SPINE_ITEMS; i++) {
+    opf += std::string(i % 2 ? "<opf:item" : "<item") + " id=\"c" + std::to_string(i) + "\" href=\"" +
+           chapterName(i) + "\" media-type=\"application/xhtml+xml\"/>";
+  }
+  opf += "</opf:manifest><spine toc=\"ncx\">";
+  for (int i = 0; i < SPINE_ITEMS; i++) {
+    opf += std::string(i % 2 ? "<opf:itemref" : "<itemref") + " idref=\"c" + std::to_string(i) + "\"/>";
+  }
+  return opf + "</spine><guide><reference type=\"text\" href=\"" + chapterName(0) + "\"/></guide></package>";
+}
+
+std::string tocNcx() {
+  std::string ncx = "<?xml version=\"1.0\"?><ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\"><navMap>";
+  for (int i = 0; i < SPINE_ITEMS; i++) {
+    ncx += "<navPoint id=\"n" + std::to_string(i) + "\" playOrder=\"" + std::to_string(i + 1) +
+           "\"><navLabel><text>Chapter " + std::to_string(i) + "</text></navLabel><content src=\"" + chapterName(i) +
+           "#start\"/></navPoint>";
+  }
+  return ncx + "</navMap></ncx>";
+}
+
+std::string tocNav() {
+  std::string nav =
+      "<html xmlns=\"http://www.w3.org/1999/xhtml\" xmlns:epub=\"http://www.idpf.org/2007/ops\"><body>"
+      "<nav epub:type=\"landmarks\"><ol><li><a href=\"" +
+      chapterName(0) + "\">Start</a></li></ol></nav><nav epub:type=\"toc\"><ol>";
+  for (int i = 0; i < SPINE_ITEMS; i++) {
+    nav += "<li><a href=\"" + chapterName(i) + "\">Chapter " + std::to_string(i) + "</a></li>";
+  }
+  return nav + "</ol></nav></body></html>";
+}
+
+// Alternating navigation entries and books, with and without the atom: prefix
+std::string opdsFeed() {
+  std::string feed = "<?xml version=\"1.0\"?><feed xmlns=\"http://www.w3.org/2005/Atom\"><title>Catalog</title>";
+  for (int i = 0; i < OPDS_ENTRIES; i++) {
+    const std::string prefix = i % 4 < 2 ? "" : "atom:";
+    feed += "<" + prefix + "entry><" + prefix + "title>Entry " + std::to_string(i) + "</" + prefix + "title><" +
+            prefix + "id>urn:entry:" + std::to_string(i) + "</" + prefix + "id>";
+    if (i % 2) {
+      feed += "<author><name>Author " + std::to_string(i) + "</name></author><link "
+              "rel=\"http://opds-spec.org/acquisition\" type=\"application/epub+zip\" href=\"/books/" +
+              std::to_string(i) + ".epub\"/>";
+    } else {
+      feed += "<link rel=\"subsection\" type=\"application/atom+xml;profile=opds-catalog\" href=\"/catalog/" +
+              std::to_string(i) + "\"/>";
+    }
+    feed += "</" + prefix + "entry>";
+  }
+  return feed + "</feed>";
+}
+
+std::string chapter() {
+  static const char* words[] = {"the", "reader", "page", "of", "a", "book", "light", "and", "shadow", "quietly"};
+  std::string out =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?><html xmlns=\"http://www.w3.org/1999/xhtml\" "
+      "xmlns:epub=\"http://www.idpf.org/2007/ops\"><head><title>Chapter</title></head><body>";
+  for (int block = 0; block < 400; block++) {
+    if (block % 40 == 0) {
+      out += "<h2>Part " + std::to_string(block / 40) + "</h2>";
+    }
+    if (block % 25 == 0) {
+      out += "<div epub:type=\"pagebreak\" title=\"" + std::to_string(block) + "\"></div>";
+    }
+    out += block % 10 == 9 ? "<blockquote><p>" : "<p>";
+    for (int word = 0; word < 60; word++) {
+      const char* text = words[(block * 7 + word) % 10];
+      switch (word % 15) {
+        case 3:
+          out += std::string("<em>") + text + "</em> ";
+          break;
+        case 8:
+          out += std::string("<strong>") + text + "</strong> ";
+          break;
+        case 12:
+          out += std::string("<span class=\"c\">") + text + "</span><br/>";
+          break;
+        default:
+          out += std::string(text) + " ";
+      }
+    }
+    out += block % 10 == 9 ? "</p></blockquote>" : "</p>";
+  }
+  return out + "</body></html>";
+}
+
+void testTable() {
+  enum Name { OTHER, ITEM, SPINE, ENTRY };
+  constexpr auto names =
+      makeXmlNameTable<Name>({{"item", ITEM}, {"opf:item", ITEM}, {"spine", SPINE}, {"entry", ENTRY}});
+  CHECK(names.find("item") == ITEM);
+  CHECK(names.find("opf:item") == ITEM);
+  CHECK(names.find("spine") == SPINE);
+  CHECK(names.find("entry") == ENTRY);
+  // Unknown names, prefixes, extensions and case variants of known ones
+  for (const char* name : {"", "itemref", "ite", "Item", "opf:", "dc:item", "entrys", "atom:entry"}) {
+    CHECK(names.find(name) == OTHER);
+  }
+  CHECK(names.findLocal("atom:entry") == ENTRY);
+  CHECK(names.findLocal("a:b:spine") == SPINE);
+  CHECK(names.findLocal("entry") == ENTRY);
+  CHECK(names.findLocal("atom:") == OTHER);
+  static_assert(names.find("spine") == SPINE, "Lookups work at compile time");
+}
+
+void benchmarkContainer() {
+  const std::string xml = containerXml();
+  constexpr int rounds = 2000;
+  double seconds = 0;
+  for (int round = 0; round < rounds; round++) {
+    ContainerParser parser(xml.size());
+    CHECK(parser.setup());
+    seconds += feed(parser, xml);
+    CHECK(parser.fullPath == "OEBPS/content.opf");
+  }
+  printThroughput("ContainerParser", xml.size() * rounds, seconds);
+}
+
+// The content.opf and TOC passes of a book.bin build, timing only the parsers
+void benchmarkBook(const bool nav, double& opfSeconds, double& tocSeconds) {
+  const std::string opf = contentOpf();
+  const std::string toc = nav ? tocNav() : tocNcx();
+  const std::string cachePath = CACHE_PATH;
+  const std::string basePath = BASE_PATH;
+  SdMan.mkdir(CACHE_PATH);
+  BookMetadataCache cache(cachePath);
+  CHECK(cache.beginWrite());
+
+  CHECK(cache.beginContentOpfPass());
+  {
+    ContentOpfParser parser(cachePath, basePath, opf.size(), &cache);
+    CHECK(parser.setup());
+    opfSeconds += feed(parser, opf);
+    CHECK(parser.title == "Benchmark");
+    CHECK(parser.author == "Host Test");
+    CHECK(parser.coverItemHref == "OEBPS/cover.jpg");
+    CHECK(parser.tocNcxPath == "OEBPS/toc.ncx");
+    CHECK(parser.tocNavPath == "OEBPS/nav.xhtml");
+    CHECK(parser.textReferenceHref == basePath + chapterName(0));
+  }
+  CHECK(cache.endContentOpfPass());
+  CHECK(cache.getSpineCount() == SPINE_ITEMS);
+
+  CHECK(cache.beginTocPass());
+  if (nav) {
+    TocNavParser parser(basePath, toc.size(), &cache);
+    CHECK(parser.setup());
+    tocSeconds += feed(parser, toc);
+  } else {
+    TocNcxParser parser(basePath, toc.size(), &cache);
+    CHECK(parser.setup());
+    tocSeconds += feed(parser, toc);
+  }
+  CHECK(cache.endTocPass());
+  CHECK(cache.getTocCount() == SPINE_ITEMS);
+  CHECK(cache.endWrite());
+  CHECK(cache.cleanupTmpFiles());
+  fs::remove_all(SdMan.hostPath(CACHE_PATH));
+}
+
+void benchmarkBooks() {
+  constexpr int rounds = 3;
+  double opfSeconds = 0;
+  double ncxSeconds = 0;
+  double navSeconds = 0;
+  for (int round = 0; round < rounds; round++) {
+    benchmarkBook(false, opfSeconds, ncxSeconds);
+    benchmarkBook(true, opfSeconds, navSeconds);
+  }
+  // content.opf includes looking up each spine item in the temp items file
+  printThroughput("ContentOpfParser", contentOpf().size() * rounds * 2, opfSeconds);
+  printThroughput("TocNcxParser", tocNcx().size() * rounds, ncxSeconds);
+  printThroughput("TocNavParser", tocNav().size() * rounds, navSeconds);
+}
+
+void benchmarkOpds() {
+  const std::string feed = opdsFeed();
+  constexpr int rounds = 20;
+  double seconds = 0;
+  for (int round = 0; round < rounds; round++) {
+    OpdsParser parser;
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(parser.parse(feed.data(), feed.size()));
+    seconds += secondsSince(start);
+    CHECK(parser.getEntries().size() == OPDS_ENTRIES);
+    CHECK(parser.getBooks().size() == OPDS_ENTRIES / 2);
+    CHECK(parser.getEntries()[3].author == "Author 3");
+    CHECK(parser.getEntries()[3].href == "/books/3.epub");
+    CHECK(parser.getEntries()[2].href == "/catalog/2");
+  }
+  printThroughput("OpdsParser", feed.size() * rounds, seconds);
+}
+
+// Parsing and layout, as the section file is built
+void benchmarkChapter(const std::string& xhtml) {
+  FsFile file;
+  CHECK(SdMan.openFileForWrite("TST", CHAPTER_PATH, file));
+  CHECK(file.write(reinterpret_cast<const uint8_t*>(xhtml.data()), xhtml.size()) == xhtml.size());
+  file.close();
+
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  insertBuiltinFonts(renderer);
+  int top, right, bottom, left;
+  renderer.getOrientedViewableTRBL(&top, &right, &bottom, &left);
+  const auto viewportWidth =
+      static_cast<uint16_t>(renderer.getScreenWidth() - left - right - 2 * SETTINGS.screenMargin);
+  const auto viewportHeight =
+      static_cast<uint16_t>(renderer.getScreenHeight() - top - bottom - 2 * SETTINGS.screenMargin);
+
+  constexpr int rounds = 3;
+  double seconds = 0;
+  for (int round = 0; round < rounds; round++) {
+    int pages = 0;
+    ChapterHtmlSlimParser parser(CHAPTER_PATH, renderer, SETTINGS.getReaderFontId(),
+                                 SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                 SETTINGS.paragraphAlignment, viewportWidth, viewportHeight,
+                                 [&pages](std::unique_ptr<Page>) { pages++; });
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(parser.parseAndBuildPages());
+    seconds += secondsSince(start);
+    CHECK(pages > 10);
+  }
+  printThroughput("ChapterHtmlSlimParser", xhtml.size() * rounds, seconds);
+}
+
+// The chapter parser's classification, as a table and as the strcmp chains it replaced
+enum TagKind { OTHER_TAG, HEADER_TAG, BLOCK_TAG, LINE_BREAK_TAG, BOLD_TAG, ITALIC_TAG, IMAGE_TAG, SKIP_TAG };
+
+constexpr auto CHAPTER_TAGS = makeXmlNameTable<TagKind>({
+    {"h1", HEADER_TAG},     {"h2", HEADER_TAG},  {"h3", HEADER_TAG},  {"h4", HEADER_TAG},  {"h5", HEADER_TAG},
+    {"h6", HEADER_TAG},     {"p", BLOCK_TAG},    {"li", BLOCK_TAG},   {"div", BLOCK_TAG},  {"blockquote", BLOCK_TAG},
+    {"br", LINE_BREAK_TAG}, {"b", BOLD_TAG},     {"strong", BOLD_TAG}, {"i", ITALIC_TAG},  {"em", ITALIC_TAG},
+    {"img", IMAGE_TAG},     {"head", SKIP_TAG},  {"table", SKIP_TAG},
+});
+
+bool matches(const char* name, const std::initializer_list<const char*> tags) {
+  for (const char* tag : tags) {
+    if (strcmp(name, tag) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// In the order the parser checked them
+TagKind classifyWithStrcmp(const char* name) {
+  if (matches(name, {"img"})) return IMAGE_TAG;
+  if (matches(name, {"head", "table"})) return SKIP_TAG;
+  if (matches(name, {"h1", "h2", "h3", "h4", "h5", "h6"})) return HEADER_TAG;
+  if (matches(name, {"p", "li", "div", "br", "blockquote"})) {
+    return strcmp(name, "br") == 0 ? LINE_BREAK_TAG : BLOCK_TAG;
+  }
+  if (matches(name, {"b", "strong"})) return BOLD_TAG;
+  if (matches(name, {"i", "em"})) return ITALIC_TAG;
+  return OTHER_TAG;
+}
+
+void benchmarkClassification(const std::string& xhtml) {
+  // Start and end tag of every element in the chapter
+  struct Names {
+    std::vector<std::string> list;
+    static void startElement(void* userData, const char* name, const char**) {
+      static_cast<Names*>(userData)->list.push_back(name);
+    }
+    static void characterData(void*, const char*, int) {}
+    static void endElement(void* userData, const char* name) { static_cast<Names*>(userData)->list.push_back(name); }
+  } collected;
+  XhtmlTokenizer tokenizer(&collected, Names::startElement, Names::characterData, Names::endElement);
+  char* buffer = tokenizer.getBuffer(xhtml.size());
+  memcpy(buffer, xhtml.data(), xhtml.size());
+  CHECK(tokenizer.parseBuffer(xhtml.size(), true));
+  const std::vector<std::string>& names = collected.list;
+
+  int differences = 0;
+  for (const auto& name : names) {
+    differences += CHAPTER_TAGS.find(name.c_str()) != classifyWithStrcmp(name.c_str());
+  }
+  CHECK(differences == 0);
+
+  constexpr int rounds = 20;
+  const auto time = [&names](TagKind (*classify)(const char*)) {
+    int sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (const auto& name : names) {
+        sum += classify(name.c_str());
+      }
+    }
+    const double seconds = secondsSince(start);
+    CHECK(sum > 0);
+    return seconds * 1e9 / (rounds * names.size());
+  };
+  const double strcmpNs = time(classifyWithStrcmp);
+  const double tableNs = time([](const char* name) { return CHAPTER_TAGS.find(name); });
+  printf("Chapter element names: %zu, strcmp chains %.1f ns, XmlNameTable %.1f ns per name\n", names.size(), strcmpNs,
+         tableNs);
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/XmlNamesTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+  fs::create_directories(SdMan.hostPath("/.crosspoint"));
+
+  testTable();
+  benchmarkContainer();
+  benchmarkBooks();
+  benchmarkOpds();
+  const std::string xhtml = chapter();
+  benchmarkChapter(xhtml);
+  benchmarkClassification(xhtml);
+
+  fs::remove_all(root);
+  return testResult();
+}
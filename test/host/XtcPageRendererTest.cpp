@@ -0,0 +1,142 @@
+// Checks that pages streamed into the framebuffer come out exactly as the buffered path draws them, in every
+// orientation and however the page is split into chunks.
+#include <EInkDisplay.h>
+#include <GfxRenderer.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "HostTest.h"
+#include "activities/reader/XtcPageRenderer.h"
+
+namespace {
+using XthPass = XtcPageRenderer::XthPass;
+
+constexpr GfxRenderer::Orientation ORIENTATIONS[] = {GfxRenderer::Portrait, GfxRenderer::LandscapeClockwise,
+                                                     GfxRenderer::PortraitInverted,
+                                                     GfxRenderer::LandscapeCounterClockwise};
+constexpr XthPass PASSES[] = {XthPass::BW, XthPass::GRAYSCALE_LSB, XthPass::GRAYSCALE_MSB};
+// One byte at a time, sizes that straddle rows, bands and planes, the reader's chunk size, and the whole page
+constexpr size_t CHUNK_SIZES[] = {1, 7, 61, 1024, SIZE_MAX};
+
+bool isPortrait(const GfxRenderer::Orientation orientation) {
+  return orientation == GfxRenderer::Portrait || orientation == GfxRenderer::PortraitInverted;
+}
+
+// Text-like content: mostly white with runs of the other values, so every pixel value and bit pattern shows up
+std::vector<uint8_t> randomPage(const size_t size, std::mt19937& random) {
+  std::vector<uint8_t> page(size);
+  for (auto& byte : page) {
+    const uint32_t r = random();
+    byte = (r & 3) == 0 ? static_cast<uint8_t>(r >> 8) : 0xFF;
+  }
+  return page;
+}
+
+XtcPageRenderer::PageStream streamOf(const std::vector<uint8_t>& page, const size_t chunkSize) {
+  return [&page, chunkSize](const XtcPageRenderer::ChunkCallback& callback) {
+    for (size_t offset = 0; offset < page.size(); offset += std::min(chunkSize, page.size() - offset)) {
+      callback(page.data() + offset, std::min(chunkSize, page.size() - offset), offset);
+    }
+    return true;
+  };
+}
+
+std::vector<uint8_t> frameBufferOf(const GfxRenderer& renderer) {
+  const uint8_t* frameBuffer = renderer.getFrameBuffer();
+  return {frameBuffer, frameBuffer + GfxRenderer::getBufferSize()};
+}
+
+// How 1-bit pages were drawn before streaming: the whole page in RAM, plotted pixel by pixel
+void drawXtgPageBuffered(const GfxRenderer& renderer, const std::vector<uint8_t>& page, const uint16_t width,
+                         const uint16_t height) {
+  const size_t rowBytes = (width + 7) / 8;
+  renderer.clearScreen();
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) {
+      if (!((page[y * rowBytes + x / 8] >> (7 - x % 8)) & 1)) {
+        renderer.drawPixel(x, y, true);
+      }
+    }
+  }
+}
+
+void testXtgPages(GfxRenderer& renderer, std::mt19937& random) {
+  for (const auto orientation : ORIENTATIONS) {
+    renderer.setOrientation(orientation);
+    const uint16_t fullWidth = isPortrait(orientation) ? EInkDisplay::DISPLAY_HEIGHT : EInkDisplay::DISPLAY_WIDTH;
+    const uint16_t fullHeight = isPortrait(orientation) ? EInkDisplay::DISPLAY_WIDTH : EInkDisplay::DISPLAY_HEIGHT;
+    // A full-size page, and one whose rows and height are not whole bytes or bands
+    const uint16_t sizes[][2] = {{fullWidth, fullHeight}, {static_cast<uint16_t>(fullWidth - 3),
+                                                           static_cast<uint16_t>(fullHeight - 5)}};
+    for (const auto& size : sizes) {
+      const uint16_t width = size[0];
+      const uint16_t height = size[1];
+      const auto page = randomPage(static_cast<size_t>((width + 7) / 8) * height, random);
+      drawXtgPageBuffered(renderer, page, width, height);
+      const auto expected = frameBufferOf(renderer);
+
+      const XtcPageRenderer pageRenderer(renderer, width, height);
+      for (const size_t chunkSize : CHUNK_SIZES) {
+        // Stale content that a streamed page must overwrite completely
+        renderer.clearScreen(0x5A);
+        CHECK(pageRenderer.drawXtgPage(streamOf(page, chunkSize)));
+        if (frameBufferOf(renderer) != expected) {
+          fprintf(stderr, "XTG %ux%u, orientation %d, chunks of %zu: framebuffer differs\n", width, height,
+                  orientation, chunkSize);
+          CHECK(false);
+        }
+      }
+    }
+  }
+}
+
+void testXthPages(GfxRenderer& renderer, std::mt19937& random) {
+  for (const auto orientation : ORIENTATIONS) {
+    renderer.setOrientation(orientation);
+    const uint16_t width = isPortrait(orientation) ? EInkDisplay::DISPLAY_HEIGHT : EInkDisplay::DISPLAY_WIDTH;
+    const uint16_t height = isPortrait(orientation) ? EInkDisplay::DISPLAY_WIDTH : EInkDisplay::DISPLAY_HEIGHT;
+    const auto page = randomPage(((static_cast<size_t>(width) * height + 7) / 8) * 2, random);
+    const XtcPageRenderer pageRenderer(renderer, width, height);
+    // Only a full-size page in portrait is laid out like the panel, the reader plots the others pixel by pixel
+    CHECK(pageRenderer.isPanelNative() == (orientation == GfxRenderer::Portrait));
+
+    for (const auto pass : PASSES) {
+      pageRenderer.drawXthPassBuffered(page.data(), pass);
+      const auto expected = frameBufferOf(renderer);
+      if (!pageRenderer.isPanelNative()) {
+        continue;
+      }
+      for (const size_t chunkSize : CHUNK_SIZES) {
+        renderer.clearScreen(0x5A);
+        CHECK(pageRenderer.drawXthPass(streamOf(page, chunkSize), pass));
+        if (frameBufferOf(renderer) != expected) {
+          fprintf(stderr, "XTH pass %d, orientation %d, chunks of %zu: framebuffer differs\n", static_cast<int>(pass),
+                  orientation, chunkSize);
+          CHECK(false);
+        }
+      }
+    }
+  }
+}
+
+void testReadFailure(GfxRenderer& renderer) {
+  renderer.setOrientation(GfxRenderer::Portrait);
+  const XtcPageRenderer pageRenderer(renderer, EInkDisplay::DISPLAY_HEIGHT, EInkDisplay::DISPLAY_WIDTH);
+  const XtcPageRenderer::PageStream failing = [](const XtcPageRenderer::ChunkCallback&) { return false; };
+  CHECK(!pageRenderer.drawXtgPage(failing));
+  CHECK(!pageRenderer.drawXthPass(failing, XthPass::BW));
+}
+}  // namespace
+
+int main() {
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  std::mt19937 random(1);
+
+  testXtgPages(renderer, random);
+  testXthPages(renderer, random);
+  testReadFailure(renderer);
+  return testResult();
+}
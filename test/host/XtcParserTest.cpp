@@ -0,0 +1,172 @@
+// Opens synthetic XTC files of 100k pages, more than the header's 16-bit page count holds, and of 20 pages. Every page
+// must be found through the lazily read page table, in order, backwards and at random, and opening the large file and
+// loading its first page must take about as long as for the small one. Prints both times.
+#include <SDCardManager.h>
+#include <Xtc/XtcParser.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t LARGE_PAGES = 100000;
+constexpr uint32_t SMALL_PAGES = 20;
+constexpr char LARGE_PATH[] = "/large.xtc";
+constexpr char SMALL_PATH[] = "/small.xtc";
+constexpr char TITLE[] = "Synthetic";
+constexpr uint32_t TITLE_OFFSET = 0x38;
+constexpr uint32_t PAGE_TABLE_OFFSET = 0x100;
+// A page is one 32-pixel row holding its own index, so every page is different and the file stays small
+constexpr uint16_t PAGE_WIDTH = 32;
+constexpr uint16_t PAGE_HEIGHT = 1;
+constexpr size_t PAGE_BYTES = PAGE_WIDTH / 8 * PAGE_HEIGHT;
+constexpr int TIMING_RUNS = 20;
+
+uint32_t pageOffset(const uint32_t pageCount, const uint32_t page) {
+  return PAGE_TABLE_OFFSET + pageCount * sizeof(xtc::PageTableEntry) +
+         page * static_cast<uint32_t>(sizeof(xtc::XtgPageHeader) + PAGE_BYTES);
+}
+
+// Header, title, page table, then the pages. headerPageCount is the 16-bit field, normally the low bits of pageCount.
+bool writeXtc(const char* path, const uint32_t pageCount, const uint16_t headerPageCount) {
+  std::vector<uint8_t> file(pageOffset(pageCount, pageCount), 0);
+
+  xtc::XtcHeader header = {};
+  header.magic = xtc::XTC_MAGIC;
+  header.versionMajor = 1;
+  header.pageCount = headerPageCount;
+  header.headerSize = 88;
+  header.pageTableOffset = PAGE_TABLE_OFFSET;
+  header.dataOffset = pageOffset(pageCount, 0);
+  header.titleOffset = TITLE_OFFSET;
+  memcpy(file.data(), &header, sizeof(header));
+  memcpy(file.data() + TITLE_OFFSET, TITLE, sizeof(TITLE));
+
+  for (uint32_t page = 0; page < pageCount; page++) {
+    const xtc::PageTableEntry entry = {pageOffset(pageCount, page),
+                                       static_cast<uint32_t>(sizeof(xtc::XtgPageHeader) + PAGE_BYTES), PAGE_WIDTH,
+                                       PAGE_HEIGHT};
+    memcpy(file.data() + PAGE_TABLE_OFFSET + page * sizeof(entry), &entry, sizeof(entry));
+
+    xtc::XtgPageHeader pageHeader = {};
+    pageHeader.magic = xtc::XTG_MAGIC;
+    pageHeader.width = PAGE_WIDTH;
+    pageHeader.height = PAGE_HEIGHT;
+    pageHeader.compression = xtc::XTG_COMPRESSION_NONE;
+    pageHeader.dataSize = PAGE_BYTES;
+    memcpy(file.data() + entry.dataOffset, &pageHeader, sizeof(pageHeader));
+    memcpy(file.data() + entry.dataOffset + sizeof(pageHeader), &page, sizeof(page));
+  }
+
+  FILE* out = fopen(SdMan.hostPath(path).c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  const bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+  return fclose(out) == 0 && written;
+}
+
+// filePages is the number of pages written, which the page table's extent holds
+bool pageMatches(xtc::XtcParser& parser, const uint32_t filePages, const uint32_t page) {
+  xtc::PageInfo info;
+  if (!parser.getPageInfo(page, info) || info.offset != pageOffset(filePages, page)) {
+    return false;
+  }
+  uint8_t bitmap[PAGE_BYTES] = {};
+  uint32_t content = 0;
+  if (parser.loadPage(page, bitmap, sizeof(bitmap)) != PAGE_BYTES) {
+    return false;
+  }
+  memcpy(&content, bitmap, sizeof(content));
+  return content == page;
+}
+
+void testEveryPage(const char* path, const uint32_t pageCount) {
+  xtc::XtcParser parser;
+  CHECK(parser.open(path) == xtc::XtcError::OK);
+  CHECK(parser.getPageCount() == pageCount);
+  CHECK(parser.getTitle() == TITLE);
+
+  int mismatches = 0;
+  for (uint32_t page = 0; page < pageCount; page++) {
+    mismatches += !pageMatches(parser, pageCount, page);
+  }
+  for (uint32_t page = pageCount; page-- > 0;) {
+    mismatches += !pageMatches(parser, pageCount, page);
+  }
+  std::mt19937 random(pageCount);
+  for (uint32_t i = 0; i < 1000; i++) {
+    mismatches += !pageMatches(parser, pageCount, random() % pageCount);
+  }
+  if (mismatches > 0) {
+    fprintf(stderr, "%s: %d page(s) read wrong\n", path, mismatches);
+    CHECK(false);
+  }
+
+  xtc::PageInfo info;
+  CHECK(!parser.getPageInfo(pageCount, info));
+  uint8_t bitmap[PAGE_BYTES];
+  CHECK(parser.loadPage(pageCount, bitmap, sizeof(bitmap)) == 0);
+}
+
+// Where the page table extent disagrees with the header on the low 16 bits, the header's count is kept
+void testMismatchedHeaderCount() {
+  CHECK(writeXtc("/mismatched.xtc", LARGE_PAGES, 1000));
+  xtc::XtcParser parser;
+  CHECK(parser.open("/mismatched.xtc") == xtc::XtcError::OK);
+  CHECK(parser.getPageCount() == 1000);
+  CHECK(pageMatches(parser, LARGE_PAGES, 999));
+}
+
+// Best of several runs of open plus loading the first page, in microseconds
+double timeToFirstPage(const char* path) {
+  double best = 1e12;
+  for (int run = 0; run < TIMING_RUNS; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    xtc::XtcParser parser;
+    uint8_t bitmap[PAGE_BYTES];
+    const bool loaded = parser.open(path) == xtc::XtcError::OK && parser.loadPage(0, bitmap, sizeof(bitmap)) > 0;
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(loaded);
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+void testTimeToFirstPage() {
+  const double small = timeToFirstPage(SMALL_PATH);
+  const double large = timeToFirstPage(LARGE_PATH);
+  printf("Open and first page: %u pages %.1f us, %u pages %.1f us\n", SMALL_PAGES, small, LARGE_PAGES, large);
+  // Both read the header, the title and one page table window. Generous, the point is no work per page.
+  CHECK(large < small * 5 + 100);
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/XtcParserTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+
+  CHECK(writeXtc(LARGE_PATH, LARGE_PAGES, static_cast<uint16_t>(LARGE_PAGES & 0xFFFF)));
+  CHECK(writeXtc(SMALL_PATH, SMALL_PAGES, SMALL_PAGES));
+  testEveryPage(LARGE_PATH, LARGE_PAGES);
+  testEveryPage(SMALL_PATH, SMALL_PAGES);
+  testMismatchedHeaderCount();
+  testTimeToFirstPage();
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,219 @@
+// Simulates XtcReaderActivity's page turns on a card with artificial SD latency: every read through FsFile costs a
+// fixed access time plus its size at an assumed SPI transfer rate, on a simulated clock. Reading one page at a time,
+// a prefetched page reaches the framebuffer without touching the card. Turning quickly, a prefetch under way stops
+// within one chunk of the input arriving instead of holding the card for the whole page. Covers uncompressed and
+// deflated 1-bit pages, and prints the card time of each turn.
+#include <SDCardManager.h>
+#include <Xtc/XtcParser.h>
+#include <miniz.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HostTest.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t PAGE_COUNT = 20;
+constexpr uint32_t PAGE_TABLE_OFFSET = 0x100;
+constexpr size_t BITMAP_BYTES = xtc::DISPLAY_WIDTH / 8 * xtc::DISPLAY_HEIGHT;
+// Assumed card speed over SPI, and the command overhead of each read
+constexpr double CARD_READ_KB_PER_S = 1000;
+constexpr double CARD_ACCESS_MS = 0.3;
+// XtcReaderActivity's maxCachedPageSize
+constexpr size_t MAX_CACHED_PAGE_SIZE = 48 * 1024;
+// Chunk size of readStoredPage with a yield function
+constexpr size_t PREFETCH_CHUNK_SIZE = 4096;
+constexpr double JUMP_AFTER_MS = 1;
+
+// Simulated time spent on the card, in ms
+double cardMs = 0;
+
+void countCardTime() {
+  FsFile::onTransfer = [](const size_t count, bool) {
+    cardMs += CARD_ACCESS_MS + count / 1024.0 / CARD_READ_KB_PER_S * 1000;
+  };
+}
+
+std::vector<uint8_t> pageBitmap(const uint32_t page) {
+  // Mostly blank like a page of text, with a few lines of noise so that deflate has work to do
+  std::vector<uint8_t> bitmap(BITMAP_BYTES, 0xFF);
+  std::mt19937 random(page);
+  for (size_t i = 0; i < BITMAP_BYTES / 4; i++) {
+    bitmap[(page * 997 + i * 3) % BITMAP_BYTES] = static_cast<uint8_t>(random());
+  }
+  return bitmap;
+}
+
+// A 480x800 1-bit book, each page stored either as is or as a raw deflate stream
+bool writeXtc(const char* path, const bool deflate) {
+  std::vector<std::vector<uint8_t>> payloads;
+  for (uint32_t page = 0; page < PAGE_COUNT; page++) {
+    std::vector<uint8_t> bitmap = pageBitmap(page);
+    if (deflate) {
+      size_t size = 0;
+      void* compressed = tdefl_compress_mem_to_heap(bitmap.data(), bitmap.size(), &size, TDEFL_DEFAULT_MAX_PROBES);
+      if (!compressed) {
+        return false;
+      }
+      bitmap.assign(static_cast<uint8_t*>(compressed), static_cast<uint8_t*>(compressed) + size);
+      mz_free(compressed);
+    }
+    payloads.push_back(std::move(bitmap));
+  }
+
+  std::vector<uint8_t> file(PAGE_TABLE_OFFSET + PAGE_COUNT * sizeof(xtc::PageTableEntry), 0);
+  xtc::XtcHeader header = {};
+  header.magic = xtc::XTC_MAGIC;
+  header.versionMajor = 1;
+  header.pageCount = PAGE_COUNT;
+  header.headerSize = 88;
+  header.pageTableOffset = PAGE_TABLE_OFFSET;
+  header.dataOffset = static_cast<uint32_t>(file.size());
+  memcpy(file.data(), &header, sizeof(header));
+
+  for (uint32_t page = 0; page < PAGE_COUNT; page++) {
+    const xtc::PageTableEntry entry = {static_cast<uint32_t>(file.size()),
+                                       static_cast<uint32_t>(sizeof(xtc::XtgPageHeader) + payloads[page].size()),
+                                       xtc::DISPLAY_WIDTH, xtc::DISPLAY_HEIGHT};
+    memcpy(file.data() + PAGE_TABLE_OFFSET + page * sizeof(entry), &entry, sizeof(entry));
+
+    xtc::XtgPageHeader pageHeader = {};
+    pageHeader.magic = xtc::XTG_MAGIC;
+    pageHeader.width = xtc::DISPLAY_WIDTH;
+    pageHeader.height = xtc::DISPLAY_HEIGHT;
+    pageHeader.compression = deflate ? xtc::XTG_COMPRESSION_DEFLATE : xtc::XTG_COMPRESSION_NONE;
+    pageHeader.dataSize = static_cast<uint32_t>(payloads[page].size());
+    const auto* headerBytes = reinterpret_cast<const uint8_t*>(&pageHeader);
+    file.insert(file.end(), headerBytes, headerBytes + sizeof(pageHeader));
+    file.insert(file.end(), payloads[page].begin(), payloads[page].end());
+  }
+
+  FILE* out = fopen(SdMan.hostPath(path).c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  const bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+  return fclose(out) == 0 && written;
+}
+
+// A page held in RAM as XtcReaderActivity::CachedPage holds it
+struct StoredPage {
+  std::vector<uint8_t> data;
+  size_t size = 0;
+  uint32_t page = UINT32_MAX;
+};
+
+// The framebuffer side of a turn: the page streamed from the card, or decoded from RAM if it was prefetched
+std::vector<uint8_t> showPage(xtc::XtcParser& parser, const uint32_t page, const StoredPage& prefetched) {
+  std::vector<uint8_t> framebuffer(BITMAP_BYTES);
+  const auto copy = [&framebuffer](const uint8_t* data, const size_t size, const size_t offset) {
+    if (offset + size <= framebuffer.size()) memcpy(framebuffer.data() + offset, data, size);
+  };
+  const xtc::XtcError error = prefetched.page == page
+                                  ? parser.decodeStoredPage(page, prefetched.data.data(), prefetched.size, copy)
+                                  : parser.loadPageStreaming(page, copy);
+  CHECK(error == xtc::XtcError::OK);
+  return framebuffer;
+}
+
+// XtcReaderActivity::prefetchNextPage: false if the page does not fit or the read was stopped
+bool prefetch(xtc::XtcParser& parser, const uint32_t page, StoredPage& slot, const std::function<bool()>& yieldFn) {
+  slot.page = UINT32_MAX;
+  const size_t storedSize = parser.getStoredPageSize(page);
+  if (storedSize == 0 || storedSize > MAX_CACHED_PAGE_SIZE) {
+    return false;
+  }
+  slot.data.resize(storedSize);
+  slot.size = parser.readStoredPage(page, slot.data.data(), slot.data.size(), yieldFn, PREFETCH_CHUNK_SIZE);
+  if (slot.size == 0) {
+    return false;
+  }
+  slot.page = page;
+  return true;
+}
+
+// Reads the book front to back, one turn after the previous page was refreshed and prefetching finished. Returns the
+// mean card time of a turn after the first.
+double readThrough(const char* path, const bool withPrefetch) {
+  xtc::XtcParser parser;
+  CHECK(parser.open(path) == xtc::XtcError::OK);
+  StoredPage prefetched;
+  double turnMs = 0;
+  for (uint32_t page = 0; page < PAGE_COUNT; page++) {
+    const double start = cardMs;
+    CHECK(showPage(parser, page, prefetched) == pageBitmap(page));
+    if (page > 0) turnMs += cardMs - start;
+    // After the refresh, while the page is being read
+    if (withPrefetch && page + 1 < PAGE_COUNT) {
+      CHECK(prefetch(parser, page + 1, prefetched, nullptr));
+    }
+  }
+  return turnMs / (PAGE_COUNT - 1);
+}
+
+// A jump arrives JUMP_AFTER_MS into the prefetch of page 1. Returns how long the card then stays busy with the
+// prefetch: to the end of the current chunk when the read can be stopped, to the end of the page when it cannot.
+double jumpWait(xtc::XtcParser& parser, const bool stoppable) {
+  StoredPage slot;
+  const double input = cardMs + JUMP_AFTER_MS;
+  const auto noInputYet = [input] { return cardMs < input; };
+  const bool done = prefetch(parser, 1, slot, stoppable ? std::function<bool()>(noInputYet) : nullptr);
+  CHECK(done != stoppable);
+  const double wait = cardMs - input;
+  // The jump target streams from the card as usual
+  CHECK(showPage(parser, 10, slot) == pageBitmap(10));
+  return wait;
+}
+
+void testBook(const char* path, const bool deflate) {
+  CHECK(writeXtc(path, deflate));
+  countCardTime();
+
+  const double streamed = readThrough(path, false);
+  const double prefetched = readThrough(path, true);
+  // Prefetched turns decode from RAM and do not touch the card at all
+  CHECK(prefetched == 0);
+  CHECK(streamed > 0);
+
+  xtc::XtcParser parser;
+  CHECK(parser.open(path) == xtc::XtcError::OK);
+  const size_t storedSize = parser.getStoredPageSize(1);
+  CHECK(storedSize > PREFETCH_CHUNK_SIZE && storedSize <= MAX_CACHED_PAGE_SIZE);
+  const double stopped = jumpWait(parser, true);
+  const double ranToEnd = jumpWait(parser, false);
+  // One chunk at most, against the rest of the page
+  CHECK(stopped <= CARD_ACCESS_MS + PREFETCH_CHUNK_SIZE / 1024.0 / CARD_READ_KB_PER_S * 1000);
+  CHECK(stopped < ranToEnd);
+
+  FsFile::onTransfer = nullptr;
+  printf("%s pages, %zu bytes stored: turn %.1f ms on the card streamed, %.1f ms prefetched\n",
+         deflate ? "Deflated" : "Uncompressed", storedSize, streamed, prefetched);
+  printf("  a jump %.0f ms into a prefetch waits %.1f ms for the card, %.1f ms if the prefetch runs to the end\n",
+         JUMP_AFTER_MS, stopped, ranToEnd);
+}
+}  // namespace
+
+int main() {
+  char rootTemplate[] = "/tmp/XtcPrefetchTest.XXXXXX";
+  const char* root = mkdtemp(rootTemplate);
+  if (!root) {
+    perror("mkdtemp");
+    return 1;
+  }
+  SdMan.setRoot(root);
+
+  testBook("/plain.xtc", false);
+  testBook("/deflated.xtc", true);
+
+  fs::remove_all(root);
+  return testResult();
+}
@@ -0,0 +1,211 @@
+// Builds the reader caches of EPUB books on a computer, with the firmware's own parsing and layout code, so that the
+// device opens them without indexing. See tools/README.md.
+
+#include <BuiltinFonts.h>
+#include <EInkDisplay.h>
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CrossPointSettings.h"
+
+namespace {
+// Same as EpubReaderActivity
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr int statusBarMargin = 19;
+
+struct Options {
+  std::string cardRoot;
+  std::vector<std::string> books;
+  bool check = false;
+};
+
+void usage() {
+  fprintf(stderr,
+          "Usage: cachegen [--check] [--verbose] <card dir> <book>...\n"
+          "\n"
+          "Builds /.crosspoint/epub_<key>/ in <card dir> for each book, a path on the card such as\n"
+          "/Books/book.epub. Layout follows <card dir>/.crosspoint/settings.bin, or the default settings.\n"
+          "\n"
+          "  --check    Build everything twice, fail unless both builds are identical and every page reads\n"
+          "             back\n"
+          "  --verbose  Print the firmware log\n");
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--check") == 0) {
+      options.check = true;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      Serial.enabled = true;
+    } else if (argv[i][0] == '-') {
+      return false;
+    } else if (options.cardRoot.empty()) {
+      options.cardRoot = argv[i];
+    } else {
+      options.books.emplace_back(argv[i][0] == '/' ? argv[i] : std::string("/") + argv[i]);
+    }
+  }
+  return !options.cardRoot.empty() && !options.books.empty();
+}
+
+void applyOrientation(GfxRenderer& renderer) {
+  switch (SETTINGS.orientation) {
+    case CrossPointSettings::ORIENTATION::PORTRAIT:
+      renderer.setOrientation(GfxRenderer::Orientation::Portrait);
+      break;
+    case CrossPointSettings::ORIENTATION::LANDSCAPE_CW:
+      renderer.setOrientation(GfxRenderer::Orientation::LandscapeClockwise);
+      break;
+    case CrossPointSettings::ORIENTATION::INVERTED:
+      renderer.setOrientation(GfxRenderer::Orientation::PortraitInverted);
+      break;
+    case CrossPointSettings::ORIENTATION::LANDSCAPE_CCW:
+      renderer.setOrientation(GfxRenderer::Orientation::LandscapeCounterClockwise);
+      break;
+    default:
+      break;
+  }
+}
+
+bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+  FsFile file;
+  if (!SdMan.openFileForRead("GEN", path, file)) {
+    return false;
+  }
+  data.resize(file.size());
+  const bool ok = file.read(data.data(), data.size()) == static_cast<int>(data.size());
+  file.close();
+  return ok;
+}
+
+// Indexes the book again from scratch and compares book.bin with the first build
+bool checkBookBin(const std::string& bookPath, const std::string& cachePath) {
+  const std::string path = cachePath + "/book.bin";
+  std::vector<uint8_t> first, second;
+  if (!readFile(path, first) || !SdMan.remove(path.c_str()) || !Epub(bookPath, CACHE_DIR).load() ||
+      !readFile(path, second)) {
+    fprintf(stderr, "  %s: second build failed\n", path.c_str());
+    return false;
+  }
+  if (first != second) {
+    fprintf(stderr, "  %s: builds differ\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Builds the section again from scratch and compares it with the first build, then reads every page back
+bool checkSection(const std::shared_ptr<Epub>& epub, const int spineIndex, GfxRenderer& renderer,
+                  const std::string& path, const int fontId, const uint16_t viewportWidth,
+                  const uint16_t viewportHeight) {
+  Section section(epub, spineIndex, renderer);
+  std::vector<uint8_t> first, second;
+  if (!readFile(path, first) || !section.clearCache() ||
+      !section.createSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                 SETTINGS.paragraphAlignment, viewportWidth, viewportHeight) ||
+      !readFile(path, second)) {
+    fprintf(stderr, "  %s: second build failed\n", path.c_str());
+    return false;
+  }
+  if (first != second) {
+    fprintf(stderr, "  %s: builds differ\n", path.c_str());
+    return false;
+  }
+
+  Section reloaded(epub, spineIndex, renderer);
+  if (!reloaded.loadSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                SETTINGS.paragraphAlignment, viewportWidth, viewportHeight) ||
+      reloaded.pageCount != section.pageCount) {
+    fprintf(stderr, "  %s: does not load with the settings it was built for\n", path.c_str());
+    return false;
+  }
+  for (reloaded.currentPage = 0; reloaded.currentPage < reloaded.pageCount; reloaded.currentPage++) {
+    if (!reloaded.loadPageFromSectionFile()) {
+      fprintf(stderr, "  %s: page %d does not read back\n", path.c_str(), reloaded.currentPage);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool generate(const std::string& bookPath, GfxRenderer& renderer, const bool check) {
+  const auto start = millis();
+  auto epub = std::make_shared<Epub>(bookPath, CACHE_DIR);
+  if (!epub->load()) {
+    fprintf(stderr, "%s: failed to index\n", bookPath.c_str());
+    return false;
+  }
+  epub->setupCacheDir();
+  bool ok = !check || checkBookBin(bookPath, epub->getCachePath());
+
+  int top, right, bottom, left;
+  renderer.getOrientedViewableTRBL(&top, &right, &bottom, &left);
+  top += SETTINGS.screenMargin;
+  left += SETTINGS.screenMargin;
+  right += SETTINGS.screenMargin;
+  bottom += statusBarMargin;
+  const uint16_t viewportWidth = renderer.getScreenWidth() - left - right;
+  const uint16_t viewportHeight = renderer.getScreenHeight() - top - bottom;
+  const int fontId = SETTINGS.getReaderFontId();
+
+  int pages = 0;
+  for (int i = 0; i < epub->getSpineItemsCount(); i++) {
+    Section section(epub, i, renderer);
+    const std::string path = epub->getCachePath() + "/sections/" + std::to_string(i) + ".bin";
+    if (!section.loadSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                 SETTINGS.paragraphAlignment, viewportWidth, viewportHeight) &&
+        !section.createSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                   SETTINGS.paragraphAlignment, viewportWidth, viewportHeight)) {
+      fprintf(stderr, "  %s: failed to lay out\n", path.c_str());
+      ok = false;
+      continue;
+    }
+    pages += section.pageCount;
+    if (check && !checkSection(epub, i, renderer, path, fontId, viewportWidth, viewportHeight)) {
+      ok = false;
+    }
+  }
+
+  printf("%s: %s, %d sections, %d pages, %lu ms\n", bookPath.c_str(), epub->getCachePath().c_str(),
+         epub->getSpineItemsCount(), pages, millis() - start);
+  return ok;
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage();
+    return 2;
+  }
+
+  SdMan.setRoot(options.cardRoot);
+  SdMan.mkdir(CACHE_DIR);
+  SETTINGS.loadFromFile();
+
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  insertBuiltinFonts(renderer);
+  applyOrientation(renderer);
+
+  bool ok = true;
+  for (const auto& book : options.books) {
+    if (!SdMan.exists(book.c_str())) {
+      fprintf(stderr, "%s: not found in %s\n", book.c_str(), options.cardRoot.c_str());
+      ok = false;
+      continue;
+    }
+    ok = generate(book, renderer, options.check) && ok;
+  }
+  return ok ? 0 : 1;
+}
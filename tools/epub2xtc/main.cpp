@@ -0,0 +1,456 @@
+// Renders an EPUB into an XTC (1-bit) or XTCH (2-bit) file with the firmware's own layout and rendering code, so that
+// the pages match the EPUB reader and turn without any layout work on the device. See tools/README.md.
+
+#include <BuiltinFonts.h>
+#include <EInkDisplay.h>
+#include <Epub.h>
+#include <Epub/Page.h>
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <HardwareSerial.h>
+#include <SDCardManager.h>
+#include <Xtc/XtcParser.h>
+#include <miniz.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <unistd.h>
+
+#include "CrossPointSettings.h"
+#include "fontIds.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// The book is copied into a scratch card directory, where its cache is built like on the device
+constexpr char WORK_BOOK[] = "/book.epub";
+constexpr char WORK_OUTPUT[] = "/book.xtc";
+constexpr char CACHE_DIR[] = "/.crosspoint";
+constexpr char SETTINGS_FILE[] = "/.crosspoint/settings.bin";
+// Same as EpubReaderActivity
+constexpr int statusBarMargin = 19;
+
+// Pages are portrait, the XTC reader rotates them for the other orientations
+constexpr uint16_t PAGE_WIDTH = xtc::DISPLAY_WIDTH;
+constexpr uint16_t PAGE_HEIGHT = xtc::DISPLAY_HEIGHT;
+constexpr size_t XTG_ROW_BYTES = (PAGE_WIDTH + 7) / 8;
+
+// Metadata follows the header: title and author, zero padded
+constexpr uint32_t METADATA_OFFSET = sizeof(xtc::XtcHeader);
+constexpr uint32_t METADATA_SIZE = 256;
+constexpr size_t TITLE_SIZE = 128;
+constexpr size_t AUTHOR_SIZE = 64;
+// Chapter table entries, as read by XtcParser::readChapters
+constexpr size_t CHAPTER_SIZE = 96;
+constexpr size_t CHAPTER_NAME_SIZE = 80;
+constexpr size_t CHAPTER_START_OFFSET = 0x50;
+constexpr size_t CHAPTER_END_OFFSET = 0x52;
+// Header flag bytes, see XtcParser::readChapters
+constexpr uint32_t FLAG_HAS_METADATA = 1 << 8;
+constexpr uint32_t FLAG_HAS_CHAPTERS = 1 << 24;
+
+struct Options {
+  std::string book;
+  std::string output;
+  std::string settings;
+  bool check = false;
+};
+
+struct Chapter {
+  std::string name;
+  uint32_t startPage;
+  uint32_t endPage;
+};
+
+struct Margins {
+  int top, right, bottom, left;
+};
+
+void usage() {
+  fprintf(stderr,
+          "Usage: epub2xtc [--settings <settings.bin>] [--check] [--verbose] <book.epub> <output.xtc|output.xtch>\n"
+          "\n"
+          "Renders every page of the book like the EPUB reader does. .xtc output is 1-bit, .xtch output keeps the\n"
+          "anti-aliased grays (2-bit).\n"
+          "\n"
+          "  --settings  Reader settings to lay out with, /.crosspoint/settings.bin from the card. Default\n"
+          "              settings otherwise.\n"
+          "  --check     Read the output back with the firmware's XTC parser and compare every page\n"
+          "  --verbose   Print the firmware log\n");
+}
+
+bool parseOptions(const int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--settings") == 0 && i + 1 < argc) {
+      options.settings = argv[++i];
+    } else if (strcmp(argv[i], "--check") == 0) {
+      options.check = true;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      Serial.enabled = true;
+    } else if (argv[i][0] == '-') {
+      return false;
+    } else if (options.book.empty()) {
+      options.book = argv[i];
+    } else if (options.output.empty()) {
+      options.output = argv[i];
+    } else {
+      return false;
+    }
+  }
+  return !options.book.empty() && !options.output.empty();
+}
+
+bool hasExtension(const std::string& path, const char* extension) {
+  const size_t length = strlen(extension);
+  return path.size() >= length && strcasecmp(path.c_str() + path.size() - length, extension) == 0;
+}
+
+// Same layout as EpubReaderActivity::renderStatusBar, without the battery
+void renderStatusBar(const GfxRenderer& renderer, const Epub& epub, const Margins& margins, const int spineIndex,
+                     const int page, const int pageCount) {
+  const bool showProgress = SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::FULL;
+  const bool showChapterTitle = SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::NO_PROGRESS ||
+                                SETTINGS.statusBar == CrossPointSettings::STATUS_BAR_MODE::FULL;
+
+  const auto textY = renderer.getScreenHeight() - margins.bottom - 4;
+  int progressTextWidth = 0;
+
+  if (showProgress) {
+    const float sectionChapterProg = static_cast<float>(page) / pageCount;
+    const uint8_t bookProgress = epub.calculateProgress(spineIndex, sectionChapterProg);
+    const std::string progress =
+        std::to_string(page + 1) + "/" + std::to_string(pageCount) + "  " + std::to_string(bookProgress) + "%";
+    progressTextWidth = renderer.getTextWidth(SMALL_FONT_ID, progress.c_str());
+    renderer.drawText(SMALL_FONT_ID, renderer.getScreenWidth() - margins.right - progressTextWidth, textY,
+                      progress.c_str());
+  }
+
+  if (showChapterTitle) {
+    const int titleMarginLeft = 50 + 30 + margins.left;  // 50px for battery
+    const int titleMarginRight = progressTextWidth + 30 + margins.right;
+    const int availableTextWidth = renderer.getScreenWidth() - titleMarginLeft - titleMarginRight;
+    const int tocIndex = epub.getTocIndexForSpineIndex(spineIndex);
+
+    std::string title = "Unnamed";
+    if (tocIndex != -1) {
+      title = epub.getTocItem(tocIndex).title;
+    }
+    int titleWidth = renderer.getTextWidth(SMALL_FONT_ID, title.c_str());
+    while (tocIndex != -1 && titleWidth > availableTextWidth && title.length() > 11) {
+      title.replace(title.length() - 8, 8, "...");
+      titleWidth = renderer.getTextWidth(SMALL_FONT_ID, title.c_str());
+    }
+    renderer.drawText(SMALL_FONT_ID, titleMarginLeft + (availableTextWidth - titleWidth) / 2, textY, title.c_str());
+  }
+}
+
+// Renders the page the way EpubReaderActivity::renderContents does, and converts the frame buffers to a page bitmap.
+// In portrait the frame buffer is already laid out like an XTH bit plane: columns right to left, 8 vertical pixels
+// per byte.
+std::vector<uint8_t> renderPage(GfxRenderer& renderer, const Page& page, const int fontId,
+                                const std::function<void()>& statusBar, const Margins& margins, const bool grayscale) {
+  const size_t size = GfxRenderer::getBufferSize();
+  const uint8_t* frameBuffer = renderer.getFrameBuffer();
+
+  renderer.clearScreen();
+  page.render(renderer, fontId, margins.left, margins.top);
+  statusBar();
+  const std::vector<uint8_t> bw(frameBuffer, frameBuffer + size);
+
+  if (!grayscale) {
+    // XTG is row major, 1 = white like the frame buffer
+    std::vector<uint8_t> bitmap(XTG_ROW_BYTES * PAGE_HEIGHT, 0);
+    for (int y = 0; y < PAGE_HEIGHT; y++) {
+      for (int x = 0; x < PAGE_WIDTH; x++) {
+        const size_t column = PAGE_WIDTH - 1 - x;
+        if (bw[column * EInkDisplay::DISPLAY_WIDTH_BYTES + y / 8] >> (7 - y % 8) & 1) {
+          bitmap[y * XTG_ROW_BYTES + x / 8] |= 1 << (7 - x % 8);
+        }
+      }
+    }
+    return bitmap;
+  }
+
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
+  page.render(renderer, fontId, margins.left, margins.top);
+  const std::vector<uint8_t> lsb(frameBuffer, frameBuffer + size);
+
+  renderer.clearScreen(0x00);
+  renderer.setRenderMode(GfxRenderer::GRAYSCALE_MSB);
+  page.render(renderer, fontId, margins.left, margins.top);
+  const std::vector<uint8_t> msb(frameBuffer, frameBuffer + size);
+  renderer.setRenderMode(GfxRenderer::BW);
+
+  // The inverse of composeXthPlanes in XtcReaderActivity: 0 = white, 1 = dark grey (LSB and MSB passes),
+  // 2 = light grey (MSB pass only), 3 = black
+  std::vector<uint8_t> bitmap(size * 2);
+  for (size_t i = 0; i < size; i++) {
+    const uint8_t ink = ~bw[i];
+    bitmap[i] = ink & ~lsb[i];
+    bitmap[size + i] = ink & (~msb[i] | lsb[i]);
+  }
+  return bitmap;
+}
+
+// Page header and payload, deflated when that is smaller (see lib/Xtc/README)
+std::vector<uint8_t> storePage(const std::vector<uint8_t>& bitmap, const bool grayscale) {
+  xtc::XtgPageHeader header = {};
+  header.magic = grayscale ? xtc::XTH_MAGIC : xtc::XTG_MAGIC;
+  header.width = PAGE_WIDTH;
+  header.height = PAGE_HEIGHT;
+  header.compression = xtc::XTG_COMPRESSION_NONE;
+
+  size_t deflatedSize = 0;
+  const auto flags = tdefl_create_comp_flags_from_zip_params(9, -15, MZ_DEFAULT_STRATEGY);
+  void* deflated = tdefl_compress_mem_to_heap(bitmap.data(), bitmap.size(), &deflatedSize, static_cast<int>(flags));
+  const bool compress = deflated && deflatedSize > 0 && deflatedSize < bitmap.size();
+  const auto* payload = compress ? static_cast<const uint8_t*>(deflated) : bitmap.data();
+  const size_t payloadSize = compress ? deflatedSize : bitmap.size();
+  if (compress) {
+    header.compression = xtc::XTG_COMPRESSION_DEFLATE;
+  }
+  header.dataSize = payloadSize;
+
+  std::vector<uint8_t> stored(sizeof(header) + payloadSize);
+  memcpy(stored.data(), &header, sizeof(header));
+  memcpy(stored.data() + sizeof(header), payload, payloadSize);
+  free(deflated);
+  return stored;
+}
+
+void copyString(std::vector<uint8_t>& out, const size_t offset, const std::string& value, const size_t size) {
+  // Always leaves room for the terminating zero
+  memcpy(out.data() + offset, value.data(), std::min(value.size(), size - 1));
+}
+
+bool writeXtc(const std::string& path, const Epub& epub, const std::vector<Chapter>& chapters,
+              const std::vector<std::vector<uint8_t>>& pages, const bool grayscale) {
+  const uint64_t chapterOffset = METADATA_OFFSET + METADATA_SIZE;
+  const uint64_t pageTableOffset = chapterOffset + chapters.size() * CHAPTER_SIZE;
+  const uint64_t dataOffset = pageTableOffset + pages.size() * sizeof(xtc::PageTableEntry);
+
+  xtc::XtcHeader header = {};
+  header.magic = grayscale ? xtc::XTCH_MAGIC : xtc::XTC_MAGIC;
+  header.versionMajor = 1;
+  header.versionMinor = 0;
+  // Low 16 bits only, XtcParser takes longer books' page count from the extent of the page table
+  header.pageCount = static_cast<uint16_t>(pages.size());
+  header.flags = FLAG_HAS_METADATA | (chapters.empty() ? 0 : FLAG_HAS_CHAPTERS);
+  header.reserved1 = METADATA_OFFSET;
+  header.pageTableOffset = pageTableOffset;
+  header.dataOffset = dataOffset;
+  // With the chapter flag this field holds the 64-bit chapter table offset, see XtcParser::readChapters
+  memcpy(&header.titleOffset, &chapterOffset, sizeof(chapterOffset));
+
+  std::vector<uint8_t> head(dataOffset, 0);
+  memcpy(head.data(), &header, sizeof(header));
+  copyString(head, METADATA_OFFSET, epub.getTitle(), TITLE_SIZE);
+  copyString(head, METADATA_OFFSET + TITLE_SIZE, epub.getAuthor(), AUTHOR_SIZE);
+
+  for (size_t i = 0; i < chapters.size(); i++) {
+    const size_t offset = chapterOffset + i * CHAPTER_SIZE;
+    copyString(head, offset, chapters[i].name, CHAPTER_NAME_SIZE);
+    // 1-based
+    const uint16_t start = chapters[i].startPage + 1;
+    const uint16_t end = chapters[i].endPage + 1;
+    memcpy(head.data() + offset + CHAPTER_START_OFFSET, &start, sizeof(start));
+    memcpy(head.data() + offset + CHAPTER_END_OFFSET, &end, sizeof(end));
+  }
+
+  uint64_t pageOffset = dataOffset;
+  for (size_t i = 0; i < pages.size(); i++) {
+    const xtc::PageTableEntry entry = {pageOffset, static_cast<uint32_t>(pages[i].size()), PAGE_WIDTH, PAGE_HEIGHT};
+    memcpy(head.data() + pageTableOffset + i * sizeof(entry), &entry, sizeof(entry));
+    pageOffset += pages[i].size();
+  }
+
+  FsFile file;
+  if (!SdMan.openFileForWrite("X2X", path, file)) {
+    return false;
+  }
+  bool ok = file.write(head.data(), head.size()) == head.size();
+  for (const auto& page : pages) {
+    ok = ok && file.write(page.data(), page.size()) == page.size();
+  }
+  ok = file.sync() && ok;
+  file.close();
+  return ok;
+}
+
+// Reads the file back with the firmware's parser and compares every page with what was rendered
+bool checkXtc(const std::string& path, const std::vector<Chapter>& chapters,
+              const std::vector<std::vector<uint8_t>>& bitmaps) {
+  xtc::XtcParser parser;
+  if (parser.open(path.c_str()) != xtc::XtcError::OK) {
+    fprintf(stderr, "  check: does not open\n");
+    return false;
+  }
+  if (parser.getPageCount() != bitmaps.size() || parser.getWidth() != PAGE_WIDTH ||
+      parser.getHeight() != PAGE_HEIGHT) {
+    fprintf(stderr, "  check: %u pages of %ux%u\n", parser.getPageCount(), parser.getWidth(), parser.getHeight());
+    return false;
+  }
+  const auto& parsed = parser.getChapters();
+  if (parsed.size() != chapters.size()) {
+    fprintf(stderr, "  check: %zu chapters, expected %zu\n", parsed.size(), chapters.size());
+    return false;
+  }
+  for (size_t i = 0; i < parsed.size(); i++) {
+    if (parsed[i].startPage != chapters[i].startPage || parsed[i].endPage != chapters[i].endPage) {
+      fprintf(stderr, "  check: chapter %zu has pages %u-%u\n", i, parsed[i].startPage, parsed[i].endPage);
+      return false;
+    }
+  }
+  std::vector<uint8_t> loaded;
+  for (uint32_t i = 0; i < bitmaps.size(); i++) {
+    loaded.assign(bitmaps[i].size(), 0);
+    if (parser.loadPage(i, loaded.data(), loaded.size()) != loaded.size() || loaded != bitmaps[i]) {
+      fprintf(stderr, "  check: page %u does not read back\n", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool convert(const Options& options, GfxRenderer& renderer, const bool grayscale) {
+  const auto start = millis();
+  auto epub = std::make_shared<Epub>(WORK_BOOK, CACHE_DIR);
+  if (!epub->load()) {
+    fprintf(stderr, "%s: failed to index\n", options.book.c_str());
+    return false;
+  }
+  epub->setupCacheDir();
+
+  // Same viewport as EpubReaderActivity::getOrientedMargins
+  Margins margins;
+  renderer.getOrientedViewableTRBL(&margins.top, &margins.right, &margins.bottom, &margins.left);
+  margins.top += SETTINGS.screenMargin;
+  margins.left += SETTINGS.screenMargin;
+  margins.right += SETTINGS.screenMargin;
+  margins.bottom += statusBarMargin;
+  const uint16_t viewportWidth = renderer.getScreenWidth() - margins.left - margins.right;
+  const uint16_t viewportHeight = renderer.getScreenHeight() - margins.top - margins.bottom;
+  const int fontId = SETTINGS.getReaderFontId();
+
+  std::vector<Chapter> chapters;
+  std::vector<std::vector<uint8_t>> bitmaps;
+  std::vector<std::vector<uint8_t>> pages;
+  int lastTocIndex = -2;
+  for (int i = 0; i < epub->getSpineItemsCount(); i++) {
+    Section section(epub, i, renderer);
+    if (!section.loadSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                 SETTINGS.paragraphAlignment, viewportWidth, viewportHeight) &&
+        !section.createSectionFile(fontId, SETTINGS.getReaderLineCompression(), SETTINGS.extraParagraphSpacing,
+                                   SETTINGS.paragraphAlignment, viewportWidth, viewportHeight)) {
+      fprintf(stderr, "%s: failed to lay out section %d\n", options.book.c_str(), i);
+      return false;
+    }
+    if (section.pageCount == 0) {
+      continue;
+    }
+
+    // One chapter per table of contents entry, spanning the sections that belong to it
+    const int tocIndex = epub->getTocIndexForSpineIndex(i);
+    if (tocIndex != lastTocIndex) {
+      const std::string name = tocIndex == -1 ? "Unnamed" : epub->getTocItem(tocIndex).title;
+      chapters.push_back({name, static_cast<uint32_t>(pages.size()), 0});
+      lastTocIndex = tocIndex;
+    }
+
+    for (section.currentPage = 0; section.currentPage < section.pageCount; section.currentPage++) {
+      const auto page = section.loadPageFromSectionFile();
+      if (!page) {
+        fprintf(stderr, "%s: failed to load page %d of section %d\n", options.book.c_str(), section.currentPage, i);
+        return false;
+      }
+      const int pageIndex = section.currentPage;
+      const int pageCount = section.pageCount;
+      auto bitmap = renderPage(
+          renderer, *page, fontId,
+          [&] { renderStatusBar(renderer, *epub, margins, i, pageIndex, pageCount); }, margins, grayscale);
+      pages.push_back(storePage(bitmap, grayscale));
+      if (options.check) {
+        bitmaps.push_back(std::move(bitmap));
+      }
+    }
+    chapters.back().endPage = pages.size() - 1;
+  }
+
+  if (pages.empty()) {
+    fprintf(stderr, "%s: no pages\n", options.book.c_str());
+    return false;
+  }
+  // Chapter pages are stored 1-based in 16 bits
+  while (!chapters.empty() && chapters.back().startPage >= UINT16_MAX) {
+    chapters.pop_back();
+  }
+  if (!chapters.empty()) {
+    chapters.back().endPage = std::min<uint32_t>(chapters.back().endPage, UINT16_MAX - 1);
+  }
+  if (!writeXtc(WORK_OUTPUT, *epub, chapters, pages, grayscale)) {
+    fprintf(stderr, "%s: failed to write\n", options.output.c_str());
+    return false;
+  }
+  if (options.check && !checkXtc(WORK_OUTPUT, chapters, bitmaps)) {
+    return false;
+  }
+
+  std::error_code ec;
+  fs::copy_file(SdMan.hostPath(WORK_OUTPUT), options.output, fs::copy_options::overwrite_existing, ec);
+  if (ec) {
+    fprintf(stderr, "%s: %s\n", options.output.c_str(), ec.message().c_str());
+    return false;
+  }
+  printf("%s: %zu pages, %zu chapters, %ju bytes, %lu ms\n", options.output.c_str(), pages.size(), chapters.size(),
+         static_cast<uintmax_t>(fs::file_size(options.output, ec)), millis() - start);
+  return true;
+}
+}  // namespace
+
+int main(const int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage();
+    return 2;
+  }
+  const bool grayscale = hasExtension(options.output, ".xtch");
+  if (!grayscale && !hasExtension(options.output, ".xtc")) {
+    fprintf(stderr, "%s: output must be .xtc or .xtch\n", options.output.c_str());
+    return 2;
+  }
+
+  std::error_code ec;
+  const fs::path work = fs::temp_directory_path(ec) / ("epub2xtc-" + std::to_string(getpid()));
+  fs::create_directories(work / (CACHE_DIR + 1), ec);
+  fs::copy_file(options.book, work / (WORK_BOOK + 1), ec);
+  if (!ec && !options.settings.empty()) {
+    fs::copy_file(options.settings, work / (SETTINGS_FILE + 1), ec);
+  }
+  if (ec) {
+    fprintf(stderr, "%s\n", ec.message().c_str());
+    fs::remove_all(work, ec);
+    return 1;
+  }
+
+  SdMan.setRoot(work.string());
+  SETTINGS.loadFromFile();
+
+  EInkDisplay display;
+  GfxRenderer renderer(display);
+  insertBuiltinFonts(renderer);
+  renderer.setOrientation(GfxRenderer::Orientation::Portrait);
+
+  const bool ok = convert(options, renderer, grayscale);
+  fs::remove_all(work, ec);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+unsigned long millis() {
+  static const auto start = std::chrono::steady_clock::now();
+  return static_cast<unsigned long>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+void delay(const unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in for the parts of the Arduino core used by the shared libraries
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "HardwareSerial.h"
+#include "Print.h"
+
+unsigned long millis();
+void delay(unsigned long ms);
+
+// Heap figures of a device with plenty free. Tests lower them to take the low memory paths.
+class EspClass {
+ public:
+  uint32_t freeHeap = 16 * 1024 * 1024;
+  uint32_t maxAllocHeap = 16 * 1024 * 1024;
+
+  uint32_t getFreeHeap() const { return freeHeap; }
+  uint32_t getMaxAllocHeap() const { return maxAllocHeap; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,35 @@
+#pragma once
+// Host stand-in for the e-ink panel driver: the frame buffer without the panel
+
+#include <cstdint>
+#include <cstring>
+
+class EInkDisplay {
+ public:
+  static constexpr uint16_t DISPLAY_WIDTH = 800;
+  static constexpr uint16_t DISPLAY_HEIGHT = 480;
+  static constexpr uint16_t DISPLAY_WIDTH_BYTES = DISPLAY_WIDTH / 8;
+  static constexpr uint32_t BUFFER_SIZE = DISPLAY_WIDTH_BYTES * DISPLAY_HEIGHT;
+
+  enum RefreshMode { FULL_REFRESH, HALF_REFRESH, FAST_REFRESH };
+
+  void begin() {}
+  void deepSleep() {}
+  uint8_t* getFrameBuffer() { return frameBuffer; }
+  void clearScreen(const uint8_t color = 0xFF) { memset(frameBuffer, color, BUFFER_SIZE); }
+  void displayBuffer(RefreshMode = FAST_REFRESH) {}
+  void displayGrayBuffer() {}
+  void copyGrayscaleLsbBuffers(const uint8_t*) {}
+  void copyGrayscaleMsbBuffers(const uint8_t*) {}
+  void cleanupGrayscaleBuffers(const uint8_t*) {}
+  void grayscaleRevert() {}
+  void drawImage(const uint8_t* bitmap, const uint16_t x, const uint16_t y, const uint16_t width,
+                 const uint16_t height) {
+    for (uint16_t row = 0; row < height && y + row < DISPLAY_HEIGHT; row++) {
+      memcpy(frameBuffer + (y + row) * DISPLAY_WIDTH_BYTES + x / 8, bitmap + row * (width / 8), width / 8);
+    }
+  }
+
+ private:
+  uint8_t frameBuffer[BUFFER_SIZE] = {};
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+unsigned long millis();
+
+// Host stand-in for the device serial port. Logs go to stderr, and only with --verbose. The device format strings
+// assume 32-bit size_t, so the format is not checked.
+class HardwareSerial {
+ public:
+  bool enabled = false;
+
+  int printf(const char* format, ...) {
+    if (!enabled) {
+      return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    const int n = vfprintf(stderr, format, args);
+    va_end(args);
+    return n;
+  }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,50 @@
+#pragma once
+// Host stand-in for the button driver. Nothing is read from pins: a test scripts the presses and releases that the
+// next update() reports.
+
+#include <cstdint>
+
+class InputManager {
+ public:
+  static constexpr uint8_t BTN_BACK = 0;
+  static constexpr uint8_t BTN_CONFIRM = 1;
+  static constexpr uint8_t BTN_LEFT = 2;
+  static constexpr uint8_t BTN_RIGHT = 3;
+  static constexpr uint8_t BTN_UP = 4;
+  static constexpr uint8_t BTN_DOWN = 5;
+  static constexpr uint8_t BTN_POWER = 6;
+
+  void begin() {}
+
+  // Changes reported by the next update(). A release reports heldTime from getHeldTime().
+  void press(const uint8_t button) { nextPressed |= 1 << button; }
+  void release(const uint8_t button, const unsigned long heldTime) {
+    nextReleased |= 1 << button;
+    nextHeldTime = heldTime;
+  }
+
+  void update() {
+    pressed = nextPressed;
+    released = nextReleased;
+    state = (state | pressed) & ~released;
+    heldTime = released ? nextHeldTime : 0;
+    nextPressed = 0;
+    nextReleased = 0;
+  }
+
+  bool wasPressed(const uint8_t button) const { return pressed & (1 << button); }
+  bool wasReleased(const uint8_t button) const { return released & (1 << button); }
+  bool isPressed(const uint8_t button) const { return state & (1 << button); }
+  bool wasAnyPressed() const { return pressed != 0; }
+  bool wasAnyReleased() const { return released != 0; }
+  unsigned long getHeldTime() const { return heldTime; }
+
+ private:
+  uint8_t state = 0;
+  uint8_t pressed = 0;
+  uint8_t released = 0;
+  uint8_t nextPressed = 0;
+  uint8_t nextReleased = 0;
+  unsigned long heldTime = 0;
+  unsigned long nextHeldTime = 0;
+};
@@ -0,0 +1,270 @@
+#include "SDCardManager.h"
+
+#include <HardwareSerial.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+SDCardManager SdMan;
+
+namespace {
+// Bumped by anything that can change the size of a file, so that open files know when to ask the host again
+uint64_t sizeChanges = 0;
+}  // namespace
+
+struct FsFile::State {
+  std::string hostPath;
+  FILE* fp = nullptr;
+  bool isDir = false;
+  // Directory entries, listed in name order so that the output does not depend on the host file system
+  std::vector<std::string> entries;
+  size_t nextEntry = 0;
+  // stdio needs a seek between reading and writing the same stream
+  bool lastWrite = false;
+  // Size as of sizeChanges == sizeChecked, available() asks for it before every read of a parser loop
+  uint64_t size = 0;
+  uint64_t sizeChecked = UINT64_MAX;
+
+  void switchTo(const bool write) {
+    if (lastWrite != write) fseeko(fp, 0, SEEK_CUR);
+    lastWrite = write;
+  }
+
+  ~State() {
+    if (fp) fclose(fp);
+  }
+};
+
+FsFile FsFile::openHost(const std::string& hostPath, const int oflag) {
+  FsFile file;
+  std::error_code ec;
+  if (fs::is_directory(hostPath, ec)) {
+    file.state = std::make_shared<State>();
+    file.state->hostPath = hostPath;
+    file.state->isDir = true;
+    for (const auto& entry : fs::directory_iterator(hostPath, ec)) {
+      file.state->entries.push_back(entry.path().filename().string());
+    }
+    std::sort(file.state->entries.begin(), file.state->entries.end());
+    return file;
+  }
+
+  const bool exists = fs::exists(hostPath, ec);
+  if ((!exists && !(oflag & O_CREAT)) || (exists && (oflag & O_CREAT) && (oflag & O_EXCL))) {
+    return file;
+  }
+  const char* mode = "rb";
+  if ((oflag & O_ACCMODE) != O_RDONLY) {
+    mode = (!exists || (oflag & O_TRUNC)) ? "w+b" : "r+b";
+  }
+  if ((oflag & O_ACCMODE) != O_RDONLY) {
+    sizeChanges++;
+  }
+  FILE* fp = fopen(hostPath.c_str(), mode);
+  if (!fp) {
+    return file;
+  }
+  file.state = std::make_shared<State>();
+  file.state->hostPath = hostPath;
+  file.state->fp = fp;
+  if (oflag & O_APPEND) {
+    fseek(fp, 0, SEEK_END);
+  }
+  return file;
+}
+
+bool FsFile::isDirectory() const { return state && state->isDir; }
+
+int FsFile::read(void* buffer, const size_t count) {
+  if (!state || !state->fp) return -1;
+  if (onTransfer) onTransfer(count, false);
+  state->switchTo(false);
+  return static_cast<int>(fread(buffer, 1, count, state->fp));
+}
+
+int FsFile::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int FsFile::available() const {
+  if (!state || !state->fp) return 0;
+  return static_cast<int>(size() - position());
+}
+
+size_t FsFile::write(const uint8_t b) { return write(&b, 1); }
+
+size_t FsFile::write(const uint8_t* buffer, const size_t size) {
+  if (!state || !state->fp) return 0;
+  if (onTransfer) onTransfer(size, true);
+  state->switchTo(true);
+  sizeChanges++;
+  return fwrite(buffer, 1, size, state->fp);
+}
+
+bool FsFile::seek(const uint64_t position) {
+  // Like SdFat, seeking past the end fails
+  if (!state || !state->fp || position > size()) return false;
+  return fseeko(state->fp, static_cast<off_t>(position), SEEK_SET) == 0;
+}
+
+bool FsFile::seekCur(const int64_t offset) {
+  if (!state || !state->fp) return false;
+  const int64_t target = static_cast<int64_t>(position()) + offset;
+  return target >= 0 && seek(static_cast<uint64_t>(target));
+}
+
+uint64_t FsFile::position() const {
+  if (!state || !state->fp) return 0;
+  return static_cast<uint64_t>(ftello(state->fp));
+}
+
+uint64_t FsFile::size() const {
+  if (!state || !state->fp) return 0;
+  if (state->sizeChecked != sizeChanges) {
+    fflush(state->fp);
+    struct stat status = {};
+    state->size = fstat(fileno(state->fp), &status) == 0 ? static_cast<uint64_t>(status.st_size) : 0;
+    state->sizeChecked = sizeChanges;
+  }
+  return state->size;
+}
+
+bool FsFile::truncate(const uint64_t length) {
+  if (!state || !state->fp) return false;
+  fflush(state->fp);
+  sizeChanges++;
+  std::error_code ec;
+  fs::resize_file(state->hostPath, length, ec);
+  return !ec && (position() <= length || seek(length));
+}
+
+bool FsFile::sync() {
+  if (!state || !state->fp || fflush(state->fp) != 0) return false;
+  if (onSync) onSync(state->hostPath);
+  return true;
+}
+
+bool FsFile::close() {
+  state.reset();
+  return true;
+}
+
+bool FsFile::rename(const char* newPath) {
+  if (!state) return false;
+  if (state->fp) fflush(state->fp);
+  const std::string target = SdMan.hostPath(newPath);
+  std::error_code ec;
+  fs::rename(state->hostPath, target, ec);
+  if (ec) return false;
+  state->hostPath = target;
+  return true;
+}
+
+size_t FsFile::getName(char* name, const size_t size) const {
+  if (!state || size == 0) return 0;
+  const std::string fileName = fs::path(state->hostPath).filename().string();
+  const size_t n = std::min(fileName.size(), size - 1);
+  memcpy(name, fileName.data(), n);
+  name[n] = '\0';
+  return n;
+}
+
+bool FsFile::getModifyDateTime(uint16_t* date, uint16_t* time) const {
+  if (!state) return false;
+  std::error_code ec;
+  const auto modified = fs::last_write_time(state->hostPath, ec);
+  if (ec) return false;
+  // FAT stores local time with two second resolution
+  const auto since = std::chrono::duration_cast<std::chrono::seconds>(modified - fs::file_time_type::clock::now());
+  const std::time_t seconds = std::time(nullptr) + since.count();
+  std::tm local{};
+  localtime_r(&seconds, &local);
+  *date = static_cast<uint16_t>((local.tm_year - 80) << 9 | (local.tm_mon + 1) << 5 | local.tm_mday);
+  *time = static_cast<uint16_t>(local.tm_hour << 11 | local.tm_min << 5 | local.tm_sec / 2);
+  return true;
+}
+
+FsFile FsFile::openNextFile() {
+  if (!state || !state->isDir || state->nextEntry >= state->entries.size()) return {};
+  return openHost(state->hostPath + "/" + state->entries[state->nextEntry++], O_RDONLY);
+}
+
+void SDCardManager::setRoot(std::string hostRoot) {
+  while (hostRoot.size() > 1 && hostRoot.back() == '/') {
+    hostRoot.pop_back();
+  }
+  root = std::move(hostRoot);
+}
+
+std::string SDCardManager::hostPath(const std::string& path) const {
+  if (path.empty() || path[0] != '/') return root + "/" + path;
+  return root + path;
+}
+
+FsFile SDCardManager::open(const char* path, const int oflag) { return FsFile::openHost(hostPath(path), oflag); }
+
+bool SDCardManager::openFileForRead(const char* moduleName, const char* path, FsFile& file) {
+  file = open(path, O_RDONLY);
+  if (!file || file.isDirectory()) {
+    Serial.printf("[%lu] [%s] File does not exist: %s\n", millis(), moduleName, path);
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+bool SDCardManager::openFileForRead(const char* moduleName, const std::string& path, FsFile& file) {
+  return openFileForRead(moduleName, path.c_str(), file);
+}
+
+bool SDCardManager::openFileForWrite(const char* moduleName, const char* path, FsFile& file) {
+  file = open(path, O_RDWR | O_CREAT | O_TRUNC);
+  if (!file) {
+    Serial.printf("[%lu] [%s] Failed to open file for writing: %s\n", millis(), moduleName, path);
+    return false;
+  }
+  return true;
+}
+
+bool SDCardManager::openFileForWrite(const char* moduleName, const std::string& path, FsFile& file) {
+  return openFileForWrite(moduleName, path.c_str(), file);
+}
+
+bool SDCardManager::exists(const char* path) {
+  std::error_code ec;
+  return fs::exists(hostPath(path), ec);
+}
+
+bool SDCardManager::mkdir(const char* path, const bool pFlag) {
+  std::error_code ec;
+  if (pFlag) {
+    fs::create_directories(hostPath(path), ec);
+  } else {
+    fs::create_directory(hostPath(path), ec);
+  }
+  return !ec;
+}
+
+bool SDCardManager::remove(const char* path) {
+  std::error_code ec;
+  return fs::is_regular_file(hostPath(path), ec) && fs::remove(hostPath(path), ec);
+}
+
+bool SDCardManager::rmdir(const char* path) {
+  std::error_code ec;
+  return fs::is_directory(hostPath(path), ec) && fs::remove(hostPath(path), ec);
+}
+
+bool SDCardManager::removeDir(const char* path) {
+  std::error_code ec;
+  return fs::remove_all(hostPath(path), ec) != static_cast<std::uintmax_t>(-1) && !ec;
+}
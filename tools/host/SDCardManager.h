@@ -0,0 +1,32 @@
+#pragma once
+// Host stand-in for the SD card manager. Card paths ("/.crosspoint/...") are resolved against a host directory that
+// holds a copy of the card, or the mounted card itself.
+
+#include <string>
+
+#include "SdFat.h"
+
+class SDCardManager {
+  std::string root;
+
+ public:
+  // Directory the card root maps to
+  void setRoot(std::string hostRoot);
+  std::string hostPath(const std::string& path) const;
+
+  bool begin() { return true; }
+  bool ready() const { return true; }
+
+  FsFile open(const char* path, int oflag = O_RDONLY);
+  bool openFileForRead(const char* moduleName, const char* path, FsFile& file);
+  bool openFileForRead(const char* moduleName, const std::string& path, FsFile& file);
+  bool openFileForWrite(const char* moduleName, const char* path, FsFile& file);
+  bool openFileForWrite(const char* moduleName, const std::string& path, FsFile& file);
+  bool exists(const char* path);
+  bool mkdir(const char* path, bool pFlag = true);
+  bool remove(const char* path);
+  bool rmdir(const char* path);
+  bool removeDir(const char* path);
+};
+
+extern SDCardManager SdMan;
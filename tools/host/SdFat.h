@@ -0,0 +1,65 @@
+#pragma once
+// Host stand-in for the SdFat file class, backed by stdio and std::filesystem. Like SdFat, it brings in the Arduino
+// core.
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+#define O_RDONLY 0x00
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_ACCMODE 0x03
+#define O_APPEND 0x08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_EXCL 0x40
+
+class FsFile : public Print {
+  struct State;
+  // Shared like the device handle, where copies refer to the same open file
+  std::shared_ptr<State> state;
+
+ public:
+  FsFile() = default;
+  // For tests: called with the host path after every successful sync(), e.g. to simulate a reset once a file is on
+  // the card
+  static inline std::function<void(const std::string& hostPath)> onSync;
+  // For tests: called with the byte count before every read and write, e.g. to count card traffic or add latency
+  static inline std::function<void(size_t count, bool write)> onTransfer;
+
+  // Opens hostPath, a path on the host file system
+  static FsFile openHost(const std::string& hostPath, int oflag);
+
+  explicit operator bool() const { return static_cast<bool>(state); }
+  bool isOpen() const { return static_cast<bool>(state); }
+  bool isDirectory() const;
+
+  int read(void* buffer, size_t count);
+  int read();
+  int available() const;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+
+  bool seek(uint64_t position);
+  bool seekCur(int64_t offset);
+  bool seekSet(uint64_t position) { return seek(position); }
+  uint64_t position() const;
+  uint64_t curPosition() const { return position(); }
+  uint64_t size() const;
+  uint64_t fileSize() const { return size(); }
+  bool truncate(uint64_t length);
+  bool sync();
+  void flush() override { sync(); }
+  bool close();
+
+  bool rename(const char* newPath);
+  size_t getName(char* name, size_t size) const;
+  bool getModifyDateTime(uint16_t* date, uint16_t* time) const;
+  FsFile openNextFile();
+};